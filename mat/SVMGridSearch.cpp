@@ -0,0 +1,391 @@
+#include "SVMGridSearch.h"
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+void print_null( const char* ) {}
+
+/// Ordering of scores: more folds evaluated first, then smaller error and
+/// finally simpler models (fewer components, smaller C)
+struct ResultLess
+{
+	bool operator()( const SVMGridSearch::Result& a, const SVMGridSearch::Result& b ) const
+	{
+		if( a.folds != b.folds ) return a.folds > b.folds;
+		if( a.error != b.error ) return a.error < b.error;
+		if( a.params.ncomp != b.params.ncomp ) return a.params.ncomp < b.params.ncomp;
+		return a.params.C < b.params.C;
+	}
+};
+
+/// Ordering of indices into a score array
+struct IndexLess
+{
+	const std::vector<SVMGridSearch::Result>& scores;
+	IndexLess( const std::vector<SVMGridSearch::Result>& s ): scores(s) {}
+	bool operator()( int a, int b ) const
+	{
+		return ResultLess()( scores[a], scores[b] );
+	}
+};
+
+/// Ordering of candidates by ncomp, class weights and finally C
+struct CandidateLess
+{
+	const std::vector<SVMGridSearch::Params>& grid;
+	CandidateLess( const std::vector<SVMGridSearch::Params>& g ): grid(g) {}
+	bool operator()( int a, int b ) const
+	{
+		const SVMGridSearch::Params& p = grid[a];
+		const SVMGridSearch::Params& q = grid[b];
+		if( p.ncomp   != q.ncomp   ) return p.ncomp   < q.ncomp;
+		if( p.weight1 != q.weight1 ) return p.weight1 < q.weight1;
+		if( p.weight2 != q.weight2 ) return p.weight2 < q.weight2;
+		return p.C < q.C;
+	}
+};
+
+} // anonymous namespace
+
+SVMGridSearch::SVMGridSearch()
+: m_m(0), m_n(0), m_nA(0), m_nB(0),
+  m_numFolds(10),
+  m_halving(false),
+  m_progress(NULL),
+  m_userData(NULL),
+  m_workDone(0),
+  m_workTotal(0),
+  m_canceled(false)
+{
+}
+
+void SVMGridSearch::setup_problem( int m, int n, const int* labels, const double* data )
+{
+	m_m = m;
+	m_n = n;
+	m_labels.assign( labels, labels + m );
+	m_data.assign( data, data + (size_t)m*n );
+
+	m_nA = (int)std::count( m_labels.begin(), m_labels.end(), -1 );
+	m_nB = m - m_nA;
+
+	m_results.clear();
+}
+
+void SVMGridSearch::set_grid( const std::vector<double>& C,
+                              const std::vector<double>& weight1,
+                              const std::vector<double>& weight2,
+                              const std::vector<int>& ncomp )
+{
+	m_grid.clear();
+	for( size_t l=0; l < ncomp.size(); ++l )
+		for( size_t i=0; i < C.size(); ++i )
+			for( size_t j=0; j < weight1.size(); ++j )
+				for( size_t k=0; k < weight2.size(); ++k )
+				{
+					Params p;
+					p.C       = C[i];
+					p.weight1 = weight1[j];
+					p.weight2 = weight2[k];
+					p.ncomp   = ncomp[l];
+					m_grid.push_back( p );
+				}
+}
+
+void SVMGridSearch::set_default_grid()
+{
+	std::vector<double> C, weight1, weight2;
+	std::vector<int> ncomp;
+	get_default_grid( C, weight1, weight2, ncomp );
+	set_grid( C, weight1, weight2, ncomp );
+}
+
+void SVMGridSearch::get_default_grid( std::vector<double>& C,
+                                      std::vector<double>& weight1,
+                                      std::vector<double>& weight2,
+                                      std::vector<int>& ncomp ) const
+{
+	double wA = 100. / (double)std::max(m_nA,1),
+	       wB = 100. / (double)std::max(m_nB,1);
+
+	C       = log_range( 0.001, 1., 4 );
+	weight1 = log_range( wA/4., wA*4., 5 );
+	weight2.assign( 1, wB );
+	ncomp.clear();
+	for( int i=1; i <= m_n; ++i )
+		ncomp.push_back( i );
+}
+
+std::vector<double> SVMGridSearch::log_range( double lo, double hi, int n )
+{
+	std::vector<double> v( std::max(n,1), lo );
+	for( int i=1; i < n; ++i )
+		v[i] = lo * pow( hi/lo, i/(double)(n-1) );
+	return v;
+}
+
+bool SVMGridSearch::train( const Params& p, SVMTrain& svm ) const
+{
+	std::vector<int> rows( m_m );
+	for( int i=0; i < m_m; ++i )
+		rows[i] = i;
+	return train( p, rows, svm );
+}
+
+bool SVMGridSearch::train( const Params& p, const std::vector<int>& rows, SVMTrain& svm ) const
+{
+	svm.clear();
+
+	svm_parameter param = svm.params();
+	param.svm_type = C_SVC;
+	param.kernel_type = LINEAR;
+	param.C = p.C;
+	svm.set_params( param );
+	svm.add_weight( -1, p.weight1 );
+	svm.add_weight( +1, p.weight2 );
+
+	// copy leading ncomp columns of selected rows
+	std::vector<int>    labels( rows.size() );
+	std::vector<double> data( rows.size() * p.ncomp );
+	for( size_t r=0; r < rows.size(); ++r )
+	{
+		labels[r] = m_labels[rows[r]];
+		std::copy( &m_data[(size_t)rows[r]*m_n], &m_data[(size_t)rows[r]*m_n] + p.ncomp,
+		           &data[r*p.ncomp] );
+	}
+
+	svm.setup_problem( (int)rows.size(), p.ncomp, &labels[0], &data[0] );
+	return svm.train();
+}
+
+void SVMGridSearch::evaluate( const std::vector<int>& candidates, int foldBegin, int foldEnd )
+{
+	// Candidates which differ only in C are trained in order of increasing C
+	// on the same SVMTrain, warm started from the previous solution (see
+	// SVMTrain::retrain()). Such a C path on one fold is a single task.
+	std::vector<int> sorted( candidates );
+	std::sort( sorted.begin(), sorted.end(), CandidateLess(m_grid) );
+
+	std::vector<int> pathStart;
+	for( size_t c=0; c < sorted.size(); ++c )
+	{
+		const Params& p = m_grid[sorted[c]];
+		const Params& q = m_grid[sorted[c ? c-1 : 0]];
+		if( c==0 || p.ncomp != q.ncomp || p.weight1 != q.weight1 || p.weight2 != q.weight2 )
+			pathStart.push_back( (int)c );
+	}
+	pathStart.push_back( (int)sorted.size() );
+
+	int numPaths = (int)pathStart.size() - 1;
+	int numFolds = foldEnd - foldBegin;
+	int numTasks = numPaths * numFolds;
+
+	#pragma omp parallel for schedule(dynamic)
+	for( int t=0; t < numTasks; ++t )
+	{
+		int path = t / numFolds,
+		    fold = foldBegin + t % numFolds;
+
+		bool canceled;
+		#pragma omp critical (SVMGridSearchProgress)
+		canceled = m_canceled;
+		if( canceled )
+			continue;
+
+		std::vector<int> trainRows, testRows;
+		int nA=0, nB=0;
+		for( int i=0; i < m_m; ++i )
+			if( m_fold[i] == fold )
+				testRows.push_back( i );
+			else
+			{
+				trainRows.push_back( i );
+				if( m_labels[i] < 0 ) nA++; else nB++;
+			}
+
+		SVMTrain svm;
+		bool trained = false;
+		for( int c=pathStart[path]; c < pathStart[path+1]; ++c )
+		{
+			int cand = sorted[c];
+			const Params& p = m_grid[cand];
+
+			// A training set with a single class (possible for tiny groups)
+			// predicts that class, otherwise an SVM is trained.
+			if( nA > 0 && nB > 0 )
+				trained = trained ? svm.retrain( p.C ) : train( p, trainRows, svm );
+
+			int errA=0, errB=0;
+			for( size_t r=0; r < testRows.size(); ++r )
+			{
+				int i = testRows[r];
+				double label = trained ? svm.predict( &m_data[(size_t)i*m_n] )
+				                       : (nA > 0 ? -1. : +1.);
+				if( (label < 0) != (m_labels[i] < 0) )
+				{
+					if( m_labels[i] < 0 ) errA++; else errB++;
+				}
+			}
+
+			m_errors[2*(cand*m_numFolds + fold)  ] = errA;
+			m_errors[2*(cand*m_numFolds + fold)+1] = errB;
+		}
+
+		#pragma omp critical (SVMGridSearchProgress)
+		{
+			m_workDone += pathStart[path+1] - pathStart[path];
+			if( m_progress && !m_progress( m_workDone / (double)m_workTotal, m_userData ) )
+				m_canceled = true;
+		}
+	}
+
+	for( size_t c=0; c < candidates.size(); ++c )
+		m_foldsDone[candidates[c]] = foldEnd;
+}
+
+SVMGridSearch::Result SVMGridSearch::score( int candidate ) const
+{
+	Result res;
+	res.params = m_grid[candidate];
+	res.folds  = m_foldsDone[candidate];
+
+	// sum up errors and class sizes over evaluated folds
+	int errA=0, errB=0, nA=0, nB=0;
+	for( int i=0; i < m_m; ++i )
+		if( m_fold[i] < res.folds )
+		{
+			if( m_labels[i] < 0 ) nA++; else nB++;
+		}
+	for( int f=0; f < res.folds; ++f )
+	{
+		errA += m_errors[2*(candidate*m_numFolds + f)  ];
+		errB += m_errors[2*(candidate*m_numFolds + f)+1];
+	}
+
+	double rateA = nA ? errA / (double)nA : 0.,
+	       rateB = nB ? errB / (double)nB : 0.;
+	res.error    = (nA && nB) ? 0.5*(rateA + rateB) : (rateA + rateB);
+	res.accuracy = (nA+nB) ? 1. - (errA+errB) / (double)(nA+nB) : 0.;
+	return res;
+}
+
+bool SVMGridSearch::run()
+{
+	m_results.clear();
+
+	// sanity checks
+	if( m_nA==0 || m_nB==0 )
+	{
+		m_errmsg = "Grid search requires instances of both classes -1 and +1!";
+		std::cerr << "Error (SVMGridSearch): " << m_errmsg << std::endl;
+		return false;
+	}
+	if( m_grid.empty() )
+	{
+		m_errmsg = "Empty parameter grid!";
+		std::cerr << "Error (SVMGridSearch): " << m_errmsg << std::endl;
+		return false;
+	}
+	for( size_t c=0; c < m_grid.size(); ++c )
+		if( m_grid[c].ncomp < 1 || m_grid[c].ncomp > m_n )
+		{
+			m_errmsg = "Number of components in grid exceeds number of columns!";
+			std::cerr << "Error (SVMGridSearch): " << m_errmsg << std::endl;
+			return false;
+		}
+
+	m_numFolds = std::max( 2, std::min( m_numFolds, m_m ) );
+
+	// stratified fold assignment, class A and B instances are dealt out
+	// round-robin such that all folds have (nearly) the same class ratio
+	m_fold.resize( m_m );
+	for( int i=0, a=0, b=m_nA; i < m_m; ++i )
+		m_fold[i] = (m_labels[i] < 0 ? a++ : b++) % m_numFolds;
+
+	int numCandidates = (int)m_grid.size();
+	m_errors.assign( 2*numCandidates*m_numFolds, 0 );
+	m_foldsDone.assign( numCandidates, 0 );
+
+	std::vector<int> alive( numCandidates );
+	for( int c=0; c < numCandidates; ++c )
+		alive[c] = c;
+
+	// initial fold budget, halved once for each halving round
+	int budget = m_numFolds;
+	if( m_halving )
+		for( int n=numCandidates; n > 1 && budget > 1; n=(n+1)/2 )
+			budget /= 2;
+
+	// total work for progress reporting, same schedule as below
+	m_workDone  = 0;
+	m_workTotal = 0;
+	m_canceled  = false;
+	for( int n=numCandidates, done=0, b=budget; ; )
+	{
+		m_workTotal += n * (b - done);
+		done = b;
+		if( done >= m_numFolds )
+			break;
+		b = std::min( 2*b, m_numFolds );
+		if( n > 1 )
+			n = (n+1)/2;
+	}
+
+	// disable libsvm console output
+	svm_set_print_string_function( &print_null );
+
+	int foldsDone = 0;
+	for( ;; )
+	{
+		evaluate( alive, foldsDone, budget );
+		if( m_canceled )
+		{
+			svm_set_print_string_function( NULL );
+			m_errmsg = "Canceled by user!";
+			return false;
+		}
+		foldsDone = budget;
+		if( foldsDone >= m_numFolds )
+			break;
+		budget = std::min( 2*budget, m_numFolds );
+		if( alive.size() <= 1 )
+			continue;
+
+		// keep better half
+		std::vector<Result> scores;
+		for( size_t c=0; c < alive.size(); ++c )
+			scores.push_back( score( alive[c] ) );
+		std::vector<int> order( alive.size() );
+		for( size_t c=0; c < order.size(); ++c )
+			order[c] = (int)c;
+		std::stable_sort( order.begin(), order.end(), IndexLess(scores) );
+
+		std::vector<int> survivors( (alive.size()+1)/2 );
+		for( size_t c=0; c < survivors.size(); ++c )
+			survivors[c] = alive[order[c]];
+		std::sort( survivors.begin(), survivors.end() );
+		alive.swap( survivors );
+	}
+
+	// restore default libsvm console output
+	svm_set_print_string_function( NULL );
+
+	for( int c=0; c < numCandidates; ++c )
+		m_results.push_back( score( c ) );
+	std::stable_sort( m_results.begin(), m_results.end(), ResultLess() );
+
+	return true;
+}
+
+void SVMGridSearch::print_table( std::ostream& os ) const
+{
+	os << "C,weight1,weight2,ncomp,folds,error,accuracy" << std::endl;
+	for( size_t i=0; i < m_results.size(); ++i )
+	{
+		const Result& r = m_results[i];
+		os << r.params.C << "," << r.params.weight1 << "," << r.params.weight2 << ","
+		   << r.params.ncomp << "," << r.folds << ","
+		   << r.error << "," << r.accuracy << std::endl;
+	}
+}
@@ -0,0 +1,132 @@
+#ifndef SVMGRIDSEARCH_H
+#define SVMGRIDSEARCH_H
+
+#include "SVMTrain.h"
+#include <string>
+#include <vector>
+#include <iostream>
+
+/// Hyperparameter search for a linear two-class C-SVC (on top of SVMTrain)
+///
+/// Candidates are all combinations of the given C, class weight and number of
+/// components values, where a candidate with ncomp components only sees the
+/// first ncomp columns of the instance matrix (e.g. leading PCA coefficients).
+/// Each candidate is scored by stratified k-fold cross validation, all
+/// (candidate,fold) pairs are trained in parallel via OpenMP, where candidates
+/// differing only in C are trained as one warm started path. The score is the
+/// balanced error rate, i.e. the mean of the two per-class error rates, which
+/// is not dominated by the larger class as plain accuracy would be.
+///
+/// With successive halving enabled, all candidates are first scored on a
+/// single fold, then only the better half is evaluated on twice as many folds
+/// and so on until the remaining candidates are scored on all folds.
+class SVMGridSearch
+{
+public:
+	/// Hyperparameters of a single candidate
+	struct Params
+	{
+		double C;       ///< cost parameter
+		double weight1; ///< weight of class -1 (class A)
+		double weight2; ///< weight of class +1 (class B)
+		int    ncomp;   ///< number of leading columns used
+	};
+
+	/// Cross validation score of a single candidate
+	struct Result
+	{
+		Params params;
+		int    folds;    ///< number of folds evaluated
+		double error;    ///< balanced error rate on evaluated folds
+		double accuracy; ///< fraction of correctly predicted instances
+	};
+
+	SVMGridSearch();
+
+	/// Setup problem with m labels (-1 or +1) and m*n data entries (row-major)
+	void setup_problem( int m, int n, const int* labels, const double* data );
+
+	/// Set grid, all combinations of the given values are evaluated
+	void set_grid( const std::vector<double>& C,
+	               const std::vector<double>& weight1,
+	               const std::vector<double>& weight2,
+	               const std::vector<int>& ncomp );
+	/// Default grid (after setup_problem()): C in 10^-3..1, class A weight
+	/// 1/4..4 times and class B weight equal to the balanced weights 100/nA
+	/// and 100/nB (see TraitDialog::defaultWeights()), all ncomp in 1..n.
+	/// Note that the effective cost per class is C times class weight and
+	/// that libsvm training becomes very slow for large effective costs.
+	void set_default_grid();
+	/// Get values of default grid, e.g. to replace only some of them
+	void get_default_grid( std::vector<double>& C,
+	                       std::vector<double>& weight1,
+	                       std::vector<double>& weight2,
+	                       std::vector<int>& ncomp ) const;
+
+	/// Number of cross validation folds (default 10, at most m)
+	void set_num_folds( int k ) { m_numFolds = k; }
+	int  num_folds() const { return m_numFolds; }
+
+	/// Enable successive halving (default off, i.e. exhaustive grid search)
+	void set_successive_halving( bool enable ) { m_halving = enable; }
+
+	/// Progress callback with progress in [0,1], return false to cancel.
+	/// Called from the OpenMP worker threads, but never concurrently.
+	typedef bool (*ProgressCallback)( double progress, void* userData );
+	void set_progress_callback( ProgressCallback f, void* userData=NULL )
+	{
+		m_progress = f;
+		m_userData = userData;
+	}
+
+	/// Score all candidates, if false is returned check getErrmsg()
+	bool run();
+
+	/// Scores of all candidates sorted best first (after run())
+	const std::vector<Result>& results() const { return m_results; }
+	/// Best candidate (after run())
+	const Result& best() const { assert(!m_results.empty()); return m_results[0]; }
+
+	/// Train given candidate on all instances
+	bool train( const Params& p, SVMTrain& svm ) const;
+
+	/// Write score table as CSV, one row per candidate sorted best first
+	void print_table( std::ostream& os ) const;
+
+	std::string getErrmsg() const { return m_errmsg; }
+
+	/// n logarithmically spaced values in [lo,hi]
+	static std::vector<double> log_range( double lo, double hi, int n );
+
+protected:
+	/// Train candidate on given subset of instances
+	bool train( const Params& p, const std::vector<int>& rows, SVMTrain& svm ) const;
+	/// Evaluate candidates on folds [foldBegin,foldEnd)
+	void evaluate( const std::vector<int>& candidates, int foldBegin, int foldEnd );
+	/// Score of candidate on its folds evaluated so far
+	Result score( int candidate ) const;
+
+private:
+	int m_m, m_n;
+	int m_nA, m_nB;
+	std::vector<int>    m_labels;
+	std::vector<double> m_data;
+
+	int  m_numFolds;
+	bool m_halving;
+	std::vector<int> m_fold; ///< fold index per instance
+
+	std::vector<Params> m_grid;
+	std::vector<int>    m_errors;    ///< errors (class A, class B) per candidate and fold
+	std::vector<int>    m_foldsDone; ///< number of evaluated folds per candidate
+
+	ProgressCallback m_progress;
+	void*            m_userData;
+	int              m_workDone, m_workTotal; ///< in (candidate,fold) units
+	bool             m_canceled;
+
+	std::vector<Result> m_results;
+	std::string m_errmsg;
+};
+
+#endif // SVMGRIDSEARCH_H
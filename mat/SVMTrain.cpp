@@ -1,5 +1,7 @@
 #include "SVMTrain.h"
 #include <iostream>
+#include <algorithm>
+#include <cmath>
 #include <cstdlib>   // malloc()
 
 SVMTrain::SVMTrain()
@@ -14,6 +16,8 @@ SVMTrain::SVMTrain()
 	m_ncols   = 0;
 	m_sv      = NULL;
 	m_sv_coef = NULL;
+	m_b       = 0.0;
+	m_linearSolver = true;
 }
 
 SVMTrain::~SVMTrain()
@@ -39,6 +43,10 @@ void SVMTrain::clear()
 	free( m_sv_coef ); m_sv_coef = NULL;
 	m_ncols = 0;
 
+	m_w.clear();
+	m_b = 0.0;
+	m_alpha.clear();
+
 	m_errmsg = "";
 	m_status = Uninitialized;
 }
@@ -172,7 +180,13 @@ bool SVMTrain::train()
 		return false;
 
 	// svm training
-	m_model = svm_train( &m_prob, &m_param );
+	if( use_linear_solver() )
+		m_model = train_linear();
+	else
+	{
+		m_model = svm_train( &m_prob, &m_param );
+		m_alpha.clear();
+	}
 	assert( m_model );
 
 	////////////////////////////////////////////////////////////////////
@@ -198,10 +212,285 @@ bool SVMTrain::train()
 	for( int r=0; r < m_model->l; ++r )
 		m_sv_coef[r] = m_model->sv_coef[ 0 ][r];
 
+	// reconstruct hyperplane w = SV'*sv_coef and b = -rho from libsvm model,
+	// train_linear() already provides these directly
+	if( m_param.kernel_type == LINEAR && m_alpha.empty() && m_model->nr_class == 2 )
+	{
+		m_w.assign( m_ncols, 0.0 );
+		for( int r=0; r < m_model->l; ++r )
+			for( int c=0; c < m_ncols; ++c )
+				m_w[c] += m_sv[r*m_ncols+c] * m_sv_coef[r];
+		m_b = - m_model->rho[0];
+
+		if( m_model->label[0] == -1 ) {
+			// see libsvm faq for rationale here
+			for( int c=0; c < m_ncols; ++c )
+				m_w[c] *= -1.;
+			m_b *= -1.;
+		}
+	}
+
 	m_status = Trained;
 	return true;
 }
 
+bool SVMTrain::retrain( double C )
+{
+	if( m_status != Trained )
+	{
+		m_errmsg = "You have to call SDMTrain::train() before you can re-train!\n";
+		std::cerr << "Error (SVMTrain): " << m_errmsg << std::endl;
+		return false;
+	}
+
+	// warm start: scaling the previous dual solution keeps it feasible for
+	// the new box constraints 0 <= alpha_i <= C*weight_i and for y'alpha = 0
+	if( C > 0. )
+		for( size_t i=0; i < m_alpha.size(); ++i )
+			m_alpha[i] *= C / m_param.C;
+	m_param.C = C;
+
+	svm_free_and_destroy_model( &m_model ); m_model=NULL;
+	free( m_sv );      m_sv = NULL;
+	free( m_sv_coef ); m_sv_coef = NULL;
+	m_status = Setup;
+
+	return train();
+}
+
+bool SVMTrain::use_linear_solver() const
+{
+	if( !m_linearSolver || m_param.svm_type != C_SVC || 
+		m_param.kernel_type != LINEAR || m_param.probability )
+		return false;
+
+	// two-class problem with labels -1 and +1 only
+	bool pos=false, neg=false;
+	for( int i=0; i < m_prob.l; ++i )
+		if( m_prob.y[i] == +1. ) pos = true; else
+		if( m_prob.y[i] == -1. ) neg = true; else
+			return false;
+	return pos && neg;
+}
+
+svm_model* SVMTrain::train_linear()
+{
+	// Same dual problem as libsvm C-SVC, i.e. including the offset b:
+	//   min_alpha 1/2 alpha'Q alpha - e'alpha
+	//   s.t. 0 <= alpha_i <= U_i,  y'alpha = 0
+	// with Q_ij = y_i y_j x_i'x_j. Because of the equality constraint two
+	// dual variables are updated at a time, selected by libsvm's second order
+	// working set selection, such that the solution matches svm_train() up to
+	// the stopping tolerance eps. For our small dense problems (one instance
+	// per dataset, few PCA coefficients) Q is computed once in full instead of
+	// via libsvm's kernel cache, and w = sum_i y_i alpha_i x_i directly.
+	const int    l = m_prob.l,
+	             n = m_ncols;
+	const double TAU = 1e-12;
+	const int    max_iter = std::max( 10000000, 100*l );
+
+	// box constraints C*weight, Q and its diagonal
+	std::vector<double> y( l ), U( l ), Q( (size_t)l*l ), QD( l );
+	for( int i=0; i < l; ++i )
+	{
+		y[i] = m_prob.y[i];
+		U[i] = m_param.C;
+		for( int k=0; k < m_param.nr_weight; ++k )
+			if( m_param.weight_label[k] == (int)y[i] )
+				U[i] *= m_param.weight[k];
+	}
+	for( int i=0; i < l; ++i )
+		for( int j=0; j <= i; ++j )
+		{
+			double k_ij = 0.;
+			for( int c=0; c < n; ++c )
+				k_ij += m_prob.x[i][c].value * m_prob.x[j][c].value;
+			Q[(size_t)i*l+j] = Q[(size_t)j*l+i] = y[i]*y[j]*k_ij;
+		}
+	for( int i=0; i < l; ++i )
+		QD[i] = Q[(size_t)i*l+i];
+
+	// initial solution, warm start if available (see retrain())
+	if( (int)m_alpha.size() != l )
+		m_alpha.assign( l, 0.0 );
+	std::vector<double>& alpha = m_alpha;
+	for( int i=0; i < l; ++i )
+		alpha[i] = std::min( std::max( alpha[i], 0.0 ), U[i] );
+
+	// gradient G = Q alpha - e
+	std::vector<double> G( l, -1.0 );
+	for( int i=0; i < l; ++i )
+		if( alpha[i] > 0. )
+			for( int k=0; k < l; ++k )
+				G[k] += Q[(size_t)i*l+k] * alpha[i];
+
+	int iter = 0;
+	for( ; iter < max_iter; ++iter )
+	{
+		// select working set (i,j), see libsvm Solver::select_working_set()
+		double Gmax = -HUGE_VAL, Gmax2 = -HUGE_VAL, obj_diff_min = HUGE_VAL;
+		int i = -1, j = -1;
+		for( int t=0; t < l; ++t )
+			if( y[t] > 0. ) {
+				if( alpha[t] < U[t] && -G[t] >= Gmax ) { Gmax = -G[t]; i = t; }
+			} else {
+				if( alpha[t] > 0.   &&  G[t] >= Gmax ) { Gmax =  G[t]; i = t; }
+			}
+		if( i < 0 )
+			break;
+
+		const double* Q_i = &Q[(size_t)i*l];
+		for( int t=0; t < l; ++t )
+		{
+			double grad_diff, quad_coef;
+			if( y[t] > 0. ) {
+				if( alpha[t] <= 0. ) continue;
+				grad_diff = Gmax + G[t];
+				Gmax2 = std::max( Gmax2, G[t] );
+				quad_coef = QD[i] + QD[t] - 2.0*y[i]*Q_i[t];
+			} else {
+				if( alpha[t] >= U[t] ) continue;
+				grad_diff = Gmax - G[t];
+				Gmax2 = std::max( Gmax2, -G[t] );
+				quad_coef = QD[i] + QD[t] + 2.0*y[i]*Q_i[t];
+			}
+			if( grad_diff > 0. )
+			{
+				double obj_diff = -(grad_diff*grad_diff) / (quad_coef > 0. ? quad_coef : TAU);
+				if( obj_diff <= obj_diff_min ) { j = t; obj_diff_min = obj_diff; }
+			}
+		}
+		if( Gmax + Gmax2 < m_param.eps || j < 0 )
+			break;
+
+		// analytic solution of two variable sub-problem, see Solver::Solve()
+		const double* Q_j = &Q[(size_t)j*l];
+		double alpha_i = alpha[i], alpha_j = alpha[j];
+		if( y[i] != y[j] )
+		{
+			double quad_coef = QD[i] + QD[j] + 2*Q_i[j];
+			double delta = (-G[i]-G[j]) / (quad_coef > 0. ? quad_coef : TAU);
+			double diff = alpha_i - alpha_j;
+			alpha_i += delta;
+			alpha_j += delta;
+			if( diff > 0 ) { if( alpha_j < 0 ) { alpha_j = 0; alpha_i = diff; } }
+			else           { if( alpha_i < 0 ) { alpha_i = 0; alpha_j = -diff; } }
+			if( diff > U[i] - U[j] ) { if( alpha_i > U[i] ) { alpha_i = U[i]; alpha_j = U[i] - diff; } }
+			else                     { if( alpha_j > U[j] ) { alpha_j = U[j]; alpha_i = U[j] + diff; } }
+		}
+		else
+		{
+			double quad_coef = QD[i] + QD[j] - 2*Q_i[j];
+			double delta = (G[i]-G[j]) / (quad_coef > 0. ? quad_coef : TAU);
+			double sum = alpha_i + alpha_j;
+			alpha_i -= delta;
+			alpha_j += delta;
+			if( sum > U[i] ) { if( alpha_i > U[i] ) { alpha_i = U[i]; alpha_j = sum - U[i]; } }
+			else             { if( alpha_j < 0 )    { alpha_j = 0;    alpha_i = sum; } }
+			if( sum > U[j] ) { if( alpha_j > U[j] ) { alpha_j = U[j]; alpha_i = sum - U[j]; } }
+			else             { if( alpha_i < 0 )    { alpha_i = 0;    alpha_j = sum; } }
+		}
+
+		// update gradient
+		double delta_i = alpha_i - alpha[i],
+		       delta_j = alpha_j - alpha[j];
+		alpha[i] = alpha_i;
+		alpha[j] = alpha_j;
+		for( int k=0; k < l; ++k )
+			G[k] += Q_i[k]*delta_i + Q_j[k]*delta_j;
+	}
+	if( iter >= max_iter )
+		std::cerr << "Warning (SVMTrain): Linear solver reached maximum number "
+		             "of iterations!" << std::endl;
+
+	// hyperplane normal
+	std::vector<double> w( n, 0.0 );
+	for( int i=0; i < l; ++i )
+		if( alpha[i] > 0. )
+			for( int c=0; c < n; ++c )
+				w[c] += y[i] * alpha[i] * m_prob.x[i][c].value;
+
+	// offset b = -rho, see libsvm Solver::calculate_rho()
+	double ub = HUGE_VAL, lb = -HUGE_VAL, sum_free = 0.;
+	int nr_free = 0;
+	for( int i=0; i < l; ++i )
+	{
+		double yG = y[i] * G[i];
+		if( alpha[i] >= U[i] ) {
+			if( y[i] < 0. ) ub = std::min( ub, yG ); else lb = std::max( lb, yG );
+		} else if( alpha[i] <= 0. ) {
+			if( y[i] > 0. ) ub = std::min( ub, yG ); else lb = std::max( lb, yG );
+		} else {
+			++nr_free;
+			sum_free += yG;
+		}
+	}
+	double rho = (nr_free > 0) ? sum_free / nr_free : (ub + lb) / 2;
+
+	m_w = w;
+	m_b = -rho;
+
+	// store as libsvm model: class of first instance is label[0] and the
+	// decision function sum_k sv_coef_k x_k'x - rho is positive for label[0],
+	// support vectors are grouped by class
+	svm_model* model = (svm_model*)malloc( sizeof(svm_model) );
+	model->param    = m_param;
+	model->nr_class = 2;
+	model->label    = (int*)malloc( 2*sizeof(int) );
+	model->nSV      = (int*)malloc( 2*sizeof(int) );
+	model->label[0] = (int)y[0];
+	model->label[1] = -model->label[0];
+	model->nSV[0]   = 0;
+	model->nSV[1]   = 0;
+	for( int i=0; i < l; ++i )
+		if( alpha[i] > 0. )
+			model->nSV[ (int)y[i]==model->label[0] ? 0 : 1 ]++;
+	model->l = model->nSV[0] + model->nSV[1];
+
+	model->SV         = (svm_node**)malloc( model->l * sizeof(svm_node*) );
+	model->sv_coef    = (double**)  malloc( sizeof(double*) );
+	model->sv_coef[0] = (double*)   malloc( model->l * sizeof(double) );
+	for( int cls=0, k=0; cls < 2; ++cls )
+		for( int i=0; i < l; ++i )
+			if( alpha[i] > 0. && (int)y[i] == model->label[cls] )
+			{
+				model->SV[k] = m_prob.x[i];
+				model->sv_coef[0][k] = alpha[i] * y[i] * model->label[0];
+				k++;
+			}
+
+	model->rho      = (double*)malloc( sizeof(double) );
+	model->rho[0]   = - m_b * model->label[0];
+	model->probA    = NULL;
+	model->probB    = NULL;
+	model->free_sv  = 0; // SV point into m_x_space
+	return model;
+}
+
+double SVMTrain::predict( const double* x ) const
+{
+	assert( m_status == Trained );
+
+	// dense instance plus "end-of-row" element, see setup_problem()
+	std::vector<svm_node> nodes( m_ncols+1 );
+	for( int c=0; c < m_ncols; ++c ) {
+		nodes[c].index = c + 1;
+		nodes[c].value = x[c];
+	}
+	nodes[m_ncols].index = -1;
+	nodes[m_ncols].value = 0.0;
+
+	return svm_predict( m_model, &nodes[0] );
+}
+
+void SVMTrain::hyperplane( std::vector<double>& w, double& b ) const
+{
+	assert( m_status == Trained );
+	assert( m_param.kernel_type == LINEAR );
+	w = m_w;
+	b = m_b;
+}
+
 bool SVMTrain::save_model( const char* filename )
 {
 	if( m_status != Trained )
@@ -7,6 +7,12 @@
 #include <vector>
 
 /// Support Vector Machine training (wrapper for libsvm)
+///
+/// Two-class linear C-SVC problems (labels -1/+1) are by default solved by a
+/// dedicated dual coordinate descent solver (see train_linear()) instead of
+/// svm_train(), which yields w and b directly and supports warm starts. Its
+/// result is stored as regular libsvm model such that sv(), sv_coef(),
+/// model(), predict() and save_model() work the same for both solvers.
 class SVMTrain
 {
 public:
@@ -21,8 +27,20 @@ public:
 	void add_weight( int labels, double weight );
 	/// SVM training, if false is returned check error message with getErrmsg()
 	bool train();
+	/// Re-train with new cost parameter C, the linear solver is warm started
+	/// from the previous solution (e.g. for a search over C)
+	bool retrain( double C );
 	/// n-fold cross validation
 	double cross_validation( int n );
+	/// Predict label of a single instance with ncols() entries (after train())
+	double predict( const double* x ) const;
+	/// Hyperplane normal w (size ncols()) and offset b of a trained linear
+	/// two-class SVM, oriented such that w'x+b > 0 for label +1
+	void hyperplane( std::vector<double>& w, double& b ) const;
+
+	/// Use dual coordinate descent solver for linear C-SVC (default on)
+	void set_linear_solver( bool enable ) { m_linearSolver = enable; }
+	bool linear_solver() const { return m_linearSolver; }
 
 	/// Get SVM parameter reference
 	svm_parameter& params() { return m_param; }
@@ -53,6 +71,12 @@ protected:
 	Status m_status;
 	bool sanity_check();
 
+	/// True if current problem and parameters are supported by train_linear()
+	bool use_linear_solver() const;
+	/// Dual coordinate descent for linear C-SVC on a precomputed dense Gram
+	/// matrix, returns model allocated the same way as svm_train() does
+	svm_model* train_linear();
+
 private:
 	svm_problem   m_prob;
 	svm_parameter m_param;
@@ -65,6 +89,11 @@ private:
 	double* m_sv;
 	double* m_sv_coef;
 	int     m_ncols; // HACK (see train())
+
+	std::vector<double> m_w;     ///< hyperplane normal (linear kernel only)
+	double              m_b;     ///< hyperplane offset (linear kernel only)
+	std::vector<double> m_alpha; ///< dual variables of linear solver
+	bool                m_linearSolver;
 };
 
 #endif // SVMTRAIN_H
@@ -0,0 +1,529 @@
+/*
+fixnum - fixed-size mini matrix library
+=======================================
+
+Header-only matrix and vector types whose dimensions are template
+parameters, intended for the small 3x3, 3xn and 6x6 problems in the tensor
+code paths. In contrast to the dynamic ublas types in numerics.h no heap
+allocation and no bounds checking is involved. Data is stored row-major in a
+plain array and all loops have compile-time trip counts, such that the
+compiler can unroll and vectorize them.
+
+Function overview:
+------------------
+//	arithmetic
+Mat  prod( const Mat<T,R,K>& A, const Mat<T,K,C>& B );
+Vec  prod( const Mat<T,R,C>& A, const Vec<T,C>& x );
+Mat  trans( const Mat<T,R,C>& A );
+//	decompositions / solvers
+void sym_eigen( const Mat<T,N,N>& A, Vec<T,N>& lambda, Mat<T,N,N>& V );
+void svd( const Mat<T,R,C>& A, Mat<T,R,C>& U, Vec<T,C>& s, Mat<T,C,C>& V );
+bool solve( const Mat<T,N,N>& A, const Vec<T,N>& b, Vec<T,N>& x );
+void solve_ls( const Mat<T,R,C>& A, const Vec<T,R>& b, Vec<T,C>& x );
+void pseudo_inverse( const Mat<T,R,C>& A, Mat<T,C,R>& Ainv );
+void sym_pseudo_inverse( const Mat<T,N,N>& A, Mat<T,N,N>& Ainv );
+//	conversion
+void from_ublas( const Matrix& M, Mat<T,R,C>& A );
+void to_ublas( const Mat<T,R,C>& A, Matrix& M );
+void from_rawbuffer( Mat<T,R,C>& A, const S* buf, bool row_major=true );
+void to_rawbuffer( const Mat<T,R,C>& A, S* buf, bool row_major=true );
+void prod_fixed( const Matrix1& A, const Matrix2& B, Mat<T,R,C>& P );
+
+Singular values and eigenvalues are sorted from largest to smallest as in
+rednum, pseudo inverses truncate at the same absolute threshold 1e-12.
+*/
+#ifndef FIXNUM_H
+#define FIXNUM_H
+
+#include <cmath>
+#include <limits>
+#include <assert.h>
+
+namespace fixnum {
+
+//------------------------------------------------------------------------------
+//	types
+//------------------------------------------------------------------------------
+
+/// Fixed-size R x C matrix (row-major)
+template<class T,int R,int C>
+struct Mat
+{
+	enum { Rows=R, Cols=C, Size=R*C };
+	typedef T value_type;
+
+	T v[R*C];
+
+	T&       operator () ( int i, int j )       { return v[i*C+j]; }
+	const T& operator () ( int i, int j ) const { return v[i*C+j]; }
+
+	static Mat zeros()
+	{
+		Mat A;
+		for( int i=0; i < Size; i++ )	A.v[i] = T(0);
+		return A;
+	}
+
+	static Mat identity()
+	{
+		Mat A = zeros();
+		for( int i=0; i < R && i < C; i++ )	A(i,i) = T(1);
+		return A;
+	}
+};
+
+/// Fixed-size vector of dimension N
+template<class T,int N>
+struct Vec
+{
+	enum { Size=N };
+	typedef T value_type;
+
+	T v[N];
+
+	T&       operator () ( int i )       { return v[i]; }
+	const T& operator () ( int i ) const { return v[i]; }
+	T&       operator [] ( int i )       { return v[i]; }
+	const T& operator [] ( int i ) const { return v[i]; }
+
+	static Vec zeros()
+	{
+		Vec x;
+		for( int i=0; i < N; i++ )	x.v[i] = T(0);
+		return x;
+	}
+};
+
+typedef Mat<double,3,3> Mat3;
+typedef Mat<double,6,6> Mat6;
+typedef Vec<double,3>   Vec3;
+typedef Vec<double,6>   Vec6;
+
+//------------------------------------------------------------------------------
+//	arithmetic
+//------------------------------------------------------------------------------
+
+template<class T,int R,int K,int C>
+inline Mat<T,R,C> prod( const Mat<T,R,K>& A, const Mat<T,K,C>& B )
+{
+	Mat<T,R,C> P;
+	for( int i=0; i < R; i++ )
+		for( int j=0; j < C; j++ )
+		{
+			T sum = T(0);
+			for( int k=0; k < K; k++ )
+				sum += A(i,k) * B(k,j);
+			P(i,j) = sum;
+		}
+	return P;
+}
+
+template<class T,int R,int C>
+inline Vec<T,R> prod( const Mat<T,R,C>& A, const Vec<T,C>& x )
+{
+	Vec<T,R> y;
+	for( int i=0; i < R; i++ )
+	{
+		T sum = T(0);
+		for( int j=0; j < C; j++ )
+			sum += A(i,j) * x(j);
+		y(i) = sum;
+	}
+	return y;
+}
+
+template<class T,int R,int C>
+inline Mat<T,C,R> trans( const Mat<T,R,C>& A )
+{
+	Mat<T,C,R> At;
+	for( int i=0; i < R; i++ )
+		for( int j=0; j < C; j++ )
+			At(j,i) = A(i,j);
+	return At;
+}
+
+template<class T,int R,int C>
+inline Mat<T,R,C> operator + ( const Mat<T,R,C>& A, const Mat<T,R,C>& B )
+{
+	Mat<T,R,C> S;
+	for( int i=0; i < R*C; i++ )	S.v[i] = A.v[i] + B.v[i];
+	return S;
+}
+
+template<class T,int R,int C>
+inline Mat<T,R,C> operator - ( const Mat<T,R,C>& A, const Mat<T,R,C>& B )
+{
+	Mat<T,R,C> S;
+	for( int i=0; i < R*C; i++ )	S.v[i] = A.v[i] - B.v[i];
+	return S;
+}
+
+template<class T,int R,int C>
+inline Mat<T,R,C> operator * ( T s, const Mat<T,R,C>& A )
+{
+	Mat<T,R,C> S;
+	for( int i=0; i < R*C; i++ )	S.v[i] = s * A.v[i];
+	return S;
+}
+
+//------------------------------------------------------------------------------
+//	helper functions
+//------------------------------------------------------------------------------
+
+namespace detail {
+
+template<class T,int R,int C>
+inline void swap_columns( Mat<T,R,C>& A, int i, int j )
+{
+	for( int k=0; k < R; k++ )
+	{
+		T tmp  = A(k,i);
+		A(k,i) = A(k,j);
+		A(k,j) = tmp;
+	}
+}
+
+/// Apply Jacobi rotation to columns p,q of A
+template<class T,int R,int C>
+inline void rotate_columns( Mat<T,R,C>& A, int p, int q, T c, T s )
+{
+	for( int k=0; k < R; k++ )
+	{
+		T akp = A(k,p),
+		  akq = A(k,q);
+		A(k,p) = c*akp - s*akq;
+		A(k,q) = s*akp + c*akq;
+	}
+}
+
+/// Rotation angle t=tan(theta) annihilating the off-diagonal element
+template<class T>
+inline T jacobi_tangent( T theta )
+{
+	T t = T(1) / (std::fabs(theta) + std::sqrt(theta*theta + T(1)));
+	return theta < T(0) ? -t : t;
+}
+
+} // namespace detail
+
+//------------------------------------------------------------------------------
+//	decompositions / solvers
+//------------------------------------------------------------------------------
+
+/// Eigen decomposition A = V diag(lambda) V' of a symmetric matrix via cyclic
+/// Jacobi rotations. Eigenvalues are sorted from largest to smallest, the
+/// normalized eigenvectors are the columns of V. As in vtkMath::Jacobi() the
+/// sign of each eigenvector is chosen such that the majority of its
+/// components is non-negative.
+template<class T,int N>
+void sym_eigen( const Mat<T,N,N>& A_, Vec<T,N>& lambda, Mat<T,N,N>& V,
+                int maxSweeps=50 )
+{
+	Mat<T,N,N> A = A_;
+	V = Mat<T,N,N>::identity();
+
+	T norm2 = T(0);
+	for( int i=0; i < N*N; i++ )
+		norm2 += A.v[i]*A.v[i];
+	T eps = std::numeric_limits<T>::epsilon();
+
+	for( int sweep=0; sweep < maxSweeps; sweep++ )
+	{
+		// Converged if off-diagonal part is negligible
+		T off2 = T(0);
+		for( int p=0; p < N; p++ )
+			for( int q=p+1; q < N; q++ )
+				off2 += 2*A(p,q)*A(p,q);
+		if( off2 <= eps*eps*norm2 )
+			break;
+
+		for( int p=0; p < N; p++ )
+			for( int q=p+1; q < N; q++ )
+			{
+				if( A(p,q) == T(0) )
+					continue;
+
+				T t = detail::jacobi_tangent( (A(q,q) - A(p,p)) / (2*A(p,q)) ),
+				  c = T(1) / std::sqrt( t*t + T(1) ),
+				  s = t*c;
+
+				// A = J'*A*J, V = V*J
+				detail::rotate_columns( A, p, q, c, s );
+				for( int k=0; k < N; k++ )
+				{
+					T apk = A(p,k),
+					  aqk = A(q,k);
+					A(p,k) = c*apk - s*aqk;
+					A(q,k) = s*apk + c*aqk;
+				}
+				detail::rotate_columns( V, p, q, c, s );
+			}
+	}
+
+	for( int i=0; i < N; i++ )
+		lambda(i) = A(i,i);
+
+	// Sort descending (selection sort)
+	for( int i=0; i < N-1; i++ )
+	{
+		int k = i;
+		for( int j=i+1; j < N; j++ )
+			if( lambda(j) > lambda(k) )	k = j;
+		if( k != i )
+		{
+			T tmp = lambda(i);  lambda(i) = lambda(k);  lambda(k) = tmp;
+			detail::swap_columns( V, i, k );
+		}
+	}
+
+	// Consistent sign of eigenvectors
+	for( int j=0; j < N; j++ )
+	{
+		int numPos = 0;
+		for( int i=0; i < N; i++ )
+			if( V(i,j) >= T(0) )	numPos++;
+		if( 2*numPos < N )
+			for( int i=0; i < N; i++ )
+				V(i,j) = -V(i,j);
+	}
+}
+
+/// Singular value decomposition A = U diag(s) V' (R >= C) via one-sided
+/// Jacobi rotations. Singular values are sorted from largest to smallest,
+/// columns of U belonging to zero singular values are zero.
+template<class T,int R,int C>
+void svd( const Mat<T,R,C>& A, Mat<T,R,C>& U, Vec<T,C>& s, Mat<T,C,C>& V,
+          int maxSweeps=50 )
+{
+	assert( R >= C );
+	U = A;
+	V = Mat<T,C,C>::identity();
+	T eps = std::numeric_limits<T>::epsilon();
+
+	for( int sweep=0; sweep < maxSweeps; sweep++ )
+	{
+		bool rotated = false;
+		for( int p=0; p < C; p++ )
+			for( int q=p+1; q < C; q++ )
+			{
+				T alpha=T(0), beta=T(0), gamma=T(0);
+				for( int k=0; k < R; k++ )
+				{
+					alpha += U(k,p)*U(k,p);
+					beta  += U(k,q)*U(k,q);
+					gamma += U(k,p)*U(k,q);
+				}
+				if( std::fabs(gamma) <= eps*std::sqrt(alpha*beta) )
+					continue;
+
+				T t = detail::jacobi_tangent( (beta - alpha) / (2*gamma) ),
+				  c = T(1) / std::sqrt( t*t + T(1) ),
+				  sn = t*c;
+				detail::rotate_columns( U, p, q, c, sn );
+				detail::rotate_columns( V, p, q, c, sn );
+				rotated = true;
+			}
+		if( !rotated )
+			break;
+	}
+
+	for( int j=0; j < C; j++ )
+	{
+		T len2 = T(0);
+		for( int k=0; k < R; k++ )
+			len2 += U(k,j)*U(k,j);
+		s(j) = std::sqrt( len2 );
+		for( int k=0; k < R; k++ )
+			U(k,j) = s(j) > T(0) ? U(k,j) / s(j) : T(0);
+	}
+
+	// Sort descending (selection sort)
+	for( int i=0; i < C-1; i++ )
+	{
+		int k = i;
+		for( int j=i+1; j < C; j++ )
+			if( s(j) > s(k) )	k = j;
+		if( k != i )
+		{
+			T tmp = s(i);  s(i) = s(k);  s(k) = tmp;
+			detail::swap_columns( U, i, k );
+			detail::swap_columns( V, i, k );
+		}
+	}
+}
+
+/// Solve square system Ax=b via LU decomposition with partial pivoting,
+/// returns false if A is singular.
+template<class T,int N>
+bool solve( const Mat<T,N,N>& A_, const Vec<T,N>& b_, Vec<T,N>& x )
+{
+	Mat<T,N,N> A = A_;
+	Vec<T,N>   b = b_;
+
+	for( int k=0; k < N; k++ )
+	{
+		// Pivot
+		int piv = k;
+		for( int i=k+1; i < N; i++ )
+			if( std::fabs(A(i,k)) > std::fabs(A(piv,k)) )	piv = i;
+		if( A(piv,k) == T(0) )
+			return false;
+		if( piv != k )
+		{
+			for( int j=0; j < N; j++ )
+			{
+				T tmp = A(k,j);  A(k,j) = A(piv,j);  A(piv,j) = tmp;
+			}
+			T tmp = b(k);  b(k) = b(piv);  b(piv) = tmp;
+		}
+
+		// Eliminate
+		for( int i=k+1; i < N; i++ )
+		{
+			T f = A(i,k) / A(k,k);
+			for( int j=k; j < N; j++ )
+				A(i,j) -= f * A(k,j);
+			b(i) -= f * b(k);
+		}
+	}
+
+	// Back substitution
+	for( int i=N-1; i >= 0; i-- )
+	{
+		T sum = b(i);
+		for( int j=i+1; j < N; j++ )
+			sum -= A(i,j) * x(j);
+		x(i) = sum / A(i,i);
+	}
+	return true;
+}
+
+/// Moore-Penrose pseudo inverse via SVD (R >= C)
+template<class T,int R,int C>
+void pseudo_inverse( const Mat<T,R,C>& A, Mat<T,C,R>& Ainv, T eps=T(1e-12) )
+{
+	Mat<T,R,C> U;
+	Mat<T,C,C> V;
+	Vec<T,C>   s;
+	svd( A, U, s, V );
+
+	// Ainv = V * diag(1/s) * trans(U)
+	Ainv = Mat<T,C,R>::zeros();
+	for( int k=0; k < C && s(k) > eps; k++ )
+		for( int i=0; i < C; i++ )
+		{
+			T vik = V(i,k) / s(k);
+			for( int j=0; j < R; j++ )
+				Ainv(i,j) += vik * U(j,k);
+		}
+}
+
+/// Pseudo inverse of a symmetric matrix via its eigen decomposition
+template<class T,int N>
+void sym_pseudo_inverse( const Mat<T,N,N>& A, Mat<T,N,N>& Ainv,
+                         T eps=T(1e-12) )
+{
+	Mat<T,N,N> V;
+	Vec<T,N>   lambda;
+	sym_eigen( A, lambda, V );
+
+	// Ainv = V * diag(1/lambda) * trans(V)
+	Ainv = Mat<T,N,N>::zeros();
+	for( int k=0; k < N; k++ )
+	{
+		if( std::fabs(lambda(k)) <= eps )
+			continue;
+		for( int i=0; i < N; i++ )
+		{
+			T vik = V(i,k) / lambda(k);
+			for( int j=0; j < N; j++ )
+				Ainv(i,j) += vik * V(j,k);
+		}
+	}
+}
+
+/// Solve Ax=b least squares via pseudo inverse (R >= C)
+template<class T,int R,int C>
+void solve_ls( const Mat<T,R,C>& A, const Vec<T,R>& b, Vec<T,C>& x )
+{
+	Mat<T,C,R> Ainv;
+	pseudo_inverse( A, Ainv );
+	x = prod( Ainv, b );
+}
+
+//------------------------------------------------------------------------------
+//	conversion
+//------------------------------------------------------------------------------
+
+/// Copy from ublas (or any other) matrix providing size1(),size2(),(i,j)
+template<class Matrix,class T,int R,int C>
+void from_ublas( const Matrix& M, Mat<T,R,C>& A )
+{
+	assert( M.size1()==(unsigned)R && M.size2()==(unsigned)C );
+	for( int i=0; i < R; i++ )
+		for( int j=0; j < C; j++ )
+			A(i,j) = (T)M(i,j);
+}
+
+template<class T,int R,int C,class Matrix>
+void to_ublas( const Mat<T,R,C>& A, Matrix& M )
+{
+	M.resize( R, C, false );
+	for( int i=0; i < R; i++ )
+		for( int j=0; j < C; j++ )
+			M(i,j) = A(i,j);
+}
+
+template<class Vector,class T,int N>
+void from_ublas( const Vector& x, Vec<T,N>& y )
+{
+	assert( x.size()==(unsigned)N );
+	for( int i=0; i < N; i++ )
+		y(i) = (T)x(i);
+}
+
+template<class T,int N,class Vector>
+void to_ublas( const Vec<T,N>& x, Vector& y )
+{
+	y.resize( N, false );
+	for( int i=0; i < N; i++ )
+		y(i) = x(i);
+}
+
+template<class S,class T,int R,int C>
+void from_rawbuffer( Mat<T,R,C>& A, const S* buf, bool row_major=true )
+{
+	for( int i=0; i < R; i++ )
+		for( int j=0; j < C; j++ )
+			A(i,j) = (T)( row_major ? buf[i*C+j] : buf[j*R+i] );
+}
+
+template<class T,int R,int C,class S>
+void to_rawbuffer( const Mat<T,R,C>& A, S* buf, bool row_major=true )
+{
+	for( int i=0; i < R; i++ )
+		for( int j=0; j < C; j++ )
+			buf[ row_major ? i*C+j : j*R+i ] = (S)A(i,j);
+}
+
+/// Product P=A*B of dynamic matrices (or ublas expressions like trans(B))
+/// with fixed-size result, e.g. the 3x3 product of a 3xn and a nx3 matrix.
+template<class Matrix1,class Matrix2,class T,int R,int C>
+void prod_fixed( const Matrix1& A, const Matrix2& B, Mat<T,R,C>& P )
+{
+	assert( A.size1()==(unsigned)R && B.size2()==(unsigned)C &&
+	        A.size2()==B.size1() );
+	unsigned n = A.size2();
+	for( int i=0; i < R; i++ )
+		for( int j=0; j < C; j++ )
+		{
+			T sum = T(0);
+			for( unsigned k=0; k < n; k++ )
+				sum += A(i,k) * B(k,j);
+			P(i,j) = sum;
+		}
+}
+
+} // namespace fixnum
+
+#endif // FIXNUM_H
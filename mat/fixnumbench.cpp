@@ -0,0 +1,342 @@
+// fixnumbench - compares the fixed-size fixnum code paths against the dynamic
+// rednum/ublas ones they replaced (and against vtkMath::Jacobi() if VTK is
+// available), both in accuracy and speed. Returns non-zero if results differ.
+#include "numerics.h"
+#include "fixnum.h"
+#ifdef SDMVIS_VTK_ENABLED
+#include "TensorSpectrum.h"
+#include <vtkMath.h>
+#endif
+#include <boost/random/mersenne_twister.hpp>
+#include <boost/random/uniform_real.hpp>
+#include <boost/random/variate_generator.hpp>
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <ctime>
+#include <iostream>
+#include <vector>
+
+using std::cout;
+using std::cerr;
+using std::endl;
+
+namespace {
+
+//------------------------------------------------------------------------------
+//	helper functions
+//------------------------------------------------------------------------------
+
+boost::mt19937 g_rng( 5489u );
+
+/// Uniform random number in [-1,1]
+double rnd()
+{
+	static boost::variate_generator< boost::mt19937&, boost::uniform_real<> >
+		uniform( g_rng, boost::uniform_real<>(-1.0,1.0) );
+	return uniform();
+}
+
+/// Average time per repetition in microseconds since start
+double microseconds( clock_t start, int reps )
+{
+	return 1e6 * (clock() - start) / (double)CLOCKS_PER_SEC / reps;
+}
+
+/// Print maximum error and return true if it is below tolerance
+bool check( const char* name, double err, double tol )
+{
+	bool ok = err <= tol;
+	cout << "  " << name << " : max. error " << err
+	     << (ok ? " (ok)" : " (FAILED)") << endl;
+	return ok;
+}
+
+/// Random symmetric positive semi-definite 6x6 matrix, optionally of rank 3
+fixnum::Mat6 randomCovariance6( bool rankDeficient )
+{
+	fixnum::Mat6 B;
+	for( int i=0; i < 36; i++ )
+		B.v[i] = rnd();
+	if( rankDeficient )
+		for( int i=0; i < 6; i++ )
+			for( int j=3; j < 6; j++ )
+				B(i,j) = 0.;
+	return fixnum::prod( B, fixnum::trans(B) );
+}
+
+//------------------------------------------------------------------------------
+//	6x6 covariance: fixnum::sym_eigen() vs. rednum::compute_svd()
+//------------------------------------------------------------------------------
+
+/// TensorNormalDistribution::computeModes() per voxel decomposition
+bool benchEigen6( int reps )
+{
+	using namespace fixnum;
+	cout << "6x6 covariance eigen decomposition" << endl;
+
+	std::vector<Mat6> S( reps );
+	std::vector<Matrix> M( reps );
+	for( int k=0; k < reps; k++ )
+	{
+		S[k] = randomCovariance6( k%3==0 );
+		to_ublas( S[k], M[k] );
+	}
+
+	// accuracy
+	double errRecon=0., errOrtho=0., errSVD=0.;
+	for( int k=0; k < std::min(reps,1000); k++ )
+	{
+		Vec6 l;
+		Mat6 V, D = Mat6::zeros();
+		sym_eigen( S[k], l, V );
+		for( int i=0; i < 6; i++ )
+			D(i,i) = l(i);
+
+		Mat6 R   = prod( V, prod( D, trans(V) ) );
+		Mat6 VtV = prod( trans(V), V );
+		for( int i=0; i < 6; i++ )
+			for( int j=0; j < 6; j++ )
+			{
+				errRecon = std::max( errRecon, fabs( R(i,j) - S[k](i,j) ) );
+				errOrtho = std::max( errOrtho, fabs( VtV(i,j) - (i==j) ) );
+			}
+
+		Matrix U, W;
+		Vector s;
+		rednum::compute_svd<Matrix,Vector,double>( M[k], U, s, W );
+		for( int i=0; i < 6; i++ )
+			errSVD = std::max( errSVD, fabs( s(i) - fabs(l(i)) ) );
+	}
+	bool ok = true;
+	ok &= check( "V diag(lambda) V' - S", errRecon, 1e-10 );
+	ok &= check( "V'V - I", errOrtho, 1e-10 );
+	ok &= check( "singular values - |eigenvalues|", errSVD, 1e-10 );
+
+	// speed
+	double checksum = 0.;
+	clock_t start = clock();
+	for( int k=0; k < reps; k++ )
+	{
+		Matrix U, W;
+		Vector s;
+		rednum::compute_svd<Matrix,Vector,double>( M[k], U, s, W );
+		checksum += s(0);
+	}
+	double tDynamic = microseconds( start, reps );
+
+	start = clock();
+	for( int k=0; k < reps; k++ )
+	{
+		Vec6 l;
+		Mat6 V;
+		sym_eigen( S[k], l, V );
+		checksum += l(0);
+	}
+	double tFixed = microseconds( start, reps );
+
+	cout << "  rednum::compute_svd : " << tDynamic << " us" << endl
+	     << "  fixnum::sym_eigen   : " << tFixed << " us" << endl
+	     << "  (checksum " << checksum << ")" << endl;
+	return ok;
+}
+
+//------------------------------------------------------------------------------
+//	Edit solve operator: n x n pseudo inverse vs. 3x3 pseudo inverse
+//------------------------------------------------------------------------------
+
+/// Solve operator (Bp'Bp + gamma)^(-1) Bp' of the numModes x numModes inner
+/// system as formerly used in LinearLocalCovariance::getZp()
+Matrix solveOperatorDynamic( const Matrix& Bp, double gamma )
+{
+	using namespace boost::numeric::ublas;
+	Matrix A = prod( trans(Bp), Bp );
+	for( unsigned i=0; i < A.size1(); i++ )
+		A(i,i) = A(i,i) + gamma;
+
+	Matrix Ainv;
+	rednum::pseudo_inverse<Matrix,Vector,ValueType>( A, Ainv );
+	return prod( Ainv, trans(Bp) );
+}
+
+/// Same operator via the identity Bp' (Bp Bp' + gamma)^(-1) on a 3x3 matrix
+/// as used in LinearLocalCovariance::getZp() and SDMVisInteractiveEditing
+Matrix solveOperatorFixed( const Matrix& Bp, double gamma )
+{
+	using boost::numeric::ublas::trans;
+	fixnum::Mat3 G, Ginv;
+	fixnum::prod_fixed( Bp, trans(Bp), G );
+	for( int i=0; i < 3; i++ )
+		G(i,i) += gamma;
+	fixnum::sym_pseudo_inverse( G, Ginv );
+
+	Matrix Zp( Bp.size2(), 3 );
+	for( unsigned i=0; i < Zp.size1(); i++ )
+		for( int j=0; j < 3; j++ )
+			Zp(i,j) = Bp(0,i)*Ginv(0,j) + Bp(1,i)*Ginv(1,j) + Bp(2,i)*Ginv(2,j);
+	return Zp;
+}
+
+bool benchSolveOperator( int numModes, int reps )
+{
+	cout << "Edit solve operator (" << numModes << " modes)" << endl;
+
+	Matrix Bp( 3, numModes );
+	for( unsigned i=0; i < Bp.size1(); i++ )
+		for( unsigned j=0; j < Bp.size2(); j++ )
+			Bp(i,j) = rnd();
+
+	// accuracy, including the singular case gamma=0
+	const double gammas[] = { 0., 1e-3, 1., 100. };
+	double err = 0.;
+	for( int g=0; g < 4; g++ )
+	{
+		Matrix K1 = solveOperatorDynamic( Bp, gammas[g] ),
+		       K2 = solveOperatorFixed  ( Bp, gammas[g] );
+		for( unsigned i=0; i < K1.size1(); i++ )
+			for( unsigned j=0; j < K1.size2(); j++ )
+				err = std::max( err, fabs( K1(i,j) - K2(i,j) ) );
+	}
+	bool ok = check( "fixed - dynamic operator", err, 1e-8 );
+
+	// speed, the dynamic path is orders of magnitude slower
+	int repsDynamic = std::max( 1, reps / 1000 );
+	double checksum = 0.;
+	clock_t start = clock();
+	for( int k=0; k < repsDynamic; k++ )
+		checksum += solveOperatorDynamic( Bp, 1. )(0,0);
+	double tDynamic = microseconds( start, repsDynamic );
+
+	start = clock();
+	for( int k=0; k < reps; k++ )
+		checksum += solveOperatorFixed( Bp, 1. )(0,0);
+	double tFixed = microseconds( start, reps );
+
+	cout << "  n x n rednum::pseudo_inverse    : " << tDynamic << " us" << endl
+	     << "  3x3 fixnum::sym_pseudo_inverse : " << tFixed << " us" << endl
+	     << "  (checksum " << checksum << ")" << endl;
+	return ok;
+}
+
+//------------------------------------------------------------------------------
+//	3x3 tensor: TensorSpectrum vs. vtkMath::Jacobi()
+//------------------------------------------------------------------------------
+#ifdef SDMVIS_VTK_ENABLED
+
+/// Former TensorSpectrum::compute() (code partly taken from vtkTensorGlyph)
+void jacobiSpectrum( double* tensor9, double* lambda, double* ev /*9*/ )
+{
+	double *m[3], *v[3];
+	double m0[3], m1[3], m2[3];
+	double v0[3], v1[3], v2[3];
+	m[0] = m0; m[1] = m1; m[2] = m2;
+	v[0] = v0; v[1] = v1; v[2] = v2;
+	for( int j=0; j<3; j++ )
+		for( int i=0; i<3; i++ )
+			m[i][j] = tensor9[i+3*j];
+
+	vtkMath::Jacobi( m, lambda, v );
+
+	// eigenvectors in columns
+	for( int i=0; i<3; i++ )
+		for( int j=0; j<3; j++ )
+			ev[3*j+i] = v[i][j];
+}
+
+bool benchTensorSpectrum( int reps )
+{
+	cout << "3x3 tensor spectrum" << endl;
+
+	std::vector<double> tensors( 9*reps );
+	for( int k=0; k < reps; k++ )
+	{
+		fixnum::Mat3 B;
+		for( int i=0; i < 9; i++ )
+			B.v[i] = rnd();
+		fixnum::to_rawbuffer( fixnum::prod( B, fixnum::trans(B) ), &tensors[9*k] );
+	}
+
+	// accuracy, eigenvectors are compared including their sign
+	double errLambda=0., errVectors=0.;
+	for( int k=0; k < std::min(reps,1000); k++ )
+	{
+		TensorSpectrum ts;
+		ts.compute( &tensors[9*k] );
+
+		double lambda[3], ev[9];
+		jacobiSpectrum( &tensors[9*k], lambda, ev );
+
+		const double* evs[3] = { ts.ev1, ts.ev2, ts.ev3 };
+		for( int j=0; j < 3; j++ )
+		{
+			errLambda = std::max( errLambda, fabs( ts.lambda[j] - lambda[j] ) );
+			for( int i=0; i < 3; i++ )
+				errVectors = std::max( errVectors, fabs( evs[j][i] - ev[3*j+i] ) );
+		}
+	}
+	bool ok = true;
+	ok &= check( "eigenvalues", errLambda, 1e-10 );
+	ok &= check( "eigenvectors", errVectors, 1e-8 );
+
+	// speed
+	double checksum = 0.;
+	clock_t start = clock();
+	for( int k=0; k < reps; k++ )
+	{
+		double lambda[3], ev[9];
+		jacobiSpectrum( &tensors[9*k], lambda, ev );
+		checksum += lambda[0];
+	}
+	double tVTK = microseconds( start, reps );
+
+	start = clock();
+	for( int k=0; k < reps; k++ )
+	{
+		TensorSpectrum ts;
+		ts.compute( &tensors[9*k] );
+		checksum += ts.lambda[0];
+	}
+	double tFixed = microseconds( start, reps );
+
+	cout << "  vtkMath::Jacobi          : " << tVTK << " us" << endl
+	     << "  TensorSpectrum::compute  : " << tFixed << " us" << endl
+	     << "  (checksum " << checksum << ")" << endl;
+	return ok;
+}
+
+#endif // SDMVIS_VTK_ENABLED
+
+} // namespace
+
+//------------------------------------------------------------------------------
+//	main
+//------------------------------------------------------------------------------
+
+/// Usage:
+///   fixnumbench [<numModes> [<repetitions>]]
+int main( int argc, char* argv[] )
+{
+	int numModes = (argc > 1) ? atoi( argv[1] ) : 100;
+	int reps     = (argc > 2) ? atoi( argv[2] ) : 20000;
+	if( numModes < 1 || reps < 1 )
+	{
+		cerr << "Usage: " << argv[0] << " [<numModes> [<repetitions>]]" << endl;
+		return -1;
+	}
+
+	bool ok = true;
+	ok &= benchEigen6( reps );
+	ok &= benchSolveOperator( numModes, reps );
+#ifdef SDMVIS_VTK_ENABLED
+	ok &= benchTensorSpectrum( reps );
+#else
+	cout << "3x3 tensor spectrum skipped (VTK not available)" << endl;
+#endif
+
+	if( !ok )
+	{
+		cerr << "Error: fixnum results differ from reference!" << endl;
+		return 1;
+	}
+	return 0;
+}
@@ -1,5 +1,7 @@
 #include "mattools.h"
 #include <cmath>
+#include <cstring>   // for memcpy()
+#include <algorithm> // for std::min()
 
 namespace mattools {
 
@@ -21,6 +23,50 @@ std::size_t RawMatrix::getFileSize( const char* filename )
 	return s;
 }
 
+std::size_t RawMatrix::getElementSize( StorageType storage )
+{
+	return (storage == StorageFloat32) ? sizeof(ValueType) 
+	                                   : sizeof(unsigned short);
+}
+
+std::size_t RawMatrix::getNumRowsFromFileSize( std::size_t fileSize, 
+	                             std::size_t numCols, StorageType storage )
+{
+	if( numCols == 0 )
+		return 0;
+
+	// Int16 matrices have a trailing float32 vector of column scales
+	if( storage == StorageInt16 )
+	{
+		std::size_t scaleSize = numCols * sizeof(float);
+		if( fileSize < scaleSize )
+			return 0;
+		fileSize -= scaleSize;
+	}
+	return fileSize / (numCols * getElementSize( storage ));
+}
+
+bool RawMatrix::checkWriteable() const
+{
+	// Currently, modifications are only supported for in-memory matrices!
+	if( !isInMemory() )	{
+		std::cerr << "Error: Out-of-core matrices are treated read-only yet!\n";
+		return false;
+	}
+	if( isQuantized() ) {
+		std::cerr << "Error: Quantized matrices are treated read-only!\n";
+		return false;
+	}
+	return true;
+}
+
+ValueType RawMatrix::dequantize( std::size_t idx, std::size_t col ) const
+{
+	if( m_storage == StorageInt16 )
+		return (ValueType)((short)m_Q[idx]) * m_scale[col];
+	return (ValueType)half_to_float( m_Q[idx] );
+}
+
 void RawMatrix::checkStreamIsOpen() const
 {
 	// Stream is only required for out-of-core treatment
@@ -53,7 +99,8 @@ void RawMatrix::checkStreamIsOpen() const
 }
 
 RawMatrix::RawMatrix()
-	: m_numRows(0),
+	: m_storage(StorageFloat32),
+	  m_numRows(0),
 	  m_numCols(0),
 	  m_inMemory(false)
 {	
@@ -71,6 +118,9 @@ void RawMatrix::clear()
 
 	// Free memory
 	m_X.reset(); // was: if( m_X ) delete [] m_X; m_X = NULL;
+	m_Q.reset();
+	m_scale.clear();
+	m_storage = StorageFloat32;
 
 	// Reset variables
 	m_numRows = 0;
@@ -115,7 +165,7 @@ bool RawMatrix::allocate( std::size_t m, std::size_t n )
 }
 
 bool RawMatrix::load( std::size_t m, std::size_t n, const char* filename, 
-                      bool tryToLoadIntoMemory )
+                      bool tryToLoadIntoMemory, StorageType storage )
 {
 	clear();
 
@@ -128,6 +178,45 @@ bool RawMatrix::load( std::size_t m, std::size_t n, const char* filename,
 		return false;
 	}
 
+	// Quantized matrices are always loaded into memory
+	if( storage != StorageFloat32 )
+	{
+		unsigned short* Q_in_mem = NULL;
+		try {
+			Q_in_mem = new unsigned short[m*n];
+			m_scale.resize( n, (ValueType)1.0 );
+		}
+		catch( std::bad_alloc& )
+		{
+			std::cerr << "Error: Could not allocate quantized matrix of size "
+				      << ((sizeof(unsigned short)*m*n) / (1024*1024)) << "MB!\n";
+			delete [] Q_in_mem;
+			return false;
+		}
+		m_Q = boost::shared_array<unsigned short>( Q_in_mem );
+
+		try {
+			m_fX->read( (char*)Q_in_mem, m*n*sizeof(unsigned short) );
+			if( storage == StorageInt16 )
+				m_fX->read( (char*)(&m_scale[0]), n*sizeof(ValueType) );
+		}
+		catch( std::exception& e )
+		{
+			std::cerr << "Error: Reading from disk failed!\n";
+			std::cerr << e.what() << "\n";
+			clear();
+			return false;
+		}
+
+		m_fX.reset();
+		m_storage  = storage;
+		m_inMemory = true;
+		m_numRows  = m;
+		m_numCols  = n;
+		m_filename = std::string(filename);
+		return true;
+	}
+
 	// Try to allocate memory for complete matrix
 	ValueType* X_in_mem = NULL;
 	if( tryToLoadIntoMemory )
@@ -177,6 +266,13 @@ bool RawMatrix::load( std::size_t m, std::size_t n, const char* filename,
 
 void RawMatrix::get_row( std::size_t row, ValueType* buf ) const
 {
+	if( isQuantized() )
+	{
+		std::size_t ofs = row*m_numCols;
+		for( std::size_t j=0; j < m_numCols; ++j )
+			buf[j] = dequantize( ofs + j, j );
+	}
+	else
 	if( isInMemory() )
 	{
 		mattools::get_row( row,    m_X.get() , m_numRows,m_numCols, buf );
@@ -198,6 +294,12 @@ void RawMatrix::get_rows( std::vector<std::size_t> rows, ValueType* buf ) const
 
 void RawMatrix::get_col( std::size_t col, ValueType* buf ) const
 {
+	if( isQuantized() )
+	{
+		for( std::size_t i=0; i < m_numRows; ++i )
+			buf[i] = dequantize( col + i*m_numCols, col );
+	}
+	else
 	if( isInMemory() )
 	{
 		mattools::get_col( col,    m_X.get() , m_numRows,m_numCols, buf );
@@ -250,10 +352,8 @@ void RawMatrix::applyRowWeights( ValueType* w )
 void RawMatrix::set_col( std::size_t col, ValueType* buf )
 {
 	// Currently, this function is only supported for in-memory matrices!
-	if( !isInMemory() )	{
-		std::cerr << "Error: Out-of-core matrices are treated read-only yet!\n";
+	if( !checkWriteable() )
 		return;
-	}
 	
 	// Assume row-major ordering
 	std::size_t ofs = col;
@@ -264,10 +364,8 @@ void RawMatrix::set_col( std::size_t col, ValueType* buf )
 void RawMatrix::set_row( std::size_t row, ValueType* buf )
 {
 	// Currently, this function is only supported for in-memory matrices!
-	if( !isInMemory() )	{
-		std::cerr << "Error: Out-of-core matrices are treated read-only yet!\n";
+	if( !checkWriteable() )
 		return;
-	}
 	
 	// Assume row-major ordering
 	// Note that copying of rows can also be realized via memcpy.
@@ -293,13 +391,107 @@ bool RawMatrix::save( const char* filename )
 	}
 
 	// Dump in-memory matrix to disk
-	std::size_t sizeInBytes = m_numRows*m_numCols*sizeof(ValueType);
-	f.write( (char*)(m_X.get()), sizeInBytes );
+	if( isQuantized() )
+	{
+		f.write( (char*)(m_Q.get()), m_numRows*m_numCols*sizeof(unsigned short) );
+		if( m_storage == StorageInt16 )
+			f.write( (char*)(&m_scale[0]), m_numCols*sizeof(ValueType) );
+	}
+	else
+	{
+		std::size_t sizeInBytes = m_numRows*m_numCols*sizeof(ValueType);
+		f.write( (char*)(m_X.get()), sizeInBytes );
+	}
 
 	f.close();
 	return true;
 }
 
+bool RawMatrix::quantize( StorageType storage, 
+	                      std::vector<QuantizationError>* error )
+{
+	if( storage == m_storage )
+		return true;
+
+	if( isQuantized() || !isInMemory() )
+	{
+		std::cerr << "Error: Only in-memory float32 matrices can be quantized!\n";
+		return false;
+	}
+
+	std::size_t m = m_numRows, n = m_numCols;
+	const ValueType* X = m_X.get();
+
+	unsigned short* Q_in_mem = NULL;
+	try {
+		Q_in_mem = new unsigned short[m*n];
+	}
+	catch( std::bad_alloc& )
+	{
+		std::cerr << "Error: Could not allocate quantized matrix of size "
+			      << ((sizeof(unsigned short)*m*n) / (1024*1024)) << "MB!\n";
+		return false;
+	}
+
+	// Per column scale maps maximum absolute value to int16 range
+	std::vector<ValueType> scale( n, (ValueType)1.0 );
+	if( storage == StorageInt16 )
+	{
+		std::vector<ValueType> maxabs( n, (ValueType)0.0 );
+		for( std::size_t i=0; i < m; i++ )
+			for( std::size_t j=0; j < n; j++ )
+				maxabs[j] = std::max( maxabs[j], (ValueType)fabs( X[i*n+j] ) );
+		for( std::size_t j=0; j < n; j++ )
+			scale[j] = (maxabs[j] > 0) ? maxabs[j] / (ValueType)32767.0 
+			                           : (ValueType)1.0;
+	}
+
+	// Quantize and gather error statistics
+	std::vector<double> maxErr( n, 0.0 ), sqErr( n, 0.0 ), sqVal( n, 0.0 );
+	for( std::size_t i=0; i < m; i++ )
+		for( std::size_t j=0; j < n; j++ )
+		{
+			std::size_t idx = i*n+j;
+			ValueType x = X[idx], y;
+			if( storage == StorageInt16 )
+			{
+				double q = floor( x / scale[j] + 0.5 );
+				q = std::min( std::max( q, -32767.0 ), 32767.0 );
+				Q_in_mem[idx] = (unsigned short)(short)q;
+				y = (ValueType)q * scale[j];
+			}
+			else
+			{
+				Q_in_mem[idx] = float_to_half( x );
+				y = half_to_float( Q_in_mem[idx] );
+			}
+
+			double e = fabs( (double)x - (double)y );
+			maxErr[j] = std::max( maxErr[j], e );
+			sqErr [j] += e*e;
+			sqVal [j] += (double)x*(double)x;
+		}
+
+	if( error )
+	{
+		error->resize( n );
+		for( std::size_t j=0; j < n; j++ )
+		{
+			QuantizationError& qe = error->at(j);
+			qe.maxAbs = maxErr[j];
+			qe.rms    = sqrt( sqErr[j] / (double)m );
+			qe.relRms = (sqVal[j] > 0) ? sqrt( sqErr[j] / sqVal[j] ) : 0.0;
+		}
+	}
+
+	// Replace float32 storage
+	m_X.reset();
+	m_Q = boost::shared_array<unsigned short>( Q_in_mem );
+	m_scale = scale;
+	m_storage = storage;
+	return true;
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 //	Compute Functions
 ////////////////////////////////////////////////////////////////////////////////
@@ -391,6 +583,138 @@ void RawMatrix::multiply( ValueType* x, ValueType* res )
 	delete [] rowbuf;
 }
 
+void RawMatrix::multiplyColumns( const ValueType* x, std::size_t n, ValueType* res ) const
+{
+	n = std::min( n, m_numCols );
+
+	if( isQuantized() )
+	{
+		// Fold per column scale into coefficients (1 for float16)
+		std::vector<ValueType> xs( std::max( n, (std::size_t)1 ), (ValueType)0.0 );
+		for( std::size_t j=0; j < n; j++ )
+			xs[j] = x[j] * ((m_storage == StorageInt16) ? m_scale[j] : (ValueType)1.0);
+
+		const unsigned short* Q = m_Q.get();
+		bool int16 = (m_storage == StorageInt16);
+		long long numRows = (long long)m_numRows;
+		#pragma omp parallel for schedule(static)
+		for( long long i=0; i < numRows; i++ )
+		{
+			const unsigned short* row = &Q[ (std::size_t)i*m_numCols ];
+			ValueType val = (ValueType)0.0;
+			if( int16 )
+				for( std::size_t j=0; j < n; j++ )
+					val += (ValueType)((short)row[j]) * xs[j];
+			else
+				for( std::size_t j=0; j < n; j++ )
+					val += half_to_float( row[j] ) * xs[j];
+			res[i] = val;
+		}
+	}
+	else
+	if( isInMemory() )
+	{
+		// Row-major storage, each row is a contiguous dot product
+		const ValueType* X = m_X.get();
+		long long numRows = (long long)m_numRows;
+		#pragma omp parallel for schedule(static)
+		for( long long i=0; i < numRows; i++ )
+		{
+			const ValueType* row = &X[ (std::size_t)i*m_numCols ];
+			ValueType val = (ValueType)0.0;
+			for( std::size_t j=0; j < n; j++ )
+				val += row[j] * x[j];
+			res[i] = val;
+		}
+	}
+	else
+	{
+		// Out-of-core matrices are read sequentially
+		ValueType* rowbuf = new ValueType[ m_numCols ];
+		for( std::size_t i=0; i < m_numRows; i++ )
+		{
+			get_row( i, rowbuf );
+			ValueType val = (ValueType)0.0;
+			for( std::size_t j=0; j < n; j++ )
+				val += rowbuf[j] * x[j];
+			res[i] = val;
+		}
+		delete [] rowbuf;
+	}
+}
+
+void RawMatrix::multiplyMatrix( const ValueType* B, std::size_t k, ValueType* res ) const
+{
+	const std::size_t n = m_numCols;
+	const std::size_t blockSize = 4096;
+
+	// In-memory float32 rows are accessed directly, quantized rows are
+	// decoded in parallel and out-of-core rows are read up front per block
+	bool direct = isInMemory() && !isQuantized();
+	std::vector<ValueType> block( direct ? 0 : blockSize*n );
+
+	for( std::size_t b0=0; b0 < m_numRows; b0 += blockSize )
+	{
+		long long numBlockRows = 
+			(long long)(std::min( b0+blockSize, m_numRows ) - b0);
+
+		if( !isInMemory() )
+			for( long long r=0; r < numBlockRows; r++ )
+				get_row( b0+(std::size_t)r, &block[(std::size_t)r*n] );
+
+		#pragma omp parallel
+		{
+			std::vector<ValueType> acc( k );
+
+			#pragma omp for schedule(static)
+			for( long long r=0; r < numBlockRows; r++ )
+			{
+				std::size_t i = b0 + (std::size_t)r;
+				const ValueType* row;
+				if( direct )
+					row = &m_X[ i*n ];
+				else
+				{
+					if( isQuantized() )
+						get_row( i, &block[(std::size_t)r*n] );
+					row = &block[(std::size_t)r*n];
+				}
+
+				if( k == 1 )
+				{
+					// Dot product with independent partial sums (SIMD friendly)
+					ValueType s[4] = { 0, 0, 0, 0 };
+					std::size_t j=0;
+					for( ; j+4 <= n; j+=4 )
+					{
+						s[0] += row[j  ] * B[j  ];
+						s[1] += row[j+1] * B[j+1];
+						s[2] += row[j+2] * B[j+2];
+						s[3] += row[j+3] * B[j+3];
+					}
+					for( ; j < n; j++ )
+						s[0] += row[j] * B[j];
+					res[i] = (s[0] + s[1]) + (s[2] + s[3]);
+				}
+				else
+				{
+					// Rank-1 updates, inner loop is contiguous in B and acc
+					std::fill( acc.begin(), acc.end(), (ValueType)0.0 );
+					for( std::size_t j=0; j < n; j++ )
+					{
+						const ValueType  xj = row[j];
+						const ValueType* Bj = &B[ j*k ];
+						for( std::size_t c=0; c < k; c++ )
+							acc[c] += xj * Bj[c];
+					}
+					for( std::size_t c=0; c < k; c++ )
+						res[ c*m_numRows + i ] = acc[c];
+				}
+			}
+		}
+	}
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 //	Core Functions
 ////////////////////////////////////////////////////////////////////////////////
@@ -444,6 +768,82 @@ void get_row( std::size_t row, MATTOOLS_IFSTREAM& M, std::size_t n, std::size_t
 }
 
 
+unsigned short float_to_half( float f )
+{
+	unsigned int x;
+	memcpy( &x, &f, sizeof(float) );
+
+	unsigned int sign = (x >> 16) & 0x8000;
+	int          exp  = (int)((x >> 23) & 0xff) - 127 + 15;
+	unsigned int mant = x & 0x007fffff;
+
+	// NaN and Inf
+	if( ((x >> 23) & 0xff) == 0xff )
+		return (unsigned short)(sign | 0x7c00 | (mant ? 0x200 : 0));
+
+	// Overflow, clamp to Inf
+	if( exp >= 31 )
+		return (unsigned short)(sign | 0x7c00);
+
+	// Underflow, produce denormal or zero
+	if( exp <= 0 )
+	{
+		if( exp < -10 )
+			return (unsigned short)sign;
+		mant |= 0x00800000;
+		unsigned int shift = (unsigned int)(14 - exp);
+		unsigned int half  = mant >> shift;
+		// Round to nearest even
+		unsigned int rest  = mant & ((1u << shift) - 1);
+		unsigned int mid   = 1u << (shift - 1);
+		if( rest > mid || (rest == mid && (half & 1)) )
+			half++;
+		return (unsigned short)(sign | half);
+	}
+
+	// Normalized, round to nearest even (may carry into exponent)
+	unsigned int half = sign | ((unsigned int)exp << 10) | (mant >> 13);
+	unsigned int rest = mant & 0x1fff;
+	if( rest > 0x1000 || (rest == 0x1000 && (half & 1)) )
+		half++;
+	return (unsigned short)half;
+}
+
+float half_to_float( unsigned short h )
+{
+	unsigned int sign = (unsigned int)(h & 0x8000) << 16;
+	unsigned int exp  = (h >> 10) & 0x1f;
+	unsigned int mant = h & 0x3ff;
+	unsigned int x;
+
+	if( exp == 0 )
+	{
+		if( mant == 0 )
+			x = sign;
+		else
+		{
+			// Denormal, normalize
+			exp = 127 - 15 + 1;
+			while( !(mant & 0x400) )
+			{
+				mant <<= 1;
+				exp--;
+			}
+			mant &= 0x3ff;
+			x = sign | (exp << 23) | (mant << 13);
+		}
+	}
+	else
+	if( exp == 31 )
+		x = sign | 0x7f800000 | (mant << 13);
+	else
+		x = sign | ((exp - 15 + 127) << 23) | (mant << 13);
+
+	float f;
+	memcpy( &f, &x, sizeof(float) );
+	return f;
+}
+
 ValueType multiply( ValueType* a, ValueType* b, std::size_t n )
 {
 	ValueType val=0;
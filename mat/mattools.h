@@ -80,6 +80,31 @@ class RawMatrix
 public:
 	static std::size_t getFileSize( const char* filename );
 
+	/// On-disk and in-memory element storage.
+	/// Quantized formats are always kept in memory and are read-only. Int16
+	/// uses a per-column scale factor (stored as trailing float32 vector of
+	/// numCols entries in the file), Float16 is IEEE 754 half precision.
+	enum StorageType {
+		StorageFloat32 = 0,
+		StorageFloat16 = 1,
+		StorageInt16   = 2
+	};
+
+	/// Size in bytes of a single element
+	static std::size_t getElementSize( StorageType storage );
+
+	/// Number of rows of an m x numCols matrix file of given size in bytes
+	static std::size_t getNumRowsFromFileSize( std::size_t fileSize, 
+		                          std::size_t numCols, StorageType storage );
+
+	/// Per column error statistics of \a quantize()
+	struct QuantizationError
+	{
+		double maxAbs; ///< maximum absolute error
+		double rms;    ///< root mean square error
+		double relRms; ///< RMS error relative to RMS of column values
+	};
+
 public:
 	RawMatrix();
 	~RawMatrix();
@@ -96,7 +121,8 @@ public:
 	void clear();
 
 	bool load( std::size_t m, std::size_t n, const char* filename, 
-		       bool tryToLoadIntoMemory=true );
+		       bool tryToLoadIntoMemory=true, 
+		       StorageType storage=StorageFloat32 );
 
 	bool allocate( std::size_t m, std::size_t n );
 
@@ -110,6 +136,14 @@ public:
 
 	bool isInMemory() const { return m_inMemory; /* && m_X;*/ }
 
+	StorageType getStorageType() const { return m_storage; }
+	bool isQuantized() const { return m_storage != StorageFloat32; }
+
+	/// Convert in-memory float32 matrix to reduced precision storage.
+	/// Optionally reports the error per column with respect to float32.
+	bool quantize( StorageType storage, 
+		           std::vector<QuantizationError>* error=NULL );
+
 	std::string getFilename() const { return m_filename; }
 
 	std::size_t getNumRows() const { return m_numRows; }
@@ -127,6 +161,20 @@ public:
 	/// @param[out] res solution A*x, of size of number of rows of A
 	void multiply( ValueType* x, ValueType* res );
 
+	/// Linear combination of the first n columns, i.e. res = A(:,0:n-1)*x.
+	/// In-memory matrices are traversed row-wise in parallel (OpenMP).
+	/// @param[in] x coefficient vector of size n <= number of columns of A
+	/// @param[out] res solution, of size of number of rows of A
+	void multiplyColumns( const ValueType* x, std::size_t n, ValueType* res ) const;
+
+	/// Multiply with k vectors at once, i.e. res = A*B for a numCols x k 
+	/// matrix B. The matrix A is streamed only once, blocks of rows are 
+	/// processed in parallel (OpenMP), out-of-core rows are read sequentially.
+	/// @param[in] B row-major matrix of size number of columns of A times k
+	/// @param[out] res solution, stored as k consecutive result vectors of 
+	///             size of number of rows of A each (i.e. column-major)
+	void multiplyMatrix( const ValueType* B, std::size_t k, ValueType* res ) const;
+
 	//@{ Modify operations currently only allowed for in-memory matrices!
 	void set_row( std::size_t row, ValueType* buf );
 	void set_col( std::size_t col, ValueType* buf );
@@ -138,9 +186,18 @@ public:
 protected:
 	void checkStreamIsOpen() const;
 
+	/// Return false and print error if matrix can not be modified
+	bool checkWriteable() const;
+
+	/// Decode quantized element at linear (row-major) index
+	ValueType dequantize( std::size_t idx, std::size_t col ) const;
+
 private:
 	boost::shared_ptr  <MATTOOLS_IFSTREAM>  m_fX;
 	boost::shared_array<ValueType> m_X;
+	boost::shared_array<unsigned short> m_Q; // quantized data (if not float32)
+	std::vector<ValueType> m_scale;         // per column scale (int16 only)
+	StorageType m_storage;
 	std::size_t m_numRows, m_numCols;
 	bool m_inMemory;
 	std::string m_filename;
@@ -154,6 +211,12 @@ private:
 /// print debug information to standard output
 void mattools_debug_info();
 
+/// convert to IEEE 754 half precision (round to nearest)
+unsigned short float_to_half( float f );
+
+/// convert from IEEE 754 half precision
+float half_to_float( unsigned short h );
+
 /// copy row from memory (untested?);
 void get_row( std::size_t row, ValueType* M, std::size_t n, std::size_t m, ValueType* buf );
 
@@ -484,6 +484,34 @@ void solve_ls( const Matrix& A, const Vector& b, Vector& x )
 	x = prod( V, x ); // x = V * x	
 }
 
+/// Solve AX=B least squares via Penrose inverse for all columns of B at once,
+/// i.e. X = pinv(A)*B with the same truncation of singular values as in 
+/// \a solve_ls(). The result can be cached as solve operator of A.
+/// \param[in]  A system matrix
+/// \param[in]  B right hand sides (columns)
+/// \param[out] X least squares solutions (columns)
+template<class Matrix,class Vector,class ValueType>
+void solve_ls_multi( const Matrix& A, const Matrix& B, Matrix& X )
+{
+	using namespace boost::numeric::ublas;
+
+	Matrix U,V;
+	Vector sigma;
+	compute_svd<Matrix,Vector,ValueType>( A, U, sigma,V );
+
+	ValueType eps = 1e-12;
+
+	// Estimate number of leading non-zero entries in sigma
+	unsigned nz;
+	for( nz=0; nz < sigma.size() && sigma[nz]>eps; nz++ );
+
+	// Compute X = V * diag(sigma_inverse) * trans(U) * B
+	Matrix UtB = prod( trans( subrange( U, 0,U.size1(), 0,nz ) ), B );
+	for( unsigned i=0; i < nz; i++ )
+		row( UtB, i ) *= 1.0 / sigma[i];
+	X = prod( subrange( V, 0,V.size1(), 0,nz ), UtB );
+}
+
 template<class Matrix,class Vector,class ValueType>
 void pseudo_inverse( const Matrix& A, Matrix& Ainv, ValueType eps=1e-12 )
 {
@@ -1,6 +1,7 @@
 #include "StatisticalDeformationModel.h"
 #include <iostream>
 #include <fstream>
+#include <algorithm>
 #include <boost/format.hpp>
 
 StatisticalDeformationModel::StatisticalDeformationModel()
@@ -175,23 +176,29 @@ bool StatisticalDeformationModel::
 
 bool StatisticalDeformationModel::
  loadRawVectorfields( unsigned numFields, const char* filename,
-			         mattools::RawMatrix& mat )
+			         mattools::RawMatrix& mat,
+			         mattools::RawMatrix::StorageType storage )
 {	
-	// Number of elements in matrix
-	unsigned numElements = mattools::RawMatrix::getFileSize( filename )
-	                       / sizeof(mattools::ValueType);
+	using mattools::RawMatrix;
+
 	// Number of rows, i.e. size of single column representing a vectorfield
-	unsigned numRows = numElements / numFields;
+	size_t fileSize = RawMatrix::getFileSize( filename );
+	size_t numRows = RawMatrix::getNumRowsFromFileSize( fileSize, numFields, 
+	                                                    storage );
+	// Expected file size
+	size_t expectedSize = numRows*numFields*RawMatrix::getElementSize( storage );
+	if( storage == RawMatrix::StorageInt16 )
+		expectedSize += numFields*sizeof(float);
 	
 	// Sanity check
-	if( numElements % numFields != 0 || numRows % 3 != 0 )
+	if( numFields == 0 || fileSize != expectedSize || numRows % 3 != 0 )
 	{
 		std::cerr << "Error: Matrix size mismatch in \"" << filename << "\"!\n";
 		return false;
 	}
 	
 	// Load matrix	
-	return mat.load( numRows, numFields, filename );
+	return mat.load( numRows, numFields, filename, true, storage );
 }
 
 void StatisticalDeformationModel::
@@ -225,8 +232,12 @@ bool StatisticalDeformationModel::
 bool StatisticalDeformationModel::
  loadEigenmodes( unsigned numFields, const char* filename )
 {
+	mattools::RawMatrix::StorageType storage;
+	if( !parseStorageType( m_config.eigenmodesFormat, storage ) )
+		return false;
+
 	m_numSamples = numFields;
-	bool ok = loadRawVectorfields( numFields, filename, m_eigenmodes );
+	bool ok = loadRawVectorfields( numFields, filename, m_eigenmodes, storage );
 	m_status.hasEigenmodes = ok;
 	return ok;
 }
@@ -282,9 +293,21 @@ bool StatisticalDeformationModel::
 		);
 
 	if( !m_config.filenameEigenmodes.empty() )
-		ok &= m_eigenmodes.save(
+	{
+		// Reduced precision storage. Only a copy is quantized, such that the
+		// model itself keeps its full precision eigenmodes. (The copy shares
+		// the float32 data, quantize() allocates new storage for the copy.)
+		mattools::RawMatrix::StorageType storage;
+		if( !parseStorageType( m_config.eigenmodesFormat, storage ) )
+			return false;
+		mattools::RawMatrix modes = m_eigenmodes;
+		if( storage != modes.getStorageType() )
+			ok &= quantizeMatrix( modes, storage );
+
+		ok &= modes.save(
 			(basepath + m_config.filenameEigenmodes).c_str()
 		);
+	}
 
 	if( !m_config.filenameV.empty() )
 		rednum::save_matrix<mattools::ValueType,Matrix>( 
@@ -323,6 +346,57 @@ bool StatisticalDeformationModel::
 	return ok;
 }
 
+bool StatisticalDeformationModel::
+  parseStorageType( std::string format, 
+                    mattools::RawMatrix::StorageType& storage )
+{
+	if( format.empty() || format == "float32" )
+		storage = mattools::RawMatrix::StorageFloat32;
+	else
+	if( format == "float16" )
+		storage = mattools::RawMatrix::StorageFloat16;
+	else
+	if( format == "int16" )
+		storage = mattools::RawMatrix::StorageInt16;
+	else
+	{
+		std::cerr << "Error: Unknown eigenmodes format \"" << format << "\"!\n";
+		return false;
+	}
+	return true;
+}
+
+bool StatisticalDeformationModel::
+  quantizeEigenmodes( mattools::RawMatrix::StorageType storage, 
+                      std::ostream& os )
+{
+	return quantizeMatrix( m_eigenmodes, storage, os );
+}
+
+bool StatisticalDeformationModel::
+  quantizeMatrix( mattools::RawMatrix& X, 
+                  mattools::RawMatrix::StorageType storage, std::ostream& os )
+{
+	using mattools::RawMatrix;
+	using boost::format;
+
+	std::vector<RawMatrix::QuantizationError> err;
+	if( !X.quantize( storage, &err ) )
+	{
+		std::cerr << "Error: Could not convert eigenmodes to reduced precision!\n";
+		return false;
+	}
+
+	// Error report wrt float32
+	os << "Eigenmode quantization error (wrt float32):\n"
+	   << format("%5s  %12s  %12s  %12s\n") % "mode" % "max abs" % "rms" % "rel. rms";
+	for( unsigned i=0; i < err.size(); i++ )
+		os << format("%5d  %12.6g  %12.6g  %12.6g\n") 
+		      % i % err[i].maxAbs % err[i].rms % err[i].relRms;
+
+	return true;
+}
+
 ///////////////////////////////////////////////////////////////////////////////
 //	Get
 ///////////////////////////////////////////////////////////////////////////////
@@ -437,23 +511,14 @@ void StatisticalDeformationModel::
 	
 	double normalization = 1.0 / sqrt((double)getNumSamples()-1.0);
 
-	// Linear combination of eigenmodes
-	std::size_t fieldSize = getFieldSize();
-	mattools::ValueType* buf = new mattools::ValueType[ fieldSize ];
+	// Linear combination of eigenmodes, evaluated row-wise in a single pass
+	// over the matrix (multi-threaded for in-memory matrices)
+	std::vector<mattools::ValueType> ci( std::max( n, 1u ), 0 );
 	for( unsigned i=0; i < n; i++ )
-	{
-		getEigenmode( i, buf );
+		ci[i] = (mattools::ValueType)(normalization * coeffs(i));
 
-		mattools::ValueType ci = (mattools::ValueType)(normalization * coeffs(i));
-
-		if( i==0 )
-			// overwrite result entries with first term
-			mattools::multiply        ( ci, buf, fieldSize, result );
-		else
-			// add additional terms
-			mattools::multiply_and_add( ci, buf, fieldSize, result );
-	}
-	delete [] buf;
+	std::size_t fieldSize = getFieldSize();
+	m_eigenmodes.multiplyColumns( &ci[0], n, result );
 
 	// Add mean warp (if valid)
 	if( considerMean )
@@ -570,6 +635,145 @@ void StatisticalDeformationModel::
 	delete [] x_i;
 }
 
+//----------------------------------------------------------------------------
+// computeROIPCA()
+//----------------------------------------------------------------------------
+bool StatisticalDeformationModel::
+  computeROIPCA( const mattools::RawMatrix& X, 
+                 const ValueType* weights, size_t numWeights,
+                 ROIPCA& out, ProgressCallback progress, void* userData )
+{
+	typedef mattools::ValueType FloatType;
+
+	size_t m = X.getNumRows(),
+	       n = X.getNumCols();
+
+	// Weights per row or per voxel (x,y,z rows of a voxel share one weight)
+	if( m == 0 || n == 0 || (numWeights != m && numWeights*3 != m) )
+	{
+		std::cerr << "Error: ROI mask size mismatch!\n";
+		return false;
+	}
+	size_t stride = (numWeights == m) ? 1 : 3;
+
+	if( !out.warps.allocate( m, n ) )
+	{
+		std::cerr << "Error: Not enough memory for weighted warps matrix!\n";
+		return false;
+	}
+
+	// Rows are processed in blocks, X is read serially (it may be out-of-core)
+	// and each block is processed in parallel. Progress is reported per block.
+	const size_t blockSize = 4096;
+	std::vector<FloatType> block( blockSize*n );
+	std::vector<FloatType> zero( n, (FloatType)0.0 );
+
+	// (1) Apply weights and accumulate upper triangle of S = Xw'*Xw
+	std::vector<double> S( n*n, 0.0 );
+	for( size_t b0=0; b0 < m; b0 += blockSize )
+	{
+		size_t b1 = std::min( b0+blockSize, m );
+
+		// Rows outside the ROI do not contribute and are not even read
+		int numActive = 0;
+		for( size_t i=b0; i < b1; i++ )
+		{
+			FloatType w = weights[i/stride];
+			if( w == (FloatType)0.0 )
+			{
+				out.warps.set_row( i, &zero[0] );
+				continue;
+			}
+
+			FloatType* row = &block[numActive*n];
+			X.get_row( i, row );
+			mattools::multiply( w, row, n, row );
+			out.warps.set_row( i, row );
+			numActive++;
+		}
+
+		// Each thread owns a row of S, such that no reduction is required
+		const FloatType* B = &block[0];
+		#pragma omp parallel for schedule(dynamic)
+		for( int j=0; j < (int)n; j++ )
+			for( size_t k=j; k < n; k++ )
+			{
+				double s = 0.0;
+				for( int r=0; r < numActive; r++ )
+					s += (double)B[r*n+j] * (double)B[r*n+k];
+				S[j*n+k] += s;
+			}
+
+		if( progress && !progress( 0.45*(double)b1/m, userData ) )
+			return false;
+	}
+
+	out.scatter.resize( n, n );
+	for( size_t j=0; j < n; j++ )
+		for( size_t k=j; k < n; k++ )
+			out.scatter(j,k) = out.scatter(k,j) = S[j*n+k];
+
+	// (2) Perform PCA
+	rednum::compute_pcacov<Matrix,Vector,rednum::ValueType>
+		( out.scatter, out.V, out.C, out.lambda );
+
+	if( progress && !progress( 0.5, userData ) )
+		return false;
+
+	// (3) Reconstruct eigenwarps, local ones are the weighted global ones
+	//     since W*X*V = W*(X*V), hence a single multiplication per row.
+	size_t numModes = out.V.size2();
+	if( !out.eigenwarps      .allocate( m, numModes ) ||
+		!out.eigenwarpsGlobal.allocate( m, numModes ) )
+	{
+		std::cerr << "Error: Not enough memory for eigenwarps matrices!\n";
+		return false;
+	}
+
+	std::vector<double> V( n*numModes );
+	for( size_t j=0; j < n; j++ )
+		for( size_t k=0; k < numModes; k++ )
+			V[j*numModes+k] = out.V(j,k);
+
+	std::vector<FloatType> global( blockSize*numModes ),
+	                       local ( blockSize*numModes );
+	for( size_t b0=0; b0 < m; b0 += blockSize )
+	{
+		size_t b1 = std::min( b0+blockSize, m );
+
+		for( size_t i=b0; i < b1; i++ )
+			X.get_row( i, &block[(i-b0)*n] );
+
+		#pragma omp parallel for schedule(static)
+		for( int r=0; r < (int)(b1-b0); r++ )
+		{
+			const FloatType* x = &block[r*n];
+			FloatType w = weights[(b0+r)/stride];
+			for( size_t k=0; k < numModes; k++ )
+			{
+				// Intermediate calculations in double precision
+				double val = 0.0;
+				for( size_t j=0; j < n; j++ )
+					val += (double)x[j] * V[j*numModes+k];
+
+				global[r*numModes+k] = (FloatType)val;
+				local [r*numModes+k] = (FloatType)(w*val);
+			}
+		}
+
+		for( size_t i=b0; i < b1; i++ )
+		{
+			out.eigenwarpsGlobal.set_row( i, &global[(i-b0)*numModes] );
+			out.eigenwarps      .set_row( i, &local [(i-b0)*numModes] );
+		}
+
+		if( progress && !progress( 0.5 + 0.5*(double)b1/m, userData ) )
+			return false;
+	}
+
+	return true;
+}
+
 //----------------------------------------------------------------------------
 // computeMean()
 //----------------------------------------------------------------------------
@@ -784,6 +988,11 @@ void StatisticalDeformationModel::
 	   << "offsetz  = "    << m_header.offset[2]         << endl
 	   << "reference = "   << m_reference                << endl;
 
+	// Only write non-default storage for backwards compatibility
+	if( !m_config.eigenmodesFormat.empty() && 
+	     m_config.eigenmodesFormat != "float32" )
+		os << "eigenmodesFormat = " << m_config.eigenmodesFormat << endl;
+
 	for( unsigned i=0; i < m_numSamples; i++ )
 	{
 		os << "names = " << getName(i) << endl;
@@ -911,5 +1120,12 @@ void StatisticalDeformationModel::
 	("fileMeanwarp",
 		po::value<string>	( &m_config.filenameMeanwarp ),		
 		"Meanwarp MAT file")
+
+	("eigenmodesFormat",
+		po::value<string>( &m_config.eigenmodesFormat )
+		->default_value("float32"),
+		"Storage of eigenmodes MAT file, one of float32, float16 or int16. "
+		"Int16 files store a trailing float32 scale per mode. Reduced "
+		"precision eigenmodes are loaded into memory and are read-only.")
     ;
-}
\ No newline at end of file
+}
\ No newline at end of file
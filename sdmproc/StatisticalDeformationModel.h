@@ -180,6 +180,10 @@ public:
 		std::vector<std::string> names;
 
 		std::string reference;
+
+		/// Storage of eigenmodes matrix: "float32" (default), "float16" or
+		/// "int16" (see \a mattools::RawMatrix::StorageType)
+		std::string eigenmodesFormat;
 	};
 	
 	StatisticalDeformationModel();
@@ -207,7 +211,8 @@ public:
 public:
 	/// Write all matrices for which filenames are specified to disk,
 	/// including the warpfields data matrix. Note that any existing files
-	/// will be silently overwritten!
+	/// will be silently overwritten! Eigenmodes are written in the storage
+	/// format of SDMConfig::eigenmodesFormat, the model is not modified.
 	bool saveSDM( std::string basepath="" );
 	
 	/// Write the current config to an INI file.
@@ -364,12 +369,57 @@ public:
 	/// Note that this is expensive for large data matrices X.
 	void reconstructEigenmodes();
 
+	/// Convert eigenmodes to reduced precision storage and print per mode
+	/// error statistics with respect to float32 to given stream.
+	/// Note that the eigenmodes are read-only afterwards.
+	bool quantizeEigenmodes( mattools::RawMatrix::StorageType storage,
+	                         std::ostream& os=std::cout );
+
+	/// Quantize given eigenmode matrix, see \a quantizeEigenmodes()
+	static bool quantizeMatrix( mattools::RawMatrix& X,
+	                            mattools::RawMatrix::StorageType storage,
+	                            std::ostream& os=std::cout );
+
+	/// Parse storage type string as used in \a SDMConfig::eigenmodesFormat
+	static bool parseStorageType( std::string format, 
+	                              mattools::RawMatrix::StorageType& storage );
+
+	/// Result of \a computeROIPCA()
+	struct ROIPCA
+	{
+		mattools::RawMatrix warps;            ///< weighted warps Xw = W*X
+		mattools::RawMatrix eigenwarps;       ///< local eigenwarps Xw*V
+		mattools::RawMatrix eigenwarpsGlobal; ///< global eigenwarps X*V
+		Matrix scatter; ///< scatter matrix Xw'*Xw
+		Matrix V;       ///< eigenvectors of scatter matrix
+		Matrix C;       ///< coefficients (as returned by rednum::compute_pcacov)
+		Vector lambda;  ///< eigenvalues
+	};
+
+	/// Progress callback with progress in [0,1], return false to cancel.
+	typedef bool (*ProgressCallback)( double progress, void* userData );
+
+	/// PCA restricted to a region of interest (ROI) given as row weights W.
+	/// The warpfields X are streamed only once to apply the weights and
+	/// accumulate the scatter matrix at the same time, a second pass then
+	/// reconstructs local and global eigenwarps. X may be out-of-core.
+	/// Weights are given either per row or per voxel (i.e. for 3 rows each).
+	/// Can be called from a worker thread, returns false on error or if
+	/// cancelled via the progress callback.
+	static bool computeROIPCA( const mattools::RawMatrix& X, 
+	                           const ValueType* weights, size_t numWeights,
+	                           ROIPCA& out,
+	                           ProgressCallback progress=NULL, 
+	                           void* userData=NULL );
+
 	
 protected:
 	/// Load raw data matrix with vectorfields stored in columns
 	static bool loadRawVectorfields( 
 		unsigned numFields, const char* filename, 
-		mattools::RawMatrix& mat );
+		mattools::RawMatrix& mat,
+		mattools::RawMatrix::StorageType storage
+		                       =mattools::RawMatrix::StorageFloat32 );
 
 	/// Assemble data matrix from single files, each storing one vectorfield
 	static bool loadRawVectorfieldsFromMultipleFiles( 
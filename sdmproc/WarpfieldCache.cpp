@@ -0,0 +1,116 @@
+#include "WarpfieldCache.h"
+#include <cmath>
+#include <algorithm>
+
+WarpfieldCache::WarpfieldCache( unsigned capacity )
+	: m_sdm         ( NULL ),
+	  m_capacity    ( capacity ),
+	  m_considerMean( true ),
+	  m_time        ( 0 ),
+	  m_hits        ( 0 ),
+	  m_misses      ( 0 )
+{
+}
+
+void WarpfieldCache::setSDM( const StatisticalDeformationModel* sdm )
+{
+	m_sdm = sdm;
+	clear();
+}
+
+void WarpfieldCache::setCapacity( unsigned capacity )
+{
+	m_capacity = capacity;
+	evict();
+}
+
+void WarpfieldCache::setConsiderMean( bool b )
+{
+	if( b != m_considerMean )
+		clear();
+	m_considerMean = b;
+}
+
+void WarpfieldCache::clear()
+{
+	m_entries.clear();
+	m_time = 0;
+	m_hits = m_misses = 0;
+}
+
+WarpfieldCache::Key WarpfieldCache::normalizeKey( const Key& coeffs )
+{
+	// Quantize to avoid cache misses due to floating point noise
+	const double quant = 1e-6;
+
+	Key key( coeffs.size() );
+	for( size_t i=0; i < coeffs.size(); i++ )
+		key[i] = quant * floor( coeffs[i] / quant + 0.5 );
+
+	while( !key.empty() && key.back()==0.0 )
+		key.pop_back();
+
+	return key;
+}
+
+bool WarpfieldCache::contains( const Key& coeffs ) const
+{
+	return m_entries.find( normalizeKey(coeffs) ) != m_entries.end();
+}
+
+void WarpfieldCache::evict()
+{
+	while( m_entries.size() > m_capacity )
+	{
+		// Linear search for least recently used entry, capacity is small
+		EntryMap::iterator lru = m_entries.begin();
+		for( EntryMap::iterator it=m_entries.begin(); it != m_entries.end(); ++it )
+			if( it->second.lastUsed < lru->second.lastUsed )
+				lru = it;
+		m_entries.erase( lru );
+	}
+}
+
+WarpfieldCache::Field WarpfieldCache::getField( const Key& coeffs, 
+                                                ValueType* maxAbs )
+{
+	if( !m_sdm )
+		return Field();
+
+	Key key = normalizeKey( coeffs );
+
+	EntryMap::iterator it = m_entries.find( key );
+	if( it != m_entries.end() )
+	{
+		m_hits++;
+		it->second.lastUsed = ++m_time;
+		if( maxAbs )
+			*maxAbs = it->second.maxAbs;
+		return it->second.field;
+	}
+	m_misses++;
+
+	// Synthesize new field
+	Vector v( key.size() );
+	for( size_t i=0; i < key.size(); i++ )
+		v(i) = key[i];
+
+	Entry e;
+	e.field = Field( new ValueType[ m_sdm->getFieldSize() ] );
+	e.lastUsed = ++m_time;
+	m_sdm->synthesizeField( v, e.field.get(), m_considerMean );
+
+	e.maxAbs = 0;
+	const ValueType* f = e.field.get();
+	for( size_t i=0; i < m_sdm->getFieldSize(); i++ )
+		e.maxAbs = std::max( e.maxAbs, (ValueType)fabs( f[i] ) );
+	if( maxAbs )
+		*maxAbs = e.maxAbs;
+
+	if( m_capacity > 0 )
+	{
+		m_entries[key] = e;
+		evict();
+	}
+	return e.field;
+}
@@ -0,0 +1,82 @@
+#ifndef WARPFIELDCACHE_H
+#define WARPFIELDCACHE_H
+#include "StatisticalDeformationModel.h"
+#include <boost/shared_array.hpp>
+#include <vector>
+#include <map>
+
+/// Cache of precombined warpfields, i.e. linear combinations of SDM
+/// eigenmodes as computed by \a StatisticalDeformationModel::synthesizeField().
+///
+/// Renderers can use a single precombined displacement field instead of
+/// evaluating the linear combination of all eigenmodes at every sample.
+/// Fields are cached keyed by their coefficient vector, the least recently
+/// used field is evicted when the capacity is exceeded.
+///
+/// Note that by default the mean warp is folded into the precombined field
+/// (see \a setConsiderMean()), i.e. renderers must not apply it separately.
+/// The magnitude of a combined field may exceed the value range of a single
+/// eigenmode by far, \a getField() therefore also returns the maximum
+/// absolute component such that renderers can adapt their warp range.
+class WarpfieldCache
+{
+public:
+	typedef mattools::ValueType ValueType;
+	typedef boost::shared_array<ValueType> Field;
+	typedef std::vector<double> Key;
+
+	WarpfieldCache( unsigned capacity=8 );
+
+	/// Set model, clears the cache. Pointer must remain valid.
+	void setSDM( const StatisticalDeformationModel* sdm );
+	const StatisticalDeformationModel* getSDM() const { return m_sdm; }
+
+	/// Maximum number of cached fields
+	void setCapacity( unsigned capacity );
+	unsigned getCapacity() const { return m_capacity; }
+
+	/// Add in the mean warp of the SDM (default true), clears the cache.
+	void setConsiderMean( bool b );
+	bool getConsiderMean() const { return m_considerMean; }
+
+	/// Return precombined field for given coefficients (in units of standard
+	/// deviation as in \a synthesizeField()), synthesized on a cache miss.
+	/// The returned field stays valid even if evicted from the cache.
+	/// Returns an empty field if no SDM is set. Optionally returns the
+	/// maximum absolute component of the field.
+	Field getField( const Key& coeffs, ValueType* maxAbs=NULL );
+
+	bool contains( const Key& coeffs ) const;
+
+	void clear();
+
+	///@{ Statistics
+	unsigned getNumHits  () const { return m_hits; }
+	unsigned getNumMisses() const { return m_misses; }
+	///@}
+
+protected:
+	/// Round coefficients and strip trailing zeros such that numerically
+	/// equivalent coefficient vectors map to the same cache entry.
+	static Key normalizeKey( const Key& coeffs );
+
+	void evict();
+
+private:
+	struct Entry
+	{
+		Field     field;
+		ValueType maxAbs;
+		unsigned  lastUsed;
+	};
+	typedef std::map<Key,Entry> EntryMap;
+
+	const StatisticalDeformationModel* m_sdm;
+	EntryMap m_entries;
+	unsigned m_capacity;
+	bool     m_considerMean;
+	unsigned m_time;
+	unsigned m_hits, m_misses;
+};
+
+#endif // WARPFIELDCACHE_H
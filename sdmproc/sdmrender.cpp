@@ -0,0 +1,626 @@
+// sdmrender - Headless CPU raycasting of a statistical deformation model
+#include <boost/program_options.hpp>
+#include <boost/property_tree/ptree.hpp>
+#include <boost/property_tree/ini_parser.hpp>
+#include <string>
+#include <vector>
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <cmath>
+#include "StatisticalDeformationModel.h"
+#include "WarpfieldCache.h"
+#include "VolumeRendering/VolumeData.h"
+#include "VolumeRendering/LookupTable.h"
+#include "VolumeRendering/VolumeRendererRaycastCPU.h"
+
+#include <vtkSmartPointer.h>
+#include <vtkImageData.h>
+#include <vtkPNGWriter.h>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+namespace po = boost::program_options;
+
+using namespace std;
+
+//-----------------------------------------------------------------------------
+//	loadVolume()
+//-----------------------------------------------------------------------------
+template<class T>
+VolumeData<T>* loadVolumeT( string filename, VolumeDataHeader* header )
+{
+	VolumeDataLoaderRAW<T> loader;
+	return loader.load( filename.c_str(), header );
+}
+
+/// Load MHD volume, returns NULL on failure
+VolumeDataHeader* loadVolume( string mhdFilename, void** dataptr )
+{
+	VolumeDataHeaderLoaderMHD header;
+	if( !header.load( mhdFilename.c_str() ) )
+	{
+		cerr << "Error: Could not load volume header \"" << mhdFilename << "\"!\n";
+		return NULL;
+	}
+
+	// RAW filename is relative to MHD
+	string path;
+	size_t seploc = mhdFilename.find_last_of("/\\");
+	if( seploc != string::npos )
+		path = mhdFilename.substr( 0, seploc+1 );
+	string rawFilename = path + header.filename();
+
+	switch( header.elementTypeName() )
+	{
+	case VolumeDataHeader::UCHAR:
+	{
+		VolumeData<unsigned char>* vol = loadVolumeT<unsigned char>( rawFilename, &header );
+		if( vol ) *dataptr = vol->rawPtr();
+		return vol;
+	}
+	case VolumeDataHeader::USHORT:
+	{
+		VolumeData<unsigned short>* vol = loadVolumeT<unsigned short>( rawFilename, &header );
+		if( vol ) *dataptr = vol->rawPtr();
+		return vol;
+	}
+	case VolumeDataHeader::FLOAT:
+	{
+		VolumeData<float>* vol = loadVolumeT<float>( rawFilename, &header );
+		if( vol ) *dataptr = vol->rawPtr();
+		return vol;
+	}
+	default:
+		cerr << "Error: Unsupported volume element type!\n";
+	}
+	return NULL;
+}
+
+//-----------------------------------------------------------------------------
+//	loadCamera()
+//-----------------------------------------------------------------------------
+
+/// Compute modelview matrix as Trackball2::getCameraMatrix() does
+void trackballCameraMatrix( double zoom, const double* q, const double* t,
+                            float* mv )
+{
+	// Rotation matrix from unit quaternion (w,x,y,z), column-major
+	double w=q[0], x=q[1], y=q[2], z=q[3];
+	double R[9] = {
+		1-2*(y*y+z*z),   2*(x*y+w*z),   2*(x*z-w*y),
+		  2*(x*y-w*z), 1-2*(x*x+z*z),   2*(y*z+w*x),
+		  2*(x*z+w*y),   2*(y*z-w*x), 1-2*(x*x+y*y) };
+
+	// Zoom * Rot * Trans
+	for( int c=0; c < 3; c++ )
+		for( int r=0; r < 3; r++ )
+			mv[4*c+r] = (float)R[3*c+r];
+	for( int r=0; r < 3; r++ )
+		mv[12+r] = (float)(R[r]*t[0] + R[3+r]*t[1] + R[6+r]*t[2]);
+	mv[14] -= (float)zoom;
+	mv[3] = mv[7] = mv[11] = 0.f;
+	mv[15] = 1.f;
+}
+
+/// Load camera lookmark as written by SDMVisVolumeRenderer::saveCamera()
+bool loadCamera( string filename, float* modelview, float& fov )
+{
+	using boost::property_tree::ptree;
+	ptree pt;
+	try {
+		boost::property_tree::ini_parser::read_ini( filename, pt );
+
+		ptree& cam = pt.get_child("SDMVis_camera_lookmark_trackball2");
+		fov = cam.get<float>("fov");
+		double zoom = cam.get<double>("zoom");
+		double q[4] = { cam.get<double>("q_scalar"), cam.get<double>("q_x"),
+		                cam.get<double>("q_y"),      cam.get<double>("q_z") };
+		double t[3] = { cam.get<double>("translation_x"),
+		                cam.get<double>("translation_y"),
+		                cam.get<double>("translation_z") };
+		trackballCameraMatrix( zoom, q, t, modelview );
+	}
+	catch( const std::exception& e )
+	{
+		cerr << "Error: Could not load camera \"" << filename << "\": "
+		     << e.what() << "\n";
+		return false;
+	}
+	return true;
+}
+
+//-----------------------------------------------------------------------------
+//	saveImage()
+//-----------------------------------------------------------------------------
+
+/// Blend RGBA raycasting result over background and save as PNG
+bool saveImage( string filename, const vector<float>& rgba, int width,
+                int rowBegin, int rowEnd, const float* bg, bool keepAlpha )
+{
+	int height = rowEnd - rowBegin;
+	int nc = keepAlpha ? 4 : 3;
+
+	vtkSmartPointer<vtkImageData> img = vtkSmartPointer<vtkImageData>::New();
+	img->SetExtent( 0, width-1, 0, height-1, 0, 0 );
+	img->SetScalarTypeToUnsignedChar();
+	img->SetNumberOfScalarComponents( nc );
+	img->AllocateScalars();
+
+	unsigned char* ptr = (unsigned char*)img->GetScalarPointer();
+	for( int y=0; y < height; y++ )
+	{
+		// VTK images are stored bottom-up
+		const float*   src = &rgba[ 4*(size_t)(rowEnd-1-y)*width ];
+		unsigned char* dst = ptr + (size_t)nc*y*width;
+		for( int x=0; x < width; x++, src+=4, dst+=nc )
+		{
+			float a = std::min( std::max( src[3], 0.f ), 1.f );
+			for( int c=0; c < 3; c++ )
+			{
+				// glBlendFunc( GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA )
+				float v = keepAlpha ? src[c] : a*src[c] + (1.f-a)*bg[c];
+				dst[c] = (unsigned char)(255.f*std::min( std::max( v, 0.f ), 1.f ) + .5f);
+			}
+			if( keepAlpha )
+				dst[3] = (unsigned char)(255.f*a + .5f);
+		}
+	}
+
+	vtkSmartPointer<vtkPNGWriter> writer = vtkSmartPointer<vtkPNGWriter>::New();
+	writer->SetFileName( filename.c_str() );
+	writer->SetInput( img );
+	writer->Write();
+	return writer->GetErrorCode() == 0;
+}
+
+//-----------------------------------------------------------------------------
+//	main()
+//-----------------------------------------------------------------------------
+int main( int argc, char* argv[] )
+{
+	StatisticalDeformationModel sdm;
+
+	vector<string> configfiles;
+	string volumeFilename, lutFilename, cameraFilename, outputFilename,
+	       batchFilename, renderModeName;
+	vector<string> warpFilenames;
+	vector<double> lambdas;
+	int    numModes, width, height, integrator, integratorSteps, numThreads,
+	       numTiles, tile, tileSize, brickSize;
+	double isovalue, stepsize, elementScale, zoom, fov, warpRange;
+	vector<float> background;
+
+	// --- Program options ---
+
+	unsigned linewidth = 80;
+
+	po::options_description general_opts("General options",linewidth,linewidth/2);
+	general_opts.add_options()
+	("help,h", "produce help message")
+
+	("config",
+		po::value<vector<string> >(&configfiles)->multitoken(),
+		"Read options from config file(s), e.g. an SDM config.")
+
+	("threads",
+		po::value<int>(&numThreads)->default_value(0),
+		"Number of threads, 0 uses all available cores.")
+	;
+
+	po::options_description input_opts("Input",linewidth,linewidth/2);
+	input_opts.add_options()
+	("volume",
+		po::value<string>(&volumeFilename),
+		"Reference volume (MHD), required.")
+
+	("modes",
+		po::value<int>(&numModes)->default_value(0),
+		"Number of SDM eigenmodes used as warpfields (requires SDM config).")
+
+	("warp",
+		po::value<vector<string> >(&warpFilenames)->multitoken(),
+		"Warpfield(s) as 3-channel float MHD, alternative to --modes.")
+
+	("mean",
+		"Add SDM mean warp.")
+
+	("precombine",
+		"Synthesize a single combined warpfield per set of lambda coefficients "
+		"instead of combining all SDM eigenmodes at every ray sample.")
+
+	("lambda",
+		po::value<vector<double> >(&lambdas)->multitoken(),
+		"Coefficients for warpfields.")
+
+	("elementScale",
+		po::value<double>(&elementScale)->default_value(0.1),
+		"Scaling of lambda coefficients as Warpfield::elementScale in sdmvis.")
+
+	("warpRange",
+		po::value<double>(&warpRange)->default_value(20.0),
+		"Warpfield components are clamped to [-warpRange,warpRange].")
+
+	("lut",
+		po::value<string>(&lutFilename),
+		"Lookup table (.table or Paraview .xml).")
+	;
+
+	po::options_description render_opts("Rendering",linewidth,linewidth/2);
+	render_opts.add_options()
+	("renderMode",
+		po::value<string>(&renderModeName)->default_value("iso"),
+		"One of dvr, iso, mip, silhouette.")
+
+	("isovalue",
+		po::value<double>(&isovalue)->default_value(0.042),
+		"Isovalue in normalized intensity range [0,1].")
+
+	("stepsize",
+		po::value<double>(&stepsize)->default_value(0.005),
+		"Ray traversal stepsize in texture coordinates.")
+
+	("integrator",
+		po::value<int>(&integrator)->default_value(0),
+		"0=displacement field, 1=SVF Euler, 2=SVF Midpoint, 3=SVF RK4.")
+
+	("integratorSteps",
+		po::value<int>(&integratorSteps)->default_value(2),
+		"Number of integration steps for SVF setting.")
+
+	("camera",
+		po::value<string>(&cameraFilename),
+		"Camera lookmark (.cam) saved by sdmvis.")
+
+	("zoom",
+		po::value<double>(&zoom)->default_value(5.0),
+		"Camera distance if no --camera is given.")
+
+	("fov",
+		po::value<double>(&fov)->default_value(45.0),
+		"Vertical field of view in degrees if no --camera is given.")
+
+	("width",
+		po::value<int>(&width)->default_value(512),
+		"Image width")
+
+	("height",
+		po::value<int>(&height)->default_value(512),
+		"Image height")
+
+	("background",
+		po::value<vector<float> >(&background)->multitoken(),
+		"Background RGB color in [0,1], defaults to white.")
+
+	("alpha",
+		"Write RGBA image instead of blending over background.")
+
+	("tileSize",
+		po::value<int>(&tileSize)->default_value(16),
+		"Edge length of image tiles distributed among threads.")
+
+	("brickSize",
+		po::value<int>(&brickSize)->default_value(16),
+		"Brick size for empty space skipping, 0 disables skipping. Brick "
+		"min/max are cached in a .bricks file next to the reference MHD.")
+	;
+
+	po::options_description output_opts("Output",linewidth,linewidth/2);
+	output_opts.add_options()
+	("output,o",
+		po::value<string>(&outputFilename),
+		"Output PNG image.")
+
+	("batch",
+		po::value<string>(&batchFilename),
+		"Render one image per line of the given text file, each line listing "
+		"the output filename followed by the lambda coefficients.")
+
+	("tiles",
+		po::value<int>(&numTiles)->default_value(1),
+		"Split image into this number of horizontal bands, see --tile.")
+
+	("tile",
+		po::value<int>(&tile)->default_value(0),
+		"Render only band with this index, e.g. to distribute a large image "
+		"over several nodes. Output contains only the rows of this band.")
+	;
+
+	po::options_description desc(linewidth,linewidth/2);
+	desc.add( general_opts )
+		.add( input_opts )
+		.add( render_opts )
+		.add( output_opts )
+		.add( sdm.getProgramOptions() );
+
+	po::variables_map vm;
+	try {
+		// Parse command line arguments
+		po::store(po::parse_command_line(argc, argv, desc), vm);
+		po::notify(vm);
+
+		// Parse config file(s)
+		if( vm.count("config") )
+		{
+			for( unsigned i=0; i < configfiles.size(); i++ )
+			{
+				string configfile = configfiles.at(i);
+				cout << "Reading options from \"" << configfile << "\"...\n";
+				po::store(
+					po::parse_config_file<char>(configfile.c_str(), desc), vm);
+				po::notify(vm);
+			}
+		}
+	}
+	catch( const std::exception& e )
+	{
+		cerr << "Error on parsing comand line arguments: " << e.what() << " "
+		     << desc << endl;
+		return -1;
+	}
+
+	if( vm.count("help") || volumeFilename.empty() ||
+		(outputFilename.empty() && batchFilename.empty()) )
+	{
+		cout << desc << "\n";
+		return 1;
+	}
+
+	if( numTiles < 1 || tile < 0 || tile >= numTiles )
+	{
+		cerr << "Error: Invalid tile " << tile << " for " << numTiles 
+		     << " tiles, expected --tiles >= 1 and 0 <= --tile < --tiles!\n";
+		return -1;
+	}
+
+#ifdef _OPENMP
+	if( numThreads > 0 )
+		omp_set_num_threads( numThreads );
+#endif
+
+	// --- Reference volume ---
+
+	void* volData = NULL;
+	VolumeDataHeader* vol = loadVolume( volumeFilename, &volData );
+	if( !vol )
+		return -1;
+
+	VolumeRendererRaycastCPU vren;
+	if( !vren.setVolume( vol, volData ) )
+		return -1;
+
+	// Empty space skipping
+	VolumeBricks bricks;
+	if( brickSize > 0 )
+	{
+		if( bricks.loadOrBuild( volumeFilename.c_str(), vol, volData, brickSize ) )
+			vren.setBricks( &bricks );
+		else
+			cerr << "Warning: Could not setup bricks for empty space skipping!\n";
+	}
+
+	// Aspect as in SDMVisVolumeRenderer::loadVolume()
+	vren.setAspect( (float)vol->spacingX(),
+	                (float)(vol->spacingY() * vol->resY()/(double)vol->resX()),
+	                (float)(vol->spacingZ() * vol->resZ()/(double)vol->resX()) );
+
+	size_t fieldSize = 3*(size_t)vol->resX()*vol->resY()*vol->resZ();
+
+	// --- Warpfields ---
+
+	vector< vector<float> > fields;
+	vector<const float*>    modes;
+	const float*            meanwarp = NULL;
+	bool                    precombine = false;
+	WarpfieldCache          cache;
+
+	if( numModes > 0 || vm.count("mean") )
+	{
+		cout << "Setting up a statistical deformation model (SDM)...\n";
+		if( !sdm.applyConfig() )
+			return -1;
+
+		if( sdm.getFieldSize() != fieldSize )
+		{
+			cerr << "Error: Resolution mismatch between SDM and reference volume!\n";
+			return -1;
+		}
+
+		numModes = std::min( numModes, (int)sdm.getNumSamples() );
+
+		if( vm.count("mean") && !sdm.loadMean() )
+		{
+			cerr << "Error: SDM does not specify a mean deformation file!\n";
+			return -1;
+		}
+
+		precombine = vm.count("precombine") > 0;
+		if( precombine )
+		{
+			// Eigenmodes are combined per job, see below
+			cache.setSDM( &sdm );
+			cache.setConsiderMean( vm.count("mean") > 0 );
+		}
+		else
+		{
+			fields.resize( numModes + (vm.count("mean") ? 1 : 0) );
+			for( int i=0; i < numModes; i++ )
+			{
+				fields[i].resize( fieldSize );
+				sdm.getEigenmode( i, &fields[i][0] );
+			}
+			if( vm.count("mean") )
+			{
+				fields.back().assign( sdm.getMeanPtr(), sdm.getMeanPtr() + fieldSize );
+				meanwarp = &fields.back()[0];
+			}
+		}
+	}
+	else
+	{
+		fields.resize( warpFilenames.size() );
+		for( size_t i=0; i < warpFilenames.size(); i++ )
+		{
+			void* ptr = NULL;
+			VolumeDataHeader* warp = loadVolume( warpFilenames[i], &ptr );
+			if( !warp )
+			{
+				cerr << "Error: Could not load warpfield \"" << warpFilenames[i] << "\"!\n";
+				return -1;
+			}
+			if( warp->elementTypeName() != VolumeDataHeader::FLOAT
+				|| warp->numChannels() != 3 )
+			{
+				cerr << "Error: Warpfield \"" << warpFilenames[i] << "\" must "
+				        "be a 3-channel float volume!\n";
+				delete warp;
+				return -1;
+			}
+			if( warp->resX() != vol->resX() || warp->resY() != vol->resY()
+				|| warp->resZ() != vol->resZ() )
+			{
+				cerr << "Error: Resolution mismatch between warpfield \""
+				     << warpFilenames[i] << "\" and reference volume!\n";
+				delete warp;
+				return -1;
+			}
+			fields[i].assign( (float*)ptr, (float*)ptr + fieldSize );
+			delete warp;
+		}
+		numModes = (int)fields.size();
+	}
+
+	if( !precombine )
+	{
+		for( int i=0; i < numModes; i++ )
+			modes.push_back( &fields[i][0] );
+		vren.setWarpfields( modes );
+		vren.setMeanwarp( meanwarp );
+	}
+	vren.setWarpRange( (float)warpRange );
+
+	// --- Rendering parameters ---
+
+	LookupTable lut;
+	if( !lutFilename.empty() )
+	{
+		if( !lut.read( lutFilename.c_str() ) )
+			return -1;
+		vren.setLookupTable( &lut );
+	}
+
+	int renderMode = VolumeRendererRaycastCPU::RenderIsosurface;
+	if( renderModeName == "dvr" )        renderMode = VolumeRendererRaycastCPU::RenderDirect; else
+	if( renderModeName == "mip" )        renderMode = VolumeRendererRaycastCPU::RenderMIP; else
+	if( renderModeName == "silhouette" ) renderMode = VolumeRendererRaycastCPU::RenderSilhouette;
+	vren.setRenderMode( renderMode );
+	vren.setIsovalue( (float)isovalue );
+	vren.setStepsize( (float)stepsize );
+	vren.setIntegrator( integrator );
+	vren.setIntegratorSteps( integratorSteps );
+	vren.setTileSize( tileSize );
+
+	float modelview[16];
+	float fovy = (float)fov;
+	if( !cameraFilename.empty() )
+	{
+		if( !loadCamera( cameraFilename, modelview, fovy ) )
+			return -1;
+	}
+	else
+	{
+		// Default Trackball2 camera
+		double q[4] = { 1,0,0,0 }, t[3] = { 0,0,0 };
+		trackballCameraMatrix( zoom, q, t, modelview );
+	}
+	vren.setCamera( modelview, fovy );
+
+	float bg[3] = { 1.f, 1.f, 1.f };
+	for( size_t c=0; c < 3 && c < background.size(); c++ )
+		bg[c] = background[c];
+
+	// --- Jobs ---
+
+	// Each job is an output filename with a set of lambda coefficients
+	vector< pair< string, vector<double> > > jobs;
+	if( !outputFilename.empty() )
+		jobs.push_back( make_pair( outputFilename, lambdas ) );
+	if( !batchFilename.empty() )
+	{
+		ifstream f( batchFilename.c_str() );
+		if( !f.is_open() )
+		{
+			cerr << "Error: Could not open batch file \"" << batchFilename << "\"!\n";
+			return -1;
+		}
+		string line;
+		while( getline( f, line ) )
+		{
+			stringstream ss( line );
+			string name;
+			if( !(ss >> name) || name[0]=='#' )
+				continue;
+			vector<double> l;
+			double v;
+			while( ss >> v )
+				l.push_back( v );
+			jobs.push_back( make_pair( name, l ) );
+		}
+	}
+
+	// Band of image rows to render
+	int rowBegin = ( tile    * height) / numTiles,
+	    rowEnd   = ((tile+1) * height) / numTiles;
+
+	vector<float> rgba( 4*(size_t)width*height, 0.f );
+	for( size_t j=0; j < jobs.size(); j++ )
+	{
+		cout << "Rendering " << j+1 << "/" << jobs.size() << ": "
+		     << jobs[j].first << "\n";
+
+		const vector<double>& l = jobs[j].second;
+		WarpfieldCache::Field combined;
+		if( precombine )
+		{
+			// Convert to synthesizeField() coefficients which are normalized
+			// by 1/sqrt(n-1) while raw eigenmodes are scaled by lambda only.
+			double normalization = sqrt( (double)sdm.getNumSamples() - 1.0 );
+			WarpfieldCache::Key coeffs( numModes, 0.0 );
+			for( int i=0; i < numModes && i < (int)l.size(); i++ )
+				coeffs[i] = normalization * elementScale * l[i];
+
+			// The combined field includes the mean warp (if requested via 
+			// --mean), so no separate meanwarp is set. Its components are
+			// not clamped to the range of a single eigenmode.
+			float maxAbs;
+			combined = cache.getField( coeffs, &maxAbs );
+			vren.setWarpRange( std::max( (float)warpRange, maxAbs ) );
+			vren.setWarpfields( vector<const float*>( 1, combined.get() ) );
+			vren.setLambda( 0, 1.f );
+		}
+		else
+		{
+			for( int i=0; i < numModes; i++ )
+				vren.setLambda( i, (float)(elementScale * (i < (int)l.size() ? l[i] : 0.0)) );
+		}
+
+		vren.render( width, height, &rgba[0], rowBegin, rowEnd );
+		if( brickSize > 0 )
+			cout << "Skipped " << vren.getNumSkippedBricks() << "/" 
+			     << bricks.getNumBricks() << " bricks\n";
+
+		if( !saveImage( jobs[j].first, rgba, width, rowBegin, rowEnd, bg,
+		                vm.count("alpha")>0 ) )
+		{
+			cerr << "Error: Could not save \"" << jobs[j].first << "\"!\n";
+			return -1;
+		}
+	}
+
+	delete vol;
+
+	cout << "sdmrender finished.\n";
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,256 @@
+// svmsearch - CLI to search SVM weights and number of components for a trait
+#include "mat/SVMGridSearch.h"
+#include <string>
+#include <vector>
+#include <iostream>
+#include <fstream>
+#include <boost/program_options.hpp>
+
+namespace po = boost::program_options;
+
+using namespace std;
+
+//-----------------------------------------------------------------------------
+//	loadLabels()
+//-----------------------------------------------------------------------------
+bool loadLabels( vector<int>& labels, string filename )
+{
+	ifstream f( filename.c_str() );
+	if( !f.is_open() )
+	{
+		cerr << "Error: Could not open labels textfile \"" << filename << "\"!\n";
+		return false;
+	}
+
+	// one label per line, labels <= 0 are mapped to class A (-1)
+	labels.clear();
+	int val;
+	while( f >> val )
+		labels.push_back( val <= 0 ? -1 : +1 );
+	return true;
+}
+
+//-----------------------------------------------------------------------------
+//	loadMatrix()
+//-----------------------------------------------------------------------------
+bool loadMatrix( vector<double>& M, int nrows, int& ncols, string filename )
+{
+	ifstream f( filename.c_str(), ios::binary );
+	if( !f.is_open() )
+	{
+		cerr << "Error: Could not open matrix \"" << filename << "\"!\n";
+		return false;
+	}
+
+	// guess dimensionality from number of labels (element type is float32)
+	f.seekg( 0, ios::end );
+	size_t size = (size_t)f.tellg() / sizeof(float);
+	f.seekg( 0, ios::beg );
+	if( nrows <= 0 || size % nrows != 0 )
+	{
+		cerr << "Error: Matrix \"" << filename << "\" has " << size << " elements "
+		     << "which does not match the number of labels " << nrows << "!\n";
+		return false;
+	}
+	ncols = (int)(size / nrows);
+
+	vector<float> buf( size );
+	f.read( (char*)&buf[0], size*sizeof(float) );
+	if( !f.good() )
+	{
+		cerr << "Error: Could not read matrix \"" << filename << "\"!\n";
+		return false;
+	}
+	M.assign( buf.begin(), buf.end() );
+	return true;
+}
+
+//-----------------------------------------------------------------------------
+//	saveVector()
+//-----------------------------------------------------------------------------
+bool saveVector( const vector<double>& v, string filename )
+{
+	ofstream f( filename.c_str(), ios::binary );
+	if( !f.is_open() )
+	{
+		cerr << "Error: Could not open \"" << filename << "\" for writing!\n";
+		return false;
+	}
+
+	vector<float> buf( v.begin(), v.end() );
+	f.write( (char*)&buf[0], buf.size()*sizeof(float) );
+	return f.good();
+}
+
+//-----------------------------------------------------------------------------
+//	main()
+//-----------------------------------------------------------------------------
+int main( int argc, char* argv[] )
+{
+	string matrixFilename, labelsFilename, outputBasename, tableFilename;
+	vector<double> C, weight1, weight2;
+	vector<int> ncomp;
+	int folds;
+
+	// --- Program options ---
+
+	po::options_description general_opts("General options");
+	general_opts.add_options()
+	("help,h", "produce help message")
+
+	("matrix",
+		po::value< string >( &matrixFilename ),
+		"Eigenvector matrix V (raw float32, one row per dataset) as used by "
+		"the sdmvis trait dialog.")
+
+	("labels",
+		po::value< string >( &labelsFilename ),
+		"Labels textfile with one label per dataset (<=0 class A, >0 class B).")
+
+	("output",
+		po::value< string >( &outputBasename ),
+		"Basename for the trait of the best candidate; writes <output>.mat, "
+		"<output>.svm, <output>-normal.mat and <output>-w.mat like the trait "
+		"dialog.")
+
+	("table",
+		po::value< string >( &tableFilename ),
+		"Filename for CSV table of cross validation scores (default: stdout).")
+	;
+
+	po::options_description search_opts("Search options");
+	search_opts.add_options()
+	("C",
+		po::value< vector<double> >( &C )->multitoken(),
+		"List of C values (default: 0.001 0.01 0.1 1).")
+
+	("weight1",
+		po::value< vector<double> >( &weight1 )->multitoken(),
+		"List of class A weights (default: 1/4..4 times 100/nA).")
+
+	("weight2",
+		po::value< vector<double> >( &weight2 )->multitoken(),
+		"List of class B weights (default: 100/nB).")
+
+	("ncomp",
+		po::value< vector<int> >( &ncomp )->multitoken(),
+		"List of number of components (default: all).")
+
+	("folds",
+		po::value<int>( &folds )->default_value(10),
+		"Number of cross validation folds.")
+
+	("halving",
+		"Successive halving, i.e. evaluate only the better half of the "
+		"candidates on twice as many folds in each round.")
+	;
+
+	po::options_description desc;
+	desc.add( general_opts ).add( search_opts );
+
+	po::variables_map vm;
+	try
+	{
+		po::store( po::parse_command_line( argc, argv, desc ), vm );
+		po::notify( vm );
+	}
+	catch( exception& e )
+	{
+		cerr << "Error: " << e.what() << endl;
+		return -1;
+	}
+
+	if( vm.count("help") || !vm.count("matrix") || !vm.count("labels") )
+	{
+		cout << "svmsearch - search SVM weights and number of components "
+		        "for a trait via cross validation\n"
+		     << desc << endl;
+		return vm.count("help") ? 0 : -1;
+	}
+
+	// --- Setup problem ---
+
+	vector<int> labels;
+	if( !loadLabels( labels, labelsFilename ) )
+		return -2;
+
+	vector<double> V;
+	int nrows = (int)labels.size(), ncols;
+	if( !loadMatrix( V, nrows, ncols, matrixFilename ) )
+		return -3;
+	cout << "Eigenvector matrix " << nrows << " x " << ncols << " loaded" << endl;
+
+	SVMGridSearch search;
+	search.setup_problem( nrows, ncols, &labels[0], &V[0] );
+	search.set_num_folds( folds );
+	search.set_successive_halving( vm.count("halving") > 0 );
+
+	// fill in defaults for grid axes not given
+	vector<double> defC, defWeight1, defWeight2;
+	vector<int> defNcomp;
+	search.get_default_grid( defC, defWeight1, defWeight2, defNcomp );
+	search.set_grid( C.empty()       ? defC       : C,
+	                 weight1.empty() ? defWeight1 : weight1,
+	                 weight2.empty() ? defWeight2 : weight2,
+	                 ncomp.empty()   ? defNcomp   : ncomp );
+
+	// --- Search ---
+
+	if( !search.run() )
+		return -4;
+
+	if( tableFilename.empty() )
+		search.print_table( cout );
+	else
+	{
+		ofstream f( tableFilename.c_str() );
+		if( !f.is_open() )
+		{
+			cerr << "Error: Could not open \"" << tableFilename << "\" for writing!\n";
+			return -5;
+		}
+		search.print_table( f );
+	}
+
+	const SVMGridSearch::Result& best = search.best();
+	cout << "Best candidate: C = " << best.params.C
+	     << ", weight1 = " << best.params.weight1
+	     << ", weight2 = " << best.params.weight2
+	     << ", ncomp = " << best.params.ncomp
+	     << " (" << search.num_folds() << "-fold balanced error "
+	     << best.error << ", accuracy " << best.accuracy << ")" << endl;
+
+	if( outputBasename.empty() )
+		return 0;
+
+	// --- Compute trait of best candidate ---
+
+	SVMTrain svm;
+	if( !search.train( best.params, svm ) )
+		return -6;
+
+	vector<double> w;
+	double b;
+	svm.hyperplane( w, b );
+
+	// project w into column space of V_k
+	int k = best.params.ncomp;
+	vector<double> v_w( nrows, 0.0 );
+	for( int i=0; i < nrows; ++i )
+		for( int j=0; j < k; ++j )
+			v_w[i] += V[i*ncols+j] * w[j];
+
+	// hyperplane normal+distance and plain trait padded to full eigenspace
+	vector<double> wb( w ), wfull( w );
+	wb.push_back( b );
+	wfull.resize( nrows, 0.0 );
+
+	cout << "Saving trait to \"" << outputBasename << ".mat\"..." << endl;
+	if( !saveVector( v_w,   outputBasename + ".mat" ) ||
+	    !saveVector( wb,    outputBasename + "-normal.mat" ) ||
+	    !saveVector( wfull, outputBasename + "-w.mat" ) ||
+	    !svm.save_model( (outputBasename + ".svm").c_str() ) )
+		return -7;
+
+	return 0;
+}
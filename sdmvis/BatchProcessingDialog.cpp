@@ -1,15 +1,95 @@
 #include <QtGui>
 #include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
 #include "BatchProcessingDialog.h"
 
+#if defined(Q_OS_WIN)
+#include <windows.h>
+#include <psapi.h>    // GetProcessMemoryInfo(), link with psapi
+#elif defined(Q_OS_LINUX)
+#include <unistd.h>   // sysconf()
+#endif
+
+namespace {
+
+/// Sample CPU time (user+system in seconds) and peak resident memory (in MB)
+/// of a running process, returns false if not supported or on error.
+bool getProcessUsage( Q_PID pid, double& cpuTime, double& peakMB )
+{
+#if defined(Q_OS_WIN)
+	if( !pid )
+		return false;
+
+	FILETIME creation, exitTime, kernel, user;
+	PROCESS_MEMORY_COUNTERS pmc;
+	if( !GetProcessTimes( pid->hProcess, &creation, &exitTime, &kernel, &user ) ||
+	    !GetProcessMemoryInfo( pid->hProcess, &pmc, sizeof(pmc) ) )
+		return false;
+
+	// FILETIME counts 100 nanosecond intervals
+	ULARGE_INTEGER k, u;
+	k.LowPart = kernel.dwLowDateTime;  k.HighPart = kernel.dwHighDateTime;
+	u.LowPart = user  .dwLowDateTime;  u.HighPart = user  .dwHighDateTime;
+	cpuTime = (double)(k.QuadPart + u.QuadPart) * 1e-7;
+	peakMB  = (double)pmc.PeakWorkingSetSize / (1024.*1024.);
+	return true;
+#elif defined(Q_OS_LINUX)
+	if( pid <= 0 )
+		return false;
+
+	// utime and stime are fields 14 and 15 of /proc/<pid>/stat in clock ticks,
+	// parse after the closing bracket since the name in field 2 may contain
+	// spaces
+	std::ifstream fstat( QString("/proc/%1/stat").arg(pid).toStdString().c_str() );
+	std::string line;
+	if( !std::getline( fstat, line ) )
+		return false;
+	size_t pos = line.rfind(')');
+	if( pos == std::string::npos )
+		return false;
+
+	std::istringstream ss( line.substr( pos+1 ) );
+	std::string field;
+	for( int i=3; i < 14; ++i )
+		ss >> field;
+	unsigned long utime, stime;
+	if( !(ss >> utime >> stime) )
+		return false;
+	cpuTime = (double)(utime + stime) / (double)sysconf(_SC_CLK_TCK);
+
+	// peak resident set size is given as "VmHWM:  1234 kB"
+	std::ifstream fstatus( QString("/proc/%1/status").arg(pid).toStdString().c_str() );
+	while( std::getline( fstatus, line ) )
+		if( line.compare( 0, 6, "VmHWM:" ) == 0 )
+		{
+			double kb = 0.;
+			std::istringstream( line.substr(6) ) >> kb;
+			peakMB = kb / 1024.;
+			break;
+		}
+	return true;
+#else
+	Q_UNUSED(pid); Q_UNUSED(cpuTime); Q_UNUSED(peakMB);
+	return false;
+#endif
+}
+
+} // anonymous namespace
+
 BatchProcessingDialog::BatchProcessingDialog( QWidget* parent )
 	: QDialog(parent),
-	  m_curProc(-1)
+	  m_numRunning(0),
+	  m_crashed(false)
 {
+	m_env = QProcessEnvironment::systemEnvironment();
+
 	m_cmdTree = new QTreeWidget;
-	m_cmdTree->setColumnCount( 4 );
+	m_cmdTree->setColumnCount( 8 );
 	m_cmdTree->setHeaderLabels( QStringList() 
-		<< "Run?" << "Command" << "Description" << "Status" );
+		<< "Run?" << "Command" << "Description" << "Depends on" << "Status"
+		<< "Wall [s]" << "CPU [s]" << "Peak [MB]" );
 
 	// -- UI ------------------------------------------------------------------
 	
@@ -52,10 +132,19 @@ BatchProcessingDialog::BatchProcessingDialog( QWidget* parent )
 	QPushButton* butSaveLog= new QPushButton(tr("Save Log"));
 	//butCancel->setEnabled( false );
 
+	m_maxJobs = new QSpinBox;
+	m_maxJobs->setRange( 1, 64 );
+	m_maxJobs->setValue( qMax( 1, QThread::idealThreadCount() ) );
+	QLabel* maxJobsLabel = new QLabel( tr("Parallel jobs") );
+	maxJobsLabel->setBuddy( m_maxJobs );
+
 	QHBoxLayout *lbut = new QHBoxLayout;
 	lbut->addWidget( butStart  );
 	lbut->addWidget( butCancel );
 	lbut->addWidget( butSaveLog );
+	lbut->addStretch();
+	lbut->addWidget( maxJobsLabel );
+	lbut->addWidget( m_maxJobs );
 
 	// tabbed layout
 
@@ -77,12 +166,11 @@ BatchProcessingDialog::BatchProcessingDialog( QWidget* parent )
 	
 	// -- process -------------------------------------------------------------
 	
-	m_proc = new QProcess( this );
-	connect( m_proc, SIGNAL(readyReadStandardOutput()), this, SLOT(updateConsole()) );
-	connect( m_proc, SIGNAL(readyReadStandardError ()), this, SLOT(updateConsole()) );
-	connect( m_proc, SIGNAL(finished(int,QProcess::ExitStatus)), this, SLOT(procFinished(int,QProcess::ExitStatus)) );
-	connect( m_proc, SIGNAL(started()), this, SLOT(procStarted()) );
-	connect( m_proc, SIGNAL(error(QProcess::ProcessError)), this, SLOT(procError(QProcess::ProcessError)) );
+	// processes are created per command in startJob(), resource usage of
+	// running processes is sampled periodically
+	m_usageTimer = new QTimer( this );
+	m_usageTimer->setInterval( 250 );
+	connect( m_usageTimer, SIGNAL(timeout()), this, SLOT(sampleUsage()) );
 
 	connect( butStart , SIGNAL(clicked()), this, SLOT(start()) );
 	connect( butCancel, SIGNAL(clicked()), this, SLOT(reset()) );
@@ -90,11 +178,29 @@ BatchProcessingDialog::BatchProcessingDialog( QWidget* parent )
 	this->resize(600,400);
 }
 
+void BatchProcessingDialog::setMaxJobs( int n )
+{
+	m_maxJobs->setValue( n );
+}
+
+int BatchProcessingDialog::maxJobs() const
+{
+	return m_maxJobs->value();
+}
+
+void BatchProcessingDialog::chain( CommandList& batch )
+{
+	for( int i=1; i < batch.size(); ++i )
+		if( batch[i].deps.isEmpty() )
+			batch[i].deps.push_back( i-1 );
+}
+
 void BatchProcessingDialog::initBatch( QList<BatchCommand> batch )
 {
 	m_batch = batch;
-	m_curProc = -1;
-	
+	m_jobs.clear();
+	m_jobs.resize( m_batch.size() );
+
 	m_info->clear();
 	for( int i=0; i < m_batch.size(); ++i )
 		m_info->append( tr("[Command %1:] ").arg(i+1) + m_batch[i].toString() );
@@ -102,17 +208,23 @@ void BatchProcessingDialog::initBatch( QList<BatchCommand> batch )
 	m_cmdTree->clear();
 	for( int i=0; i < m_batch.size(); ++i )
 	{
+		// dependencies are shown 1-based like the command numbers
+		QStringList deps;
+		for( int j=0; j < m_batch[i].deps.size(); ++j )
+			deps << QString::number( m_batch[i].deps[j]+1 );
+
 		QTreeWidgetItem* item = new
-			QTreeWidgetItem( (QTreeWidget*)0, QStringList() 
+			QTreeWidgetItem( (QTreeWidget*)0, QStringList()
 				<< ""                         // run?
 				<< m_batch[i].toString("\n")  // command
 				<< m_batch[i].desc            // description
+				<< deps.join(", ")            // depends on
 				<< ""                         // status
 			  );
 		item->setToolTip( 1, m_batch[i].toString() );
-		
+
 		m_cmdTree->insertTopLevelItem( i, item );
-		
+
 		QCheckBox* runCheckBox = new QCheckBox;
 		runCheckBox->setChecked( m_batch[i].run );
 		m_cmdTree->setItemWidget( item, 0, runCheckBox );
@@ -143,199 +255,414 @@ void BatchProcessingDialog::updateCmdStatus( int i, QString status )
 {
 	QTreeWidgetItem* item = m_cmdTree->topLevelItem(i);
 	if( item )
-		item->setText( 3, status );	
+		item->setText( 4, status );
 }
 
-bool BatchProcessingDialog::getNextCommand( BatchCommand& cmd, int& index )
+void BatchProcessingDialog::updateCmdUsage( int i )
 {
-	index++;
-	if( index >= m_batch.size() )
-		return false;
+	QTreeWidgetItem* item = m_cmdTree->topLevelItem(i);
+	if( !item )
+		return;
+
+	const Job& job = m_jobs[i];
+	item->setText( 5, QString::number( job.wallTime, 'f', 1 ) );
+	item->setText( 6, job.cpuTime > 0. ? QString::number( job.cpuTime, 'f', 1 ) : QString("-") );
+	item->setText( 7, job.peakMB  > 0. ? QString::number( job.peakMB,  'f', 0 ) : QString("-") );
+}
+
+bool BatchProcessingDialog::checkDependencies( QString& errmsg ) const
+{
+	int n = m_batch.size();
+	for( int i=0; i < n; ++i )
+		for( int j=0; j < m_batch[i].deps.size(); ++j )
+		{
+			int d = m_batch[i].deps[j];
+			if( d < 0 || d >= n || d == i )
+			{
+				errmsg = tr("Command %1 has invalid dependency %2!").arg(i+1).arg(d+1);
+				return false;
+			}
+		}
+
+	// Kahn's algorithm, all commands are visited iff the graph is acyclic
+	QVector<int> indegree( n, 0 );
+	QVector< QList<int> > dependents( n );
+	for( int i=0; i < n; ++i )
+		for( int j=0; j < m_batch[i].deps.size(); ++j )
+		{
+			indegree[i]++;
+			dependents[ m_batch[i].deps[j] ].push_back( i );
+		}
 
-	DEBUG_BPD_BATCH("BatchProcessingDialog::getNextCommand()")
+	QList<int> ready;
+	for( int i=0; i < n; ++i )
+		if( indegree[i] == 0 )
+			ready.push_back( i );
 
-	cmd = m_batch[index];
-	while( !cmd.run && (index < m_batch.size()-1) )
+	int visited = 0;
+	while( !ready.isEmpty() )
 	{
-		m_con->append( tr("### Skipping command %1 because it is disabled ###").arg(index+1) );
-		updateCmdStatus( index, tr("skipped") );
-		index++;
-		cmd = m_batch[index];
+		int i = ready.takeFirst();
+		visited++;
+		for( int j=0; j < dependents[i].size(); ++j )
+			if( --indegree[ dependents[i][j] ] == 0 )
+				ready.push_back( dependents[i][j] );
 	}
-	if( !cmd.run )
+
+	if( visited < n )
 	{
-		m_con->append( tr("### Skipping command %1 because it is disabled ###").arg(index+1) );
-		updateCmdStatus( index, tr("skipped") );
+		errmsg = tr("Cyclic dependencies between commands!");
+		return false;
 	}
-	return cmd.run;
+	return true;
 }
 
 void BatchProcessingDialog::start()
 {
 	DEBUG_BPD_BATCH("BatchProcessingDialog::start()")
-m_progressBar->setMaximum(100);	
+m_progressBar->setMaximum(100);
 m_progressBar->setMinimum(0);
 m_progressBar->setValue(0);
 
-	if( m_batch.isEmpty() )
+	if( m_batch.isEmpty() || m_numRunning > 0 )
 		return;
 
-	m_curProc = -1;
-	BatchCommand curCmd;
-	if( !getNextCommand( curCmd, m_curProc ) )
+	QString errmsg;
+	if( !checkDependencies( errmsg ) )
 	{
 		m_con->append( tr("#####################################################\n"
-						  "##  No commands enabled!  \n"
-						  "#####################################################") );
+						  "##  %1  \n"
+						  "#####################################################").arg(errmsg) );
 		return;
 	}
 
-	m_proc->start( curCmd.prog, curCmd.args );	
-	if( !m_proc->waitForStarted() )
+	m_crashed = false;
+	m_jobs.clear();
+	m_jobs.resize( m_batch.size() );
+
+	bool anyEnabled = false;
+	for( int i=0; i < m_batch.size(); ++i )
+	{
+		if( m_batch[i].run )
+		{
+			anyEnabled = true;
+			updateCmdStatus( i, tr("pending") );
+		}
+		else
+		{
+			m_jobs[i].state = Skipped;
+			m_con->append( tr("### Skipping command %1 because it is disabled ###").arg(i+1) );
+			updateCmdStatus( i, tr("skipped") );
+		}
+	}
+
+	if( !anyEnabled )
 	{
-		updateCmdStatus( m_curProc, tr("error!") );
 		m_con->append( tr("#####################################################\n"
-						  "##  First command could not be started!  \n"
+						  "##  No commands enabled!  \n"
 						  "#####################################################") );
 		return;
 	}
+
 	setWindowTitle( tr("Batch processing (running)") );
+	m_usageTimer->start();
+	schedule();
+}
+
+void BatchProcessingDialog::schedule()
+{
+	// cancel commands depending on failed or cancelled ones, repeat until no
+	// more changes since dependencies may refer to any command
+	bool changed = true;
+	while( changed )
+	{
+		changed = false;
+		for( int i=0; i < m_batch.size(); ++i )
+		{
+			if( m_jobs[i].state != Pending )
+				continue;
+			for( int j=0; j < m_batch[i].deps.size(); ++j )
+			{
+				JobState s = m_jobs[ m_batch[i].deps[j] ].state;
+				if( s == Failed || s == Cancelled )
+				{
+					m_jobs[i].state = Cancelled;
+					updateCmdStatus( i, tr("cancelled") );
+					m_con->append( tr("### Cancelling command %1 since command %2 did not succeed ###")
+						.arg(i+1).arg(m_batch[i].deps[j]+1) );
+					changed = true;
+					break;
+				}
+			}
+		}
+	}
+
+	// start commands whose dependencies all succeeded (or were skipped)
+	for( int i=0; i < m_batch.size() && m_numRunning < maxJobs(); ++i )
+	{
+		if( m_jobs[i].state != Pending )
+			continue;
+
+		bool ready = true;
+		for( int j=0; j < m_batch[i].deps.size() && ready; ++j )
+		{
+			JobState s = m_jobs[ m_batch[i].deps[j] ].state;
+			ready = (s == Succeeded || s == Skipped);
+		}
+		if( ready )
+			startJob( i );
+	}
+
+	if( m_numRunning == 0 )
+		batchFinished();
+}
+
+void BatchProcessingDialog::startJob( int i )
+{
+	QProcess* proc = new QProcess( this );
+	proc->setProcessEnvironment( m_env );
+	connect( proc, SIGNAL(readyReadStandardOutput()), this, SLOT(updateConsole()) );
+	connect( proc, SIGNAL(readyReadStandardError ()), this, SLOT(updateConsole()) );
+	connect( proc, SIGNAL(finished(int,QProcess::ExitStatus)), this, SLOT(procFinished(int,QProcess::ExitStatus)) );
+	connect( proc, SIGNAL(started()), this, SLOT(procStarted()) );
+	// queued since a start error may be emitted from within start(), i.e.
+	// while schedule() is still iterating over the commands
+	connect( proc, SIGNAL(error(QProcess::ProcessError)), this, SLOT(procError(QProcess::ProcessError)),
+		Qt::QueuedConnection );
+
+	Job& job = m_jobs[i];
+	job.state = Running;
+	job.proc  = proc;
+	job.timer.start();
+	m_numRunning++;
+
+	proc->start( m_batch[i].prog, m_batch[i].args );
+}
+
+void BatchProcessingDialog::jobDone( int i, bool success, QString status )
+{
+	Job& job = m_jobs[i];
+	if( job.state != Running )
+		return;
+
+	job.state    = success ? Succeeded : Failed;
+	job.wallTime = job.timer.elapsed() / 1000.;
+	job.proc->disconnect( this );
+	job.proc->deleteLater();
+	job.proc = 0;
+	m_numRunning--;
+
+	updateCmdStatus( i, status );
+	updateCmdUsage( i );
+
+	if( !success )
+		m_crashed = true;
+
+	// progress over all commands which are done in some way
+	int done = 0;
+	for( int j=0; j < m_jobs.size(); ++j )
+		if( m_jobs[j].state != Pending && m_jobs[j].state != Running )
+			done++;
+	m_progressBar->setValue( (100*done) / m_jobs.size() );
+
+	schedule();
+}
+
+void BatchProcessingDialog::batchFinished()
+{
+	m_usageTimer->stop();
+
+	// summary table
+	int numFailed = 0, numCancelled = 0;
+	m_con->append( tr("#####################################################\n"
+					  "##  Batch processing FINISHED  \n"
+					  "#####################################################") );
+	for( int i=0; i < m_jobs.size(); ++i )
+	{
+		const Job& job = m_jobs[i];
+		if( job.state == Failed    ) numFailed++;
+		if( job.state == Cancelled ) numCancelled++;
+		if( job.state == Succeeded || job.state == Failed )
+			m_con->append( tr("## %1: %2, wall %3 s, CPU %4 s, peak %5 MB  ")
+				.arg(i+1)
+				.arg(job.state == Succeeded ? tr("succeeded") : tr("FAILED"))
+				.arg(job.wallTime, 0, 'f', 1)
+				.arg(job.cpuTime,  0, 'f', 1)
+				.arg(job.peakMB,   0, 'f', 0) );
+	}
+
+	// do nothing, requires user to reset() manually before starting next batch job
+	setWindowTitle( tr("Batch processing (finished)") );
+
+	if( numFailed > 0 )
+	{
+		emit crashed();
+		emit finished();
+		m_progressBar->setValue(0);
+
+		QMessageBox::warning(this,tr("ERROR"),
+			tr("Error : %1 command(s) failed and %2 dependent command(s) were cancelled!")
+			.arg(numFailed).arg(numCancelled));
+	}
+	else
+	{
+		emit finished();
+		m_progressBar->setMaximum(100);
+		m_progressBar->setValue(100);
+		QMessageBox::warning(this,tr("Finished"),tr("Batch processing FINISHED !"));
+		m_progressBar->setValue(0);
+		this->close();
+	}
+
+	//emit mhdFinished();
 }
 
 void BatchProcessingDialog::reset()
 {
-	m_proc->kill();
+	m_usageTimer->stop();
+	for( int i=0; i < m_jobs.size(); ++i )
+		if( m_jobs[i].proc )
+		{
+			m_jobs[i].proc->disconnect( this );
+			m_jobs[i].proc->kill();
+			m_jobs[i].proc->waitForFinished( 1000 );
+			m_jobs[i].proc->deleteLater();
+			m_jobs[i].proc = 0;
+		}
+	m_numRunning = 0;
+
 	m_con->append( tr("#####################################################\n"
 		              "##  Batch processing RESET  \n"
-	                  "#####################################################") );	
+	                  "#####################################################") );
 	m_info->clear();
 	m_batch.clear();
-	m_curProc = -1;
+	m_jobs.clear();
 	m_crashed = false;
-	
+
 	m_cmdTree->clear();
-	
+
 	setWindowTitle( tr("Batch processing") );
 }
 
+int BatchProcessingDialog::jobIndex( QObject* proc ) const
+{
+	for( int i=0; i < m_jobs.size(); ++i )
+		if( m_jobs[i].proc && m_jobs[i].proc == proc )
+			return i;
+	return -1;
+}
+
 void BatchProcessingDialog::updateConsole()
 {
-	QByteArray sout = m_proc->readAllStandardOutput(),
-	           eout = m_proc->readAllStandardError();
-	
+	QProcess* proc = qobject_cast<QProcess*>( sender() );
+	int i = jobIndex( proc );
+	if( i < 0 )
+		return;
+
+	QByteArray sout = proc->readAllStandardOutput(),
+	           eout = proc->readAllStandardError();
+
+	// prefix output with command number since processes run concurrently
+	QString prefix = QString("[%1] ").arg(i+1);
+
 	// TODO: color standard and error output differently
 	m_con->setTextColor( QColor(0,255,0) );
-	m_con->append( sout );
+	if( !sout.isEmpty() )
+		m_con->append( prefix + QString(sout).trimmed().replace("\n", "\n"+prefix) );
 	m_con->setTextColor( QColor(255,0,0) );
-	m_con->append( eout );
+	if( !eout.isEmpty() )
+		m_con->append( prefix + QString(eout).trimmed().replace("\n", "\n"+prefix) );
 	m_con->setTextColor( QColor(64,128,128) );
 }
 
 void BatchProcessingDialog::procFinished( int exitCode, QProcess::ExitStatus exitStatus )
 {
+	int i = jobIndex( sender() );
+	if( i < 0 )
+		return;
+
+	// remaining output
+	updateConsole();
+
 	m_con->append( tr("#####################################################\n"
 		              "##  Process %1 finished with exit code %2  \n"
 	                  "#####################################################")
-					  .arg(m_curProc+1)
+					  .arg(i+1)
 					  .arg(exitCode) );
 
-
-	
-
 	if( exitStatus == QProcess::Crashed )
 	{
-
-
-		updateCmdStatus( m_curProc, tr("crashed!") );
 		m_con->append( tr("#####################################################\n"
-						  "##  Last process CRASHED! Aborting batch processing! \n"
-						  "#####################################################") );
-		reset();
-		m_crashed = true;
-		emit crashed();
-		emit finished();
-		m_progressBar->setValue(0);
-
-		QMessageBox::warning(this,tr("ERROR"),tr("Error : Last process CRASHED! Aborting batch processing !"));
-
-	}
-
-	updateCmdStatus( m_curProc, tr("finished") );
-
-	BatchCommand cmd;
-	if( !getNextCommand( cmd, m_curProc ) )
-	{		
-		m_con->append( tr("#####################################################\n"
-						  "##  Batch processing FINISHED  \n"
-						  "#####################################################") );
-		
-		// do nothing, requires user to reset() manually before starting next batch job
-		setWindowTitle( tr("Batch processing (finished)") );
-		
-		if (m_crashed)
-		{
-			emit finished();
-			m_progressBar->setValue(0);
-		}
-		else
-		{
-			m_crashed = false; // why false
-			emit finished();
-			m_progressBar->setMaximum(100);
-			m_progressBar->setValue(100);
-			QMessageBox::warning(this,tr("Finished"),tr("Batch processing FINISHED !"));
-			m_progressBar->setValue(0);
-			this->close(); 
-		
-
-		}
-		
-		//emit mhdFinished();
+						  "##  Process %1 CRASHED! Cancelling dependent commands! \n"
+						  "#####################################################").arg(i+1) );
+		jobDone( i, false, tr("crashed!") );
 	}
 	else
-	{
-		// start next process
-		int oldValue=m_progressBar->value();
-		int step=100/m_batch.size();
-		m_progressBar->setValue((oldValue+step));
-		m_proc->start( cmd.prog, cmd.args );
-	}
+	if( exitCode != 0 )
+		jobDone( i, false, tr("failed (exit code %1)").arg(exitCode) );
+	else
+		jobDone( i, true, tr("finished") );
 }
 
 void BatchProcessingDialog::procStarted()
 {
+	int i = jobIndex( sender() );
+	if( i < 0 )
+		return;
+
 	m_con->append( tr("#####################################################\n"
 		              "##  Process %1 / %2 started \n"
 					  "##  %3 \n"
 	                  "#####################################################")
-					  .arg(m_curProc+1)
+					  .arg(i+1)
 					  .arg(m_batch.size())
-					  .arg(m_batch[m_curProc].desc) );
+					  .arg(m_batch[i].desc) );
 
-	updateCmdStatus( m_curProc, tr("started...") );
-	m_con->append( QString("> ") + m_batch[m_curProc].toString() );
+	updateCmdStatus( i, tr("started...") );
+	m_con->append( QString("> ") + m_batch[i].toString() );
 }
 
 void BatchProcessingDialog::procError( QProcess::ProcessError err )
 {
-	updateCmdStatus( m_curProc, tr("error!") );
+	int i = jobIndex( sender() );
+	if( i < 0 )
+		return;
+
 	m_con->append( tr("#####################################################\n"
 		              "##  Error on process %1! \n"
 					  "##  \n"
 	                  "#####################################################")
-					  .arg(m_curProc+1)
+					  .arg(i+1)
 					  );
+
+	// other errors are followed by finished() or are not fatal
+	if( err == QProcess::FailedToStart )
+		jobDone( i, false, tr("error!") );
 }
 
-void BatchProcessingDialog::printConsole( QString msg )
+void BatchProcessingDialog::sampleUsage()
 {
-	m_con->setTextColor( QColor(255,100,100) );
-	m_con->append( msg );
+	for( int i=0; i < m_jobs.size(); ++i )
+	{
+		Job& job = m_jobs[i];
+		if( job.state != Running || !job.proc )
+			continue;
+
+		double cpuTime, peakMB;
+		if( getProcessUsage( job.proc->pid(), cpuTime, peakMB ) )
+		{
+			job.cpuTime = cpuTime;
+			job.peakMB  = peakMB;
+		}
+		job.wallTime = job.timer.elapsed() / 1000.;
+		updateCmdUsage( i );
+	}
 }
 
-QProcess* BatchProcessingDialog::process()
+void BatchProcessingDialog::printConsole( QString msg )
 {
-	return m_proc;
+	m_con->setTextColor( QColor(255,100,100) );
+	m_con->append( msg );
 }
 
 
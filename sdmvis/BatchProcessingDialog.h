@@ -3,17 +3,30 @@
 
 #include <QDialog>
 #include <QList>
+#include <QVector>
 #include <QProcess>
 #include <QProgressBar>
+#include <QElapsedTimer>
 
 class QTextEdit;
 class QTreeWidget;
+class QSpinBox;
+class QTimer;
 
-/// Execute a batch of commands in a \a QProcess (non-blocking).
+/// Execute a batch of commands in \a QProcess'es (non-blocking).
 /// Provides console widget for standard output.
 ///
-/// TODO: Add status and corresponding indicator
-/// TODO: Add time measurement
+/// The batch is a dependency graph: a command is started as soon as all
+/// commands it depends on have finished successfully, with at most maxJobs()
+/// processes running concurrently. If a command fails (non-zero exit code,
+/// crash or start error) only the commands depending on it, directly or
+/// indirectly, are cancelled while independent commands continue. Disabled
+/// commands are skipped and count as satisfied dependencies.
+///
+/// Wall time, CPU time and peak resident memory are recorded per command.
+/// CPU time and memory are sampled while the process runs (Windows and Linux
+/// only), i.e. the last fraction of a second of CPU time may be missing.
+///
 /// TODO: Add log file support
 class BatchProcessingDialog : public QDialog
 {
@@ -31,21 +44,33 @@ public:
 		QString     prog; ///< command line program call
 		QStringList args; ///< command line arguments
 		QString     desc; ///< description (optional)
-		
+		QList<int>  deps; ///< indices of commands which have to succeed first
+
 		BatchCommand(): run(true) {}
-		BatchCommand( QString prog_, QStringList args_, QString desc_="" )
+		BatchCommand( QString prog_, QStringList args_, QString desc_="",
+		              QList<int> deps_=QList<int>() )
 			: run(true) {
-				prog = prog_;	args = args_;	desc = desc_; 
+				prog = prog_;	args = args_;	desc = desc_;	deps = deps_;
 			}
-		
+
 		QString toString( QString separator=" " );
 		bool run;
 	};
 
 	typedef QList<BatchCommand> CommandList;
-	
+
+	/// Make each command without dependencies depend on its predecessor,
+	/// i.e. run the batch strictly one command after another.
+	static void chain( CommandList& batch );
+
 	void initBatch( CommandList batch );
-	QProcess* process();
+
+	/// Environment for all processes started afterwards
+	void setProcessEnvironment( const QProcessEnvironment& env ) { m_env = env; }
+
+	/// Maximum number of concurrently running processes (default: number of cores)
+	void setMaxJobs( int n );
+	int  maxJobs() const;
 
 	void printConsole( QString msg );
 
@@ -61,19 +86,48 @@ protected slots:
 	void procFinished( int exitCode, QProcess::ExitStatus exitStatus );
 	void procStarted();
 	void procError( QProcess::ProcessError err );
+	void sampleUsage();
 	void saveLog();
 
 protected:
-	bool getNextCommand( BatchCommand& cmd, int& index );
+	enum JobState { Pending, Running, Succeeded, Failed, Cancelled, Skipped };
+
+	/// Run state and resource usage of a single command
+	struct Job
+	{
+		JobState      state;
+		QProcess*     proc;
+		QElapsedTimer timer;
+		double        wallTime; ///< seconds
+		double        cpuTime;  ///< seconds (user+system)
+		double        peakMB;   ///< peak resident memory in MB
+
+		Job(): state(Pending), proc(0), wallTime(0.), cpuTime(0.), peakMB(0.) {}
+	};
+
+	/// Check dependency indices and cycles, returns false on error
+	bool checkDependencies( QString& errmsg ) const;
+	/// Cancel dependents of failed commands and start ready commands
+	void schedule();
+	void startJob( int i );
+	void jobDone( int i, bool success, QString status );
+	void batchFinished();
+	/// Index of command run by given process, -1 if unknown
+	int  jobIndex( QObject* proc ) const;
+
 	void updateCmdStatus( int i, QString status );
+	void updateCmdUsage( int i );
 
-	QProcess* m_proc;
-	int m_curProc; ///< currently running proc, -1 if none is running
-	CommandList m_batch;
+	CommandList  m_batch;
+	QVector<Job> m_jobs;    ///< state per command in m_batch
+	int m_numRunning;       ///< number of currently running processes
+	QProcessEnvironment m_env;
 
 private:
 	QTextEdit *m_info, *m_con;  // m_info is OBSOLETE!
 	QTreeWidget *m_cmdTree;
+	QSpinBox *m_maxJobs;
+	QTimer *m_usageTimer;
 	bool m_crashed;
 	QProgressBar * m_progressBar;
 
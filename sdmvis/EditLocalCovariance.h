@@ -7,6 +7,14 @@
 #include "mattools.h" // mattools::RawMatrix
 #include "numerics.h" // Matrix, Vector
 
+/// Local covariance tensor field induced by edits at a reference point
+///
+/// For a reference point the edit is solved for displacements in all
+/// directions of a subdivided icosahedron. All directions share the same
+/// linear system and are solved at once, the coefficients are kept as
+/// columns of a numModes x numDirections matrix. The tensor at a query point
+/// is the covariance of the resulting displacements there, which amounts to
+/// a single 3 x numModes times numModes x numDirections product.
 class EditLocalCovariance : public SDMTensorDataProvider
 {
 public:
@@ -49,11 +57,13 @@ public:
 
 	// ---
 
-protected:
+	/// Icosahedron subdivision level of sampled edit directions (default 1),
+	/// takes effect on next \a setReferencePoint().
 	void setDirectionalSamplingLevel( int l );
+	int  getNumDirections() const { return m_icosahedron.num_vertices(); }
 	
 private:	
-	std::vector<Vector> m_coeffSet;
+	Matrix              m_coeffs; ///< numModes x numDirections
 	double              m_referencePoint[3];
 	
 	SDMVisInteractiveEditing     m_edit;
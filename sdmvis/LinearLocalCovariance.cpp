@@ -1,6 +1,7 @@
 #include "LinearLocalCovariance.h"
 #include "ImageDataSpace.h"
 #include "StatisticalDeformationModel.h"
+#include "fixnum.h"
 #include <iostream>
 #include <iomanip>
 
@@ -29,21 +30,25 @@ Matrix LinearLocalCovariance::
 	
 	Matrix Bp;
 	getReducedMatrix( x,y,z, Bp );
-	
-	// Inner system matrix  A = Bp'Bp + gamma
-	Matrix A = prod( trans(Bp), Bp );
-	for( unsigned i=0; i < A.size1(); i++ )
-		A(i,i) = A(i,i) + getGamma();
-	
-	// Pseudo inverse
-	Matrix Ainv;
-	rednum::pseudo_inverse<Matrix,Vector,ValueType>( A, Ainv );
 
 	// Precomputed part of linear co-variation depending only on reference
 	// position p:
 	//               Zpq = Bq (Bp'Bp + gamma)^(-1) Bp'
 	//                   = Bq Zp
-	return prod( Ainv, trans(Bp) );
+	// Instead of the numModes x numModes inner system we invert the 3x3
+	// matrix of the identity
+	//   (Bp'Bp + gamma)^(-1) Bp' = Bp' (Bp Bp' + gamma)^(-1)
+	fixnum::Mat3 G, Ginv;
+	fixnum::prod_fixed( Bp, trans(Bp), G );
+	for( int i=0; i < 3; i++ )
+		G(i,i) += getGamma();
+	fixnum::sym_pseudo_inverse( G, Ginv );
+
+	Matrix Zp( Bp.size2(), 3 );
+	for( unsigned i=0; i < Zp.size1(); i++ )
+		for( int j=0; j < 3; j++ )
+			Zp(i,j) = Bp(0,i)*Ginv(0,j) + Bp(1,i)*Ginv(1,j) + Bp(2,i)*Ginv(2,j);
+	return Zp;
 }
 
 void LinearLocalCovariance::
@@ -103,12 +108,6 @@ void LinearLocalCovariance::
 }
 
 
-Matrix prod3( Matrix A, Matrix B, Matrix C )
-{
-	Matrix T = prod(B,C);
-	return prod(A,T);
-}
-
 void LinearLocalCovariance::
   getTensor( double x_, double y_, double z_, float (&tensor3x3)[9] )
 {
@@ -143,11 +142,14 @@ void LinearLocalCovariance::
 		}
 	}
 
+	using fixnum::Mat3;
+
 	// Zpq = Bq (Bp'Bp + gamma)^(-1) Bp'
 	//     = Bq Zp
 	Matrix Bq;
 	getReducedMatrix( x,y,z, Bq );
-	Matrix Zpq = prod( Bq, m_Zp );
+	Mat3 Zpq;
+	fixnum::prod_fixed( Bq, m_Zp, Zpq );
 
 	// Sample covariance matrix
 	float sigma3x3[9] = { // Identity by default
@@ -159,8 +161,8 @@ void LinearLocalCovariance::
 		// Use user specified sample covariance
 		m_sampleCovariance->getTensor( x_, y_, z_, sigma3x3 );
 	}
-	Matrix Sigma(3,3);
-	rednum::matrix_from_rawbuffer<float,Matrix,double>( Sigma, (float*)sigma3x3 );
+	Mat3 Sigma;
+	fixnum::from_rawbuffer( Sigma, sigma3x3 );
 	
 	// Compute tensor
 	if( m_tensorType == CovarianceTensor )
@@ -170,50 +172,47 @@ void LinearLocalCovariance::
 		// The canonical symmetric tensor for Zpq is Zpq*Zpq' = UDU',
 		// although more direct visualization techniques could be employed.	
 	
-		Matrix T;
+		Mat3 T;
 		if( m_sampleCovariance )
 			// Weight with sample covariance
-			T = prod3( Zpq, Sigma, trans(Zpq) );
+			T = prod( Zpq, prod( Sigma, trans(Zpq) ) );
 		else
 			// Avoid unecessary multiplication with identity
 			T = prod( Zpq, trans(Zpq) );
-		rednum::matrix_to_rawbuffer( T, tensor3x3 );
+		fixnum::to_rawbuffer( T, tensor3x3 );
 	}
 	else 
 	if( m_tensorType == InteractionOperator )
 	{
 		// Return Zpq
-		rednum::matrix_to_rawbuffer( Zpq, tensor3x3 );
+		fixnum::to_rawbuffer( Zpq, tensor3x3 );
 	}
 	else
 	if( m_tensorType == IntegralTensor )
 	{
 		// Tensor used for statistical integration of tensorfield
-		Matrix T;
+		Mat3 T;
 		if( m_sampleCovariance )
 			// Weight with sample covariance
-			T = prod3( trans(Zpq), Sigma, Zpq );
+			T = prod( trans(Zpq), prod( Sigma, Zpq ) );
 		else
 			// Avoid unecessary multiplication with identity
 			T = prod( trans(Zpq), Zpq );
-		rednum::matrix_to_rawbuffer( T, tensor3x3 );
+		fixnum::to_rawbuffer( T, tensor3x3 );
 	}
 	else
 	if( m_tensorType == SelfInteractionTensor )
 	{
 		// Return Tq(q)
-		Matrix Zq = getZp( x, y, z );
-		Matrix Zqq = prod( Bq, Zq );
-		Matrix T = prod( Zqq, trans(Zqq) );
-		rednum::matrix_to_rawbuffer( T, tensor3x3 );
+		Mat3 Zqq = getZqq( Bq );
+		Mat3 T = prod( Zqq, trans(Zqq) );
+		fixnum::to_rawbuffer( T, tensor3x3 );
 	}
 	else
 	if( m_tensorType == SelfInteractionOperator )
 	{
 		// Return Zqq
-		Matrix Zq = getZp( x, y, z );
-		Matrix Zqq = prod( Bq, Zq );
-		rednum::matrix_to_rawbuffer( Zqq, tensor3x3 );
+		fixnum::to_rawbuffer( getZqq( Bq ), tensor3x3 );
 	}
 	else
 	{
@@ -222,6 +221,21 @@ void LinearLocalCovariance::
 	}
 }
 
+fixnum::Mat3 LinearLocalCovariance::
+  getZqq( const Matrix& Bq ) const
+{
+	using namespace boost::numeric::ublas;
+
+	// Zqq = Bq Zq = Bq Bq' (Bq Bq' + gamma)^(-1), a product of 3x3 matrices
+	fixnum::Mat3 G, A, Ainv;
+	fixnum::prod_fixed( Bq, trans(Bq), G );
+	A = G;
+	for( int i=0; i < 3; i++ )
+		A(i,i) += m_gamma;
+	fixnum::sym_pseudo_inverse( A, Ainv );
+	return fixnum::prod( G, Ainv );
+}
+
 void LinearLocalCovariance::
   getCoefficients( Vector edit, Vector& coeffs )
 {
@@ -4,6 +4,7 @@
 #include "SDMTensorDataProvider.h"
 #include "mattools.h" // mattools::RawMatrix
 #include "numerics.h" // Matrix, Vector
+#include "fixnum.h"   // fixnum::Mat3
 
 /// Replacement for \a EditLocalCovariance class.
 class LinearLocalCovariance : public SDMTensorDataProvider
@@ -63,6 +64,8 @@ protected:
 	void getReducedMatrix( double x, double y, double z, Matrix& B );
 
 	Matrix getZp( double x, double y, double z );
+	/// Self-interaction Zqq = Bq Zq for reduced matrix Bq at q
+	fixnum::Mat3 getZqq( const Matrix& Bq ) const;
 	
 private:	
 	std::vector<Vector> m_coeffSet;
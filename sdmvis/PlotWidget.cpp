@@ -508,7 +508,8 @@ void PlotWidget::createScene()
 		}
 		tempPoint->setLocation(QPointF(x_loc,y_loc));
 		tempPoint->setToolTip(m_nameList.at(iA)+" Pos: ("+QString::number(m_plotterMatrix->at_element(iA,m_pcX))+
-							" , "+QString::number(m_plotterMatrix->at_element(iA,m_pcY))+" )");
+							" , "+QString::number(m_plotterMatrix->at_element(iA,m_pcY))+" )"+
+							(iA<m_traitScores.size() ? " Trait score: "+QString::number(m_traitScores[iA]) : QString()));
       
 		// push Point into View->ItemList		
 		tempPoint->setThisPointSize(4);
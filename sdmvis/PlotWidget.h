@@ -56,6 +56,7 @@ private:
 	bool m_bool_traitSet;
 	QVector<double> m_movingPointVector; 
 	QVector<int> m_classVector;
+	QVector<double> m_traitScores;
 	PlotView *m_view;
 	PlotItem *m_movingItem;
 	int  m_numPCs;
@@ -72,6 +73,9 @@ public:
 	void prepareMatrix( int m,int n, Matrix *plotMatrix, double traitScaling,
 		QStringList names, QString configPath, QString configName );
 	void setTrait( Trait trait );
+	/// Signed distances of all subjects to current trait shown in tooltips,
+	/// empty to hide; takes effect on next setTrait()
+	void setTraitScores( const QVector<double>& scores ) { m_traitScores=scores; }
 	void setConfigName(QString filename);
 	void reset();
 	void setTraitList(QList<Trait> traits);
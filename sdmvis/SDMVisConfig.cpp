@@ -3,6 +3,8 @@
 #include <QSettings>
 #include <QDir>
 #include <QString>
+#include <QApplication>
+#include <QMessageBox>
 #include <fstream>
 #include <iostream>
 #include <string>
@@ -45,6 +47,19 @@ QByteArray matrixToQByteArray( Matrix M )
 	return tmp;
 }
 
+/// Warning in a message box, on the console if there is no GUI (e.g. sdmbatch)
+void show_warning( QString message )
+{
+	if( QApplication::type() == QApplication::Tty )
+	{
+		std::cerr << message.toStdString();
+		return;
+	}
+	QMessageBox msgBox;
+	msgBox.setText( message );
+	msgBox.exec();
+}
+
 //------------------------------------------------------------------------------
 //	sanityCheck()
 //------------------------------------------------------------------------------
@@ -262,12 +277,10 @@ bool SDMVisConfig::readConfig( QString iniFilename )
 	ini.endArray();
 	if (!failedTraitList.isEmpty())
 	{
-		QMessageBox msgBox;
 		QString message=QObject::tr("Warning: \n");
 		for (int iA=0;iA<failedTraitList.size();iA++)
 			message.append(QObject::tr("File Not Found ")+ failedTraitList.at(iA)+"\n");
-		msgBox.setText(message);	
-		msgBox.exec();
+		show_warning(message);
 	}
 
 	// --- ROI ----------------------------------------------------------------
@@ -538,12 +551,10 @@ void SDMVisConfig::writeConfig( QString iniFilename )
 		ini.endArray();
 	}
 	if (traits.size()>0 && failedTraitsList.size()>0){
-		QMessageBox msgBox;
 		QString message=QObject::tr("Warning: \n");
 		for (int iA=0;iA<failedTraitsList.size();iA++)
 			message.append(failedTraitsList.at(iA)+QObject::tr(", skipped : Trait is INVALID, calculate trait and warpfield!\n"));
-		msgBox.setText(message);
-		msgBox.exec();
+		show_warning(message);
 	}
 
 #ifdef SDMVIS_VARVIS_ENABLED
@@ -1,4 +1,5 @@
 #include "SDMVisInteractiveEditing.h"
+#include "fixnum.h"
 #include <cmath>
 #include <cstdio>
 #include <vector>
@@ -73,10 +74,76 @@ SDMVisInteractiveEditing::SDMVisInteractiveEditing()
       m_modeScaling( ModePlain ),
 	  m_gamma      (  100.0 ),
 	  m_editScale  (    1.0 ),
-	  m_resultScale(    1.0 )
+	  m_resultScale(    1.0 ),
+	  m_cacheSize  (   4096 ),
+	  m_dumpSystem (  false )
 {
 }
 
+//-----------------------------------------------------------------------------
+//  System cache
+//-----------------------------------------------------------------------------
+void SDMVisInteractiveEditing::clearCache()
+{
+	m_cache.clear();
+	m_cacheOrder.clear();
+}
+
+const SDMVisInteractiveEditing::System& SDMVisInteractiveEditing::
+  getSystem( const IndexVector& rows, bool weighted )
+{
+	using namespace boost::numeric::ublas;
+
+	SystemKey key;
+	key.row         = rows[0];
+	key.gamma       = m_gamma;
+	key.modeScaling = weighted ? m_modeScaling : -1;
+
+	std::map<SystemKey,System>::const_iterator it = m_cache.find( key );
+	if( it != m_cache.end() )
+		return it->second;
+
+	// Evict oldest systems
+	while( !m_cacheOrder.empty() && m_cacheOrder.size() >= m_cacheSize )
+	{
+		m_cache.erase( m_cacheOrder.front() );
+		m_cacheOrder.pop_front();
+	}
+
+	System& sys = m_cache[key];
+	m_cacheOrder.push_back( key );
+
+	if( weighted )
+	{
+		Matrix A;
+		getSystemMatrices( rows, A, sys.B, sys.D );
+
+		// Solve operator for right hand side b = trans(B)*d_edit
+		rednum::solve_ls_multi<Matrix,Vector,ValueType>( A, Matrix(trans(sys.B)), sys.K );
+	}
+	else
+	{
+		// Restricted eigenmode matrix B
+		getSubMatrix( rows, sys.B );
+
+		// Solve operator of system matrix A = trans(B)*B + gamma*I via the
+		// identity  inv(A)*trans(B) = trans(B)*inv(B*trans(B) + gamma*I),
+		// i.e. only a 3x3 matrix has to be inverted.
+		fixnum::Mat3 G, Ginv;
+		fixnum::prod_fixed( sys.B, trans(sys.B), G );
+		for( int i=0; i < 3; i++ )
+			G(i,i) += m_gamma;
+		fixnum::sym_pseudo_inverse( G, Ginv );
+
+		sys.K.resize( sys.B.size2(), 3, false );
+		for( unsigned i=0; i < sys.K.size1(); i++ )
+			for( int j=0; j < 3; j++ )
+				sys.K(i,j) = sys.B(0,i)*Ginv(0,j) + sys.B(1,i)*Ginv(1,j) 
+				           + sys.B(2,i)*Ginv(2,j);
+	}
+	return sys;
+}
+
 //-----------------------------------------------------------------------------
 //  setPickedPoints()
 //-----------------------------------------------------------------------------
@@ -211,28 +278,44 @@ void SDMVisInteractiveEditing::
 	solve( getMatrixRows( v0, m_volumeSize ), d_edit );
 }
 
+void SDMVisInteractiveEditing::
+  solveEdits( VectorType v0, const Matrix& D_edit, Matrix& C )
+{
+	double w0[3];
+	w0[0] = v0.x();	w0[1] = v0.y();	w0[2] = v0.z();
+
+	// All edits share the same linear system, i.e. a single application of
+	// the cached solve operator to all right hand sides C = K*D_edit.
+	const Matrix& K = getSystem( getMatrixRows( w0, m_volumeSize ), false ).K;
+
+	int n = (int)K.size1(),
+	    m = (int)K.size2(),  // 3 rows of the picked voxel
+	    k = (int)D_edit.size2();
+	C.resize( n, k, false );
+
+	#pragma omp parallel for schedule(static) if(n*k > 4096)
+	for( int j=0; j < k; j++ )
+		for( int i=0; i < n; i++ )
+		{
+			double sum = 0.;
+			for( int l=0; l < m; l++ )
+				sum += K(i,l) * D_edit(l,j);
+			C(i,j) = m_resultScale * sum;
+		}
+}
+
 void SDMVisInteractiveEditing::
   solve( IndexVector rows, Vector d_edit )
 {
 	using namespace boost::numeric::ublas;
 	
-	// Restricted eigenmode matrix B
-	Matrix B;
-	getSubMatrix( rows, B );
-	
-	// System matrix
-	Matrix A = prod( trans(B), B );
-	for( unsigned i=0; i < A.size1(); i++ )
-	{
-		A(i,i) = A(i,i) + m_gamma;
-	}	
-	
-	// Right hand side
-	Vector b = prod( d_edit, B );
+	// Cached restricted eigenmode matrix B and solve operator of 
+	// (trans(B)*B + gamma*I)*x = trans(B)*d_edit
+	const System& sys = getSystem( rows, false );
+	const Matrix& B = sys.B;
 	
 	// Solve A*x=b
-	Vector x;
-	rednum::solve_ls<Matrix,Vector,ValueType>( A, b, x );	
+	Vector x = prod( sys.K, d_edit );
 
 	// Store solution
 	m_copt  = x * m_resultScale;
@@ -242,43 +325,10 @@ void SDMVisInteractiveEditing::
 	m_displacement = prod( B, m_copt );
 }
 
-void SDMVisInteractiveEditing::getReducedBasis( VectorType v0, Matrix& B )
-{
-	using namespace boost::numeric::ublas;
-
-	// Get row indices
-
-	int ix = std::floor( v0.x() * (m_volumeSize[0]-1) ),
-		iy = std::floor( v0.y() * (m_volumeSize[1]-1) ),
-		iz = std::floor( v0.z() * (m_volumeSize[2]-1) );
-
-	size_t ofs = iz * m_volumeSize[1]*m_volumeSize[0] + iy * m_volumeSize[0] + ix;
-
-	std::vector<size_t> rows(3);
-	rows[0] = 3*ofs+0;
-	rows[1] = 3*ofs+1;
-	rows[2] = 3*ofs+2;
-
-	// Assemble restricted eigenmode matrix B
-
-	//static std::vector<mattools::ValueType> modeRows;
-	//modeRows.resize( rows.size(), m_eigenmodes.getNumCols() );
-	mattools::ValueType* modeRows;
-	modeRows = new mattools::ValueType[ rows.size() * m_eigenmodes.getNumCols() ];	
-	m_eigenmodes.get_rows( rows, modeRows );
-
-	// Number of modes to consider
-	unsigned numModes = m_eigenmodes.getNumCols();
-	B = Matrix( rows.size(), numModes );
-	rednum::matrix_from_rawbuffer< 
-		mattools::ValueType, Matrix, ValueType>( B, modeRows, true );
-	delete [] modeRows;
-}
-
-void SDMVisInteractiveEditing::getSystemMatrices( VectorType v0, 
+void SDMVisInteractiveEditing::getSystemMatrices( const IndexVector& rows, 
 	Matrix& A, Matrix& B, Matrix& D )
 {
-	getReducedBasis( v0, B );
+	getSubMatrix( rows, B );
 
 	unsigned numModes = m_eigenmodes.getNumCols();
 	unsigned numRows = 3;
@@ -342,9 +392,14 @@ void SDMVisInteractiveEditing::solveWeighted( VectorType v0, VectorType v1 )
 {
 	using namespace boost::numeric::ublas;
 
-	// Setup linear system
-	Matrix A, B, D;
-	getSystemMatrices( v0, A, B, D );
+	double w0[3];
+	w0[0] = v0.x();	w0[1] = v0.y();	w0[2] = v0.z();
+	IndexVector rows = getMatrixRows( w0, m_volumeSize );
+
+	// Cached linear system
+	const System& sys = getSystem( rows, true );
+	const Matrix& B = sys.B;
+	const Matrix& D = sys.D;
 
 	ValueType gamma     = m_gamma;     // 1e10;
 	ValueType editScale = m_editScale; // 1e12;
@@ -368,14 +423,17 @@ void SDMVisInteractiveEditing::solveWeighted( VectorType v0, VectorType v1 )
 	// could as well be done via: axpy_prod( d_edit, B, b, true );
 
 	// Solve A*x=b
-	Vector x;
-	rednum::solve_ls<Matrix,Vector,ValueType>( A, b, x );
+	Vector x = prod( sys.K, d_edit );
 
-#if 1
-	rednum::save_matrix<float>( A, "tmp_A.mat" );
-	rednum::save_vector<float>( b, "tmp_b.mat" );
-	rednum::save_vector<float>( x, "tmp_x.mat" );	
-#endif
+	if( m_dumpSystem )
+	{
+		// System matrix is not cached, set it up again
+		Matrix A, B_, D_;
+		getSystemMatrices( rows, A, B_, D_ );
+		rednum::save_matrix<float>( A, "tmp_A.mat" );
+		rednum::save_vector<float>( b, "tmp_b.mat" );
+		rednum::save_vector<float>( x, "tmp_x.mat" );	
+	}
 
 	// Convert result
 #if 0
@@ -6,12 +6,21 @@
 #include "mattools.h" // mattools::RawMatrix
 #include "numerics.h" // Matrix, Vector, rednum::solve_ls()
 #include <QVector3D>
+#include <map>
+#include <deque>
 
 //==============================================================================
 //	SDMVisInteractiveEditing
 //==============================================================================
 
 /// Constrained least-squares deformation editing
+///
+/// The linear system of an edit only depends on the picked voxel, the
+/// regularization gamma and the mode scaling, while the edit vector only
+/// enters the right hand side. The solve operator pinv(A)*B' of each system
+/// is therefore cached, such that repeated edits at the same voxel (e.g.
+/// while dragging) only require a 3 column matrix-vector product. Note that
+/// the cache is not thread-safe.
 class SDMVisInteractiveEditing
 {
 public:
@@ -43,6 +52,7 @@ public:
 			m_volumeSize[1] = sdm->getHeader().resolution[1];
 			m_volumeSize[2] = sdm->getHeader().resolution[2];
 		}
+		clearCache();
 	}
 
 	///@{ Required input
@@ -52,10 +62,20 @@ public:
 		m_volumeSize[1] = h;
 		m_volumeSize[2] = d;
 	}
-	void setEigenModes ( mattools::RawMatrix X ) { m_eigenmodes = X; }
-	void setEigenValues( Vector lambda )         { m_eigenvalues = lambda; }
+	void setEigenModes ( mattools::RawMatrix X ) { m_eigenmodes = X;       clearCache(); }
+	void setEigenValues( Vector lambda )         { m_eigenvalues = lambda; clearCache(); }
 	///@}
 
+	///@{ Cache of per voxel solve operators
+	void clearCache();
+	void setCacheSize( unsigned n ) { m_cacheSize = n; clearCache(); }
+	unsigned getCacheSize() const   { return m_cacheSize; }
+	///@}
+
+	/// Write system matrix, right hand side and solution of each
+	/// \a solveWeighted() to tmp_A.mat, tmp_b.mat and tmp_x.mat (default off)
+	void setDumpSystem( bool b ) { m_dumpSystem = b; }
+
 	/// Set start/end point of edit, invokes \a solve() internally.
 	void setPickedPoints( RayPickingInfo s, RayPickingInfo t );
 
@@ -92,6 +112,11 @@ public:
 	/// Solve, where v0 in normalized and d_edit in physical coordinates
 	void solveEdit( double* v0, Vector d_edit );
 	void solveEdit( VectorType v0, VectorType d_edit );
+	/// Solve for several edits at the same point v0 (normalized coordinates)
+	/// at once, where the columns of D_edit (3 x k) are the edit vectors in
+	/// physical coordinates. The solutions are returned as columns of C
+	/// (numModes x k). The last solution (\a getCoeffs() etc.) is unchanged.
+	void solveEdits( VectorType v0, const Matrix& D_edit, Matrix& C );
 	
 	/// The main solver
 	void solve( IndexVector rows, Vector d_edit );
@@ -100,9 +125,34 @@ public:
 	void solveWeighted( VectorType v0, VectorType v1 );
 
 protected:
+	/// Cached linear system of a single voxel
+	struct System
+	{
+		Matrix B; ///< restricted eigenmode rows (scaled by D if weighted)
+		Matrix D; ///< diagonal mode scaling (weighted only)
+		Matrix K; ///< solve operator, solution is x = K*d_edit
+	};
+
+	/// Cache key, mode scaling is -1 for the unweighted solve()
+	struct SystemKey
+	{
+		size_t row;
+		double gamma;
+		int    modeScaling;
+
+		bool operator < ( const SystemKey& other ) const
+		{
+			if( row   != other.row   ) return row   < other.row;
+			if( gamma != other.gamma ) return gamma < other.gamma;
+			return modeScaling < other.modeScaling;
+		}
+	};
+
+	/// Return cached system for given rows, set up on cache miss
+	const System& getSystem( const IndexVector& rows, bool weighted );
+
 	void getSubMatrix( std::vector<size_t> rows, Matrix& B );
-	void getReducedBasis( VectorType v0, Matrix& B );
-	void getSystemMatrices( VectorType v0, Matrix& A, Matrix& B, Matrix& D  );
+	void getSystemMatrices( const IndexVector& rows, Matrix& A, Matrix& B, Matrix& D  );
 
 private:
 	StatisticalDeformationModel* m_sdm;
@@ -123,6 +173,11 @@ private:
 
 	VectorType m_pStart;
 	VectorType m_pEnd;
+
+	std::map<SystemKey,System> m_cache;
+	std::deque<SystemKey>      m_cacheOrder; ///< insertion order for eviction
+	unsigned                   m_cacheSize;  ///< max. number of cached systems
+	bool                       m_dumpSystem;
 };
 
 #endif // SDMVISINTERACTIVEEDITING_H
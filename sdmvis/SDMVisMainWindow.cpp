@@ -8,6 +8,7 @@
 #include <QHelpContentWidget>
 #include <QHelpIndexWidget>
 #include <QTimer>
+#include <QtConcurrentRun>
 
 #include <fstream>
 #include <string>
@@ -18,6 +19,7 @@
 #include "PlotWidget.h"
 #include "TraitSelectionWidget.h"
 #include "ConfigGenerator.h"
+#include "SDMVisTasks.h"
 #include "e7/VolumeRendering/RayPickingInfo.h"
 
 #ifdef SDMVIS_VTKVISWIDGET_ENABLED  // automatically set by cmake (see CMakeLists.txt)
@@ -569,8 +571,8 @@ SDMVisMainWindow::SDMVisMainWindow()
 	// -- Widgets -------------------------------------------------------------
 
 	m_traitDialog = new TraitDialog( this );
-	m_batchDialog = new BatchProcessingDialog( this );
-	m_batchDialog->setWindowIcon( APP_ICON );
+	m_traitWatcher = new QFutureWatcher<bool>( this );
+	connect( m_traitWatcher, SIGNAL(finished()), this, SLOT(traitWarpfieldFinished()) );
 	
 	m_scatterPlotWidget = new ScatterPlotWidget();
 	m_scatterPlotWidget->setWindowTitle( tr("%1 - PCA scatter plot matrix").arg(APP_NAME) );
@@ -655,6 +657,11 @@ SDMVisMainWindow::SDMVisMainWindow()
 	VTKPTR<vtkCamera> masterCamera = VTKPTR<vtkCamera> ::New();
 	m_roiRender->getRenderer()->SetActiveCamera(masterCamera);
 	m_varvisRender->getRenderer()->SetActiveCamera(masterCamera);
+
+	// ROI PCA worker, progress dialog is created per computation
+	m_roiWatcher  = new QFutureWatcher<bool>( this );
+	m_roiProgress = NULL;
+	connect( m_roiWatcher, SIGNAL(finished()), this, SLOT(batchROIfinished()) );
 #endif // SDMVIS_VARVIS_ENABLED
 
 #ifdef SDMVIS_TENSORVIS_ENABLED
@@ -1135,7 +1142,6 @@ SDMVisMainWindow::SDMVisMainWindow()
 
 	// -- Finish up -----------------------------------------------------------
 
-	m_batchproc = new BatchProcessingDialog();
 	readSettings();
 #ifdef SDMVIS_VTKVISWIDGET_ENABLED
 	vtkWidget->setBaseDir( m_baseDir );
@@ -1155,6 +1161,11 @@ SDMVisMainWindow::SDMVisMainWindow()
 
 SDMVisMainWindow::~SDMVisMainWindow()
 {
+#ifdef SDMVIS_VARVIS_ENABLED
+	// Worker references our cancel flag and progress dialog
+	m_roiCanceled = 1;
+	m_roiWatcher->waitForFinished();
+#endif
 #ifdef SDMVIS_VTK_ENABLED
 	m_vtkCameraInterpolator->Delete();
 #endif
@@ -1453,10 +1464,11 @@ void SDMVisMainWindow::testBatchProcessingDialog()
 	static BatchProcessingDialog bpd;
 	BatchProcessingDialog::CommandList cmds;
 	typedef BatchProcessingDialog::BatchCommand Command;
+	// foo1 and foo2 depend on foo and may run concurrently, foo3 on both
 	cmds.push_back( Command( "foo", QStringList() << "bar", "this is foobar" ) );
-	cmds.push_back( Command( "foo1",QStringList() << "bar1", "this is foobar1" ) );
-	cmds.push_back( Command( "foo2",QStringList() << "bar2", "this is foobar2" ) );
-	cmds.push_back( Command( "foo3",QStringList() << "bar3", "this is foobar3" ) );
+	cmds.push_back( Command( "foo1",QStringList() << "bar1", "this is foobar1", QList<int>() << 0 ) );
+	cmds.push_back( Command( "foo2",QStringList() << "bar2", "this is foobar2", QList<int>() << 0 ) );
+	cmds.push_back( Command( "foo3",QStringList() << "bar3", "this is foobar3", QList<int>() << 1 << 2 ) );
 	bpd.initBatch( cmds );
 	bpd.show();
 }
@@ -1645,12 +1657,16 @@ void SDMVisMainWindow::writeSettings()
 	settings.setValue( "geometry"   , saveGeometry() );
 	settings.setValue( "windowState", saveState()    );
 	settings.setValue( "baseDir"    , m_baseDir      );
+	settings.setValue( "volumeCacheMB", m_volumeCacheMB );
 }
 
 void SDMVisMainWindow::readSettings()
 {
 	QSettings settings( APP_ORGANIZATION, APP_NAME );
 	m_baseDir = settings.value( "baseDir", QString("../data/") ).toString();
+	m_volumeCacheMB = settings.value( "volumeCacheMB", 512 ).toInt();
+	m_volumeRenderer->setVolumeCacheBudget( m_volumeCacheMB );
+	m_traitRenderer ->setVolumeCacheBudget( m_volumeCacheMB );
 	restoreGeometry( settings.value("geometry")   .toByteArray() );
 	restoreState   ( settings.value("windowState").toByteArray() );
 	restoreDockWidget( m_controlDock );
@@ -2413,6 +2429,7 @@ void SDMVisMainWindow::loadWidgetsContents()
 
 		m_traitRenderer->setTitle( specificTrait.identifier );
 
+		updateTraitScores( 0 );
 		m_volumeRenderer->getControlWidget()->getPlotWidget()->setTrait( specificTrait ); 
 		m_scatterPlotWidget->setTrait( specificTrait );
 		m_traitRenderer->getControlWidget()->getTraitSelector()->enable_TraitProperties(true);
@@ -2522,11 +2539,6 @@ void SDMVisMainWindow::setupConnections()
 			SIGNAL(updateTraitList(QList<Trait>,int)),this,SLOT(updateTraitList(QList<Trait>,int)));
 
 
-	disconnect(m_batchDialog,SIGNAL(finished()),
-		m_traitRenderer->getControlWidget()->getTraitSelector(),
-		SLOT(warpfieldGenerated()));
-
-
 	////////////////////////////////////////////////////////////////
 	//  Connect
 	////////////////////////////////////////////////////////////////
@@ -2616,11 +2628,6 @@ void SDMVisMainWindow::setupConnections()
 
 	connect(m_traitRenderer->getControlWidget()->getTraitSelector(),
 			SIGNAL(updateTraitList(QList<Trait>,int)),this,SLOT(updateTraitList(QList<Trait>,int)));
-
-
-	connect(m_batchDialog,SIGNAL(finished()),
-		m_traitRenderer->getControlWidget()->getTraitSelector(),
-		SLOT(warpfieldGenerated()));
 }
 
 void SDMVisMainWindow::updateTraitList(QList<Trait> updatedList, int pos)
@@ -2651,6 +2658,7 @@ void SDMVisMainWindow::updateTraitList(QList<Trait> updatedList, int pos)
 	}	
 	else
 	{
+		updateTraitScores( -1 );
 		m_volumeRenderer->getControlWidget()->getPlotWidget()->reset();
 		m_scatterPlotWidget->setEmptyClassVector();		
 	}
@@ -2666,8 +2674,24 @@ void SDMVisMainWindow::updateTraitList(QList<Trait> updatedList, int pos)
 //	ROI computation
 //------------------------------------------------------------------------------
 
+bool SDMVisMainWindow::roiProgressCallback( double progress, void* userData )
+{
+	// called from worker thread, progress dialog lives in GUI thread
+	SDMVisMainWindow* w = (SDMVisMainWindow*)userData;
+	QMetaObject::invokeMethod( w->m_roiProgress, "setValue", 
+		Qt::QueuedConnection, Q_ARG(int,(int)(100.0*progress)) );
+	return w->m_roiCanceled == 0;
+}
+
 void SDMVisMainWindow::refineROI()
 {
+	if( m_roiWatcher->isRunning() )
+	{
+		QMessageBox::warning( this, tr("sdmvis: Warning"),
+			tr("ROI computation is already running!") );
+		return;
+	}
+
 	// dataset size is given implicitly by names array
 	// get config options (config directory, warps matrix, output suffix)
 
@@ -2715,124 +2739,43 @@ void SDMVisMainWindow::refineROI()
 
 
 
-	// environment
-	QString path = m_batchVoltoolsPath;
-
-	// build batch
-	
-	typedef BatchProcessingDialog::BatchCommand Command;
-	typedef BatchProcessingDialog::CommandList  CommandList;
-
-	Command 
-		cmdApplyROI( path+"mat_op",	QStringList()
-			 << parms.sN << parms.sM 
-			 << parms.warpsFilename
-			 << parms.ROIBasename + QString(".raw")
-			 << parms.outWarps,
-			tr("Apply selection to warps datamatrix") ),
-		
-		cmdComputeScatterMat( path+"scattermat", QStringList()
-			 << "-t" << parms.sN << parms.sM
-			 << parms.outWarps
-			 << parms.outScatter,
-			tr("Compute scatter matrix") ),
-
-		cmdPCA( path+"yapca", QStringList()
-			 << "pcacov" << parms.sM << parms.sK
-			 << parms.outScatter
-			 << parms.outPCAEigenvectors
-			 << parms.outPCACoefficients
-			 << parms.outPCAEigenvalues,
-			tr("PCA analysis") ),
-
-		cmdPCA_csv( path+"yapca", QStringList()
-			 << "pcacov" << parms.sM << parms.sK
-			 << parms.outScatter
-			 << (parms.outPCAEigenvectors + ".csv")
-			 << (parms.outPCACoefficients + ".csv")
-			 << (parms.outPCAEigenvalues  + ".csv"),
-			tr("PCA analysis (.csv output)") ),
-
-		cmdReconEigenwarpsMat( path+"matmult", QStringList()
-			 << parms.sN << parms.sM << parms.sK
-			 << parms.outWarps		 // *weighted* dataset
-			 << parms.outPCAEigenvectors
-			 << parms.outEigenwarps,
-			tr("Reconstruct eigenwarp matrix (local)") ),
-		
-		cmdReconEigenwarpsMat_global( path+"matmult", QStringList()
-			 << parms.sN << parms.sM << parms.sK
-			 << parms.warpsFilename   // *original* unweighted dataset
-			 << parms.outPCAEigenvectors
-			 << parms.outEigenwarps_global,
-			tr("Reconstruct eigenwarp matrix (global)") ),
-
-		cmdNorm( path+"matnorm", QStringList()
-			 << parms.sN << parms.sK
-			 << parms.outEigenwarps,
-			tr("Column norms (local eigenwarps)") ),
-
-		cmdNorm_global( path+"matnorm", QStringList()
-			 << parms.sN << parms.sK
-			 << parms.outEigenwarps_global,
-			tr("Column norms (global eigenwarps)") );
-
-	CommandList batch;
-	batch.push_back( cmdApplyROI );
-
-	batch.push_back( cmdComputeScatterMat );
-	batch.push_back( cmdPCA );
-	batch.push_back( cmdPCA_csv );
-	batch.push_back( cmdReconEigenwarpsMat );
-	batch.push_back( cmdReconEigenwarpsMat_global );
+	// resolve paths relative to config (formerly working directory of batch)
+	QDir baseDir( m_baseDir );
+
+	RefineROITask task;
+	task.warpsFilename = baseDir.absoluteFilePath( parms.warpsFilename );
+	task.maskFilename  = baseDir.absoluteFilePath( parms.ROIBasename + QString(".raw") );
+	task.N             = parms.N;
+	task.M             = parms.M;
+	task.resolution[0] = parms.resX;
+	task.resolution[1] = parms.resY;
+	task.resolution[2] = parms.resZ;
+	task.spacing[0]    = vol->spacingX();
+	task.spacing[1]    = vol->spacingY();
+	task.spacing[2]    = vol->spacingZ();
+	task.outWarps            = parms.outWarps;
+	task.outScatter          = parms.outScatter;
+	task.outPCAEigenvectors  = parms.outPCAEigenvectors;
+	task.outPCACoefficients  = parms.outPCACoefficients;
+	task.outPCAEigenvalues   = parms.outPCAEigenvalues;
+	task.outEigenwarps       = parms.outEigenwarps;
+	task.outEigenwarpsGlobal = parms.outEigenwarps_global;
 
 	QStringList eigenWarpList;
 	QStringList eigenWarpListLocal;
 
-	// set spacing according to warpfields
-	QString sSpacingX = QString::number(m_volumeRenderer->getVolumeData()->spacingX()),
-		    sSpacingY = QString::number(m_volumeRenderer->getVolumeData()->spacingY()),
-		    sSpacingZ = QString::number(m_volumeRenderer->getVolumeData()->spacingZ());
-
 	for( int i=0; i < numEigenwarpsToExtract; ++i )
 	{
 		QString si = QString::number(i),
-				sResX = QString::number(parms.resX),
-				sResY = QString::number(parms.resY),
-				sResZ = QString::number(parms.resZ),
 		        outEigenwarp = configPath+"/" + "eigenwarp"+si+"_"+parms.sOutputSuffix+".raw",
 				outEigenwarp_global = configPath+"/" + "global_eigenwarp"+si+"_"+parms.sOutputSuffix+".raw";
-		batch.push_back( 
-			Command( path+"matcol2raw", QStringList()
-				 << parms.sN << parms.sK << parms.outEigenwarps << si 
-				 << outEigenwarp
-				 << "mhd" << sResX << sResY << sResZ << "3" << sSpacingX << sSpacingY << sSpacingZ,
-				tr("Convert local eigenwarp %1 to MHD Volume").arg(i+1) )
-			);
-		batch.push_back( 
-			Command( path+"matcol2raw", QStringList()
-				 << parms.sN << parms.sK << parms.outEigenwarps_global << si 
-				 << outEigenwarp_global
-				 << "mhd" << sResX << sResY << sResZ << "3" << sSpacingX << sSpacingY << sSpacingZ,
-				tr("Convert global eigenwarp %1 to MHD Volume").arg(i+1) )
-			);
+		task.outEigenwarpList      .push_back( outEigenwarp );
+		task.outEigenwarpListGlobal.push_back( outEigenwarp_global );
+
 		eigenWarpList.push_back(configPath+"/" + "global_eigenwarp"+si+"_"+parms.sOutputSuffix+".mhd");
 		eigenWarpListLocal.push_back(configPath+"/" + "eigenwarp"+si+"_"+parms.sOutputSuffix+".mhd");
 	}
-	batch.push_back( cmdNorm );
-	batch.push_back( cmdNorm_global );
-	
 	
-	// start batch processing
-	
-	m_batchproc->reset();
-	m_batchproc->initBatch( batch );
-	//m_batchproc->setLogFile( configPath + "/" + "log_"+parms.sOutputSuffix+".txt" );  --> TODO: Log file functionality
-	m_batchproc->process()->setWorkingDirectory( m_baseDir );
-	m_batchproc->show();
-	//m_batchproc->start();  // --> started manually in dialog	
-
-	connect( m_batchproc, SIGNAL(finished()), this, SLOT(batchROIfinished()) );
 	
 #ifdef SDMVIS_VARVIS_ENABLED
 	// ROIs are specified via VarVis
@@ -2859,6 +2802,26 @@ void SDMVisMainWindow::refineROI()
 	parms.eigenWarpList = eigenWarpList;
 	parms.eigenWarpListLocal = eigenWarpListLocal;
 	m_roiParms = parms;
+
+	// start computation in worker thread
+
+	m_roiCanceled = 0;
+	m_roiProgress = new QProgressDialog( tr("Computing ROI PCA..."), 
+		tr("Cancel"), 0, 100, this );
+	m_roiProgress->setWindowTitle( tr("%1 - Refine ROI").arg(APP_NAME) );
+	m_roiProgress->setMinimumDuration( 0 );
+	m_roiProgress->setValue( 0 );
+	connect( m_roiProgress, SIGNAL(canceled()), this, SLOT(cancelROI()) );
+
+	task.progress = &SDMVisMainWindow::roiProgressCallback;
+	task.userData = this;
+	m_roiWatcher->setFuture( QtConcurrent::run( task, &RefineROITask::run ) );
+}
+
+void SDMVisMainWindow::cancelROI()
+{
+	m_roiCanceled = 1;
+	statusMessage( tr("Cancelling ROI computation...") );
 }
 
 void SDMVisMainWindow::saveConfigROI( RefineROIParameters parms, bool local, QString reference )
@@ -2906,11 +2869,21 @@ void SDMVisMainWindow::saveConfigROI( RefineROIParameters parms, bool local, QSt
 
 void SDMVisMainWindow::batchROIfinished()
 {
+	if( m_roiProgress )
+	{
+		m_roiProgress->deleteLater();
+		m_roiProgress = NULL;
+	}
 
-
-	disconnect( m_batchproc, SIGNAL(finished()), this, SLOT(batchROIfinished()) );
-	if( m_batchproc->hasCrashed() )
+	if( !m_roiWatcher->result() )
+	{
+		if( m_roiCanceled != 0 )
+			statusMessage( tr("ROI computation cancelled") );
+		else
+			QMessageBox::warning( this, tr("sdmvis: Warning"),
+				tr("ROI computation failed, see console output for details!") );
 		return;
+	}
 
 	// computeNormalization( m_roiParms );
 	//--> FIXME: computeNormalization() crashs!
@@ -3008,6 +2981,7 @@ void SDMVisMainWindow::loadNewTrait(int index)
 
 		m_traitRenderer->setWarpfields(temp_field);
 		m_traitRenderer->getControlWidget()->getBarPlotWidget()->setDisabled(false);
+		prefetchAdjacentTraits( index );
 	}
 	else
 		m_traitRenderer->getControlWidget()->getBarPlotWidget()->setDisabled(true);
@@ -3019,12 +2993,54 @@ void SDMVisMainWindow::loadNewTrait(int index)
 
 	m_traitRenderer->setTitle( specificTrait.identifier );
 
+	updateTraitScores( index );
 	m_scatterPlotWidget->setTrait(specificTrait);
 	m_volumeRenderer->getControlWidget()->getPlotWidget()->setTrait(specificTrait);
 	m_volumeRenderer->getControlWidget()->getPlotWidget()->setIndex(index);
 	
 }
 
+void SDMVisMainWindow::prefetchAdjacentTraits( int index )
+{
+	QList<Warpfield> neighbours;
+	for( int i=index-1; i <= index+1; i+=2 )
+	{
+		if( i < 0 || i >= m_tempTraitList.size() ||
+			m_tempTraitList.at(i).mhdFilename=="empty" )
+			continue;
+
+		Warpfield w;
+		w.mhdFilename = m_config.getAbsolutePath(m_tempTraitList.at(i).mhdFilename);
+		neighbours.push_back( w );
+	}
+	m_traitRenderer->prefetchWarpfields( neighbours );
+}
+
+void SDMVisMainWindow::updateTraitScores( int index )
+{
+	if( m_traitProjection.update( *m_config.getPlotterMatrix(), m_tempTraitList ) )
+	{
+		for( int t=0; t < m_traitProjection.numTraits(); t++ )
+		{
+			if( !m_traitProjection.isValid(t) )
+				continue;
+			const TraitProjection::Statistics& s = m_traitProjection.statistics(t);
+			std::cout << "Trait \"" << m_tempTraitList.at(t).identifier.toStdString() << "\": "
+				<< "class -1 score " << s.mean[0] << " +/- " << s.stddev[0] << ", "
+				<< "class +1 score " << s.mean[1] << " +/- " << s.stddev[1] << ", "
+				<< s.misclassified << "/" << s.count[0]+s.count[1] << " misclassified, "
+				<< "separation " << s.separation << std::endl;
+		}
+	}
+
+	QVector<double> scores;
+	if( index >= 0 && index < m_traitProjection.numTraits() && m_traitProjection.isValid(index) )
+		scores = m_traitProjection.scores( index );
+
+	m_scatterPlotWidget->setTraitScores( scores );
+	m_volumeRenderer->getControlWidget()->getPlotWidget()->setTraitScores( scores );
+}
+
 void SDMVisMainWindow::setNewTrait(int index)
 {
 	if (m_tempTraitList.at(index).mhdFilename!="empty")
@@ -3037,6 +3053,7 @@ void SDMVisMainWindow::setNewTrait(int index)
 
 		this->m_traitRenderer->setWarpfields(temp_field);
 		this->m_traitRenderer->getControlWidget()->getBarPlotWidget()->setDisabled(false);
+		prefetchAdjacentTraits( index );
 	}
 	else
 		this->m_traitRenderer->getControlWidget()->getBarPlotWidget()->setDisabled(true);
@@ -3045,6 +3062,7 @@ void SDMVisMainWindow::setNewTrait(int index)
 	Trait specificTrait=m_tempTraitList.at(index);
 	specificTrait.computeNormal();
 
+	updateTraitScores( index );
 	this->m_scatterPlotWidget->setTrait(specificTrait);
 	this->m_volumeRenderer->getControlWidget()->getPlotWidget()->setTrait(specificTrait);
 	this->m_volumeRenderer->getControlWidget()->getPlotWidget()->setIndex(index);
@@ -3160,82 +3178,34 @@ void SDMVisMainWindow::saveConfigAs()
 //	Trait computation
 //------------------------------------------------------------------------------
 
-/// execute batch processing to reconstruct trait warpfield from trait vector
+/// reconstruct trait warpfield from trait vector in worker thread
 void SDMVisMainWindow::computeTraitWarpfield_internal( ReconTraitParameters parms )
 {
-	// --- build batch -------------------------------------------------------
-	
-	QString path = m_batchVoltoolsPath;
-
-	QString sN = QString::number(parms.N),
-		    sM = QString::number(parms.M),
-		outBasename = parms.configPath+"/"+ parms.sOutputSuffix,// changed
-		outWarp    = outBasename +".mat",
-		outWarpRaw = outBasename + ".raw",
-			sResX = QString::number(parms.resX),
-			sResY = QString::number(parms.resY),
-			sResZ = QString::number(parms.resZ),
-			sSX = QString::number(parms.spacingX),
-			sSY = QString::number(parms.spacingY),
-			sSZ = QString::number(parms.spacingZ);
+	if( m_traitWatcher->isRunning() )
+	{
+		QMessageBox::warning( this, tr("sdmvis: Warning"),
+			tr("Trait warpfield reconstruction is already running!") );
+		return;
+	}
 
-	typedef BatchProcessingDialog::BatchCommand Command;
-	typedef BatchProcessingDialog::CommandList  CommandList;
-
-	Command 
-		cmdReconTraitWarp( path+"matmult",	QStringList()
-			 << sN << sM 
-			 << QString::number( 1 )
-			 << parms.warpsFilename
-			 << parms.traitFilename
-			 << outWarp,
-			tr("Reconstruct warp corresponding to trait vector") ),
-
-		cmdReconTraitWarpCUDA( path+"cuda_matmul",	QStringList()
-			 << sN << sM 
-			 << QString::number( 1 )
-			 << parms.warpsFilename
-			 << parms.traitFilename
-			 << outWarp,
-			tr("Reconstruct warp corresponding to trait vector") ),
-
-		cmdMHD( path+"matcol2raw", QStringList()
-			 << sN << QString::number(1) << outWarp << QString::number( 0 ) 
-			 << outWarpRaw
-			 << "mhd" << sResX << sResY << sResZ << "3" << sSX << sSY << sSZ,
-			tr("Convert trait warp to MHD Volume") ),
-
-		cmdNorm( path+"matnorm", QStringList()
-			 << sN << QString::number( 1 )
-			 << outWarp,
-			tr("Column norms") );
-
-#if 1
-	// disable CUDA by default (let the user decide CUDA is applicable for now)
-	cmdReconTraitWarpCUDA.run = false;
-#else
-	// enable CUDA for video and demos
-	cmdReconTraitWarpCUDA.run = true;
-	cmdReconTraitWarp.run = false;
-#endif
-	// disable norm computation by default 
-	// (output goes only to console; irrelevant for sdmvis)
-	cmdNorm.run = false;
-
-	CommandList batch;
-	batch.push_back( cmdReconTraitWarp );
-	batch.push_back( cmdReconTraitWarpCUDA );
-	batch.push_back( cmdMHD );
-	batch.push_back( cmdNorm );
-	
-	// --- start batch processing --------------------------------------------
+	// resolve paths relative to config (formerly working directory of batch)
+	QDir baseDir( m_baseDir );
+
+	ReconWarpsTask task;
+	task.warpsFilename = baseDir.absoluteFilePath( parms.warpsFilename );
+	task.traitFilenames.push_back( baseDir.absoluteFilePath( parms.traitFilename ) );
+	task.outBasenames  .push_back( baseDir.absoluteFilePath( parms.configPath+"/"+ parms.sOutputSuffix ) );
+	task.N = parms.N;
+	task.M = parms.M;
+	task.resolution[0] = parms.resX;
+	task.resolution[1] = parms.resY;
+	task.resolution[2] = parms.resZ;
+	task.spacing[0] = parms.spacingX;
+	task.spacing[1] = parms.spacingY;
+	task.spacing[2] = parms.spacingZ;
 
-	m_batchDialog->reset();
-	m_batchDialog->initBatch( batch );
-	//m_batchproc->setLogFile( configPath + "/" + "log_"+parms.sOutputSuffix+".txt" );  
-		// --> TODO: Log file functionality
-	m_batchDialog->process()->setWorkingDirectory( m_baseDir );
-	m_batchDialog->show();
+	statusMessage( tr("Reconstructing trait warpfield...") );
+	m_traitWatcher->setFuture( QtConcurrent::run( task, &ReconWarpsTask::run ) );
 
 	connect(m_traitRenderer->getControlWidget()->getTraitSelector(),
 			SIGNAL(computeWarpField(QString,QString)),
@@ -3244,6 +3214,19 @@ void SDMVisMainWindow::computeTraitWarpfield_internal( ReconTraitParameters parm
 
 }
 
+void SDMVisMainWindow::traitWarpfieldFinished()
+{
+	if( !m_traitWatcher->result() )
+	{
+		QMessageBox::warning( this, tr("sdmvis: Warning"),
+			tr("Trait warpfield reconstruction failed, see console output for details!") );
+		return;
+	}
+
+	statusMessage( tr("Trait warpfield reconstructed") );
+	m_traitRenderer->getControlWidget()->getTraitSelector()->warpfieldGenerated();
+}
+
 #ifdef SDMVIS_MANUAL_ANALYSIS
 void SDMVisMainWindow::computeTraitWarpfield()
 {
@@ -26,6 +26,8 @@
 #include <QList>
 #include <QStringList>
 #include <QHelpEngine>
+#include <QFutureWatcher>
+#include <QAtomicInt>
 
 #ifndef Q_MOC_RUN
 // Workaround for BOOST_JOIN problem: Undef critical code for moc'ing.
@@ -39,6 +41,7 @@
 #include "SDMVisConfig.h"
 #include "ScatterPlotWidget.h"
 #include "Trait.h"
+#include "TraitProjection.h"
 #include "StatisticalDeformationModel.h"
 #endif
 
@@ -52,6 +55,7 @@ class SDMVisVolumeRenderer;
 class DatasetWidget;
 class TraitDialog;
 class BatchProcessingDialog;
+class QProgressDialog;
 
 // forwards
 class HelpBrowser;
@@ -388,6 +392,9 @@ protected:
 	QString getBasePath();
 	void computeTraitWarpfield_internal( ReconTraitParameters parms );
 
+protected slots:
+	void traitWarpfieldFinished();
+
 private:
 	bool m_expertMode;
 
@@ -400,9 +407,8 @@ private:
 	SDMVisScalesDialog*   m_scalesDialog;
 	DatasetWidget*        m_datasetWidget;
 	TraitDialog*          m_traitDialog;
-	BatchProcessingDialog*m_batchDialog;
+	QFutureWatcher<bool>* m_traitWatcher; // trait warpfield reconstruction
 	ScatterPlotWidget*    m_scatterPlotWidget;
-	BatchProcessingDialog*m_batchproc ;
 	LookmarkWidget*       m_lookmarkWidget;
 
 	
@@ -419,15 +425,23 @@ private:
 	StatisticalDeformationModel m_sdm;
 
 	QList<Trait> m_tempTraitList;
+	TraitProjection m_traitProjection; ///< scores of all subjects for m_tempTraitList
 	
 	// Application settings
 	void readSettings();
     void writeSettings();
+
+	/// Read warpfields of neighbouring traits in background, since these are
+	/// the most likely to be selected next.
+	void prefetchAdjacentTraits( int index );
+	/// Pass scores of given trait (-1 for none) to the plot widgets, the
+	/// projection onto all traits is only recomputed if V or traits changed.
+	void updateTraitScores( int index );
 	void setupConnections();
 	void unloadConfig();	
 	void loadWidgetsContents();
 	QString m_baseDir;     // ... sync m_baseDir with config.sdm.basePath ?
-	QString m_batchVoltoolsPath;
+	int     m_volumeCacheMB; // CPU memory budget of warpfield cache
 	QString m_loadedConfigName;
 
 #ifdef SDMVIS_VARVIS_ENABLED
@@ -444,7 +458,14 @@ protected slots:
 	void openVolumeDatasetVarVis();
 	void openWarpDatasetVarVis();
 	void clearVarVisBox();	
+	void cancelROI();
 private:
+	// ROI PCA computed in a worker thread (see refineROI())
+	QFutureWatcher<bool>* m_roiWatcher;
+	QProgressDialog     * m_roiProgress;
+	QAtomicInt            m_roiCanceled;
+	static bool roiProgressCallback( double progress, void* userData );
+
 	// VarVis
 	VarVisRender	    * m_varvisRender;
 	VarVisControls      * m_varvisControls;
@@ -0,0 +1,263 @@
+#include "SDMVisTasks.h"
+#include "MetaImageHeader.h"
+#include <QFileInfo>
+#include <QDir>
+#include <VolumeRendering/VolumeData.h>  // VolumeDataHeaderLoaderMHD
+#include <fstream>
+#include <iostream>
+#include <vector>
+
+//------------------------------------------------------------------------------
+//	Helper functions
+//------------------------------------------------------------------------------
+
+void saveMatrixCSV( const Matrix& M, QString filename )
+{
+	std::ofstream f( filename.toAscii() );
+	for( unsigned i=0; i < M.size1(); ++i )
+	{
+		for( unsigned j=0; j < M.size2(); ++j )
+			f << (j>0 ? "," : "") << M(i,j);
+		f << "\n";
+	}
+}
+
+bool saveVectorfieldMHD( const mattools::ValueType* data, size_t size,
+                         QString rawFilename,
+                         const unsigned resolution[3], const double spacing[3] )
+{
+	std::ofstream f( rawFilename.toAscii(), std::ios::binary );
+	if( !f.is_open() )
+	{
+		std::cerr << "Error: Could not open \""
+			<< rawFilename.toStdString() << "\" for writing!\n";
+		return false;
+	}
+	f.write( (const char*)data, size*sizeof(mattools::ValueType) );
+	f.close();
+
+	MetaImageHeader mhd;
+	unsigned res[3] = { resolution[0], resolution[1], resolution[2] };
+	double   sp [3] = { spacing[0], spacing[1], spacing[2] };
+	mhd.setResolution ( res );
+	mhd.setSpacing    ( sp );
+	mhd.setNumChannels( 3 );
+	mhd.setFilename   ( rawFilename.toStdString() );
+	std::ofstream hdr( (mhd.basename + ".mhd").c_str() );
+	hdr << mhd.getHeader() << std::endl;
+	return true;
+}
+
+bool loadVolumeGeometry( QString mhdFilename,
+                         unsigned resolution[3], double spacing[3],
+                         QString* rawFilename )
+{
+	VolumeDataHeaderLoaderMHD mhd;
+	if( !mhd.load( mhdFilename.toAscii() ) )
+	{
+		std::cerr << "Error: Could not load volume header \""
+			<< mhdFilename.toStdString() << "\"!\n";
+		return false;
+	}
+	resolution[0] = mhd.resX();
+	resolution[1] = mhd.resY();
+	resolution[2] = mhd.resZ();
+	spacing[0] = mhd.spacingX();
+	spacing[1] = mhd.spacingY();
+	spacing[2] = mhd.spacingZ();
+
+	// raw filename is relative to MHD
+	if( rawFilename )
+		*rawFilename = QFileInfo( mhdFilename ).absoluteDir()
+			.absoluteFilePath( QString::fromStdString( mhd.filename() ) );
+	return true;
+}
+
+bool loadWarpsMatrix( QString filename, int N, int M, mattools::RawMatrix& X )
+{
+	using mattools::RawMatrix;
+	if( RawMatrix::getFileSize( filename.toAscii() ) !=
+	      (size_t)N*M*sizeof(mattools::ValueType) ||
+	    !X.load( N, M, filename.toAscii() ) )
+	{
+		std::cerr << "Error: Could not load warps matrix \""
+			<< filename.toStdString() << "\"!\n";
+		return false;
+	}
+	return true;
+}
+
+//------------------------------------------------------------------------------
+//	ComputePCATask
+//------------------------------------------------------------------------------
+
+bool ComputePCATask::run()
+{
+	mattools::RawMatrix X;
+	if( !loadWarpsMatrix( warpsFilename, N, M, X ) )
+		return false;
+
+	StatisticalDeformationModel sdm;
+	sdm.setWarpfields( X );
+	sdm.computePCA();
+
+	scatter = sdm.getScatterMatrix();
+	V       = sdm.getEigenvectors();
+	lambda  = sdm.getEigenvalues();
+	return true;
+}
+
+//------------------------------------------------------------------------------
+//	RefineROITask
+//------------------------------------------------------------------------------
+
+bool RefineROITask::computeProgress( double p, void* task )
+{
+	return ((const RefineROITask*)task)->setProgress( 0.9*p );
+}
+
+bool RefineROITask::run() const
+{
+	using mattools::RawMatrix;
+	typedef mattools::ValueType FloatType;
+
+	RawMatrix X;
+	if( !loadWarpsMatrix( warpsFilename, N, M, X ) )
+		return false;
+
+	// Load ROI mask (float volume, i.e. one weight per voxel)
+	std::vector<FloatType> mask( N / 3 );
+	std::ifstream f( maskFilename.toAscii(), std::ios::binary );
+	if( RawMatrix::getFileSize( maskFilename.toAscii() ) !=
+	      mask.size()*sizeof(FloatType) || !f.is_open() ||
+	    !f.read( (char*)&mask[0], mask.size()*sizeof(FloatType) ) )
+	{
+		std::cerr << "Error: Could not load ROI mask \""
+			<< maskFilename.toStdString() << "\"!\n";
+		return false;
+	}
+	f.close();
+
+	StatisticalDeformationModel::ROIPCA pca;
+	if( !StatisticalDeformationModel::computeROIPCA( X, &mask[0],
+	        mask.size(), pca, &RefineROITask::computeProgress,
+	        (void*)this ) )
+		return false;
+
+	// Write results
+	if( !pca.warps           .save( outWarps           .toAscii() ) ||
+		!pca.eigenwarps      .save( outEigenwarps      .toAscii() ) ||
+		!pca.eigenwarpsGlobal.save( outEigenwarpsGlobal.toAscii() ) )
+		return false;
+
+	rednum::save_matrix<FloatType,Matrix>( pca.scatter, outScatter        .toAscii() );
+	rednum::save_matrix<FloatType,Matrix>( pca.V,       outPCAEigenvectors.toAscii() );
+	rednum::save_matrix<FloatType,Matrix>( pca.C,       outPCACoefficients.toAscii() );
+	rednum::save_vector<FloatType,Vector>( pca.lambda,  outPCAEigenvalues .toAscii() );
+
+	Matrix lambda( pca.lambda.size(), 1 );
+	for( unsigned i=0; i < pca.lambda.size(); ++i )
+		lambda(i,0) = pca.lambda(i);
+	saveMatrixCSV( pca.V,  outPCAEigenvectors + ".csv" );
+	saveMatrixCSV( pca.C,  outPCACoefficients + ".csv" );
+	saveMatrixCSV( lambda, outPCAEigenvalues  + ".csv" );
+
+	// Write eigenwarps as MHD vectorfield volumes
+	int numEigenwarps = outEigenwarpList.size();
+	std::vector<FloatType> buf( N );
+	for( int i=0; i < numEigenwarps; ++i )
+	{
+		if( (unsigned)i >= pca.eigenwarps.getNumCols() )
+		{
+			std::cerr << "Error: Eigenwarp " << i << " exceeds number of "
+				"PCA modes!\n";
+			return false;
+		}
+
+		pca.eigenwarps.get_col( i, &buf[0] );
+		if( !saveVectorfieldMHD( &buf[0], buf.size(), outEigenwarpList.at(i),
+		                         resolution, spacing ) )
+			return false;
+
+		pca.eigenwarpsGlobal.get_col( i, &buf[0] );
+		if( !saveVectorfieldMHD( &buf[0], buf.size(), outEigenwarpListGlobal.at(i),
+		                         resolution, spacing ) )
+			return false;
+
+		if( !setProgress( 0.9 + (0.1*(i+1))/numEigenwarps ) )
+			return false;
+	}
+	return true;
+}
+
+//------------------------------------------------------------------------------
+//	ReconWarpsTask
+//------------------------------------------------------------------------------
+
+bool ReconWarpsTask::run() const
+{
+	using mattools::RawMatrix;
+	typedef mattools::ValueType FloatType;
+
+	RawMatrix X;
+	if( !loadWarpsMatrix( warpsFilename, N, M, X ) )
+		return false;
+
+	// Gather trait vectors (or given coefficients) as columns of M x k
+	// matrix B (row-major)
+	int k = traitFilenames.isEmpty() ? (int)coefficients.size2()
+	                                 : traitFilenames.size();
+	if( k != outBasenames.size() ||
+	    (traitFilenames.isEmpty() && (int)coefficients.size1() != M) )
+	{
+		std::cerr << "Error: Mismatching number of warpfields to reconstruct!\n";
+		return false;
+	}
+
+	std::vector<FloatType> B( M*k ), trait( M );
+	for( int c=0; c < k; ++c )
+	{
+		if( traitFilenames.isEmpty() )
+		{
+			for( int j=0; j < M; ++j )
+				B[j*k+c] = (FloatType)coefficients( j, c );
+			continue;
+		}
+
+		std::ifstream f( traitFilenames.at(c).toAscii(), std::ios::binary );
+		if( RawMatrix::getFileSize( traitFilenames.at(c).toAscii() ) !=
+		      M*sizeof(FloatType) || !f.is_open() ||
+		    !f.read( (char*)&trait[0], M*sizeof(FloatType) ) )
+		{
+			std::cerr << "Error: Could not load trait vector \""
+				<< traitFilenames.at(c).toStdString() << "\"!\n";
+			return false;
+		}
+		for( int j=0; j < M; ++j )
+			B[j*k+c] = trait[j];
+	}
+
+	// Warps X*B
+	std::vector<FloatType> warps( (size_t)N*k );
+	X.multiplyMatrix( &B[0], k, &warps[0] );
+
+	// Write each warp as .mat (N x 1 matrix) and as MHD volume
+	for( int c=0; c < k; ++c )
+	{
+		QString basename = outBasenames.at(c);
+		const FloatType* data = &warps[(size_t)c*N];
+
+		std::ofstream fmat( (basename + ".mat").toAscii(), std::ios::binary );
+		if( !fmat.is_open() )
+		{
+			std::cerr << "Error: Could not open \"" << basename.toStdString()
+				<< ".mat\" for writing!\n";
+			return false;
+		}
+		fmat.write( (const char*)data, (size_t)N*sizeof(FloatType) );
+
+		if( !saveVectorfieldMHD( data, N, basename + ".raw", resolution, spacing ) )
+			return false;
+	}
+	return true;
+}
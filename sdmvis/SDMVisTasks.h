@@ -0,0 +1,110 @@
+#ifndef SDMVISTASKS_H
+#define SDMVISTASKS_H
+
+//------------------------------------------------------------------------------
+// Processing tasks on the warps matrix of an SDMVis config
+//------------------------------------------------------------------------------
+// The tasks below do not depend on any widget and can be executed in a worker
+// thread of SDMVisMainWindow as well as headless by the sdmbatch tool. All
+// filenames are expected to be absolute paths. Errors are reported on stderr.
+
+#include <QString>
+#include <QStringList>
+#include "StatisticalDeformationModel.h"
+#include "numerics.h"   // Matrix, Vector
+
+/// Progress callback with progress in [0,1], return false to cancel.
+typedef StatisticalDeformationModel::ProgressCallback TaskProgressCallback;
+
+/// Write a matrix in ASCII comma separated format
+void saveMatrixCSV( const Matrix& M, QString filename );
+
+/// Write raw float vectorfield and accompanying MHD header, where rawFilename
+/// is the .raw file and the .mhd is placed next to it.
+bool saveVectorfieldMHD( const mattools::ValueType* data, size_t size,
+                         QString rawFilename,
+                         const unsigned resolution[3], const double spacing[3] );
+
+/// Read resolution and spacing from an MHD volume header (no data is loaded),
+/// optionally returns the absolute filename of the raw data.
+bool loadVolumeGeometry( QString mhdFilename,
+                         unsigned resolution[3], double spacing[3],
+                         QString* rawFilename=NULL );
+
+/// Load N x M warps matrix (kept out-of-core if it does not fit into memory)
+bool loadWarpsMatrix( QString filename, int N, int M, mattools::RawMatrix& X );
+
+//------------------------------------------------------------------------------
+/// PCA of the full warps matrix, i.e. the scatter matrix X'*X and its
+/// eigen decomposition as stored in the [yapca] section of an SDMVis config.
+/// The warpfields are assumed to be mean free (see
+/// StatisticalDeformationModel::computePCA()).
+struct ComputePCATask
+{
+	QString warpsFilename; ///< N x M warps matrix
+	int     N, M;
+
+	///@{ Results of run()
+	Matrix  scatter, V;
+	Vector  lambda;
+	///@}
+
+	bool run();
+};
+
+//------------------------------------------------------------------------------
+/// ROI PCA as executed in worker thread by SDMVisMainWindow::refineROI().
+/// Replaces the former voltools batch (mat_op, scattermat, yapca, matmult,
+/// matcol2raw) and writes the same set of output files.
+struct RefineROITask
+{
+	QString     warpsFilename, maskFilename; ///< N x M matrix, float ROI mask
+	int         N, M;
+	unsigned    resolution[3];
+	double      spacing[3];
+
+	///@{ Output filenames (see RefineROIParameters for naming convention)
+	QString     outWarps, outScatter,
+	            outPCAEigenvectors, outPCACoefficients, outPCAEigenvalues,
+	            outEigenwarps, outEigenwarpsGlobal;
+	QStringList outEigenwarpList, outEigenwarpListGlobal; ///< .raw filenames
+	///@}
+
+	/// Optional, computation accounts for 90%, writing results for the rest
+	TaskProgressCallback progress;
+	void*                userData;
+
+	RefineROITask(): progress(NULL), userData(NULL) {}
+
+	bool run() const;
+
+protected:
+	bool setProgress( double p ) const
+	{
+		return progress ? progress( p, userData ) : true;
+	}
+
+	static bool computeProgress( double p, void* task );
+};
+
+//------------------------------------------------------------------------------
+/// Reconstruction of warpfields as linear combinations X*B of the warps
+/// matrix X, as executed in worker thread by
+/// SDMVisMainWindow::computeTraitWarpfield_internal(). Replaces the former
+/// voltools batch (matmult or cuda_matmul, matcol2raw). Any number of
+/// warpfields (e.g. all traits of a config or the leading eigenwarps) is
+/// reconstructed in a single pass over the warps matrix.
+struct ReconWarpsTask
+{
+	QString     warpsFilename;  ///< N x M warps matrix
+	QStringList traitFilenames; ///< trait vectors of size M
+	Matrix      coefficients;   ///< M x k, used if no trait vectors are given
+	QStringList outBasenames;   ///< output .mat/.raw/.mhd without extension
+	int         N, M;
+	unsigned    resolution[3];
+	double      spacing[3];
+
+	bool run() const;
+};
+
+#endif // SDMVISTASKS_H
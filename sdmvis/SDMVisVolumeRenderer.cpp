@@ -10,6 +10,8 @@
 #include <GL/GLConfig.h>  // CheckGLError()
 #include <iostream>
 #include <vector>
+#include <cmath>
+#include <algorithm>
 #include "SDMVisConfig.h"
 #include "BatchProcessingDialog.h"
 #include "PleaseWaitDialog.h"
@@ -418,7 +420,11 @@ SDMVisVolumeRenderer::SDMVisVolumeRenderer( QWidget* parent, const QGLWidget* sh
 	  m_cameraFOV          ( 30.f ),  // VTK default view angle is 30
 	  m_renderLock         ( false ),
 	  m_modeString         ( tr("Mode") ),
-	  m_editValidDeform    ( false )
+	  m_editValidDeform    ( false ),
+	  m_precombineWarps    ( false ),
+	  m_precombineActive   ( false ),
+	  m_precombinedScale   ( 1.f ),
+	  m_sdmMeanwarp        ( NULL )
 {
 	// Setup trackball 
 	// Note that Trackball2::setViewSize() has to be called with actual OpenGL
@@ -455,7 +461,7 @@ SDMVisVolumeRenderer::SDMVisVolumeRenderer( QWidget* parent, const QGLWidget* sh
 			QString("C:/Qt/4.7.0-beta2/bin") +
 			QString("C:/Libs/vtk-5.6.0_build-x64/bin/Release") +
 			env.value("PATH") );
-		m_batchproc->process()->setProcessEnvironment( env );*/
+		m_batchproc->setProcessEnvironment( env );*/
 
 		// default path for voltools programs
 		m_batchVoltoolsDir = ""; //"G:/BITGrad/VolumeTools/bin_vs2010_x64/Release/";
@@ -583,6 +589,13 @@ SDMVisVolumeRenderer::SDMVisVolumeRenderer( QWidget* parent, const QGLWidget* sh
 	QAction* actWarpAnimWarp = new QAction( tr("Set animation warp"), this );
 	connect( actWarpAnimWarp, SIGNAL(triggered()), this, SLOT(changeWarpAnimationWarp()) );
 
+	QAction* actPrecombineWarps = new QAction( tr("Precombine SDM warpfields"), this );
+	actPrecombineWarps->setStatusTip( tr("Synthesize a single warpfield on the CPU "
+		"on coefficient change instead of combining all eigenmodes per ray sample.") );
+	actPrecombineWarps->setCheckable( true );
+	actPrecombineWarps->setChecked( m_precombineWarps );
+	connect( actPrecombineWarps, SIGNAL(toggled(bool)), this, SLOT(togglePrecombineWarps(bool)) );
+
 	// Camera actions
 
 	QAction* actLoadLookmark = new QAction( tr("Load lookmark..."), this );
@@ -625,6 +638,7 @@ SDMVisVolumeRenderer::SDMVisVolumeRenderer( QWidget* parent, const QGLWidget* sh
 	m_actionsRenderer.push_back( actWarpAnim );
 	m_actionsRenderer.push_back( actWarpAnimSpeed );
 	m_actionsRenderer.push_back( actWarpAnimWarp );
+	m_actionsRenderer.push_back( actPrecombineWarps );
 	m_actionsRenderer.push_back( sep5 );
 	m_actionsRenderer.push_back( actLoadLookmark );
 	m_actionsRenderer.push_back( actSaveLookmark );
@@ -662,6 +676,7 @@ SDMVisVolumeRenderer::~SDMVisVolumeRenderer()
 {
 	delete m_vol; m_vol=NULL;
 	m_vtex.Destroy();
+	m_warpCombinedTex.Destroy();
 	delete m_vren;
 }
 
@@ -1942,6 +1957,30 @@ void SDMVisVolumeRenderer::resetShader()
 	m_warpfields.clear();
 	m_vren->resetWarpfields(); // reset shader		
 	m_vren->setMeanwarp( NULL );
+	m_sdmModes.clear();
+	m_sdmMeanwarp = NULL;
+	if( m_precombineActive )
+	{
+		// Restore coefficients of eigenmodes
+		for( int i=0; i < m_precombinedLambdas.size(); i++ )
+			m_vren->setLambda( i, (float)m_precombinedLambdas.at(i) );
+		m_precombineActive = false;
+	}
+}
+
+void SDMVisVolumeRenderer::prefetchWarpfields( const QList<Warpfield>& warpfields )
+{
+	for( int i=0; i < warpfields.size(); ++i )
+	{
+		std::string filename = warpfields.at(i).mhdFilename.toStdString();
+		if( !filename.empty() )
+			m_vman.prefetch( filename );
+	}
+}
+
+void SDMVisVolumeRenderer::setVolumeCacheBudget( int megabytes )
+{
+	m_vman.setMemoryBudget( (size_t)std::max( megabytes, 0 ) * 1024 * 1024 );
 }
 
 bool SDMVisVolumeRenderer::setMeanwarp( const Warpfield& meanwarp )
@@ -2028,6 +2067,9 @@ bool SDMVisVolumeRenderer::setWarpfields( const QList<Warpfield>& warpfields )
 	// release current warpfields
 	resetShader();
 
+	// read all warpfields in parallel while uploading in order below
+	prefetchWarpfields( warpfields );
+
 	// only download volumes to GPU, do not keep in CPU memory
 	int opts = VolumeManager::DownloadToGPU | VolumeManager::ReleaseCPUMemory;
 
@@ -2156,8 +2198,8 @@ bool SDMVisVolumeRenderer::setWarpfieldsFromSDM( unsigned numModes )
 		}
 	#endif
 
-	#if 1 // DEBUG
-		//if( i==0 )
+	#ifdef SDMVISVOLUMERENDERER_DUMP_EIGENMODES // DEBUG
+		// Dump decoded (float32) eigenmode to working directory
 		{
 			std::stringstream ss; ss << "mode" << i << ".raw";
 			std::ofstream f(ss.str(),std::ios::binary);
@@ -2170,6 +2212,7 @@ bool SDMVisVolumeRenderer::setWarpfieldsFromSDM( unsigned numModes )
 		// Put into VolumeDataHeader derived class instance
 		VolumeDataSetFromRAW< mattools::ValueType > vol;
 		vol.setSpacing( header.spacing[0], header.spacing[1], header.spacing[2] );
+		vol.setNumChannels( 3 );
 		VolumeDataHeader* volHeader = 
 		  vol.setFromRaw( header.resolution[0], header.resolution[1], header.resolution[2],
 			              rawdata, true );  // take ownership (of raw data)
@@ -2208,6 +2251,7 @@ bool SDMVisVolumeRenderer::setWarpfieldsFromSDM( unsigned numModes )
 		// Put into VolumeDataHeader derived class instance
 		VolumeDataSetFromRAW< mattools::ValueType > vol;
 		vol.setSpacing( header.spacing[0], header.spacing[1], header.spacing[2] );
+		vol.setNumChannels( 3 );
 		VolumeDataHeader* volHeader = 
 		  vol.setFromRaw( header.resolution[0], header.resolution[1], header.resolution[2],
 			              rawdata, true );  // take ownership (of raw data)
@@ -2232,8 +2276,9 @@ bool SDMVisVolumeRenderer::setWarpfieldsFromSDM( unsigned numModes )
 	gl_adjustPixeltransfer( 1, 0 );
 
 	// re-init shader
-	m_vren->setWarpfields( modes );
-	m_vren->setMeanwarp( meanwarp );
+	m_sdmModes    = modes;
+	m_sdmMeanwarp = meanwarp;
+	setupSDMWarpfields();
 
 	if( !reinitShader() )
 	{
@@ -2250,6 +2295,119 @@ bool SDMVisVolumeRenderer::setWarpfieldsFromSDM( unsigned numModes )
 	return true;	
 }
 
+void SDMVisVolumeRenderer::setupSDMWarpfields()
+{
+	if( m_sdmModes.empty() )
+		return;
+
+	if( m_precombineWarps && m_sdm )
+	{
+		if( !m_precombineActive )
+		{
+			// Keep coefficients, since shader lambdas are re-assigned below
+			m_precombinedLambdas.clear();
+			for( unsigned i=0; i < m_sdmModes.size(); i++ )
+				m_precombinedLambdas.push_back( m_vren->getLambda(i) );
+		}
+
+		if( m_warpCache.getSDM() != m_sdm )
+			m_warpCache.setSDM( m_sdm );
+
+		if( updatePrecombinedWarp() )
+		{
+			// The last warpfield is kept since its coefficient is reserved 
+			// for lambdaUser in the raycast shader.
+			std::vector<GL::GLTexture*> modes;
+			modes.push_back( &m_warpCombinedTex );
+			modes.push_back( m_sdmModes.back() );
+			m_vren->setWarpfields( modes );
+			m_vren->setMeanwarp( NULL ); // mean is part of precombined field
+			m_vren->setLambda( 0, m_precombinedScale );
+			m_vren->setLambda( 1, (float)m_precombinedLambdas.last() );
+			m_precombineActive = true;
+			return;
+		}
+
+		std::cerr << "Warning: Could not precombine warpfields, using "
+		             "eigenmodes instead!" << std::endl;
+	}
+
+	if( m_precombineActive )
+	{
+		// Restore coefficients of eigenmodes
+		for( int i=0; i < m_precombinedLambdas.size(); i++ )
+			m_vren->setLambda( i, (float)m_precombinedLambdas.at(i) );
+		m_precombineActive = false;
+	}
+	m_vren->setWarpfields( m_sdmModes );
+	m_vren->setMeanwarp( m_sdmMeanwarp );
+}
+
+bool SDMVisVolumeRenderer::updatePrecombinedWarp()
+{
+	if( !m_sdm || m_precombinedLambdas.isEmpty() )
+		return false;
+
+	// Shader lambdas scale the raw eigenmodes while synthesizeField() 
+	// normalizes coefficients by 1/sqrt(n-1). The last coefficient is 
+	// reserved for lambdaUser and does not contribute to the warp.
+	double normalization = sqrt( (double)m_sdm->getNumSamples() - 1.0 );
+	WarpfieldCache::Key coeffs;
+	for( int i=0; i < m_precombinedLambdas.size()-1; i++ )
+		coeffs.push_back( normalization * m_precombinedLambdas.at(i) );
+
+	// The combined field includes the mean warp (WarpfieldCache default), the
+	// separate meanwarp texture is disabled in setupSDMWarpfields().
+	mattools::ValueType maxAbs;
+	WarpfieldCache::Field field = m_warpCache.getField( coeffs, &maxAbs );
+	if( !field )
+		return false;
+
+	// Eigenmodes are uploaded with the fixed range [-20,20] (see
+	// SDMVISVOLUMERENDERER_ADJUST_PIXEL_TRANSFER) which a combination of 
+	// several modes easily exceeds. Extend the range to the combined field
+	// and compensate via its shader coefficient, since the shader decodes
+	// all warp textures w.r.t. the fixed range.
+	const float defaultRange = 20.f;
+	float range = std::max( defaultRange, (float)maxAbs );
+	m_precombinedScale = range / defaultRange;
+
+	StatisticalDeformationModel::Header header = m_sdm->getHeader();
+	VolumeDataSetFromRAW< mattools::ValueType > vol;
+	vol.setSpacing( header.spacing[0], header.spacing[1], header.spacing[2] );
+	vol.setNumChannels( 3 );
+	VolumeDataHeader* volHeader = 
+	  vol.setFromRaw( header.resolution[0], header.resolution[1], header.resolution[2],
+		              field.get(), false );  // data is owned by cache
+
+	// activate GL context
+	makeCurrent();
+
+	gl_adjustPixeltransfer( 0.5f / range, 0.5f );  // maps [-range,range] -> [0,1]
+	bool success = create_volume_tex( m_warpCombinedTex, volHeader, field.get(), 0 );
+	gl_adjustPixeltransfer( 1, 0 );
+
+	if( m_precombineActive )
+		m_vren->setLambda( 0, m_precombinedScale );
+
+	delete volHeader;
+	return success;
+}
+
+void SDMVisVolumeRenderer::togglePrecombineWarps( bool enable )
+{
+	m_precombineWarps = enable;
+
+	if( m_sdmModes.empty() || !m_initialized )
+		return;
+
+	makeCurrent();
+	setupSDMWarpfields();
+
+	// Number of warpfields changed
+	reinitShader();
+}
+
 //------------------------------------------------------------------------------
 //	SDMVisVolumeRenderer -	Config
 //------------------------------------------------------------------------------
@@ -2304,7 +2462,19 @@ void SDMVisVolumeRenderer::setLambdas( QVector<double> lambdas )
 	{
 		// consider warpfield elementScale (e.g. as specified in config file)
 		double scale = m_warpfields.at(i).elementScale;
-		m_vren->setLambda( i, (float)scale*lambdas.at(i) );
+		if( m_precombineActive )
+		{
+			if( i < m_precombinedLambdas.size() )
+				m_precombinedLambdas[i] = scale*lambdas.at(i);
+		}
+		else
+			m_vren->setLambda( i, (float)scale*lambdas.at(i) );
+	}
+
+	if( m_precombineActive )
+	{
+		m_vren->setLambda( 1, (float)m_precombinedLambdas.last() );
+		updatePrecombinedWarp();
 	}
 
 	invokeRenderUpdate();
@@ -2318,7 +2488,19 @@ void SDMVisVolumeRenderer::setLambda( int i, double lambda )
 	// consider warpfield elementScale (e.g. as specified in config file)
 	double scale = m_warpfields.at(i).elementScale;
 
-	m_vren->setLambda( i, (float)scale*lambda );	
+	if( m_precombineActive )
+	{
+		if( i < 0 || i >= m_precombinedLambdas.size() )
+			return;
+		m_precombinedLambdas[i] = scale*lambda;
+
+		if( i == m_precombinedLambdas.size()-1 )
+			m_vren->setLambda( 1, (float)scale*lambda ); // lambdaUser
+		else
+			updatePrecombinedWarp();
+	}
+	else
+		m_vren->setLambda( i, (float)scale*lambda );	
 
 	invokeRenderUpdate();
 }
@@ -2333,6 +2515,9 @@ double SDMVisVolumeRenderer::getLambda( int i ) const
 	// (inverse scaling here)
 	double inv_scale = 1.0 / m_warpfields.at(i).elementScale;
 
+	if( m_precombineActive && i < m_precombinedLambdas.size() )
+		return inv_scale * m_precombinedLambdas.at( i );
+
 	return inv_scale * m_vren->getLambda( i );
 }
 
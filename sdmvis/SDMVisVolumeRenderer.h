@@ -28,6 +28,7 @@
 #include "e7/Engines/Trackball2.h"
 #include "e7/VolumeRendering/RayPickingInfo.h"
 #include "StatisticalDeformationModel.h"
+#include "WarpfieldCache.h"
 #endif
 
 #ifdef SDMVIS_USE_OVERDRAW
@@ -238,6 +239,13 @@ public slots:
 
 	bool setWarpfieldsFromSDM( unsigned numModes );
 
+	/// Start reading warpfields from disk in the background, such that a
+	/// later \a setWarpfields() with these warpfields only has to upload them.
+	void prefetchWarpfields( const QList<Warpfield>& warpfields );
+
+	/// CPU memory budget for cached volumes read from disk
+	void setVolumeCacheBudget( int megabytes );
+
 	/// Assummes that the given config pointer remains valid!
 	/// If warpfields have already been set by \a setWarpfields() loading them
 	/// again can be prevented by specifying update=false.
@@ -301,6 +309,10 @@ protected slots:
 
 	void setOutputType( QAction* act );
 
+	/// Use a single precombined warpfield instead of combining all SDM
+	/// eigenmodes per ray sample (only for warpfields set from SDM).
+	void togglePrecombineWarps( bool enable );
+
 protected:
 #ifdef SDMVIS_USE_OVERDRAW
 	// Overdraw implementation
@@ -332,6 +344,13 @@ protected:
 
 	void resetShader();
 
+	///@{ Precombined warpfields (see \a WarpfieldCache)
+	/// Switch shader between SDM eigenmodes and precombined warpfield
+	void setupSDMWarpfields();
+	/// Upload precombined warpfield for current lambda coefficients
+	bool updatePrecombinedWarp();
+	///@}
+
 	///@{ LOD
 	enum { FastRendering, QualityRendering };
 	void setLOD( int level );
@@ -370,6 +389,17 @@ private:
 	GL::GLTexture          m_vtex;
 	VolumeManager          m_vman;       // only used for warpfields yet
 	QList<Warpfield>       m_warpfields;
+
+	///@{ Precombined warpfields
+	WarpfieldCache         m_warpCache;
+	GL::GLTexture          m_warpCombinedTex;
+	bool                   m_precombineWarps;  ///< user option
+	bool                   m_precombineActive; ///< shader uses m_warpCombinedTex
+	QVector<double>        m_precombinedLambdas; ///< incl. elementScale
+	float                  m_precombinedScale; ///< shader lambda of combined field
+	std::vector<GL::GLTexture*> m_sdmModes;    ///< eigenmode textures from SDM
+	GL::GLTexture*         m_sdmMeanwarp;
+	///@}
 	Trackball2             m_trackball2;
 	bool                   m_overlay;     ///< overlay additional information
 	InteractionMode        m_mode;
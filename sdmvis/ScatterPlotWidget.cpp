@@ -203,7 +203,8 @@ void ScatterPlotWidget::createData( double min, double max )
 
 			tempPoint->setLocation(QPointF(x_loc,y_loc));
 			tempPoint->setToolTip(m_nameList.at(iB)+" Pos: ("+QString::number(m_plotterMatrix->at_element(iB,xComp))+
-							 " , "+QString::number(m_plotterMatrix->at_element(iB,yComp))+" )");
+							 " , "+QString::number(m_plotterMatrix->at_element(iB,yComp))+" )"+
+							 (iB<m_traitScores.size() ? " Trait score: "+QString::number(m_traitScores[iB]) : QString()));
       
 			tempPoint->setThisPointSize(2);
 			// push Point into View->ItemList		
@@ -19,6 +19,9 @@ public:
     ScatterPlotWidget(QWidget *parent = 0);
 	void prepareMatrix(int m,int n,Matrix *plotMatrix,double traitScaling, QStringList names);
 	void setTrait(Trait trait);
+	/// Signed distances of all subjects to current trait shown in tooltips,
+	/// empty to hide; takes effect on next setTrait()
+	void setTraitScores(const QVector<double>& scores) { m_traitScores=scores; }
 	void setEmptyClassVector();
 
 private:
@@ -32,6 +35,7 @@ private:
     Trait					m_trait;
 	QVector<double>			m_movingPointVector; 
 	QVector<int>			m_classVector;
+	QVector<double>			m_traitScores;
 	
 	QGraphicsScene			*m_scene;   
 	Matrix					*m_plotterMatrix;
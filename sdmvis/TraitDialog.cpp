@@ -1,4 +1,5 @@
 #include "TraitDialog.h"
+#include "TraitWeightSearch.h"
 #include <QtGui>
 #include <fstream>
 #include <vector>
@@ -80,12 +81,14 @@ TraitDialog::TraitDialog( QWidget* parent )
 	QPushButton* butComputeTrait = new QPushButton(tr("Compute trait..."));
 	//butComputeTrait->setEnabled(false);
 	QPushButton* butDefaultWeights = new QPushButton(tr("Default weights"));
+	QPushButton* butSearchWeights  = new QPushButton(tr("Search weights..."));
 
 	connect( butOpenNames   , SIGNAL(clicked()), this, SLOT(openNames()) );
 	connect( butOpenMatrix  , SIGNAL(clicked()), this, SLOT(openMatrix()) );
 	connect( butLoadLabels  , SIGNAL(clicked()), this, SLOT(loadLabels()) );
 	connect( butComputeTrait, SIGNAL(clicked()), this, SLOT(computeTrait()) );
 	connect(butDefaultWeights,SIGNAL(clicked()), this, SLOT(defaultWeights()) );
+	connect(butSearchWeights, SIGNAL(clicked()), this, SLOT(searchWeights()) );
 
 	// --- widgets ---
 
@@ -119,6 +122,9 @@ TraitDialog::TraitDialog( QWidget* parent )
 		lweights->addWidget( weights[i], i,1 );
 	}
 	lweights->addWidget( butDefaultWeights );
+	lweights->addWidget( butSearchWeights );
+	m_weightSearch = new TraitWeightSearch( this, m_ncompSpinBox,
+		m_weightC, m_weightW1, m_weightW2 );
 
 	// scale dimension w/ eigenvalues?
 	m_lambdaScaling = new QCheckBox(tr("Lambda scaling"));
@@ -355,6 +361,15 @@ void TraitDialog::defaultWeights()
 	m_weightW2->setValue( wB );
 }
 
+void TraitDialog::searchWeights()
+{
+	// get labels and group sizes
+	std::vector<int> labels;
+	int nA(0), nB(0);
+	if( getClassification( labels, nA, nB ) )
+		m_weightSearch->start( m_V, labels );
+}
+
 bool TraitDialog::getClassification( std::vector<int>& labels, int& nA, int& nB )
 {
 	using namespace std;
@@ -464,23 +479,14 @@ void TraitDialog::computeTrait()
 		return;
 	}
 
-	// get model SV, coefficients
-	Matrix SV( m_svm.nrows(), m_svm.ncols() );
-	Vector sv_coef( m_svm.nrows() );
-	rednum::matrix_from_rawbuffer<double,Matrix,double>( SV     , m_svm.sv() );
-	rednum::vector_from_rawbuffer<double,Vector,double>( sv_coef, m_svm.sv_coef() );
-
 	namespace ublas = boost::numeric::ublas;
 
-	// compute normal vector w = SV'*sv_coef  and distance b
-	Vector w = ublas::prod( ublas::trans(SV), sv_coef );
-	double b = - m_svm.model()->rho[0];
-
-	if( m_svm.model()->label[0] == -1 ) {
-		// see libsvm faq for rationale here
-		w *= -1.;
-		b *= -1.;
-	}
+	// get normal vector w and distance b
+	vector<double> wbuf;
+	double b;
+	m_svm.hyperplane( wbuf, b );
+	Vector w( wbuf.size() );
+	rednum::vector_from_rawbuffer<double,Vector,double>( w, &wbuf[0] );
 
 	// project w into column space of V
 	Vector v_w = ublas::prod( V_k, w );          // FIXME: normalization?!
@@ -21,6 +21,7 @@ class ComboDelegate;
 class QSpinBox;
 class QDoubleSpinBox;
 class QCheckBox;
+class TraitWeightSearch;
 
 class TraitDialog : public QDialog
 {
@@ -40,6 +41,7 @@ protected slots:
 	void loadLabels();
 	void computeTrait();
 	void defaultWeights();
+	void searchWeights();
 
 protected:
 	bool getClassification( std::vector<int>& labels, int& nA, int& nB );
@@ -56,6 +58,7 @@ private:
 	QDoubleSpinBox*     m_weightW1;
 	QDoubleSpinBox*     m_weightW2;
 	QCheckBox*          m_lambdaScaling;
+	TraitWeightSearch*  m_weightSearch;
 
 	QCheckBox*          m_updateMatlab;
 
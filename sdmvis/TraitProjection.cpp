@@ -0,0 +1,160 @@
+#include "TraitProjection.h"
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+bool equal( const Vector& a, const Vector& b )
+{
+	return a.size()==b.size() &&
+		std::equal( a.data().begin(), a.data().end(), b.data().begin() );
+}
+
+} // anonymous namespace
+
+TraitProjection::TraitProjection()
+: m_dirty( true )
+{
+}
+
+bool TraitProjection::update( const Matrix& V, const QList<Trait>& traits )
+{
+	if( !changed( V, traits ) )
+		return false;
+
+	compute( V, traits );
+	m_dirty = false;
+	return true;
+}
+
+bool TraitProjection::changed( const Matrix& V, const QList<Trait>& traits ) const
+{
+	if( m_dirty ||
+		V.size1() != m_V.size1() || V.size2() != m_V.size2() ||
+		traits.size() != (int)m_normals.size() )
+		return true;
+
+	if( !std::equal( V.data().begin(), V.data().end(), m_V.data().begin() ) )
+		return true;
+
+	for( int t=0; t < traits.size(); ++t )
+		if( offset(traits[t]) != m_offsets[t] ||
+			!equal( traits[t].trait,  m_normals[t] ) ||
+			!equal( traits[t].labels, m_labels[t] ) )
+			return true;
+
+	return false;
+}
+
+void TraitProjection::compute( const Matrix& V, const QList<Trait>& traits )
+{
+	namespace ublas = boost::numeric::ublas;
+
+	int N = (int)V.size1(),
+	    T = traits.size();
+
+	// keep a copy of the inputs to detect changes
+	m_V = V;
+	m_normals.resize( T );
+	m_offsets.resize( T );
+	m_labels .resize( T );
+	for( int t=0; t < T; ++t )
+	{
+		m_normals[t] = traits[t].trait;
+		m_offsets[t] = offset( traits[t] );
+		m_labels [t] = traits[t].labels;
+	}
+
+	// a trait uses the first numOfComp components, i.e. its normal is zero
+	// padded to the largest number of components kmax of all traits
+	size_t kmax = 0;
+	std::vector<double> length( T, 0.0 );
+	m_valid.assign( T, false );
+	for( int t=0; t < T; ++t )
+	{
+		const Vector& w = m_normals[t];
+		length[t] = ublas::norm_2( w );
+		if( w.size() > 0 && w.size() <= V.size2() && length[t] > 0.0 )
+		{
+			m_valid[t] = true;
+			kmax = std::max( kmax, w.size() );
+		}
+	}
+
+	// unit normals as columns of W and scaled offsets b
+	Matrix W = ublas::zero_matrix<double>( kmax, T );
+	Vector b = ublas::zero_vector<double>( T );
+	for( int t=0; t < T; ++t )
+		if( m_valid[t] )
+		{
+			for( size_t j=0; j < m_normals[t].size(); ++j )
+				W( j, t ) = m_normals[t][j] / length[t];
+			b[t] = m_offsets[t] / length[t];
+		}
+
+	// all subjects against all traits in one product
+	m_scores.resize( N, T, false );
+	if( kmax > 0 )
+		ublas::noalias( m_scores ) = ublas::prod( ublas::subrange( V, 0,N, 0,kmax ), W );
+	else
+		m_scores.clear();
+
+	for( int i=0; i < N; ++i )
+		for( int t=0; t < T; ++t )
+			m_scores( i, t ) += b[t];
+
+	m_stats.resize( T );
+	for( int t=0; t < T; ++t )
+		computeStatistics( t, m_labels[t] );
+}
+
+void TraitProjection::computeStatistics( int trait, const Vector& labels )
+{
+	Statistics& s = m_stats[trait];
+	s.min = s.max = 0.0;
+	s.misclassified = 0;
+	s.separation = 0.0;
+
+	double sum[2]   = { 0.0, 0.0 },
+	       sumSq[2] = { 0.0, 0.0 };
+	s.count[0] = s.count[1] = 0;
+
+	int N = numSubjects();
+	for( int i=0; i < N; ++i )
+	{
+		double d = m_scores( i, trait );
+		if( i==0 || d < s.min ) s.min = d;
+		if( i==0 || d > s.max ) s.max = d;
+
+		// labels other than -1 and +1 (e.g. 0 for unassigned) are ignored
+		if( i >= (int)labels.size() || (labels[i] != -1 && labels[i] != 1) )
+			continue;
+
+		int c = labels[i] < 0 ? 0 : 1;
+		s.count[c]++;
+		sum  [c] += d;
+		sumSq[c] += d*d;
+		if( (d < 0) != (c==0) )
+			s.misclassified++;
+	}
+
+	for( int c=0; c < 2; ++c )
+	{
+		s.mean  [c] = s.count[c] ? sum[c] / s.count[c] : 0.0;
+		s.stddev[c] = s.count[c] ?
+			sqrt( std::max( 0.0, sumSq[c] / s.count[c] - s.mean[c]*s.mean[c] ) ) : 0.0;
+	}
+
+	double var = s.stddev[0]*s.stddev[0] + s.stddev[1]*s.stddev[1],
+	       dm  = s.mean[1] - s.mean[0];
+	if( s.count[0] && s.count[1] && var > 0.0 )
+		s.separation = dm*dm / var;
+}
+
+QVector<double> TraitProjection::scores( int trait ) const
+{
+	QVector<double> v( numSubjects() );
+	for( int i=0; i < v.size(); ++i )
+		v[i] = m_scores( i, trait );
+	return v;
+}
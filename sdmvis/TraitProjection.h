@@ -0,0 +1,84 @@
+#ifndef TRAITPROJECTION_H
+#define TRAITPROJECTION_H
+
+#include "Trait.h"
+#include "numerics.h"   // Matrix, Vector
+#include <QList>
+#include <QVector>
+#include <vector>
+
+/// Signed distances of all subjects to all trait hyperplanes
+///
+/// A trait is the hyperplane w'x + b = 0 of a linear SVM trained on the
+/// leading Trait::numOfComp columns of the plotter matrix (V scaled by
+/// SDMVisConfig::getPlotScaling(), see TraitSelectionWidget::computeTrait()).
+/// The N x T score matrix
+///		S(i,t) = (w_t' x_i + b_t) / |w_t|
+/// is computed for all subjects i and traits t by a single matrix product of
+/// V with the zero padded unit normals of all traits, the sign of a score is
+/// the predicted class (negative for class -1, positive for class +1).
+///
+/// Scores and statistics are cached, update() only recomputes them if V,
+/// a hyperplane, the number of components or the labels of a trait changed.
+/// It is therefore cheap to call before each redraw of a plot.
+class TraitProjection
+{
+public:
+	/// Score statistics of a single trait, index 0 is class -1, 1 is class +1
+	struct Statistics
+	{
+		double min, max;      ///< score range over all subjects
+		double mean[2];       ///< mean score per class
+		double stddev[2];     ///< standard deviation of score per class
+		int    count[2];      ///< number of labeled subjects per class
+		int    misclassified; ///< labeled subjects on the wrong side
+		double separation;    ///< Fisher ratio (mean1-mean0)^2/(var0+var1)
+	};
+
+	TraitProjection();
+
+	/// Recompute scores if V or traits changed since last call, returns true
+	/// if scores were recomputed.
+	bool update( const Matrix& V, const QList<Trait>& traits );
+
+	/// Force recomputation on next update()
+	void invalidate() { m_dirty = true; }
+
+	int numSubjects() const { return (int)m_scores.size1(); }
+	int numTraits  () const { return (int)m_scores.size2(); }
+
+	/// False if trait has no normal or more components than V has columns,
+	/// the scores of such a trait are zero.
+	bool isValid( int trait ) const { return m_valid[trait]; }
+
+	/// N x T score matrix (after update())
+	const Matrix& scores() const { return m_scores; }
+	/// Scores of all subjects for a single trait (after update())
+	QVector<double> scores( int trait ) const;
+	/// Statistics of a single trait (after update())
+	const Statistics& statistics( int trait ) const { return m_stats[trait]; }
+
+	/// Hyperplane offset b, Trait::distance stores 0.1*b for the plot widgets
+	static double offset( const Trait& trait ) { return 10.0*trait.distance; }
+
+protected:
+	bool changed( const Matrix& V, const QList<Trait>& traits ) const;
+	void compute( const Matrix& V, const QList<Trait>& traits );
+	void computeStatistics( int trait, const Vector& labels );
+
+private:
+	bool m_dirty;
+
+	///@{ Inputs of last computation
+	Matrix m_V;
+	std::vector<Vector> m_normals; ///< hyperplane normal w per trait
+	std::vector<double> m_offsets; ///< hyperplane offset b per trait
+	std::vector<Vector> m_labels;  ///< class labels per trait
+	///@}
+
+	Matrix m_scores;
+	std::vector<bool>       m_valid;
+	std::vector<Statistics> m_stats;
+};
+
+#endif // TRAITPROJECTION_H
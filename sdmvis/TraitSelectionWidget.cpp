@@ -1,4 +1,5 @@
 #include "TraitSelectionWidget.h"
+#include "TraitWeightSearch.h"
 
 #include <QHBoxLayout>
 #include <QVBoxLayout>
@@ -71,6 +72,7 @@ TraitSelectionWidget::TraitSelectionWidget(QWidget *parent)
 	QPushButton *loadLabelsButton	= new QPushButton(tr("Load Labels..."));
 	QPushButton *butOpenMatrix		= new QPushButton(tr("Open eigenvector matrix..."));
 	QPushButton *butDefaultWeights	= new QPushButton(tr("Default weights"));
+	QPushButton *butSearchWeights	= new QPushButton(tr("Search weights..."));
 	
 	butComputeTrait	= new QPushButton(tr("Compute trait..."));
 	butComputeWarp	= new QPushButton(tr("Compute warpfield..."));
@@ -121,6 +123,9 @@ TraitSelectionWidget::TraitSelectionWidget(QWidget *parent)
 	}
 	
 	lweights->addWidget( butDefaultWeights );
+	lweights->addWidget( butSearchWeights );
+	m_weightSearch = new TraitWeightSearch( this, m_ncompSpinBox,
+		m_weightC, m_weightW1, m_weightW2 );
 
 	// scale dimension w/ eigenvalues?
 	m_lambdaScaling = new QCheckBox(tr("Lambda scaling"));
@@ -219,6 +224,7 @@ TraitSelectionWidget::TraitSelectionWidget(QWidget *parent)
 	connect(butComputeTrait  ,SIGNAL(clicked()),			this, SLOT(computeTrait()) );
 	connect(butComputeWarp   ,SIGNAL(clicked()),			this, SLOT(computeWarp()) );
 	connect(butDefaultWeights,SIGNAL(clicked()),			this, SLOT(defaultWeights()) );
+	connect(butSearchWeights ,SIGNAL(clicked()),			this, SLOT(searchWeights()) );
 	connect(m_butAdd		 ,SIGNAL(clicked()),			this, SLOT(addExistTrait()));
 	connect(m_butCreate		 ,SIGNAL(clicked()),			this, SLOT(addNewTrait()));
 	connect(m_butRemove		 ,SIGNAL(clicked()),			this, SLOT(removeTraitFromCFG()));
@@ -970,6 +976,15 @@ void TraitSelectionWidget::defaultWeights()
 	m_weightW2->setValue( wB );
 }
 
+void TraitSelectionWidget::searchWeights()
+{
+	// get labels and group sizes
+	std::vector<int> labels;
+	int nA(0), nB(0);
+	if( getClassification( labels, nA, nB ) )
+		m_weightSearch->start( m_V, labels );
+}
+
 bool TraitSelectionWidget::getClassification( std::vector<int>& labels, int& nA, int& nB )
 {
 	using namespace std;
@@ -1107,23 +1122,14 @@ void TraitSelectionWidget::computeTrait()
 		return;
 	}
 
-	// get model SV, coefficients
-	Matrix SV( m_svm.nrows(), m_svm.ncols() );
-	Vector sv_coef( m_svm.nrows() );
-	rednum::matrix_from_rawbuffer<double,Matrix,double>( SV     , m_svm.sv() );
-	rednum::vector_from_rawbuffer<double,Vector,double>( sv_coef, m_svm.sv_coef() );
-
 	namespace ublas = boost::numeric::ublas;
 
-	// compute normal vector w = SV'*sv_coef  and distance b
-	Vector w = ublas::prod( ublas::trans(SV), sv_coef );
-	double b = - m_svm.model()->rho[0];
-
-	if( m_svm.model()->label[0] == -1 ) {
-		// see libsvm faq for rationale here
-		w *= -1.;
-		b *= -1.;
-	}
+	// get normal vector w and distance b
+	vector<double> wbuf;
+	double b;
+	m_svm.hyperplane( wbuf, b );
+	Vector w( wbuf.size() );
+	rednum::vector_from_rawbuffer<double,Vector,double>( w, &wbuf[0] );
 
 	// project w into column space of V
 	Vector v_w = ublas::prod( V_k, w );          // FIXME: normalization?!
@@ -21,6 +21,7 @@
 #include <QDoubleSpinBox>
 // HelpClass
 class TraitComb;
+class TraitWeightSearch;
 
 class TraitSelectionWidget : public QWidget
 {
@@ -119,6 +120,7 @@ private:
 	QDoubleSpinBox*     m_weightW1;
 	QDoubleSpinBox*     m_weightW2;
 	QCheckBox*          m_lambdaScaling;
+	TraitWeightSearch*  m_weightSearch;
 	//QCheckBox*          m_updateMatlab;  // TODO: add the Matlab checkbox for 'expert mode'
 	Matrix   m_V;      ///< first k eigenvectors
 	SVMTrain m_svm;
@@ -136,6 +138,7 @@ public slots:
 		void openNames();
 		void openLabels();
 		void defaultWeights();
+		void searchWeights();
 		void computeTrait();
 		void setValue(int index);
 		void computeWarp();
@@ -0,0 +1,124 @@
+#include "TraitWeightSearch.h"
+#include <QtConcurrentRun>
+#include <QMessageBox>
+#include <QProgressDialog>
+#include <QSpinBox>
+#include <QDoubleSpinBox>
+#include <iostream>
+
+TraitWeightSearch::TraitWeightSearch( QWidget* parent, QSpinBox* ncomp,
+	QDoubleSpinBox* C, QDoubleSpinBox* weight1, QDoubleSpinBox* weight2 )
+	: QObject(parent),
+	  m_parent  (parent),
+	  m_ncomp   (ncomp),
+	  m_weightC (C),
+	  m_weightW1(weight1),
+	  m_weightW2(weight2),
+	  m_progress(NULL)
+{
+	// small C values found by the search need more than 2 decimals
+	QDoubleSpinBox* weights[3] = { m_weightC, m_weightW1, m_weightW2 };
+	for( int i=0; i < 3; ++i )
+		weights[i]->setDecimals( 4 );
+
+	m_watcher = new QFutureWatcher<bool>( this );
+	connect( m_watcher, SIGNAL(finished()), this, SLOT(finished()) );
+}
+
+TraitWeightSearch::~TraitWeightSearch()
+{
+	// worker thread accesses m_search
+	m_canceled = 1;
+	m_watcher->waitForFinished();
+}
+
+bool TraitWeightSearch::progressCallback( double progress, void* userData )
+{
+	// called from worker thread, progress dialog lives in GUI thread
+	TraitWeightSearch* s = (TraitWeightSearch*)userData;
+	if( s->m_canceled != 0 )
+		return false;
+	QMetaObject::invokeMethod( s->m_progress, "setValue",
+		Qt::QueuedConnection, Q_ARG(int,(int)(100.0*progress)) );
+	return true;
+}
+
+void TraitWeightSearch::start( const Matrix& V, const std::vector<int>& labels )
+{
+	if( m_watcher->isRunning() )
+	{
+		QMessageBox::warning( m_parent, tr("sdmvis: Warning"),
+			tr("SVM weight search is already running!") );
+		return;
+	}
+
+	if( V.size1() != labels.size() )	{
+		QMessageBox::warning( m_parent, tr("sdmvis: Warning"),
+			tr("Mismatch number of names and number of columns in eigenvector matrix!"));
+		return;
+	}
+
+	// search over C, class weights and number of components
+	std::vector<double> data;
+	rednum::matrix_to_stdvector<double,Matrix>( V, data );
+
+	m_search.setup_problem( (int)labels.size(), (int)V.size2(), &labels[0], &data[0] );
+	m_search.set_default_grid();
+	m_search.set_successive_halving( true );
+	m_search.set_progress_callback( &TraitWeightSearch::progressCallback, this );
+
+	// start search in worker thread, parameter widgets are blocked meanwhile
+	m_canceled = 0;
+	m_progress = new QProgressDialog( tr("Searching SVM weights..."),
+		tr("Cancel"), 0, 100, m_parent );
+	m_progress->setWindowTitle( tr("sdmvis: SVM weight search") );
+	m_progress->setWindowModality( Qt::WindowModal );
+	m_progress->setMinimumDuration( 0 );
+	m_progress->setValue( 0 );
+	connect( m_progress, SIGNAL(canceled()), this, SLOT(cancel()) );
+
+	m_watcher->setFuture( QtConcurrent::run( &m_search, &SVMGridSearch::run ) );
+}
+
+void TraitWeightSearch::cancel()
+{
+	m_canceled = 1;
+}
+
+void TraitWeightSearch::finished()
+{
+	using namespace std;
+
+	if( m_progress )
+	{
+		m_progress->deleteLater();
+		m_progress = NULL;
+	}
+
+	if( !m_watcher->result() )
+	{
+		if( m_canceled == 0 )
+			QMessageBox::warning( m_parent, tr("sdmvis: Error in SVM weight search"),
+				tr("Search for SVM weights failed!\nError: %1")
+				.arg( m_search.getErrmsg().c_str() ));
+		return;
+	}
+
+	cout << "SVM weight search, " << m_search.num_folds() << "-fold cross validation scores:" << endl;
+	m_search.print_table( cout );
+
+	// set best candidate (invalidates the current trait of
+	// TraitSelectionWidget, see verifyValidation())
+	const SVMGridSearch::Result& best = m_search.best();
+	m_ncomp   ->setValue( best.params.ncomp );
+	m_weightC ->setValue( best.params.C );
+	m_weightW1->setValue( best.params.weight1 );
+	m_weightW2->setValue( best.params.weight2 );
+
+	QMessageBox::information( m_parent, tr("sdmvis: SVM weight search"),
+		tr("Best of %1 candidates has %2 components, C = %3, w1 = %4, w2 = %5.\n"
+		   "Balanced %6-fold cross validation error is %7.")
+		.arg( (int)m_search.results().size() ).arg( best.params.ncomp )
+		.arg( best.params.C ).arg( best.params.weight1 ).arg( best.params.weight2 )
+		.arg( m_search.num_folds() ).arg( best.error ));
+}
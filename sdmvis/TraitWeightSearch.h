@@ -0,0 +1,58 @@
+#ifndef TRAITWEIGHTSEARCH_H
+#define TRAITWEIGHTSEARCH_H
+
+#include <QObject>
+#include <QFutureWatcher>
+#include <QAtomicInt>
+
+#ifndef Q_MOC_RUN
+// Workaround for BOOST_JOIN problem, see TraitDialog.h
+#include "mat/numerics.h"
+#include "mat/SVMGridSearch.h"
+#endif
+
+#include <vector>
+
+class QWidget;
+class QSpinBox;
+class QDoubleSpinBox;
+class QProgressDialog;
+
+/// Cross validated search for the SVM parameters of a trait (see
+/// SVMGridSearch), shared by TraitDialog and TraitSelectionWidget.
+/// The search runs in a worker thread with a cancelable progress dialog,
+/// afterwards the best candidate is set in the given parameter widgets.
+class TraitWeightSearch : public QObject
+{
+	Q_OBJECT
+
+public:
+	TraitWeightSearch( QWidget* parent, QSpinBox* ncomp, QDoubleSpinBox* C,
+	                   QDoubleSpinBox* weight1, QDoubleSpinBox* weight2 );
+	~TraitWeightSearch();
+
+	/// Start search on eigenvector matrix V with one row per label (-1,+1)
+	void start( const Matrix& V, const std::vector<int>& labels );
+
+	bool isRunning() const { return m_watcher->isRunning(); }
+
+protected slots:
+	void cancel();
+	void finished();
+
+private:
+	static bool progressCallback( double progress, void* userData );
+
+	QWidget*        m_parent;
+	QSpinBox*       m_ncomp;
+	QDoubleSpinBox* m_weightC;
+	QDoubleSpinBox* m_weightW1;
+	QDoubleSpinBox* m_weightW2;
+
+	SVMGridSearch         m_search;
+	QFutureWatcher<bool>* m_watcher;
+	QProgressDialog*      m_progress;
+	QAtomicInt            m_canceled;
+};
+
+#endif // TRAITWEIGHTSEARCH_H
@@ -1058,7 +1058,7 @@ void tomSetupStratifiedGrid( vtkStructuredGrid* grid, int* dim,
 #include <vtkFieldDataToAttributeDataFilter.h>
 #include <vtkOutlineFilter.h>
 #include <vtkPointSource.h>
-#include <vtkProbeFilter.h>
+#include "../varvis/ImageProbeFilter.h"
 
 template<class T>
 T maxv( T* v, int n )
@@ -1134,7 +1134,7 @@ VectorfieldGlyphVisualization2::VectorfieldGlyphVisualization2
 	samples->SetRadius( maxv(extent,6)/2. );
 	samples->Update();
 
-	VTKPTR<vtkProbeFilter> probe = VTKPTR<vtkProbeFilter>::New();
+	VTKPTR<ImageProbeFilter> probe = VTKPTR<ImageProbeFilter>::New();
 	probe->SetInputConnection( samples->GetOutputPort() );
 	probe->SetSource( source );
 	probe->Update();
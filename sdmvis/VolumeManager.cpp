@@ -1,12 +1,16 @@
 #include "VolumeManager.h"
 #include <VolumeRendering/VolumeData.h>
 #include <VolumeRendering/VolumeUtils.h>  // load_volume(), create_volume_tex()
+#include <QtConcurrentRun>
 #include <iostream>
 
 using namespace std;
 
 int VolumeManager::s_verbosity = 1;
 
+// Default CPU memory budget of volume cache
+#define VOLUMEMANAGER_DEFAULT_BUDGET_MB 512
+
 //==============================================================================
 //	VolumeManager :: Volume
 //==============================================================================
@@ -75,6 +79,26 @@ bool VolumeManager::Volume::download()
 //	VolumeManager
 //==============================================================================
 
+VolumeManager::VolumeManager()
+: m_budget( (size_t)VOLUMEMANAGER_DEFAULT_BUDGET_MB * 1024 * 1024 ),
+  m_time  ( 0 )
+{
+}
+
+VolumeManager::~VolumeManager()
+{
+	clearCache();
+
+	// Free remaining entries still referenced by managed volumes
+	for( Cache::iterator it=m_cache.begin(); it!=m_cache.end(); ++it )
+	{
+		it->second.data.volume->clear();
+		delete it->second.data.volume;
+	}
+	for( size_t i=0; i < m_released.size(); ++i )
+		delete m_released[i];
+}
+
 void VolumeManager::clear()
 {
 	for( size_t i=0; i < m_vols.size(); ++i )
@@ -146,10 +170,33 @@ bool VolumeManager::add_volume( Volume vol, int opts )
 
 bool VolumeManager::loadVolume( std::string mhdFilename, int opts )
 {
-	int verbosity = 3;
-
 	Volume w( mhdFilename );
 
+	LoadResult res;
+	if( acquire_cached( mhdFilename, res ) )
+	{
+		// cache keeps ownership
+		w.set( res.volume, false );
+	}
+	else
+	if( m_budget > 0 )
+	{
+		// load volume from disk and put into cache
+		res = load_task( mhdFilename );
+		if( !res.dataptr )
+		{
+			cerr << "VolumeManager::loadVolume : Could not load volume " 
+				 << mhdFilename << endl;
+			return false;
+		}
+		CacheEntry e;
+		e.data     = res;
+		e.bytes    = get_size( res.volume );
+		e.lastUsed = ++m_time;
+		m_cache[mhdFilename] = e;
+		w.set( res.volume, false );
+	}
+	else
 	// load volume from disk
 	if( !w.load() )
 	{
@@ -166,6 +213,8 @@ bool VolumeManager::loadVolume( std::string mhdFilename, int opts )
 		w.clear();
 		return false;
 	}
+
+	enforce_budget();
 	return true;
 }
 
@@ -197,4 +246,176 @@ bool VolumeManager::setVolume( std::string idName, VolumeDataHeader* volume,
 	}
 
 	return true;
-}
\ No newline at end of file
+}
+
+//------------------------------------------------------------------------------
+//	Cache and background loading
+//------------------------------------------------------------------------------
+
+VolumeManager::LoadResult VolumeManager::load_task( std::string fname )
+{
+	// Note that load_volume() does not require a GL context
+	LoadResult res;
+	res.volume = load_volume( fname.c_str(), s_verbosity, &res.dataptr );
+	if( res.volume && !res.dataptr )
+	{
+		delete res.volume;
+		res.volume = NULL;
+	}
+	return res;
+}
+
+size_t VolumeManager::get_size( const VolumeDataHeader* vol )
+{
+	if( !vol ) return 0;
+	size_t elsize = 1;
+	switch( vol->elementTypeName() )
+	{
+	case VolumeDataHeader::USHORT: elsize = sizeof(unsigned short); break;
+	case VolumeDataHeader::FLOAT : elsize = sizeof(float);          break;
+	default: break;
+	}
+	return (size_t)vol->resX()*vol->resY()*vol->resZ()*vol->numChannels()*elsize;
+}
+
+QFuture<VolumeManager::LoadResult> VolumeManager::prefetch( std::string mhdFilename )
+{
+	collect_pending();
+
+	PendingMap::iterator it = m_pending.find( mhdFilename );
+	if( it != m_pending.end() )
+		return it->second;
+
+	if( m_budget == 0 || m_cache.count( mhdFilename ) )
+		return QFuture<LoadResult>();
+
+	QFuture<LoadResult> f = QtConcurrent::run( &VolumeManager::load_task, 
+	                                           mhdFilename );
+	m_pending[mhdFilename] = f;
+	return f;
+}
+
+void VolumeManager::collect_pending( std::string waitFor )
+{
+	PendingMap::iterator it = m_pending.begin();
+	while( it != m_pending.end() )
+	{
+		if( it->first == waitFor )
+			it->second.waitForFinished();
+
+		if( !it->second.isFinished() )
+		{
+			++it;
+			continue;
+		}
+
+		LoadResult res = it->second.result();
+		if( res.dataptr )
+		{
+			CacheEntry e;
+			e.data     = res;
+			e.bytes    = get_size( res.volume );
+			e.lastUsed = ++m_time;
+			m_cache[it->first] = e;
+		}
+		else
+			cerr << "VolumeManager::prefetch : Could not load volume " 
+			     << it->first << endl;
+
+		m_pending.erase( it++ );
+	}
+}
+
+bool VolumeManager::acquire_cached( std::string fname, LoadResult& res )
+{
+	collect_pending( fname );
+
+	Cache::iterator it = m_cache.find( fname );
+	if( it == m_cache.end() )
+		return false;
+
+	it->second.lastUsed = ++m_time;
+	res = it->second.data;
+	return true;
+}
+
+bool VolumeManager::isCached( std::string mhdFilename ) const
+{
+	return m_cache.find( mhdFilename ) != m_cache.end();
+}
+
+size_t VolumeManager::getMemoryUsage() const
+{
+	size_t bytes = 0;
+	for( Cache::const_iterator it=m_cache.begin(); it!=m_cache.end(); ++it )
+		bytes += it->second.bytes;
+	return bytes;
+}
+
+void VolumeManager::setMemoryBudget( size_t bytes )
+{
+	m_budget = bytes;
+	enforce_budget();
+}
+
+void VolumeManager::enforce_budget()
+{
+	collect_pending();
+
+	size_t usage = getMemoryUsage();
+	while( usage > m_budget )
+	{
+		// Find least recently used entry, preferably one not referenced by a
+		// managed volume. Managed volumes still access the header and, unless
+		// they released their CPU memory, the data as well.
+		Cache::iterator lru = m_cache.end();
+		bool lruInUse = false;
+		for( Cache::iterator it=m_cache.begin(); it!=m_cache.end(); ++it )
+		{
+			bool inUse = false, needsData = false;
+			for( size_t i=0; i < m_vols.size(); ++i )
+				if( m_vols[i].volume() == it->second.data.volume )
+				{
+					inUse = true;
+					needsData = needsData || m_vols[i].is_in_cpu_memory();
+				}
+			if( needsData )
+				continue;
+
+			if( lru==m_cache.end() || (lruInUse && !inUse) ||
+			    (lruInUse==inUse && it->second.lastUsed < lru->second.lastUsed) )
+			{
+				lru = it;
+				lruInUse = inUse;
+			}
+		}
+		if( lru == m_cache.end() )
+		{
+			cerr << "VolumeManager : Warning: Volumes in use exceed CPU memory "
+			        "budget (" << usage/(1024*1024) << " MB > " 
+			     << m_budget/(1024*1024) << " MB)!" << endl;
+			break;
+		}
+
+		usage -= lru->second.bytes;
+		lru->second.data.volume->clear();
+		if( lruInUse )
+			m_released.push_back( lru->second.data.volume );
+		else
+			delete lru->second.data.volume;
+		m_cache.erase( lru );
+	}
+}
+
+void VolumeManager::clearCache()
+{
+	for( PendingMap::iterator it=m_pending.begin(); it!=m_pending.end(); ++it )
+		it->second.waitForFinished();
+	collect_pending();
+
+	// Evict everything not in use
+	size_t budget = m_budget;
+	m_budget = 0;
+	enforce_budget();
+	m_budget = budget;
+}
@@ -3,12 +3,26 @@
 
 #include <vector>
 #include <string>
+#include <map>
+#include <QFuture>
 #include <GL/GLTexture.h>
 
 class VolumeDataHeader;
 
 /// \todo function to download \a Volume to GPU memory after \a loadVolume()
 ///       (load and upload could be functions of \a Volume class itself)
+///
+/// Volumes read from disk are kept in a CPU cache which is bounded by a
+/// memory budget, least recently used entries are evicted first. Entries of
+/// managed volumes which released their CPU memory (see \a ReleaseCPUMemory)
+/// are evicted last, only their header is kept. The budget is exceeded only
+/// by volumes which still need their CPU data, a warning is issued then.
+/// Disk reads
+/// can be started ahead of time in a background thread via \a prefetch(),
+/// a subsequent \a loadVolume() of the same file then only has to wait for
+/// the pending read (if any) and upload the data to the GPU. Note that
+/// \a clear() only releases the managed volumes and textures, the cache is
+/// kept such that switching back to a previously loaded volume is fast.
 class VolumeManager
 {
 	static int s_verbosity;
@@ -16,6 +30,17 @@ class VolumeManager
 public:
 	class Volume;
 
+	/// Result of a (background) disk read
+	struct LoadResult
+	{
+		VolumeDataHeader* volume;
+		void*             dataptr;
+		LoadResult(): volume(NULL), dataptr(NULL) {}
+	};
+
+	VolumeManager();
+	~VolumeManager();
+
 	/// Bit combinable options for \a loadVolume()
 	enum Options {
 		DownloadToGPU   = 1,
@@ -30,9 +55,28 @@ public:
 					VolumeDataHeader* volume, bool takeOwnerShip=true,
 					int opts= (int)DownloadToGPU | (int)ReleaseCPUMemory );
 
-	/// Release all textures, free all memory
+	/// Release all textures, free all memory (except the cache)
 	void clear();
 
+	/// Start reading volume from disk in a background thread, returns
+	/// immediately. Nothing is done if the volume is already cached or
+	/// pending. Use a QFutureWatcher on the result to get notified when the
+	/// read has finished.
+	QFuture<LoadResult> prefetch( std::string mhdFilename );
+
+	/// Returns true if volume is resident in cache (i.e. read has finished)
+	bool isCached( std::string mhdFilename ) const;
+
+	///@{ CPU memory budget of the cache in bytes (0 disables caching)
+	void   setMemoryBudget( size_t bytes );
+	size_t getMemoryBudget() const { return m_budget; }
+	size_t getMemoryUsage() const;
+	///@}
+
+	/// Wait for pending reads and free all cached volumes which are not
+	/// referenced by a managed volume (see \a clear())
+	void clearCache();
+
 	Volume getVolume( std::string fname ) const { return get_volume(fname); }
 
 	/// Volume handle with header information, data pointer and GL texture
@@ -106,9 +150,38 @@ protected:
 	Volume get_volume( std::string fname ) const;
 	bool   add_volume( Volume warp, int opts );
 
+	/// Disk read, executed in a worker thread by \a prefetch()
+	static LoadResult load_task( std::string fname );
+
+	/// Move finished reads into cache, optionally wait for \a fname
+	void collect_pending( std::string waitFor="" );
+	/// Get volume from cache or pending read, returns false if not present
+	bool acquire_cached( std::string fname, LoadResult& res );
+	/// Evict least recently used entries whose data is not in use to meet
+	/// budget, warns if volumes in use exceed it
+	void enforce_budget();
+
+	static size_t get_size( const VolumeDataHeader* vol );
+
 private:
 	typedef std::vector<Volume> VolumeArray;
 	VolumeArray m_vols;
+
+	struct CacheEntry
+	{
+		LoadResult data;
+		size_t     bytes;
+		unsigned   lastUsed;
+	};
+	typedef std::map< std::string, CacheEntry >            Cache;
+	typedef std::map< std::string, QFuture<LoadResult> >   PendingMap;
+
+	Cache      m_cache;
+	PendingMap m_pending;
+	std::vector<VolumeDataHeader*> m_released; ///< Headers of evicted entries
+	                                           ///< still used by managed volumes
+	size_t     m_budget;
+	unsigned   m_time;
 };
 
 #endif // VOLUMEMANAGER_H
@@ -0,0 +1,229 @@
+#include "VolumeBricks.h"
+#include "VolumeData.h"
+#include <iostream>
+#include <fstream>
+#include <cstring>  // for memcmp()
+#include <cfloat>   // for FLT_MAX
+#include <sys/types.h>
+#include <sys/stat.h>
+
+using namespace std;
+
+namespace {
+	const char c_magic[4] = { 'B','R','K','1' };
+}
+
+VolumeBricks::VolumeBricks()
+{
+	clear();
+}
+
+void VolumeBricks::clear()
+{
+	m_res[0] = m_res[1] = m_res[2] = 0;
+	m_numBricks[0] = m_numBricks[1] = m_numBricks[2] = 0;
+	m_brickSize   = 16;
+	m_numChannels = 1;
+	m_elementType = 0;
+	m_stampSize = m_stampTime = 0.0;
+	m_min.clear();
+	m_max.clear();
+}
+
+void VolumeBricks::setup( const int res[3], int brickSize )
+{
+	m_brickSize = std::max( brickSize, 1 );
+	for( int d=0; d < 3; d++ )
+	{
+		m_res[d] = std::max( res[d], 0 );
+		m_numBricks[d] = (m_res[d] + m_brickSize - 1) / m_brickSize;
+	}
+	size_t n = (size_t)m_numBricks[0]*m_numBricks[1]*m_numBricks[2];
+	m_min.assign( n,  FLT_MAX );
+	m_max.assign( n, -FLT_MAX );
+}
+
+bool VolumeBricks::build( const VolumeDataHeader* vol, const void* dataptr,
+                          int brickSize )
+{
+	if( !vol || !dataptr )
+		return false;
+
+	int res[3] = { (int)vol->resX(), (int)vol->resY(), (int)vol->resZ() };
+	int nc = (int)vol->numChannels();
+	switch( vol->elementTypeName() )
+	{
+	case VolumeDataHeader::UCHAR:
+		build( (const unsigned char*)dataptr, res, nc, brickSize );
+		break;
+	case VolumeDataHeader::USHORT:
+		build( (const unsigned short*)dataptr, res, nc, brickSize );
+		break;
+	case VolumeDataHeader::FLOAT:
+		build( (const float*)dataptr, res, nc, brickSize );
+		break;
+	default:
+		cerr << "VolumeBricks::build() : Unsupported volume element type!" << endl;
+		return false;
+	}
+	m_elementType = (int)vol->elementTypeName();
+	return true;
+}
+
+int VolumeBricks::computeSkipMask( float threshold, int dilation,
+                                   std::vector<unsigned char>& mask ) const
+{
+	mask.assign( m_min.size(), 0 );
+	if( empty() )
+		return 0;
+
+	// Dilation in number of bricks
+	int r = (std::max( dilation, 0 ) + m_brickSize - 1) / m_brickSize;
+
+	const int* nb = m_numBricks;
+	int count = 0;
+	for( int k=0; k < nb[2]; k++ )
+		for( int j=0; j < nb[1]; j++ )
+			for( int i=0; i < nb[0]; i++ )
+			{
+				bool skip = true;
+				for( int kk=std::max(k-r,0); kk <= std::min(k+r,nb[2]-1) && skip; kk++ )
+				for( int jj=std::max(j-r,0); jj <= std::min(j+r,nb[1]-1) && skip; jj++ )
+				for( int ii=std::max(i-r,0); ii <= std::min(i+r,nb[0]-1) && skip; ii++ )
+					if( m_max[ (kk*nb[1] + jj)*nb[0] + ii ] >= threshold )
+						skip = false;
+
+				if( skip )
+				{
+					mask[ (k*nb[1] + j)*nb[0] + i ] = 1;
+					count++;
+				}
+			}
+	return count;
+}
+
+//-----------------------------------------------------------------------------
+//	Serialization
+//-----------------------------------------------------------------------------
+
+std::string VolumeBricks::getBrickFilename( const char* mhdFilename )
+{
+	std::string fname( mhdFilename );
+	size_t slash = fname.find_last_of( "/\\" );
+	size_t dot   = fname.find_last_of( '.' );
+	if( dot != std::string::npos && (slash == std::string::npos || dot > slash) )
+		fname = fname.substr( 0, dot );
+	return fname + ".bricks";
+}
+
+bool VolumeBricks::getFileStamp( const std::string& filename,
+                                 double& size, double& mtime )
+{
+	struct stat st;
+	if( stat( filename.c_str(), &st ) != 0 )
+		return false;
+	size  = (double)st.st_size;
+	mtime = (double)st.st_mtime;
+	return true;
+}
+
+bool VolumeBricks::save( const char* filename ) const
+{
+	ofstream f( filename, ios::binary );
+	if( !f.is_open() )
+	{
+		cerr << "Error: Could not open \"" << filename << "\" for writing!" << endl;
+		return false;
+	}
+
+	int header[6] = { m_res[0], m_res[1], m_res[2],
+	                  m_brickSize, m_numChannels, m_elementType };
+	double stamp[2] = { m_stampSize, m_stampTime };
+
+	f.write( c_magic, 4 );
+	f.write( (const char*)header, sizeof(header) );
+	f.write( (const char*)stamp,  sizeof(stamp) );
+	if( !m_min.empty() )
+	{
+		f.write( (const char*)&m_min[0], m_min.size()*sizeof(float) );
+		f.write( (const char*)&m_max[0], m_max.size()*sizeof(float) );
+	}
+	return f.good();
+}
+
+bool VolumeBricks::load( const char* filename )
+{
+	clear();
+
+	ifstream f( filename, ios::binary );
+	if( !f.is_open() )
+		return false;
+
+	char magic[4];
+	int header[6];
+	double stamp[2];
+	f.read( magic, 4 );
+	f.read( (char*)header, sizeof(header) );
+	f.read( (char*)stamp,  sizeof(stamp) );
+	if( !f.good() || memcmp( magic, c_magic, 4 ) != 0 )
+	{
+		cerr << "Error: \"" << filename << "\" is not a valid brick file!" << endl;
+		return false;
+	}
+
+	setup( header, header[3] );
+	m_numChannels = header[4];
+	m_elementType = header[5];
+	m_stampSize   = stamp[0];
+	m_stampTime   = stamp[1];
+
+	if( !m_min.empty() )
+	{
+		f.read( (char*)&m_min[0], m_min.size()*sizeof(float) );
+		f.read( (char*)&m_max[0], m_max.size()*sizeof(float) );
+	}
+	if( !f.good() )
+	{
+		cerr << "Error: Could not read brick data from \"" << filename << "\"!" << endl;
+		clear();
+		return false;
+	}
+	return true;
+}
+
+bool VolumeBricks::loadOrBuild( const char* mhdFilename,
+                                const VolumeDataHeader* vol, const void* dataptr,
+                                int brickSize, bool writeFile )
+{
+	if( !vol )
+		return false;
+
+	// Raw data file is relative to MHD as in load_volume()
+	std::string mhd( mhdFilename );
+	size_t slash = mhd.find_last_of( "/\\" );
+	std::string path = (slash == std::string::npos) ? "" : mhd.substr( 0, slash+1 );
+	double size=0.0, mtime=0.0;
+	bool hasStamp = getFileStamp( path + vol->filename(), size, mtime );
+
+	// Try to reuse existing brick file
+	std::string fname = getBrickFilename( mhdFilename );
+	if( hasStamp && load( fname.c_str() ) )
+	{
+		if( m_res[0]==(int)vol->resX() && m_res[1]==(int)vol->resY() &&
+		    m_res[2]==(int)vol->resZ() && m_brickSize==brickSize &&
+		    m_numChannels==(int)vol->numChannels() &&
+		    m_elementType==(int)vol->elementTypeName() &&
+		    m_stampSize==size && m_stampTime==mtime )
+			return true;
+	}
+
+	// Outdated or missing, build anew
+	if( !build( vol, dataptr, brickSize ) )
+		return false;
+	m_stampSize = size;
+	m_stampTime = mtime;
+
+	if( writeFile && hasStamp )
+		save( fname.c_str() ); // failure is not critical
+	return true;
+}
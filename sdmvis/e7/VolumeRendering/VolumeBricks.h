@@ -0,0 +1,156 @@
+//=============================================================================
+//
+//  VolumeBricks
+//
+//  Per-brick min/max metadata of a dense volume for empty space skipping.
+//
+//=============================================================================
+#ifndef VOLUMEBRICKS_H
+#define VOLUMEBRICKS_H
+
+#include <vector>
+#include <string>
+#include <cmath>
+#include <algorithm>
+
+class VolumeDataHeader;
+
+/// Min/max value range of cubic bricks partitioning a dense volume.
+///
+/// The volume data itself stays a dense linear array, only the value range
+/// of each brick of \a getBrickSize()^3 voxels is recorded. For scalar
+/// volumes the value is the (raw, non-normalized) intensity, for vector
+/// volumes the vector magnitude. Bricks are stored x-fastest like voxels.
+///
+/// The metadata is built once at load time and can be serialized to a small
+/// binary file next to the MHD (see \a getBrickFilename()), which is reused
+/// as long as the raw data file does not change (size and modification time).
+/// Consumers (raycasting, iso-surface extraction, sample point generation)
+/// query \a computeSkipMask() or \a isBelow() to avoid touching empty space.
+class VolumeBricks
+{
+public:
+	VolumeBricks();
+
+	/// Build from raw buffer of given resolution (x-fastest) and channels
+	template<class T>
+	void build( const T* data, const int res[3], int numChannels=1,
+	            int brickSize=16 );
+
+	/// Build from volume, supports UCHAR, USHORT and FLOAT element types
+	bool build( const VolumeDataHeader* vol, const void* dataptr,
+	            int brickSize=16 );
+
+	bool save( const char* filename ) const;
+	bool load( const char* filename );
+
+	/// Load brick file next to given MHD if it matches the volume, else build
+	/// from volume data and (optionally) write brick file for next time.
+	bool loadOrBuild( const char* mhdFilename, const VolumeDataHeader* vol,
+	                  const void* dataptr, int brickSize=16,
+	                  bool writeFile=true );
+
+	/// Brick file for given MHD, i.e. same path and name with .bricks suffix
+	static std::string getBrickFilename( const char* mhdFilename );
+
+	void clear();
+	bool empty() const { return m_min.empty(); }
+
+	int  getBrickSize() const { return m_brickSize; }
+	int  getNumBricks() const { return (int)m_min.size(); }
+	int  getNumBricks( int dim ) const { return m_numBricks[dim]; }
+	void getResolution( int (&res)[3] ) const
+	{
+		res[0] = m_res[0];
+		res[1] = m_res[1];
+		res[2] = m_res[2];
+	}
+
+	/// Index of brick containing voxel (i,j,k), no range check
+	int getBrickIndex( int i, int j, int k ) const
+	{
+		return ((k / m_brickSize)*m_numBricks[1] + (j / m_brickSize))
+		                        *m_numBricks[0] + (i / m_brickSize);
+	}
+
+	float getMin( int brick ) const { return m_min[brick]; }
+	float getMax( int brick ) const { return m_max[brick]; }
+
+	/// Returns true if all voxels of the brick containing voxel (i,j,k) are
+	/// below threshold. Voxels outside the volume are never below.
+	bool isBelow( int i, int j, int k, float threshold ) const
+	{
+		if( empty() || i < 0 || j < 0 || k < 0 ||
+		    i >= m_res[0] || j >= m_res[1] || k >= m_res[2] )
+			return false;
+		return m_max[ getBrickIndex(i,j,k) ] < threshold;
+	}
+
+	/// Set mask[b]=1 for each brick b where all voxels within a distance of
+	/// \a dilation voxels (per axis) of the brick are below \a threshold.
+	/// Dilation accounts for interpolation footprints and bounded warps.
+	/// Returns number of skippable bricks.
+	int computeSkipMask( float threshold, int dilation,
+	                     std::vector<unsigned char>& mask ) const;
+
+protected:
+	/// Identify raw data file version, returns false if file does not exist
+	static bool getFileStamp( const std::string& filename,
+	                          double& size, double& mtime );
+
+	void setup( const int res[3], int brickSize );
+
+	template<class T>
+	static float value( const T* data, size_t idx, int numChannels )
+	{
+		if( numChannels == 1 )
+			return (float)data[idx];
+		float s = 0.f;
+		for( int c=0; c < numChannels; c++ )
+		{
+			float x = (float)data[idx*numChannels + c];
+			s += x*x;
+		}
+		return sqrt( s );
+	}
+
+private:
+	int m_res[3];
+	int m_numBricks[3];
+	int m_brickSize;
+	int m_numChannels;
+	int m_elementType;        // VolumeDataHeader::ElementTypeName or 0
+	double m_stampSize,       // raw data file size and modification time
+	       m_stampTime;
+	std::vector<float> m_min, m_max;
+};
+
+//-----------------------------------------------------------------------------
+//	Template implementation
+//-----------------------------------------------------------------------------
+
+template<class T>
+void VolumeBricks::build( const T* data, const int res[3], int numChannels,
+                          int brickSize )
+{
+	clear();
+	setup( res, brickSize );
+	m_numChannels = numChannels;
+
+	// Single pass over the volume in memory order
+	size_t idx = 0;
+	for( int k=0; k < m_res[2]; k++ )
+		for( int j=0; j < m_res[1]; j++ )
+		{
+			int rowBrick = getBrickIndex( 0, j, k );
+			for( int i=0; i < m_res[0]; i++, idx++ )
+			{
+				int b = rowBrick + i / m_brickSize;
+				float v = value( data, idx, numChannels );
+				m_min[b] = std::min( m_min[b], v );
+				m_max[b] = std::max( m_max[b], v );
+			}
+		}
+}
+
+#endif // VOLUMEBRICKS_H
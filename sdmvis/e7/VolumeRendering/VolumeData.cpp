@@ -29,6 +29,7 @@ VolumeDataSetFromRAW<float>::VolumeDataSetFromRAW()
 {
 	m_elementType = VolumeDataHeader::FLOAT;
 	m_spacing[0] = m_spacing[1] = m_spacing[2] = 1.0;
+	m_numChannels = 1;
 }
 
 template<>
@@ -36,6 +37,7 @@ VolumeDataSetFromRAW<unsigned char>::VolumeDataSetFromRAW()
 {
 	m_elementType = VolumeDataHeader::UCHAR;
 	m_spacing[0] = m_spacing[1] = m_spacing[2] = 1.0;
+	m_numChannels = 1;
 }
 
 
@@ -243,6 +243,11 @@ public:
 		m_spacing[1] = sy;
 		m_spacing[2] = sz;
 	}
+	/// Number of interleaved channels, e.g. 3 for a vectorfield (default 1)
+	void setNumChannels( unsigned n )
+	{
+		m_numChannels = n;
+	}
 	//void setOffset( double x, double y, double z );
 	//void setOrigin( double x, double y, double z );
 
@@ -252,6 +257,7 @@ protected:
 	VolumeDataHeader::ElementTypeName m_elementType;
 private:
 	double   m_spacing[3];
+	unsigned m_numChannels;
 };
 
 //-----------------------------------------------------------------------------
@@ -706,6 +712,7 @@ VolumeData<T>* VolumeDataSetFromRAW<T>::
 	volume->m_spacingZ = m_spacing[2];
 	volume->m_filename = "";
 	volume->m_elementType = m_elementType;
+	volume->m_numChannels = m_numChannels;
 	// m_elementType is set in specialized constructor
 
 	volume->setBufferPtr( (void*)rawData, takeOwnerShip );	
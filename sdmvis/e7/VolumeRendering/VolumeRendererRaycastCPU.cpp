@@ -0,0 +1,739 @@
+#include "VolumeRendererRaycastCPU.h"
+#include <iostream>
+#include <algorithm>
+#include <cmath>
+#include <climits>  // for USHRT_MAX, UCHAR_MAX
+#include <cfloat>   // for FLT_MAX
+#include <cassert>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#ifdef WIN32
+// disable some VisualStudio warnings
+#pragma warning(disable: 4244)
+#endif
+
+using namespace std;
+
+namespace {
+	// Constants of raycast.fs.glsl
+	const float c_lambdaEps         = 0.001f;
+	const float c_terminationAlpha  = 1.f - 0.0039f;
+	const float c_minAlpha          = 0.0039f;
+	const int   c_refinementSteps   = 5;
+	const float c_dispColorScale    = 25.f * 1.75f;
+	const float c_opacityScale      = 128.f;  // OPACITY_CORRECTION == 3
+	const int   c_lutSize           = 256;    // as in VolumeRendererRaycast
+	const float c_matKa = 0.23f, c_matKs = 0.06f, c_matKd = 0.7f;
+
+	inline float clampf( float x, float lo, float hi )
+	{
+		return x < lo ? lo : (x > hi ? hi : x);
+	}
+
+	inline float smoothstep( float e0, float e1, float x )
+	{
+		float t = clampf( (x - e0) / (e1 - e0), 0.f, 1.f );
+		return t*t*(3.f - 2.f*t);
+	}
+
+	template<class T>
+	void normalize_copy( const T* src, size_t n, int channels, float scale,
+	                     std::vector<float>& dst )
+	{
+		dst.resize( n );
+		for( size_t i=0; i < n; i++ )
+		{
+			if( channels == 1 )
+				dst[i] = clampf( scale*(float)src[i], 0.f, 1.f );
+			else
+			{
+				// Magnitude of vectorfield entry (CHANNELS == 3)
+				float x = scale*(float)src[3*i  ],
+				      y = scale*(float)src[3*i+1],
+				      z = scale*(float)src[3*i+2];
+				dst[i] = sqrt( x*x + y*y + z*z );
+			}
+		}
+	}
+}
+
+//------------------------------------------------------------------------------
+//	Vec3
+//------------------------------------------------------------------------------
+
+float VolumeRendererRaycastCPU::Vec3::length() const
+{
+	return sqrt( x*x + y*y + z*z );
+}
+
+VolumeRendererRaycastCPU::Vec3 VolumeRendererRaycastCPU::Vec3::normalized() const
+{
+	float l = length();
+	return (l > 0.f) ? (*this)*(1.f/l) : *this;
+}
+
+//------------------------------------------------------------------------------
+//	C'tor and setters
+//------------------------------------------------------------------------------
+
+VolumeRendererRaycastCPU::VolumeRendererRaycastCPU()
+: m_intensityScale ( 1.f ),
+  m_bricks         ( NULL ),
+  m_numSkippedBricks( 0 ),
+  m_meanwarp       ( NULL ),
+  m_warpRange      ( 20.f ),
+  m_renderMode     ( RenderDirect ),
+  m_isovalue       ( 0.042f ), // defaults as in RaycastShader
+  m_stepsize       ( 0.005f ),
+  m_integrator     ( IntegrateDisplacementField ),
+  m_integratorSteps( 2 ),
+  m_lut            ( NULL ),
+  m_fovy           ( 45.f ),
+  m_znear          ( 0.1f ),
+  m_tileSize       ( 16 )
+{
+	m_res[0] = m_res[1] = m_res[2] = 0;
+	m_aspect[0] = m_aspect[1] = m_aspect[2] = 1.f;
+	for( int i=0; i < 16; i++ )
+		m_modelviewInv[i] = (i%5==0) ? 1.f : 0.f;
+	updateLookupTable();
+}
+
+bool VolumeRendererRaycastCPU::setVolume( const VolumeDataHeader* vol,
+                                          const void* dataptr )
+{
+	if( !vol || !dataptr )
+		return false;
+
+	int nc = (int)vol->numChannels();
+	if( nc != 1 && nc != 3 )
+	{
+		cerr << "Error: Only scalar (1 channel) and vectorfield (3 channels) volumes supported!" << endl;
+		cerr << "       Given volume has " << nc << " channels!" << endl;
+		return false;
+	}
+
+	m_res[0] = (int)vol->resX();
+	m_res[1] = (int)vol->resY();
+	m_res[2] = (int)vol->resZ();
+	m_voxelsize = Vec3( 1.f/m_res[0], 1.f/m_res[1], 1.f/m_res[2] );
+
+	size_t n = (size_t)m_res[0]*m_res[1]*m_res[2];
+	switch( vol->elementTypeName() )
+	{
+	case VolumeDataHeader::UCHAR:
+		m_intensityScale = 1.f/UCHAR_MAX;
+		normalize_copy( (const unsigned char*)dataptr, n, nc, m_intensityScale, m_volume );
+		break;
+	case VolumeDataHeader::USHORT:
+		m_intensityScale = 1.f/USHRT_MAX;
+		normalize_copy( (const unsigned short*)dataptr, n, nc, m_intensityScale, m_volume );
+		break;
+	case VolumeDataHeader::FLOAT:
+		m_intensityScale = 1.f;
+		normalize_copy( (const float*)dataptr, n, nc, m_intensityScale, m_volume );
+		break;
+	default:
+		cerr << "Error: Unsupported volume element type!" << endl;
+		return false;
+	}
+	return true;
+}
+
+void VolumeRendererRaycastCPU::setBricks( const VolumeBricks* bricks )
+{
+	m_bricks = bricks;
+}
+
+void VolumeRendererRaycastCPU::setWarpfields( const std::vector<const float*>& modes )
+{
+	m_modes = modes;
+	m_warpMaxAbs.clear();
+	if( m_lambda.size() < m_modes.size() )
+		m_lambda.resize( m_modes.size(), 0.f );
+}
+
+void VolumeRendererRaycastCPU::setMeanwarp( const float* meanwarp )
+{
+	m_meanwarp = meanwarp;
+	m_warpMaxAbs.clear();
+}
+
+void VolumeRendererRaycastCPU::setAspect( float ax, float ay, float az )
+{
+	m_aspect[0] = ax;
+	m_aspect[1] = ay;
+	m_aspect[2] = az;
+}
+
+void VolumeRendererRaycastCPU::setLambda( int i, float lambda )
+{
+	assert( i >= 0 );
+	if( i >= (int)m_lambda.size() )
+		m_lambda.resize( i+1, 0.f );
+	m_lambda[i] = lambda;
+}
+
+float VolumeRendererRaycastCPU::getLambda( int i ) const
+{
+	if( i < 0 || i >= (int)m_lambda.size() )
+		return 0.f;
+	return m_lambda[i];
+}
+
+void VolumeRendererRaycastCPU::setStepsize( float step )
+{
+	m_stepsize = step;
+
+	// Change in stepsize requires new pre-integration of LUT
+	updateLookupTable();
+}
+
+void VolumeRendererRaycastCPU::setLookupTable( LookupTable* lut )
+{
+	m_lut = lut;
+	updateLookupTable();
+}
+
+void VolumeRendererRaycastCPU::updateLookupTable()
+{
+	m_lutTable.clear();
+	if( m_lut )
+	{
+		m_lut->setStepsize( m_stepsize );
+		m_lut->getTable( m_lutTable, c_lutSize );
+	}
+	else
+	{
+		// Fallback to linear grayscale ramp
+		LookupTable ramp;
+		ramp.add( 0.0, 0.0, 0.0, 0.0, 0.0 );
+		ramp.add( 1.0, 1.0, 1.0, 1.0, 1.0 );
+		ramp.setStepsize( m_stepsize );
+		ramp.getTable( m_lutTable, c_lutSize );
+	}
+}
+
+void VolumeRendererRaycastCPU::setCamera( const float* mv, float fovy, float znear )
+{
+	m_fovy  = fovy;
+	m_znear = znear;
+
+	// Invert affine modelview matrix (column-major)
+	float a00=mv[0], a10=mv[1], a20=mv[2],
+	      a01=mv[4], a11=mv[5], a21=mv[6],
+	      a02=mv[8], a12=mv[9], a22=mv[10];
+	float det = a00*(a11*a22 - a21*a12)
+	          - a01*(a10*a22 - a20*a12)
+	          + a02*(a10*a21 - a20*a11);
+	if( fabs(det) < 1e-12f )
+	{
+		cerr << "VolumeRendererRaycastCPU::setCamera() : Singular modelview matrix!" << endl;
+		return;
+	}
+	float id = 1.f / det;
+	float* m = m_modelviewInv;
+	m[0] =  (a11*a22 - a21*a12)*id;
+	m[4] = -(a01*a22 - a21*a02)*id;
+	m[8] =  (a01*a12 - a11*a02)*id;
+	m[1] = -(a10*a22 - a20*a12)*id;
+	m[5] =  (a00*a22 - a20*a02)*id;
+	m[9] = -(a00*a12 - a10*a02)*id;
+	m[2] =  (a10*a21 - a20*a11)*id;
+	m[6] = -(a00*a21 - a20*a01)*id;
+	m[10]=  (a00*a11 - a10*a01)*id;
+	for( int r=0; r < 3; r++ )
+		m[12+r] = -(m[r]*mv[12] + m[4+r]*mv[13] + m[8+r]*mv[14]);
+	m[3] = m[7] = m[11] = 0.f;
+	m[15] = 1.f;
+}
+
+//------------------------------------------------------------------------------
+//	Sampling
+//------------------------------------------------------------------------------
+
+void VolumeRendererRaycastCPU::getStencil( const Vec3& x, Stencil& s ) const
+{
+	// GL_LINEAR filtering with GL_CLAMP_TO_EDGE on texture coordinates x
+	float u[3] = { x.x*m_res[0] - .5f, x.y*m_res[1] - .5f, x.z*m_res[2] - .5f };
+	int   i0[3], i1[3];
+	float a[3];
+	for( int d=0; d < 3; d++ )
+	{
+		u[d] = clampf( u[d], 0.f, (float)(m_res[d]-1) );
+		i0[d] = (int)u[d];
+		i1[d] = std::min( i0[d]+1, m_res[d]-1 );
+		a[d]  = u[d] - i0[d];
+	}
+
+	int sx = 1, sy = m_res[0], sz = m_res[0]*m_res[1];
+	for( int c=0; c < 8; c++ )
+	{
+		int ix = (c&1) ? i1[0] : i0[0],
+		    iy = (c&2) ? i1[1] : i0[1],
+		    iz = (c&4) ? i1[2] : i0[2];
+		s.ofs[c] = ix*sx + iy*sy + iz*sz;
+		s.w[c] = ((c&1) ? a[0] : 1.f-a[0])
+		       * ((c&2) ? a[1] : 1.f-a[1])
+		       * ((c&4) ? a[2] : 1.f-a[2]);
+	}
+}
+
+float VolumeRendererRaycastCPU::getScalar( const Vec3& x ) const
+{
+	Stencil s;
+	getStencil( x, s );
+	const float* f = &m_volume[0];
+	float v = 0.f;
+	for( int c=0; c < 8; c++ )
+		v += s.w[c] * f[s.ofs[c]];
+	return v;
+}
+
+VolumeRendererRaycastCPU::Vec3 VolumeRendererRaycastCPU::getWarp( const Vec3& x ) const
+{
+	Stencil s;
+	getStencil( x, s );
+
+	const float r = m_warpRange;
+	float disp[3] = { 0.f, 0.f, 0.f };
+
+	// Linear combination of modes, trilinear weights are shared among modes
+	for( size_t i=0; i < m_modes.size(); i++ )
+	{
+		float lambda = m_lambda[i];
+		if( fabs(lambda) <= c_lambdaEps || !m_modes[i] )
+			continue;
+
+		const float* mode = m_modes[i];
+		for( int c=0; c < 8; c++ )
+		{
+			const float* v = mode + 3*(size_t)s.ofs[c];
+			float w = lambda * s.w[c];
+			disp[0] += w * clampf( v[0], -r, r );
+			disp[1] += w * clampf( v[1], -r, r );
+			disp[2] += w * clampf( v[2], -r, r );
+		}
+	}
+
+	// Mean warp is added unweighted
+	if( m_meanwarp )
+	{
+		for( int c=0; c < 8; c++ )
+		{
+			const float* v = m_meanwarp + 3*(size_t)s.ofs[c];
+			disp[0] += s.w[c] * clampf( v[0], -r, r );
+			disp[1] += s.w[c] * clampf( v[1], -r, r );
+			disp[2] += s.w[c] * clampf( v[2], -r, r );
+		}
+	}
+
+	// Voxel units to texture coordinates
+	return Vec3( disp[0]*m_voxelsize.x, disp[1]*m_voxelsize.y, disp[2]*m_voxelsize.z );
+}
+
+VolumeRendererRaycastCPU::Vec3 VolumeRendererRaycastCPU::integrate(
+	const Vec3& x0, float sign, int steps ) const
+{
+	Vec3 x = x0;
+	float h = sign / (float)steps;
+	for( int k=0; k < steps; k++ )
+	{
+		switch( m_integrator )
+		{
+		case IntegrateSVF_Euler:
+			x += getWarp( x ) * h;
+			break;
+		case IntegrateSVF_Midpoint:
+		{
+			Vec3 k1 = getWarp( x ) * h;
+			Vec3 k2 = getWarp( x + k1*.5f ) * h;
+			x += k2;
+			break;
+		}
+		default:
+		case IntegrateSVF_RK4:
+		{
+			Vec3 k1 = getWarp( x ) * h;
+			Vec3 k2 = getWarp( x + k1*.5f ) * h;
+			Vec3 k3 = getWarp( x + k2*.5f ) * h;
+			Vec3 k4 = getWarp( x + k3 ) * h;
+			x += k1*(1.f/6.f) + k2*(1.f/3.f) + k3*(1.f/3.f) + k4*(1.f/6.f);
+			break;
+		}
+		}
+	}
+	// Return displacement
+	return x - x0;
+}
+
+VolumeRendererRaycastCPU::Vec3 VolumeRendererRaycastCPU::getInverseDisplacement(
+	const Vec3& x ) const
+{
+	if( m_modes.empty() && !m_meanwarp )
+		return Vec3();
+
+	if( m_integrator == IntegrateDisplacementField )
+		// Simple negation to approximate inverse
+		return -getWarp( x );
+
+	// Vectorfield exponential of -v yields inverse deformation
+	return integrate( x, -1.f, std::max( m_integratorSteps, 1 ) );
+}
+
+VolumeRendererRaycastCPU::Vec3 VolumeRendererRaycastCPU::getNormal( const Vec3& x ) const
+{
+	Vec3 dx( m_voxelsize.x, 0.f, 0.f ),
+	     dy( 0.f, m_voxelsize.y, 0.f ),
+	     dz( 0.f, 0.f, m_voxelsize.z );
+	Vec3 n( getScalar(x - dx) - getScalar(x + dx),
+	        getScalar(x - dy) - getScalar(x + dy),
+	        getScalar(x - dz) - getScalar(x + dz) );
+	return n.normalized();
+}
+
+//------------------------------------------------------------------------------
+//	Shading
+//------------------------------------------------------------------------------
+
+VolumeRendererRaycastCPU::Vec3 VolumeRendererRaycastCPU::colorcode(
+	const Vec3& x, const Vec3& disp, const Vec3& normal ) const
+{
+	// COLORMODE 2 for isosurface rendering, plain white otherwise
+	bool iso = (m_renderMode==RenderIsosurface || m_renderMode==RenderSilhouette);
+	if( !iso || (m_modes.empty() && !m_meanwarp) )
+		return Vec3( 1.f, 1.f, 1.f );
+
+	// Displacement setting encodes displacement, SVF setting the initial
+	// velocity at x
+	Vec3 d = (m_integrator == IntegrateDisplacementField)
+	           ? disp : -getWarp( x + disp );
+
+	// Project displacement vector onto surface normal, sign indicates if warp
+	// deforms surface in- or outwards (grey = no change, red = outwards,
+	// blue = inwards)
+	float imp = (d * c_dispColorScale).dot( normal );
+	float imp_pos =  clampf( imp,  0.f, 1.f );
+	float imp_neg = -clampf( imp, -1.f, 0.f );
+	return Vec3( .5f + .5f*(imp_neg - imp_pos),
+	             .5f - .25f*std::max( imp_pos, imp_neg ),
+	             .5f + .5f*(imp_pos - imp_neg) ) * 2.f;
+}
+
+float VolumeRendererRaycastCPU::phong( const Vec3& n, const Vec3& eye, const Vec3& L ) const
+{
+	Vec3 E = eye.normalized();
+	Vec3 R = n * (2.f*n.dot(L)) - L; // reflect( -L, n )
+	float diff = std::max( L.dot(n), 0.23f );
+	float spec = 0.f;
+	if( diff > 0.f )
+	{
+		spec = std::max( R.dot(E), 0.7f );
+		spec = pow( spec, 5.8f );
+	}
+	return c_matKa + c_matKs*spec + c_matKd*diff;
+}
+
+float VolumeRendererRaycastCPU::phong( const Vec3& n, const Vec3& eye ) const
+{
+	const Vec3 light_pos( 1.f, 1.f, 1.f );
+	return .7f*phong( n, eye, eye.normalized() ) + .3f*phong( n, eye, light_pos );
+}
+
+void VolumeRendererRaycastCPU::transfer( float scalar, float* rgba ) const
+{
+	// 1D texture lookup, GL_LINEAR with GL_CLAMP_TO_EDGE
+	float u = clampf( scalar*c_lutSize - .5f, 0.f, (float)(c_lutSize-1) );
+	int   i0 = (int)u,
+	      i1 = std::min( i0+1, c_lutSize-1 );
+	float a = u - i0;
+	for( int j=0; j < 4; j++ )
+		rgba[j] = (1.f-a)*m_lutTable[4*i0+j] + a*m_lutTable[4*i1+j];
+
+	// VTK style opacity correction (OPACITY_CORRECTION == 3)
+	rgba[3] = clampf( rgba[3]*c_opacityScale, 0.f, 1.f );
+	rgba[0] *= rgba[3];
+	rgba[1] *= rgba[3];
+	rgba[2] *= rgba[3];
+}
+
+//------------------------------------------------------------------------------
+//	Empty space skipping
+//------------------------------------------------------------------------------
+
+void VolumeRendererRaycastCPU::updateSkipMask()
+{
+	m_skipMask.clear();
+	m_numSkippedBricks = 0;
+	if( !m_bricks || m_bricks->empty() || m_renderMode==RenderSilhouette )
+		return;
+
+	int res[3];
+	m_bricks->getResolution( res );
+	if( res[0]!=m_res[0] || res[1]!=m_res[1] || res[2]!=m_res[2] )
+	{
+		cerr << "VolumeRendererRaycastCPU : Brick resolution does not match "
+		        "volume, disabling empty space skipping!" << endl;
+		return;
+	}
+
+	// Samples contribute only above this (normalized) intensity
+	float threshold;
+	if( m_renderMode == RenderIsosurface )
+		threshold = m_isovalue;
+	else
+	{
+		// Lowest intensity where interpolated opacity can reach c_minAlpha
+		int first = c_lutSize;
+		for( int i=0; i < c_lutSize; i++ )
+			if( m_lutTable[4*i+3]*c_opacityScale >= c_minAlpha )
+			{
+				first = i;
+				break;
+			}
+		if( first == 0 )
+			return;
+		threshold = (first == c_lutSize) ? FLT_MAX 
+		                                 : (first - .5f) / (float)c_lutSize;
+	}
+
+	// Maximum absolute (clamped) component per warpfield, last is meanwarp
+	if( m_warpMaxAbs.size() != m_modes.size()+1 )
+	{
+		size_t n = 3*(size_t)m_res[0]*m_res[1]*m_res[2];
+		m_warpMaxAbs.assign( m_modes.size()+1, 0.f );
+		for( size_t i=0; i <= m_modes.size(); i++ )
+		{
+			const float* f = (i < m_modes.size()) ? m_modes[i] : m_meanwarp;
+			if( !f ) continue;
+			float maxabs = 0.f;
+			for( size_t j=0; j < n; j++ )
+				maxabs = std::max( maxabs, (float)fabs(f[j]) );
+			m_warpMaxAbs[i] = std::min( maxabs, m_warpRange );
+		}
+	}
+
+	// Bound on warp displacement (per axis, in voxels)
+	float maxDisp = m_warpMaxAbs.back();
+	for( size_t i=0; i < m_modes.size(); i++ )
+		if( fabs(m_lambda[i]) > c_lambdaEps )
+			maxDisp += fabs(m_lambda[i]) * m_warpMaxAbs[i];
+
+	// Plus trilinear footprint and texel center offset
+	int dilation = (int)ceil( maxDisp ) + 2;
+	if( dilation > 4*m_bricks->getBrickSize() )
+		// Hardly anything to skip but expensive to compute
+		return;
+
+	float rawThreshold = (threshold == FLT_MAX) ? FLT_MAX 
+	                                            : threshold / m_intensityScale;
+	m_numSkippedBricks = m_bricks->computeSkipMask( rawThreshold, dilation, m_skipMask );
+	if( m_numSkippedBricks == 0 )
+		m_skipMask.clear();
+}
+
+bool VolumeRendererRaycastCPU::isSkippable( const Vec3& x ) const
+{
+	int i = std::min( std::max( (int)(x.x*m_res[0]), 0 ), m_res[0]-1 ),
+	    j = std::min( std::max( (int)(x.y*m_res[1]), 0 ), m_res[1]-1 ),
+	    k = std::min( std::max( (int)(x.z*m_res[2]), 0 ), m_res[2]-1 );
+	return m_skipMask[ m_bricks->getBrickIndex( i, j, k ) ] != 0;
+}
+
+//------------------------------------------------------------------------------
+//	Raycasting
+//------------------------------------------------------------------------------
+
+bool VolumeRendererRaycastCPU::setupRay( float px, float py, int width, int height,
+                                         Vec3& rayIn, Vec3& rayOut ) const
+{
+	// Eye space ray direction with unit depth, such that ray parameter t
+	// equals eye space depth
+	const float deg2rad = 3.14159265358979f / 180.f;
+	float tanf = tan( .5f*m_fovy*deg2rad );
+	float ndcx = 2.f*px/width - 1.f,
+	      ndcy = 1.f - 2.f*py/height;
+	float de[3] = { ndcx*tanf*width/(float)height, ndcy*tanf, -1.f };
+
+	// Transform into volume bounding box space
+	const float* m = m_modelviewInv;
+	float o[3], d[3];
+	for( int r=0; r < 3; r++ )
+	{
+		o[r] = m[12+r];
+		d[r] = m[r]*de[0] + m[4+r]*de[1] + m[8+r]*de[2];
+	}
+
+	// Slab intersection with box [-aspect,aspect]
+	float t0 = m_znear + 0.01f, // near plane clipping as in draw_nearclip()
+	      t1 = 1e30f;
+	for( int r=0; r < 3; r++ )
+	{
+		if( fabs(d[r]) < 1e-12f )
+		{
+			if( o[r] < -m_aspect[r] || o[r] > m_aspect[r] )
+				return false;
+			continue;
+		}
+		float ta = (-m_aspect[r] - o[r]) / d[r],
+		      tb = ( m_aspect[r] - o[r]) / d[r];
+		if( ta > tb ) std::swap( ta, tb );
+		t0 = std::max( t0, ta );
+		t1 = std::min( t1, tb );
+	}
+	if( t1 <= t0 )
+		return false;
+
+	// Texture coordinates of entry and exit point
+	float in[3], out[3];
+	for( int r=0; r < 3; r++ )
+	{
+		in [r] = (o[r] + t0*d[r] + m_aspect[r]) / (2.f*m_aspect[r]);
+		out[r] = (o[r] + t1*d[r] + m_aspect[r]) / (2.f*m_aspect[r]);
+	}
+	rayIn  = Vec3( in [0], in [1], in [2] );
+	rayOut = Vec3( out[0], out[1], out[2] );
+	return true;
+}
+
+void VolumeRendererRaycastCPU::castRay( const Vec3& rayIn, const Vec3& rayOut,
+                                        float* dst ) const
+{
+	bool iso = (m_renderMode==RenderIsosurface || m_renderMode==RenderSilhouette);
+	bool mip = (m_renderMode==RenderMIP);
+
+	// Ray direction and traversal length
+	Vec3  dir = rayOut - rayIn;
+	float len = dir.length() + 0.001f;
+	dir = dir * (1.f/len);
+
+	Vec3 step = dir * m_stepsize;
+	Vec3 ray;
+	dst[0] = dst[1] = dst[2] = dst[3] = 0.f;
+	float mipvalue = 0.f;
+	bool skipping = !m_skipMask.empty();
+
+	int numsteps = (int)((1.f/m_stepsize) * 1.4142135f);
+	for( int i=0; i < numsteps; ++i )
+	{
+		// Ray termination
+		if( ray.length() >= len || dst[3] >= c_terminationAlpha )
+			break;
+
+		// Empty space skipping, keeps sample positions on the same grid
+		if( skipping && isSkippable( rayIn + ray ) )
+		{
+			ray += step;
+			continue;
+		}
+
+		Vec3 disp = getInverseDisplacement( rayIn + ray );
+		float intensity = getScalar( rayIn + ray + disp );
+
+		if( iso )
+		{
+			if( intensity > m_isovalue )
+			{
+				// Intersection refinement (binary search)
+				float searchdir = -1.f;
+				Vec3 ministep = step*.5f;
+				for( int j=0; j < c_refinementSteps; ++j )
+				{
+					ray += ministep * searchdir;
+					disp = getInverseDisplacement( rayIn + ray );
+					intensity = getScalar( rayIn + ray + disp );
+					searchdir = (intensity > m_isovalue) ? -1.f : 1.f;
+					ministep = ministep * .5f;
+				}
+
+				Vec3 normal = getNormal( rayIn + ray + disp );
+				Vec3 color  = colorcode( rayIn + ray, disp, normal );
+
+				if( m_renderMode == RenderSilhouette )
+				{
+					float edge = smoothstep( .5f, .6f, fabs( normal.dot(-dir) ) );
+					dst[0] = dst[1] = dst[2] = edge;
+				}
+				else
+				{
+					float li = phong( normal, -dir );
+					dst[0] = color.x * li;
+					dst[1] = color.y * li;
+					dst[2] = color.z * li;
+				}
+				dst[3] = 1.f;
+				break;
+			}
+		}
+		else
+		{
+			float src[4];
+			transfer( intensity, src );
+
+			if( mip )
+			{
+				if( src[3] > mipvalue && src[3] >= c_minAlpha )
+				{
+					mipvalue = src[3];
+					for( int j=0; j < 4; j++ )
+						dst[j] = src[j];
+				}
+			}
+			else
+			if( src[3] >= c_minAlpha )
+			{
+				// Front-to-back compositing (w/ pre-multiplied alpha)
+				float w = 1.f - dst[3];
+				for( int j=0; j < 4; j++ )
+					dst[j] += w * src[j];
+			}
+		}
+
+		// Advance ray position
+		ray += step;
+	}
+}
+
+void VolumeRendererRaycastCPU::render( int width, int height, float* rgba,
+                                       int rowBegin, int rowEnd )
+{
+	if( m_volume.empty() || width <= 0 || height <= 0 )
+		return;
+
+	if( rowEnd < 0 || rowEnd > height )
+		rowEnd = height;
+	rowBegin = std::max( rowBegin, 0 );
+	if( rowBegin >= rowEnd )
+		return;
+
+	updateSkipMask();
+
+	const int ts = m_tileSize;
+	const int tilesX = (width + ts - 1) / ts,
+	          tilesY = (rowEnd - rowBegin + ts - 1) / ts,
+	          numTiles = tilesX * tilesY;
+
+	// Tiles differ heavily in cost (empty space vs. warped surface), hence
+	// dynamic scheduling.
+	#pragma omp parallel for schedule(dynamic)
+	for( int tile=0; tile < numTiles; tile++ )
+	{
+		int x0 = (tile % tilesX) * ts,
+		    y0 = (tile / tilesX) * ts + rowBegin,
+		    x1 = std::min( x0 + ts, width ),
+		    y1 = std::min( y0 + ts, rowEnd );
+
+		for( int y=y0; y < y1; y++ )
+			for( int x=x0; x < x1; x++ )
+			{
+				float* dst = rgba + 4*((size_t)y*width + x);
+				Vec3 rayIn, rayOut;
+				if( setupRay( x+.5f, y+.5f, width, height, rayIn, rayOut ) )
+					castRay( rayIn, rayOut, dst );
+				else
+					dst[0] = dst[1] = dst[2] = dst[3] = 0.f;
+			}
+	}
+}
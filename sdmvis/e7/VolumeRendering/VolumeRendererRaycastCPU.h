@@ -0,0 +1,197 @@
+#ifndef VOLUMERENDERERRAYCASTCPU_H
+#define VOLUMERENDERERRAYCASTCPU_H
+
+#include "VolumeData.h"
+#include "LookupTable.h"
+#include "VolumeBricks.h"
+#include <vector>
+
+/// Software raycaster mirroring the GLSL raycaster (shader/raycast.fs.glsl).
+///
+/// Implements the same warp model as \a RaycastShader, i.e. a linear
+/// combination of (eigen-)warpfields weighted by lambda coefficients plus an
+/// optional mean warp, interpreted either as displacement field or as
+/// stationary velocity field (Euler, Midpoint or RK4 integration), and the
+/// same compositing modes (DVR, MIP, isosurface, silhouette) using a
+/// \a LookupTable transfer function. No OpenGL context is required, so this
+/// class can be used for headless batch rendering.
+///
+/// Remarks on equivalence with the GPU path:
+/// - Warpfields are given as interleaved float vectorfields in voxel units
+///   (as returned by \a StatisticalDeformationModel::getEigenmode()) and are
+///   clamped to [-warpRange,warpRange] like the pixel transfer mapping does
+///   on texture upload, but are not quantized to 8 bit.
+/// - All given warpfields contribute, i.e. there is no equivalent of the
+///   "lambdaUser" hack in \a RaycastShader.
+///
+/// Empty space is skipped if brick metadata of the reference volume is given
+/// via \a setBricks(). Skipping is conservative w.r.t. the transfer function
+/// (DVR, MIP) or isovalue and the maximum displacement of the current warp,
+/// such that the rendered image is identical to the one without skipping.
+///
+/// Rendering is parallelized over image tiles via OpenMP (if available).
+/// The warp synthesis shares trilinear weights among all modes such that the
+/// inner loop over modes is a plain multiply-add over contiguous floats.
+class VolumeRendererRaycastCPU
+{
+public:
+	/// Same values as \a RaycastShader::RenderMode
+	enum RenderMode {
+		RenderDirect    =0, ///< Direct Volume Rendering
+		RenderIsosurface=1, ///< Non-polygonal Isosurface
+		RenderMIP       =2, ///< Maximum-intensity-projection
+		RenderSilhouette=3  ///< Simple silhouette
+	};
+
+	/// Same values as \a RaycastShader::Integrators
+	enum Integrators {
+		IntegrateDisplacementField = 0,
+		IntegrateSVF_Euler         = 1,
+		IntegrateSVF_Midpoint      = 2,
+		IntegrateSVF_RK4           = 3
+	};
+
+	VolumeRendererRaycastCPU();
+
+	/// Set scalar reference volume (single channel UCHAR, USHORT or FLOAT).
+	/// Intensities are normalized to [0,1] like on GL texture upload, i.e.
+	/// integer types are divided by their maximum and float is clamped.
+	bool setVolume( const VolumeDataHeader* vol, const void* dataptr );
+
+	/// Set brick min/max of the reference volume (optional, may be NULL) for
+	/// empty space skipping. Must match resolution of reference volume and
+	/// pointer must remain valid.
+	void setBricks( const VolumeBricks* bricks );
+
+	/// Number of bricks skipped in last \a render() call
+	int getNumSkippedBricks() const { return m_numSkippedBricks; }
+
+	/// Set warpfields, each an interleaved xyz float buffer of the same
+	/// resolution as the reference volume. Pointers must remain valid.
+	void setWarpfields( const std::vector<const float*>& modes );
+	/// Set mean warpfield (optional, may be NULL). Pointer must remain valid.
+	void setMeanwarp( const float* meanwarp );
+
+	/// Warp components are clamped to [-range,range] (default 20 as in
+	/// SDMVISVOLUMERENDERER_ADJUST_PIXEL_TRANSFER).
+	void  setWarpRange( float range ) { m_warpRange = range; }
+	float getWarpRange() const { return m_warpRange; }
+
+	///@{ Same semantics as the corresponding \a VolumeRendererRaycast setters
+	void  setAspect( float ax, float ay, float az );
+	void  setRenderMode( int mode ) { m_renderMode = mode; }
+	int   getRenderMode() const { return m_renderMode; }
+	void  setIsovalue( float iso ) { m_isovalue = iso; }
+	float getIsovalue() const { return m_isovalue; }
+	void  setLambda( int i, float lambda );
+	float getLambda( int i ) const;
+	void  setStepsize( float step );
+	float getStepsize() const { return m_stepsize; }
+	void  setIntegrator( int type ) { m_integrator = type; }
+	int   getIntegrator() const { return m_integrator; }
+	void  setIntegratorSteps( int steps ) { m_integratorSteps = steps; }
+	int   getIntegratorSteps() const { return m_integratorSteps; }
+	void  setLookupTable( LookupTable* lut );
+	///@}
+
+	/// Set camera by a column-major 4x4 modelview matrix (as returned by
+	/// \a Trackball2::getCameraMatrix()) and perspective parameters as used
+	/// in \a SDMVisVolumeRenderer::resizeGL().
+	void setCamera( const float* modelview, float fovy, float znear=0.1f );
+
+	/// Edge length of square image tiles which are distributed among threads.
+	void setTileSize( int size ) { m_tileSize = size>0 ? size : 1; }
+	int  getTileSize() const { return m_tileSize; }
+
+	/// Render image rows [rowBegin,rowEnd) of a width x height image into
+	/// \a rgba (width*height*4 floats, row 0 at the top). Output is the color
+	/// the fragment shader writes, i.e. it has to be blended over a background
+	/// with source alpha like in \a SDMVisVolumeRenderer::paintGL().
+	/// Restricting the row range allows to distribute a single image over
+	/// several processes.
+	void render( int width, int height, float* rgba,
+	             int rowBegin=0, int rowEnd=-1 );
+
+protected:
+	struct Vec3
+	{
+		float x, y, z;
+		Vec3(): x(0.f), y(0.f), z(0.f) {}
+		Vec3( float x_, float y_, float z_ ): x(x_), y(y_), z(z_) {}
+		Vec3  operator + ( const Vec3& o ) const { return Vec3(x+o.x,y+o.y,z+o.z); }
+		Vec3  operator - ( const Vec3& o ) const { return Vec3(x-o.x,y-o.y,z-o.z); }
+		Vec3  operator * ( float s ) const { return Vec3(s*x,s*y,s*z); }
+		Vec3  operator - () const { return Vec3(-x,-y,-z); }
+		Vec3& operator += ( const Vec3& o ) { x+=o.x; y+=o.y; z+=o.z; return *this; }
+		float dot( const Vec3& o ) const { return x*o.x + y*o.y + z*o.z; }
+		float length() const;
+		Vec3  normalized() const;
+	};
+
+	/// Trilinear sampling weights and voxel offsets (GL_LINEAR semantics)
+	struct Stencil
+	{
+		int   ofs[8];
+		float w[8];
+	};
+
+	void  getStencil( const Vec3& x, Stencil& s ) const;
+
+	float getScalar( const Vec3& x ) const;
+	Vec3  getWarp( const Vec3& x ) const;
+	Vec3  getInverseDisplacement( const Vec3& x ) const;
+	Vec3  integrate( const Vec3& x0, float sign, int steps ) const;
+	Vec3  getNormal( const Vec3& x ) const;
+	Vec3  colorcode( const Vec3& x, const Vec3& disp, const Vec3& normal ) const;
+	float phong( const Vec3& n, const Vec3& eye, const Vec3& L ) const;
+	float phong( const Vec3& n, const Vec3& eye ) const;
+	void  transfer( float scalar, float* rgba ) const;
+
+	/// Compute ray entry and exit texture coordinates for pixel (px,py)
+	bool  setupRay( float px, float py, int width, int height,
+	                Vec3& rayIn, Vec3& rayOut ) const;
+	/// Traverse single ray, result is the RGBA fragment color
+	void  castRay( const Vec3& rayIn, const Vec3& rayOut, float* dst ) const;
+
+	void  updateLookupTable();
+
+	/// Setup \a m_skipMask for current render settings
+	void  updateSkipMask();
+
+	/// Returns true if sample position x lies in a skippable brick
+	bool  isSkippable( const Vec3& x ) const;
+
+private:
+	int   m_res[3];
+	Vec3  m_voxelsize;
+	std::vector<float> m_volume;   // normalized copy of the reference volume
+	float m_intensityScale;        // normalization factor of raw intensities
+
+	const VolumeBricks*        m_bricks;
+	std::vector<unsigned char> m_skipMask; // per brick, empty if no skipping
+	std::vector<float>         m_warpMaxAbs; // per mode (+ meanwarp), lazily
+	int                        m_numSkippedBricks;
+
+	std::vector<const float*> m_modes;
+	std::vector<float>        m_lambda;
+	const float*              m_meanwarp;
+	float                     m_warpRange;
+
+	float m_aspect[3];
+	int   m_renderMode;
+	float m_isovalue;
+	float m_stepsize;
+	int   m_integrator;
+	int   m_integratorSteps;
+
+	LookupTable*       m_lut;
+	std::vector<float> m_lutTable; // RGBA, sample rate corrected
+
+	float m_modelviewInv[16];
+	float m_fovy;
+	float m_znear;
+
+	int   m_tileSize;
+};
+
+#endif // VOLUMERENDERERRAYCASTCPU_H
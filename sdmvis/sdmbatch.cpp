@@ -0,0 +1,529 @@
+// sdmbatch - Headless processing jobs on SDMVis configs
+#include <boost/program_options.hpp>
+#include <string>
+#include <vector>
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <QCoreApplication>
+#include <QFileInfo>
+#include <QDir>
+#include <QMutex>
+#include <QThreadPool>
+#include <QtConcurrentMap>
+#include "SDMVisConfig.h"
+#include "SDMVisTasks.h"
+#include "TraitProjection.h"
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+namespace po = boost::program_options;
+
+using namespace std;
+
+//-----------------------------------------------------------------------------
+//	Jobs
+//-----------------------------------------------------------------------------
+
+/// Job list and job options, identical for all configs
+struct BatchSpec
+{
+	vector<string> jobs;
+	string roiMask, roiName, outputPath;
+	int    numModes, numThreads;
+	bool   save;
+};
+
+BatchSpec g_spec;
+
+/// Console output of concurrently processed configs, one line at a time
+void logMessage( QString config, string msg, bool error=false )
+{
+	static QMutex mutex;
+	QMutexLocker lock( &mutex );
+	(error ? cerr : cout) << "[" << config.toStdString() << "] "
+		<< (error ? "Error: " : "") << msg << endl;
+}
+
+/// Per config state shared by all jobs
+struct ConfigJobs
+{
+	QString      iniFilename, name, outputPath;
+	SDMVisConfig config;
+	bool         modified;
+
+	QString  warpsFilename;
+	int      N, M;
+	unsigned resolution[3];
+	double   spacing[3];
+
+	void info ( string msg ) const { logMessage( name, msg ); }
+	bool error( string msg ) const { logMessage( name, msg, true ); return false; }
+
+	bool setup();
+	bool pca();
+	bool roi();
+	bool traits();
+	bool csv();
+	bool modes();
+	bool run();
+};
+
+bool ConfigJobs::setup()
+{
+	QFileInfo info( iniFilename );
+	name = info.baseName();
+	modified = false;
+
+	if( !config.readConfig( info.absoluteFilePath() ) )
+		return error( "Could not read config \"" + iniFilename.toStdString()
+		              + "\": " + config.getErrMsg().toStdString() );
+
+	// output next to config as done by SDMVisMainWindow::refineROI()
+	outputPath = g_spec.outputPath.empty() ? config.getBasePath() + "/" + name
+	                     : QString::fromStdString( g_spec.outputPath ) + "/" + name;
+	if( !QDir().mkpath( outputPath ) )
+		return error( "Could not create output directory \""
+		              + outputPath.toStdString() + "\"" );
+
+	// dataset size is given implicitly by names array
+	M = config.getNames().size();
+	warpsFilename = config.getWarpsMatrix();
+	if( M == 0 || warpsFilename.isEmpty() )
+		return error( "Config must specify dataset names and warps matrix!" );
+
+	// volume resolution/spacing from first eigenwarp or reference (as in
+	// SDMVisMainWindow::computeTraitWarpfieldFileName())
+	QString volumeHeaderFilename = config.getEigenwarps().empty()
+		? config.getReference() : config.getEigenwarps().at(0).mhdFilename;
+	if( !loadVolumeGeometry( volumeHeaderFilename, resolution, spacing ) )
+		return error( "Eigenwarps or at least reference volume must be "
+		              "specified in the config!" );
+	N = 3 * resolution[0]*resolution[1]*resolution[2];
+	return true;
+}
+
+bool ConfigJobs::pca()
+{
+	info( "Computing PCA of warps matrix..." );
+
+	ComputePCATask task;
+	task.warpsFilename = warpsFilename;
+	task.N = N;
+	task.M = M;
+	if( !task.run() )
+		return false;
+
+	config.setScatterMatrix  ( task.scatter );
+	config.setPCAEigenvectors( task.V );
+	config.setPCAEigenvalues ( task.lambda );
+	modified = true;
+	return true;
+}
+
+bool ConfigJobs::roi()
+{
+	QString maskFilename = QString::fromStdString( g_spec.roiMask ),
+	        suffix = g_spec.roiName.empty() ? QFileInfo( maskFilename ).baseName()
+	                                        : QString::fromStdString( g_spec.roiName );
+	info( "Refining ROI " + suffix.toStdString() + "..." );
+
+	RefineROITask task;
+	unsigned maskResolution[3];
+	double   maskSpacing[3];
+	if( !loadVolumeGeometry( maskFilename, maskResolution, maskSpacing,
+	                         &task.maskFilename ) )
+		return false;
+	if( maskResolution[0] != resolution[0] || maskResolution[1] != resolution[1] ||
+		maskResolution[2] != resolution[2] )
+		return error( "Resolution mismatch between ROI mask and warpfields!" );
+
+	task.warpsFilename = warpsFilename;
+	task.N = N;
+	task.M = M;
+	for( int i=0; i < 3; ++i )
+	{
+		task.resolution[i] = resolution[i];
+		task.spacing   [i] = spacing[i];
+	}
+
+	// naming convention of RefineROIParameters
+	QString roiPath = outputPath + "/Roi/",
+	        sK = QString::number(M);
+	QDir().mkpath( roiPath );
+	task.outWarps            = roiPath + "warps_"    +suffix+".mat";
+	task.outScatter          = roiPath + "scatter_t_"+suffix+".mat";
+	task.outPCAEigenvectors  = roiPath + "yapca_"+suffix+"_V"     +sK+".mat";
+	task.outPCACoefficients  = roiPath + "yapca_"+suffix+"_C"     +sK+".mat";
+	task.outPCAEigenvalues   = roiPath + "yapca_"+suffix+"_lambda"+sK+".mat";
+	task.outEigenwarps       = roiPath + "eigenwarps"       +sK+"_"+suffix+".mat";
+	task.outEigenwarpsGlobal = roiPath + "global_eigenwarps"+sK+"_"+suffix+".mat";
+
+	QStringList eigenwarpList, eigenwarpListLocal;
+	for( int i=0; i < config.getEigenwarps().size(); ++i )
+	{
+		QString si = QString::number(i);
+		task.outEigenwarpList      .push_back( roiPath + "eigenwarp"       +si+"_"+suffix+".raw" );
+		task.outEigenwarpListGlobal.push_back( roiPath + "global_eigenwarp"+si+"_"+suffix+".raw" );
+		eigenwarpListLocal.push_back( roiPath + "eigenwarp"       +si+"_"+suffix+".mhd" );
+		eigenwarpList     .push_back( roiPath + "global_eigenwarp"+si+"_"+suffix+".mhd" );
+	}
+
+	if( !task.run() )
+		return false;
+
+	// ROI configs with global and local eigenwarps (see
+	// SDMVisMainWindow::saveConfigROI() and ConfigGenerator::auto_generateConfig())
+	for( int local=0; local < 2; ++local )
+	{
+		QString savingPath = outputPath + "/Roi-" + suffix
+		                     + (local ? "_LOCAL.ini" : ".ini");
+
+		SDMVisConfig roiConfig = config;
+		roiConfig.clearTraits();
+		roiConfig.clearRoi();
+#ifdef SDMVIS_VARVIS_ENABLED
+		roiConfig.setMeshFilename("");
+		roiConfig.setPointsFilename("");
+#endif
+		roiConfig.setBasePath( QFileInfo(savingPath).absolutePath() );
+		roiConfig.setIdentifier( QString::number(roiConfig.version) );
+		roiConfig.setDescription( "N.A" );
+		roiConfig.setReference( config.getReference() );
+		roiConfig.clearWarpFieldList();
+		roiConfig.setWarpfieldFileList( local ? eigenwarpListLocal : eigenwarpList );
+		roiConfig.setWarpsMatrix( task.outWarps );
+		roiConfig.setEigenwarpsMatrix( local ? task.outEigenwarps : task.outEigenwarpsGlobal );
+		roiConfig.loadScatterMatrix  ( task.outScatter, M );
+		roiConfig.loadPCAEigenvectors( task.outPCAEigenvectors, roiConfig.getScatterMatrix().size1() );
+		roiConfig.loadPCAEigenvalues ( task.outPCAEigenvalues,  roiConfig.getPCAEigenvectors().size2() );
+		roiConfig.writeConfig( savingPath );
+		info( "Wrote ROI config \"" + savingPath.toStdString() + "\"" );
+	}
+	return true;
+}
+
+bool ConfigJobs::traits()
+{
+	QList<Trait>& traits = config.getTraits();
+
+	ReconWarpsTask task;
+	task.warpsFilename = warpsFilename;
+	task.N = N;
+	task.M = M;
+	for( int i=0; i < 3; ++i )
+	{
+		task.resolution[i] = resolution[i];
+		task.spacing   [i] = spacing[i];
+	}
+
+	QList<int> recon;
+	for( int i=0; i < traits.size(); ++i )
+	{
+		if( traits[i].matFilename.isEmpty() || traits[i].mhdFilename.isEmpty() )
+		{
+			info( "Warning: Skipping trait " + traits[i].identifier.toStdString()
+			      + " without trait vector" );
+			continue;
+		}
+		QString basename = config.getAbsolutePath( traits[i].mhdFilename );
+		basename.remove( QRegExp("\\.mhd$") );
+		task.traitFilenames.push_back( config.getAbsolutePath( traits[i].matFilename ) );
+		task.outBasenames  .push_back( basename );
+		recon.push_back( i );
+	}
+
+	if( recon.empty() )
+	{
+		info( "No traits to reconstruct" );
+		return true;
+	}
+
+	stringstream ss;
+	ss << "Reconstructing " << recon.size() << " trait warpfield(s)...";
+	info( ss.str() );
+	if( !task.run() )
+		return false;
+
+	for( int i=0; i < recon.size(); ++i )
+		traits[recon[i]].valid = true;
+	modified = true;
+	return true;
+}
+
+bool ConfigJobs::csv()
+{
+	QStringList names = config.getNames();
+	// scaled as in the scatter plot (getPlotterMatrix() is not thread-safe)
+	Matrix scores = config.getPCAEigenvectors() * config.getPlotScaling();
+	Vector lambda = config.getPCAEigenvalues();
+	if( (int)scores.size1() != names.size() )
+		return error( "Config PCA does not match dataset names!" );
+
+	info( "Exporting CSV to \"" + outputPath.toStdString() + "\"..." );
+
+	// PCA coefficients, one row per dataset
+	ofstream f( (outputPath + "/" + name + "_scores.csv").toAscii() );
+	f << "name";
+	for( unsigned j=0; j < scores.size2(); ++j )
+		f << ",PC" << j+1;
+	f << "\n";
+	for( int i=0; i < names.size(); ++i )
+	{
+		f << names[i].toStdString();
+		for( unsigned j=0; j < scores.size2(); ++j )
+			f << "," << scores(i,j);
+		f << "\n";
+	}
+
+	Matrix L( lambda.size(), 1 );
+	for( unsigned i=0; i < lambda.size(); ++i )
+		L(i,0) = lambda(i);
+	saveMatrixCSV( L, outputPath + "/" + name + "_lambda.csv" );
+
+	// signed distances of all datasets to all trait hyperplanes
+	const QList<Trait>& traits = config.getTraits();
+	if( traits.empty() )
+		return true;
+
+	TraitProjection projection;
+	projection.update( scores, traits );
+
+	ofstream ft( (outputPath + "/" + name + "_traits.csv").toAscii() );
+	ft << "name";
+	for( int t=0; t < traits.size(); ++t )
+		ft << "," << traits[t].identifier.toStdString();
+	ft << "\n";
+	for( int i=0; i < projection.numSubjects(); ++i )
+	{
+		ft << names[i].toStdString();
+		for( int t=0; t < projection.numTraits(); ++t )
+			ft << "," << projection.scores()(i,t);
+		ft << "\n";
+	}
+	return true;
+}
+
+bool ConfigJobs::modes()
+{
+	Matrix V = config.getPCAEigenvectors();
+	int numModes = g_spec.numModes > 0 ? g_spec.numModes
+	                                   : config.getEigenwarps().size();
+	if( (int)V.size1() != M || numModes > (int)V.size2() || numModes <= 0 )
+		return error( "Invalid number of modes or config PCA does not match "
+		              "warps matrix!" );
+
+	stringstream ss;
+	ss << "Extracting " << numModes << " eigenwarp(s)...";
+	info( ss.str() );
+
+	// eigenwarps U = X*V
+	ReconWarpsTask task;
+	task.warpsFilename = warpsFilename;
+	task.coefficients  = boost::numeric::ublas::subrange( V, 0,M, 0,numModes );
+	task.N = N;
+	task.M = M;
+	for( int i=0; i < 3; ++i )
+	{
+		task.resolution[i] = resolution[i];
+		task.spacing   [i] = spacing[i];
+	}
+
+	QStringList mhdList;
+	for( int i=0; i < numModes; ++i )
+	{
+		QString basename = outputPath + "/eigenwarp" + QString::number(i) + "_" + name;
+		task.outBasenames.push_back( basename );
+		mhdList.push_back( basename + ".mhd" );
+	}
+
+	if( !task.run() )
+		return false;
+
+	config.clearWarpFieldList();
+	config.setWarpfieldFileList( mhdList );
+	modified = true;
+	return true;
+}
+
+bool ConfigJobs::run()
+{
+	if( !setup() )
+		return false;
+
+	for( unsigned j=0; j < g_spec.jobs.size(); ++j )
+	{
+		string job = g_spec.jobs[j];
+		bool ok = false;
+		if( job == "pca"    ) ok = pca();    else
+		if( job == "roi"    ) ok = roi();    else
+		if( job == "traits" ) ok = traits(); else
+		if( job == "csv"    ) ok = csv();    else
+		if( job == "modes"  ) ok = modes();
+
+		if( !ok )
+			return error( "Job " + job + " failed, skipping remaining jobs!" );
+	}
+
+	if( modified && g_spec.save )
+	{
+		config.writeConfig( QFileInfo(iniFilename).absoluteFilePath() );
+		info( "Updated config" );
+	}
+	return true;
+}
+
+/// Process single config, called concurrently for all configs
+bool processConfig( const QString& iniFilename )
+{
+#ifdef _OPENMP
+	// OpenMP settings are per thread
+	if( g_spec.numThreads > 0 )
+		omp_set_num_threads( g_spec.numThreads );
+#endif
+	ConfigJobs cj;
+	cj.iniFilename = iniFilename;
+	return cj.run();
+}
+
+//-----------------------------------------------------------------------------
+//	main()
+//-----------------------------------------------------------------------------
+int main( int argc, char* argv[] )
+{
+	QCoreApplication app( argc, argv );
+
+	vector<string> configs, jobfiles;
+	int numParallel;
+
+	// --- Program options ---
+
+	unsigned linewidth = 80;
+
+	po::options_description general_opts("General options",linewidth,linewidth/2);
+	general_opts.add_options()
+	("help,h", "produce help message")
+
+	("jobfile",
+		po::value<vector<string> >(&jobfiles)->multitoken(),
+		"Read options from job file(s), one option per line, e.g.\n"
+		"  config = study1.ini\n  job = pca\n  job = csv")
+
+	("threads",
+		po::value<int>(&g_spec.numThreads)->default_value(0),
+		"Number of threads per config, 0 uses all available cores.")
+
+	("parallel",
+		po::value<int>(&numParallel)->default_value(1),
+		"Number of configs processed concurrently.")
+	;
+
+	po::options_description job_opts("Jobs",linewidth,linewidth/2);
+	job_opts.add_options()
+	("config",
+		po::value<vector<string> >(&configs)->multitoken(),
+		"SDMVis config(s) (.ini) to process.")
+
+	("job",
+		po::value<vector<string> >(&g_spec.jobs)->multitoken(),
+		"Jobs executed in given order for each config, one of:\n"
+		"  pca    - recompute PCA of warps matrix\n"
+		"  roi    - ROI refinement, writes ROI configs\n"
+		"  traits - reconstruct all trait warpfields\n"
+		"  csv    - export PCA coefficients, eigenvalues and trait scores\n"
+		"  modes  - extract eigenwarps from warps matrix")
+
+	("roi-mask",
+		po::value<string>(&g_spec.roiMask),
+		"ROI mask (float MHD, one weight per voxel) for roi job.")
+
+	("roi-name",
+		po::value<string>(&g_spec.roiName),
+		"Suffix for roi job output, defaults to name of mask.")
+
+	("modes",
+		po::value<int>(&g_spec.numModes)->default_value(0),
+		"Number of eigenwarps for modes job, 0 uses number in config.")
+
+	("output,o",
+		po::value<string>(&g_spec.outputPath),
+		"Output directory, defaults to config path. Outputs are placed into "
+		"a subdirectory named as the config.")
+
+	("save",
+		"Write config back after pca, traits or modes job.")
+	;
+
+	po::positional_options_description pos;
+	pos.add( "config", -1 );
+
+	po::options_description desc(linewidth,linewidth/2);
+	desc.add( general_opts )
+		.add( job_opts );
+
+	po::variables_map vm;
+	try {
+		// Parse command line arguments
+		po::store(po::command_line_parser(argc, argv)
+			.options(desc).positional(pos).run(), vm);
+		po::notify(vm);
+
+		// Parse job file(s)
+		for( unsigned i=0; i < jobfiles.size(); i++ )
+		{
+			string jobfile = jobfiles.at(i);
+			cout << "Reading options from \"" << jobfile << "\"...\n";
+			po::store(
+				po::parse_config_file<char>(jobfile.c_str(), desc), vm);
+			po::notify(vm);
+		}
+	}
+	catch( const std::exception& e )
+	{
+		cerr << "Error on parsing comand line arguments: " << e.what() << " "
+		     << desc << endl;
+		return -1;
+	}
+
+	if( vm.count("help") || configs.empty() || g_spec.jobs.empty() )
+	{
+		cout << "sdmbatch - Headless processing jobs on SDMVis configs\n"
+		     << "Usage: sdmbatch [options] config.ini [config2.ini ...]\n"
+		     << desc << "\n";
+		return 1;
+	}
+
+	g_spec.save = vm.count("save") > 0;
+
+	for( unsigned j=0; j < g_spec.jobs.size(); ++j )
+	{
+		string job = g_spec.jobs[j];
+		if( job != "pca" && job != "roi" && job != "traits" &&
+			job != "csv" && job != "modes" )
+		{
+			cerr << "Error: Unknown job \"" << job << "\"!\n";
+			return -1;
+		}
+		if( job == "roi" && g_spec.roiMask.empty() )
+		{
+			cerr << "Error: Job roi requires --roi-mask!\n";
+			return -1;
+		}
+	}
+
+	// --- Process configs concurrently ---
+
+	QStringList iniFilenames;
+	for( unsigned i=0; i < configs.size(); ++i )
+		iniFilenames.push_back( QString::fromStdString( configs[i] ) );
+
+	QThreadPool::globalInstance()->setMaxThreadCount( std::max( numParallel, 1 ) );
+	QList<bool> results = QtConcurrent::blockingMapped( iniFilenames, processConfig );
+
+	int numFailed = results.count( false );
+	cout << "Processed " << iniFilenames.size() << " config(s), "
+	     << numFailed << " failed.\n";
+	return numFailed > 0 ? -1 : 0;
+}
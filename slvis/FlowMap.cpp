@@ -0,0 +1,257 @@
+#include "FlowMap.h"
+#include "VolumeUtils.h"
+#include <iostream>
+#include <fstream>
+#include <cstring>  // for memcmp()
+#include <cmath>
+#include <algorithm>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+using namespace std;
+
+namespace {
+	const char c_magic[4] = { 'F','L','M','1' };
+
+	bool getFileStamp( const std::string& filename, double& size, double& mtime )
+	{
+		struct stat st;
+		if( stat( filename.c_str(), &st ) != 0 )
+			return false;
+		size  = (double)st.st_size;
+		mtime = (double)st.st_mtime;
+		return true;
+	}
+}
+
+FlowMap::FlowMap()
+{
+	clear();
+}
+
+void FlowMap::clear()
+{
+	m_params = Parameters();
+	m_levels.clear();
+	m_stampSize = m_stampTime = 0.0;
+}
+
+bool FlowMap::build( const StreamlineTracer& tracer, Parameters p )
+{
+	clear();
+	if( !tracer.hasWarpfield() || p.numLevels < 1 || p.subsampling < 1 ||
+		p.stepsPerLevel < 1 || !(p.maxTime > 0.0) )
+	{
+		cerr << "FlowMap::build() : Missing warpfield or invalid parameters!" << endl;
+		return false;
+	}
+
+	// Subsampled grid
+	const StreamlineTracer::Grid& warp = tracer.getWarpfield();
+	StreamlineTracer::Grid grid;
+	for( int d=0; d < 3; d++ )
+	{
+		grid.res[d]     = (warp.res[d] - 1) / p.subsampling + 1;
+		grid.origin[d]  = warp.origin[d];
+		grid.spacing[d] = warp.spacing[d] * p.subsampling;
+	}
+	grid.components = 3;
+
+	int n = grid.res[0]*grid.res[1]*grid.res[2];
+	std::vector<float> x0( 3*(size_t)n );
+	for( int k=0, i=0; k < grid.res[2]; k++ )
+		for( int j=0; j < grid.res[1]; j++ )
+			for( int l=0; l < grid.res[0]; l++, i++ )
+			{
+				x0[3*i+0] = (float)(grid.origin[0] + l*grid.spacing[0]);
+				x0[3*i+1] = (float)(grid.origin[1] + j*grid.spacing[1]);
+				x0[3*i+2] = (float)(grid.origin[2] + k*grid.spacing[2]);
+			}
+
+	// Advect level by level, forward then backward
+	double dt = p.maxTime / p.numLevels;
+	m_levels.resize( 2*p.numLevels, grid );
+	for( int dir=0; dir < 2; dir++ )
+	{
+		std::vector<float> x( x0 );
+		for( int k=0; k < p.numLevels; k++ )
+		{
+			tracer.advect( &x[0], n, dir==0 ? dt : -dt, p.stepsPerLevel );
+
+			std::vector<float>& disp = m_levels[dir*p.numLevels + k].values;
+			disp.resize( x.size() );
+			for( size_t i=0; i < x.size(); i++ )
+				disp[i] = x[i] - x0[i];
+		}
+	}
+
+	m_params = p;
+	return true;
+}
+
+void FlowMap::lookup( const double x[3], double time, double pos[3] ) const
+{
+	// Bracketing time levels, level 0 has zero displacement
+	int K = m_params.numLevels;
+	double u = std::fabs( time ) / (m_params.maxTime / K);
+	int k0 = std::min( (int)u, K );
+	int k1 = std::min( k0+1, K );
+	double f = u - k0;
+	int ofs = (time < 0.0) ? K-1 : -1;
+
+	double d0[3] = { 0.0, 0.0, 0.0 }, d1[3] = { 0.0, 0.0, 0.0 };
+	if( k0 > 0 ) m_levels[k0 + ofs].sample( x, d0 );
+	if( k1 > 0 && f > 0.0 ) m_levels[k1 + ofs].sample( x, d1 );
+
+	for( int i=0; i < 3; i++ )
+		pos[i] = x[i] + (1.0-f)*d0[i] + f*d1[i];
+}
+
+//-----------------------------------------------------------------------------
+//	Serialization
+//-----------------------------------------------------------------------------
+
+FlowMap::Parameters FlowMap::parametersFor( const StreamlineTracer& tracer )
+{
+	Parameters p;
+	double T = std::fabs( (double)tracer.getTimescale() );
+	if( T > 0.0 )
+		p.maxTime = T;
+	p.stepsPerLevel = std::max( 1, (tracer.getNumSteps() + p.numLevels - 1) / p.numLevels );
+	return p;
+}
+
+std::string FlowMap::getFlowMapFilename( const char* mhdFilename )
+{
+	std::string fname( mhdFilename );
+	size_t slash = fname.find_last_of( "/\\" );
+	size_t dot   = fname.find_last_of( '.' );
+	if( dot != std::string::npos && (slash == std::string::npos || dot > slash) )
+		fname = fname.substr( 0, dot );
+	return fname + ".flowmap";
+}
+
+bool FlowMap::save( const char* filename ) const
+{
+	if( empty() )
+		return false;
+
+	ofstream f( filename, ios::binary );
+	if( !f.is_open() )
+	{
+		cerr << "Error: Could not open \"" << filename << "\" for writing!" << endl;
+		return false;
+	}
+
+	const StreamlineTracer::Grid& g = m_levels[0];
+	int header[6] = { g.res[0], g.res[1], g.res[2], m_params.numLevels,
+	                  m_params.subsampling, m_params.stepsPerLevel };
+	double geom[9] = { g.origin[0], g.origin[1], g.origin[2],
+	                   g.spacing[0], g.spacing[1], g.spacing[2],
+	                   m_params.maxTime, m_stampSize, m_stampTime };
+
+	f.write( c_magic, 4 );
+	f.write( (const char*)header, sizeof(header) );
+	f.write( (const char*)geom,   sizeof(geom) );
+	for( size_t k=0; k < m_levels.size(); k++ )
+		f.write( (const char*)&m_levels[k].values[0],
+		         m_levels[k].values.size()*sizeof(float) );
+	return f.good();
+}
+
+bool FlowMap::load( const char* filename )
+{
+	clear();
+
+	ifstream f( filename, ios::binary );
+	if( !f.is_open() )
+		return false;
+
+	char magic[4];
+	int header[6];
+	double geom[9];
+	f.read( magic, 4 );
+	f.read( (char*)header, sizeof(header) );
+	f.read( (char*)geom,   sizeof(geom) );
+	if( !f.good() || memcmp( magic, c_magic, 4 ) != 0 ||
+		header[0] < 1 || header[1] < 1 || header[2] < 1 || header[3] < 1 )
+	{
+		cerr << "Error: \"" << filename << "\" is not a valid flow map file!" << endl;
+		return false;
+	}
+
+	StreamlineTracer::Grid grid;
+	for( int d=0; d < 3; d++ )
+	{
+		grid.res[d]     = header[d];
+		grid.origin[d]  = geom[d];
+		grid.spacing[d] = geom[3+d];
+	}
+	grid.components = 3;
+	grid.values.resize( 3*(size_t)grid.res[0]*grid.res[1]*grid.res[2] );
+
+	m_params.numLevels     = header[3];
+	m_params.subsampling   = header[4];
+	m_params.stepsPerLevel = header[5];
+	m_params.maxTime = geom[6];
+	m_stampSize      = geom[7];
+	m_stampTime      = geom[8];
+
+	m_levels.resize( 2*m_params.numLevels, grid );
+	for( size_t k=0; k < m_levels.size() && f.good(); k++ )
+		f.read( (char*)&m_levels[k].values[0],
+		        m_levels[k].values.size()*sizeof(float) );
+	if( !f.good() )
+	{
+		cerr << "Error: Could not read flow map data from \"" << filename << "\"!" << endl;
+		clear();
+		return false;
+	}
+	return true;
+}
+
+bool FlowMap::loadOrBuild( const char* mhdFilename, const StreamlineTracer& tracer,
+                           Parameters p, bool writeFile )
+{
+	if( !tracer.hasWarpfield() )
+		return false;
+
+	// Stamp of raw data file, which is relative to MHD as in load_volume()
+	double size=0.0, mtime=0.0;
+	bool hasStamp = false;
+	VolumeDataHeader* header = load_volume_header( mhdFilename, 0 );
+	if( header )
+	{
+		std::string mhd( mhdFilename );
+		size_t slash = mhd.find_last_of( "/\\" );
+		std::string path = (slash == std::string::npos) ? "" : mhd.substr( 0, slash+1 );
+		hasStamp = getFileStamp( path + header->filename(), size, mtime );
+		delete header;
+	}
+
+	// Try to reuse existing flow map file
+	std::string fname = getFlowMapFilename( mhdFilename );
+	if( hasStamp && load( fname.c_str() ) )
+	{
+		const StreamlineTracer::Grid& warp = tracer.getWarpfield();
+		const StreamlineTracer::Grid& g = m_levels[0];
+		bool match = (m_params == p) && m_stampSize==size && m_stampTime==mtime;
+		for( int d=0; d < 3; d++ )
+			match = match && g.res[d]==(warp.res[d] - 1) / p.subsampling + 1
+			              && g.origin[d]==warp.origin[d]
+			              && g.spacing[d]==warp.spacing[d]*p.subsampling;
+		if( match )
+			return true;
+		clear();
+	}
+
+	// Outdated or missing, build anew
+	if( !build( tracer, p ) )
+		return false;
+	m_stampSize = size;
+	m_stampTime = mtime;
+
+	if( writeFile && hasStamp )
+		save( fname.c_str() ); // failure is not critical
+	return true;
+}
@@ -0,0 +1,87 @@
+#ifndef FLOWMAP_H
+#define FLOWMAP_H
+
+#include <vector>
+#include <string>
+#include "StreamlineTracer.h"
+
+/**
+	Precomputed flow map of a stationary warpfield.
+
+	Stores the displacement phi_t(x) - x of the flow for time levels
+	t = +-k*maxTime/numLevels, k=1..numLevels, on a grid subsampled from the
+	warpfield grid. Positions along a streamline are then obtained by
+	trilinear interpolation in space and linear interpolation between time
+	levels instead of numerical integration, such that changing the
+	timescale does not require a re-integration.
+
+	The flow map is built on the CPU via \a StreamlineTracer::advect(), i.e.
+	in parallel if OpenMP is available, and can be stored in a binary file
+	next to the warpfield MHD (see \a getFlowMapFilename()) which is reused
+	as long as the warpfield raw data does not change (size and modification
+	time) and the flow map parameters match.
+*/
+class FlowMap
+{
+public:
+	/// Build parameters
+	struct Parameters
+	{
+		Parameters(): maxTime(1.0), numLevels(4), subsampling(4), stepsPerLevel(4) {}
+		double maxTime;     ///< Largest absolute integration time covered
+		int    numLevels;   ///< Number of time levels per direction
+		int    subsampling; ///< Flow map grid spacing in warpfield voxels
+		int    stepsPerLevel; ///< RK4 steps between successive time levels
+
+		bool operator == ( const Parameters& other ) const
+		{
+			return maxTime==other.maxTime && numLevels==other.numLevels &&
+			       subsampling==other.subsampling &&
+			       stepsPerLevel==other.stepsPerLevel;
+		}
+	};
+
+	FlowMap();
+
+	/// Build flow map for warpfield set in tracer
+	bool build( const StreamlineTracer& tracer, Parameters p=Parameters() );
+
+	bool save( const char* filename ) const;
+	bool load( const char* filename );
+
+	/// Load flow map file next to given warpfield MHD if it matches, else
+	/// build from tracer and (optionally) write flow map file for next time.
+	bool loadOrBuild( const char* mhdFilename, const StreamlineTracer& tracer,
+	                  Parameters p=Parameters(), bool writeFile=true );
+
+	/// Parameters covering the current timescale of the tracer, with about
+	/// as many RK4 steps per direction as its fixed step integrators take
+	static Parameters parametersFor( const StreamlineTracer& tracer );
+
+	/// Flow map file for given MHD, i.e. same path and name with .flowmap suffix
+	static std::string getFlowMapFilename( const char* mhdFilename );
+
+	void clear();
+	bool empty() const { return m_levels.empty(); }
+
+	const Parameters& getParameters() const { return m_params; }
+
+	/// Returns true if the absolute time is within the precomputed range
+	bool covers( double time ) const
+	{
+		return !empty() && (time >= 0.0 ? time : -time) <= m_params.maxTime;
+	}
+
+	/// Position of x after given (signed) time, time must be covered
+	void lookup( const double x[3], double time, double pos[3] ) const;
+
+private:
+	Parameters m_params;
+
+	/// Displacement levels, first numLevels forward then numLevels backward
+	std::vector<StreamlineTracer::Grid> m_levels;
+
+	double m_stampSize, m_stampTime; ///< Warpfield raw file stamp
+};
+
+#endif // FLOWMAP_H
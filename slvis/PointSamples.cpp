@@ -9,8 +9,8 @@
 //	VTK IO functions
 //-----------------------------------------------------------------------------
 
-#include <vtkPolyDataReader.h>
 #include <vtkPolyData.h>
+#include "../varvis/PolyDataCache.h"
 
 #ifndef VTKPTR
  #include <vtkSmartPointer.h>
@@ -37,14 +37,14 @@ float* createVertexBufferData( vtkPolyData* pd )
 
 float* loadPointSamplesVTK( const char* filename, int& numPoints )
 {
-	VTKPTR<vtkPolyDataReader> reader = VTKPTR<vtkPolyDataReader>::New();
-	reader->SetFileName( filename );
-	reader->Update();
+	// Binary cache file next to the VTK file skips parsing on warm starts
+	VTKPTR<vtkPolyData> pd = VTKPTR<vtkPolyData>::New();
+	PolyDataCache::readPolyData( QString::fromLocal8Bit( filename ), pd );
 	
-	numPoints = reader->GetOutput()->GetNumberOfPoints();
+	numPoints = pd->GetNumberOfPoints();
 	if( numPoints > 0 )
 	{	
-		return createVertexBufferData( reader->GetOutput() );
+		return createVertexBufferData( pd );
 	}
 	return NULL;
 }
@@ -0,0 +1,504 @@
+#include "StreamlineTracer.h"
+#include "FlowMap.h"
+#include <vtkPolyData.h>
+#include <vtkPoints.h>
+#include <vtkCellArray.h>
+#include <vtkFloatArray.h>
+#include <vtkIntArray.h>
+#include <vtkPointData.h>
+#include <vtkCellData.h>
+#include <algorithm>
+#include <cmath>
+#include <cstring> // memcpy
+#include <iostream>
+
+using std::cerr;
+using std::endl;
+
+//------------------------------------------------------------------------------
+//  Grid
+//------------------------------------------------------------------------------
+
+template<class T>
+void copy_to_float( const void* src, size_t n, std::vector<float>& dst )
+{
+	const T* ptr = (const T*)src;
+	dst.resize( n );
+	for( size_t i=0; i < n; i++ )
+		dst[i] = (float)ptr[i];
+}
+
+bool StreamlineTracer::Grid::setup( const VolumeTextureManager::Data& d )
+{
+	values.clear();
+	if( !d.data || d.resolution[0]<1 || d.resolution[1]<1 || d.resolution[2]<1 )
+	{
+		cerr << "StreamlineTracer - Invalid volume data!" << endl;
+		return false;
+	}
+
+	for( int i=0; i < 3; i++ )
+	{
+		res[i]     = d.resolution[i];
+		origin[i]  = d.origin[i];
+		spacing[i] = d.spacing[i];
+	}
+	components = d.components;
+
+	size_t n = (size_t)res[0]*res[1]*res[2]*components;
+	switch( d.type )
+	{
+	case VolumeTextureManager::Char   : copy_to_float<char>          ( d.data, n, values ); break;
+	case VolumeTextureManager::UChar  : copy_to_float<unsigned char> ( d.data, n, values ); break;
+	case VolumeTextureManager::Short  : copy_to_float<short>         ( d.data, n, values ); break;
+	case VolumeTextureManager::UShort : copy_to_float<unsigned short>( d.data, n, values ); break;
+	case VolumeTextureManager::Int    : copy_to_float<int>           ( d.data, n, values ); break;
+	case VolumeTextureManager::UInt   : copy_to_float<unsigned int>  ( d.data, n, values ); break;
+	case VolumeTextureManager::Float32: copy_to_float<float>         ( d.data, n, values ); break;
+	default:
+		cerr << "StreamlineTracer - Unsupported volume element type!" << endl;
+		return false;
+	}
+	return true;
+}
+
+bool StreamlineTracer::Grid::inside( const double x[3] ) const
+{
+	// Domain of voxel cells, as for a texture with clamp to edge
+	for( int i=0; i < 3; i++ )
+	{
+		double g = (x[i] - origin[i]) / spacing[i];
+		if( !(g >= -0.5 && g <= res[i] - 0.5) )
+			return false;
+	}
+	return true;
+}
+
+void StreamlineTracer::Grid::sample( const double x[3], double* value ) const
+{
+	int    i0[3], i1[3];
+	double f[3];
+	for( int i=0; i < 3; i++ )
+	{
+		double g = (x[i] - origin[i]) / spacing[i];
+		g = std::max( 0.0, std::min( g, (double)(res[i]-1) ) );
+		i0[i] = (int)g;
+		i1[i] = std::min( i0[i]+1, res[i]-1 );
+		f[i]  = g - i0[i];
+	}
+
+	size_t sy = (size_t)res[0],
+	       sz = (size_t)res[0]*res[1];
+	size_t ofs[8] = {
+		i0[0] + i0[1]*sy + i0[2]*sz,
+		i1[0] + i0[1]*sy + i0[2]*sz,
+		i0[0] + i1[1]*sy + i0[2]*sz,
+		i1[0] + i1[1]*sy + i0[2]*sz,
+		i0[0] + i0[1]*sy + i1[2]*sz,
+		i1[0] + i0[1]*sy + i1[2]*sz,
+		i0[0] + i1[1]*sy + i1[2]*sz,
+		i1[0] + i1[1]*sy + i1[2]*sz };
+	double w[8] = {
+		(1-f[0])*(1-f[1])*(1-f[2]),
+		   f[0] *(1-f[1])*(1-f[2]),
+		(1-f[0])*   f[1] *(1-f[2]),
+		   f[0] *   f[1] *(1-f[2]),
+		(1-f[0])*(1-f[1])*   f[2] ,
+		   f[0] *(1-f[1])*   f[2] ,
+		(1-f[0])*   f[1] *   f[2] ,
+		   f[0] *   f[1] *   f[2]  };
+
+	const float* v = &values[0];
+	for( int c=0; c < components; c++ )
+	{
+		double sum = 0.0;
+		for( int j=0; j < 8; j++ )
+			sum += w[j] * v[ofs[j]*components + c];
+		value[c] = sum;
+	}
+}
+
+double StreamlineTracer::Grid::minSpacing() const
+{
+	return std::min( spacing[0], std::min( spacing[1], spacing[2] ) );
+}
+
+//------------------------------------------------------------------------------
+//  StreamlineTracer
+//------------------------------------------------------------------------------
+
+StreamlineTracer::StreamlineTracer()
+: m_flowMap(NULL),
+  m_mode(Streamlines),
+  m_integrator(RK4),
+  m_timescale(1.f),
+  m_isovalue(0.f),
+  m_numSteps(10),
+  m_tolerance(0.01),
+  m_maxVertices(10000),
+  m_newtonIterations(10),
+  m_numEvaluations(0),
+  m_numRejected(0),
+  m_numVertices(0)
+{
+}
+
+bool StreamlineTracer::setWarpfield( const VolumeTextureManager::Data& d )
+{
+	if( d.components != 3 )
+	{
+		cerr << "StreamlineTracer::setWarpfield() - "
+			"Warpfield must have 3 components!" << endl;
+		m_warp.values.clear();
+		return false;
+	}
+	return m_warp.setup( d );
+}
+
+bool StreamlineTracer::setVolume( const VolumeTextureManager::Data& d )
+{
+	if( d.components != 1 )
+	{
+		cerr << "StreamlineTracer::setVolume() - "
+			"Volume must be scalar!" << endl;
+		m_volume.values.clear();
+		return false;
+	}
+	return m_volume.setup( d );
+}
+
+void StreamlineTracer::velocity( const double x[3], double sign, double v[3],
+                                 long& evals ) const
+{
+	m_warp.sample( x, v );
+	v[0] *= sign;
+	v[1] *= sign;
+	v[2] *= sign;
+	evals++;
+}
+
+double StreamlineTracer::step( int integrator, const double x[3], double h,
+                               double sign, double xnew[3], long& evals ) const
+{
+	double k1[3], k2[3], k3[3], k4[3], k5[3], k6[3], y[3];
+	int i;
+
+	velocity( x, sign, k1, evals );
+
+	if( integrator == Euler )
+	{
+		for( i=0; i < 3; i++ ) xnew[i] = x[i] + h*k1[i];
+		return 0.0;
+	}
+
+	if( integrator == RK4 )
+	{
+		for( i=0; i < 3; i++ ) y[i] = x[i] + 0.5*h*k1[i];
+		velocity( y, sign, k2, evals );
+		for( i=0; i < 3; i++ ) y[i] = x[i] + 0.5*h*k2[i];
+		velocity( y, sign, k3, evals );
+		for( i=0; i < 3; i++ ) y[i] = x[i] + h*k3[i];
+		velocity( y, sign, k4, evals );
+		for( i=0; i < 3; i++ )
+			xnew[i] = x[i] + h*(k1[i]/6.0 + k2[i]/3.0 + k3[i]/3.0 + k4[i]/6.0);
+		return 0.0;
+	}
+
+	// Cash-Karp Runge-Kutta 4(5), see Numerical Recipes 16.2
+	static const double
+		b21 = 1.0/5.0,
+		b31 = 3.0/40.0,       b32 = 9.0/40.0,
+		b41 = 3.0/10.0,       b42 = -9.0/10.0,   b43 = 6.0/5.0,
+		b51 = -11.0/54.0,     b52 = 5.0/2.0,     b53 = -70.0/27.0,
+		b54 = 35.0/27.0,
+		b61 = 1631.0/55296.0, b62 = 175.0/512.0, b63 = 575.0/13824.0,
+		b64 = 44275.0/110592.0, b65 = 253.0/4096.0,
+		c1  = 37.0/378.0,     c3  = 250.0/621.0,
+		c4  = 125.0/594.0,    c6  = 512.0/1771.0,
+		dc1 = c1 - 2825.0/27648.0,
+		dc3 = c3 - 18575.0/48384.0,
+		dc4 = c4 - 13525.0/55296.0,
+		dc5 = -277.0/14336.0,
+		dc6 = c6 - 0.25;
+
+	for( i=0; i < 3; i++ ) y[i] = x[i] + h*b21*k1[i];
+	velocity( y, sign, k2, evals );
+	for( i=0; i < 3; i++ ) y[i] = x[i] + h*(b31*k1[i] + b32*k2[i]);
+	velocity( y, sign, k3, evals );
+	for( i=0; i < 3; i++ ) y[i] = x[i] + h*(b41*k1[i] + b42*k2[i] + b43*k3[i]);
+	velocity( y, sign, k4, evals );
+	for( i=0; i < 3; i++ )
+		y[i] = x[i] + h*(b51*k1[i] + b52*k2[i] + b53*k3[i] + b54*k4[i]);
+	velocity( y, sign, k5, evals );
+	for( i=0; i < 3; i++ )
+		y[i] = x[i] + h*(b61*k1[i] + b62*k2[i] + b63*k3[i] + b64*k4[i]
+		                 + b65*k5[i]);
+	velocity( y, sign, k6, evals );
+
+	double err = 0.0;
+	for( i=0; i < 3; i++ )
+	{
+		xnew[i] = x[i] + h*(c1*k1[i] + c3*k3[i] + c4*k4[i] + c6*k6[i]);
+		double e = h*(dc1*k1[i] + dc3*k3[i] + dc4*k4[i] + dc5*k5[i] + dc6*k6[i]);
+		err = std::max( err, std::fabs(e) );
+	}
+	return err;
+}
+
+void StreamlineTracer::normal( const double x[3], double n[3] ) const
+{
+	// Central differences, pointing towards lower values as in the shader
+	double len = 0.0;
+	for( int i=0; i < 3; i++ )
+	{
+		double a[3] = { x[0], x[1], x[2] },
+		       b[3] = { x[0], x[1], x[2] };
+		a[i] -= m_volume.spacing[i];
+		b[i] += m_volume.spacing[i];
+		double sa, sb;
+		m_volume.sample( a, &sa );
+		m_volume.sample( b, &sb );
+		n[i] = (sa - sb) / m_volume.spacing[i];
+		len += n[i]*n[i];
+	}
+
+	len = std::sqrt( len );
+	for( int i=0; i < 3; i++ )
+		n[i] = (len > 0.0) ? n[i] / len : 0.0;
+}
+
+void StreamlineTracer::projectToIsosurface( double x[3], const double dir[3] ) const
+{
+	// Damped Newton iteration along dir, step length clamped to one voxel.
+	// Same scheme as project_to_isosurface() in the shader.
+	double maxStep = m_volume.minSpacing(),
+	       delta   = 2.0*maxStep;
+	for( int it=0; it < m_newtonIterations; it++ )
+	{
+		double s, sa, sb;
+		double a[3] = { x[0] - delta*dir[0], x[1] - delta*dir[1], x[2] - delta*dir[2] },
+		       b[3] = { x[0] + delta*dir[0], x[1] + delta*dir[1], x[2] + delta*dir[2] };
+		m_volume.sample( x, &s );
+		m_volume.sample( a, &sa );
+		m_volume.sample( b, &sb );
+
+		double f  = m_isovalue - s,
+		       df = (sa - sb) / (2.0*delta);
+		if( std::fabs(df) < 1e-12 )
+			break;
+
+		double steplength = std::max( -maxStep, std::min( f/df, maxStep ) );
+		for( int i=0; i < 3; i++ )
+			x[i] -= 0.5*steplength*dir[i];
+	}
+}
+
+void StreamlineTracer::traceLine( const float* seed, std::vector<float>& pts,
+	              std::vector<float>& times, long& evals, long& rejected ) const
+{
+	double x0[3] = { seed[0], seed[1], seed[2] }; // seed position
+	double x [3] = { seed[0], seed[1], seed[2] }; // position on streamline
+	double px[3] = { seed[0], seed[1], seed[2] }; // projected position
+	double xn[3], disp[3], n[3];
+
+	bool warpOnly  = (m_mode == Meshwarp),
+	     projected = (m_mode == ProjectedStreamlines),
+	     useMap    = m_flowMap && m_flowMap->covers( m_timescale ),
+	     adaptive  = (m_integrator == AdaptiveRK45) && !useMap;
+
+	if( !warpOnly )
+	{
+		pts.push_back( seed[0] );
+		pts.push_back( seed[1] );
+		pts.push_back( seed[2] );
+		times.push_back( 0.f );
+	}
+
+	double T    = std::fabs( (double)m_timescale ),
+	       sign = (m_timescale < 0.f) ? -1.0 : 1.0,
+	       hmax = (useMap && warpOnly) ? T : T / m_numSteps,
+	       hmin = 1e-3 * hmax,
+	       h    = hmax,
+	       t    = 0.0;
+
+	int numVertices = 1;
+	while( t < T && (warpOnly || numVertices < m_maxVertices) )
+	{
+		double hstep = std::min( h, T - t );
+		double err = 0.0;
+		if( useMap )
+			// Lookup position at end of step from seed
+			m_flowMap->lookup( x0, sign*(t + hstep), xn );
+		else
+			err = step( m_integrator, x, hstep, sign, xn, evals );
+
+		if( adaptive )
+		{
+			if( err > m_tolerance && hstep > hmin )
+			{
+				// Reject and retry with smaller step
+				rejected++;
+				h = std::max( hmin, hstep*std::max( 0.1,
+				                      0.9*std::pow( m_tolerance/err, 0.25 ) ) );
+				continue;
+			}
+			h = (err > 0.0)
+				? std::min( hmax, hstep*std::min( 4.0,
+				                      0.9*std::pow( m_tolerance/err, 0.2 ) ) )
+				: hmax;
+			h = std::max( h, hmin );
+		}
+
+		if( !m_warp.inside( xn ) )
+			break;
+
+		for( int i=0; i < 3; i++ )
+		{
+			disp[i] = xn[i] - x[i];
+			x[i] = xn[i];
+		}
+		t += hstep;
+
+		if( projected )
+		{
+			// Remove normal component of displacement, then move back onto
+			// isosurface along the normal of the previous position
+			normal( px, n );
+			double dn = n[0]*disp[0] + n[1]*disp[1] + n[2]*disp[2];
+			for( int i=0; i < 3; i++ )
+			{
+				px[i] += disp[i] - dn*n[i];
+				n[i] = -n[i];
+			}
+			projectToIsosurface( px, n );
+		}
+		else
+		{
+			px[0] = x[0];
+			px[1] = x[1];
+			px[2] = x[2];
+		}
+
+		if( !warpOnly )
+		{
+			pts.push_back( (float)px[0] );
+			pts.push_back( (float)px[1] );
+			pts.push_back( (float)px[2] );
+			times.push_back( (float)(t / T) );
+			numVertices++;
+		}
+	}
+
+	if( warpOnly )
+	{
+		pts.push_back( (float)x[0] );
+		pts.push_back( (float)x[1] );
+		pts.push_back( (float)x[2] );
+		times.push_back( T > 0.0 ? (float)(t / T) : 0.f );
+	}
+}
+
+void StreamlineTracer::advect( float* points, int numPoints, double time,
+                               int numSteps ) const
+{
+	if( !hasWarpfield() || numSteps < 1 )
+		return;
+
+	double h    = std::fabs( time ) / numSteps,
+	       sign = (time < 0.0) ? -1.0 : 1.0;
+
+	#pragma omp parallel for schedule(static)
+	for( int i=0; i < numPoints; i++ )
+	{
+		float* p = points + 3*i;
+		double x[3] = { p[0], p[1], p[2] }, xn[3];
+		long evals = 0;
+		for( int k=0; k < numSteps; k++ )
+		{
+			step( RK4, x, h, sign, xn, evals );
+			if( !m_warp.inside( xn ) )
+				break;
+			x[0] = xn[0];
+			x[1] = xn[1];
+			x[2] = xn[2];
+		}
+		p[0] = (float)x[0];
+		p[1] = (float)x[1];
+		p[2] = (float)x[2];
+	}
+}
+
+vtkSmartPointer<vtkPolyData> StreamlineTracer::trace( const float* seeds,
+                                                      int numSeeds )
+{
+	m_numEvaluations = m_numRejected = m_numVertices = 0;
+
+	if( !hasWarpfield() || (m_mode==ProjectedStreamlines && !hasVolume()) )
+	{
+		cerr << "StreamlineTracer::trace() - Missing warpfield or volume!" << endl;
+		return vtkSmartPointer<vtkPolyData>();
+	}
+
+	// Trace lines into separate buffers
+	std::vector< std::vector<float> > pts( numSeeds ), times( numSeeds );
+	long evals = 0, rejected = 0;
+
+	#pragma omp parallel for schedule(dynamic,64) reduction(+:evals,rejected)
+	for( int i=0; i < numSeeds; i++ )
+	{
+		traceLine( seeds + 3*i, pts[i], times[i], evals, rejected );
+	}
+
+	m_numEvaluations = evals;
+	m_numRejected = rejected;
+
+	// Assemble polydata
+	vtkIdType numPoints = 0;
+	for( int i=0; i < numSeeds; i++ )
+		numPoints += (vtkIdType)times[i].size();
+	m_numVertices = (long)numPoints;
+
+	vtkSmartPointer<vtkPoints> points = vtkSmartPointer<vtkPoints>::New();
+	points->SetDataTypeToFloat();
+	points->SetNumberOfPoints( numPoints );
+
+	vtkSmartPointer<vtkFloatArray> time = vtkSmartPointer<vtkFloatArray>::New();
+	time->SetName( "Time" );
+	time->SetNumberOfTuples( numPoints );
+
+	vtkSmartPointer<vtkIntArray> seedId = vtkSmartPointer<vtkIntArray>::New();
+	seedId->SetName( "SeedId" );
+	seedId->SetNumberOfTuples( numSeeds );
+
+	vtkSmartPointer<vtkCellArray> cells = vtkSmartPointer<vtkCellArray>::New();
+	cells->Allocate( numPoints + numSeeds );
+
+	float* pptr = (float*)points->GetVoidPointer(0);
+	float* tptr = time->GetPointer(0);
+	vtkIdType id = 0;
+	for( int i=0; i < numSeeds; i++ )
+	{
+		vtkIdType n = (vtkIdType)times[i].size();
+		if( n == 0 )
+			continue;
+		memcpy( pptr + 3*id, &pts[i][0], 3*n*sizeof(float) );
+		memcpy( tptr + id, &times[i][0], n*sizeof(float) );
+
+		cells->InsertNextCell( n );
+		for( vtkIdType j=0; j < n; j++ )
+			cells->InsertCellPoint( id + j );
+		seedId->SetValue( i, i );
+		id += n;
+	}
+
+	vtkSmartPointer<vtkPolyData> pd = vtkSmartPointer<vtkPolyData>::New();
+	pd->SetPoints( points );
+	if( m_mode == Meshwarp )
+		pd->SetVerts( cells );
+	else
+		pd->SetLines( cells );
+	pd->GetPointData()->AddArray( time );
+	pd->GetCellData()->AddArray( seedId );
+
+	return pd;
+}
@@ -0,0 +1,168 @@
+#ifndef STREAMLINETRACER_H
+#define STREAMLINETRACER_H
+
+#include <vector>
+#include <vtkSmartPointer.h>
+#include "VolumeTextureManager.h"
+
+class vtkPolyData;
+class FlowMap;
+
+/**
+	CPU counterpart of the streamline geometry shader (streamline.gs.glsl).
+
+	Supports the same modes as \a StreamlineRenderer, i.e. streamline tracing,
+	point warping and streamlines projected onto an isosurface of a scalar
+	volume (tangential projection followed by Newton iterations along the
+	surface normal). In contrast to the shader the number of line vertices is
+	not limited and the step size can be chosen adaptively by an embedded
+	Runge-Kutta 4(5) scheme.
+
+	Volumes are copied to float buffers on setup. World coordinates follow the
+	MHD convention, i.e. voxel (i,j,k) is centered at origin + (i,j,k)*spacing.
+	Fields are sampled trilinearly; integration of a line stops when it leaves
+	the warpfield domain.
+
+	Seeds are traced in parallel via OpenMP if available, the output does not
+	depend on the number of threads.
+
+	If a precomputed \a FlowMap is set which covers the current timescale,
+	vertices are interpolated from the flow map instead of being integrated.
+*/
+class StreamlineTracer
+{
+public:
+	/// Modes, identical to \a StreamlineRenderer::Modes
+	enum Modes
+	{
+		Streamlines,
+		Meshwarp,
+		ProjectedStreamlines
+	};
+
+	/// Integrators, first two correspond to INTEGRATOR 0 and 2 of the shader
+	enum Integrators
+	{
+		Euler,
+		RK4,
+		AdaptiveRK45  ///< Cash-Karp embedded Runge-Kutta with error control
+	};
+
+	/// Float copy of a volume, components are interleaved
+	struct Grid
+	{
+		int    res[3];
+		int    components;
+		double origin[3];
+		double spacing[3];
+		std::vector<float> values;
+
+		bool setup( const VolumeTextureManager::Data& d );
+		bool inside( const double x[3] ) const;
+		/// Trilinear interpolation with clamp to edge
+		void sample( const double x[3], double* value ) const;
+		double minSpacing() const;
+	};
+
+	StreamlineTracer();
+
+	///@{ Setup volumes (data is copied and converted to float)
+	bool setWarpfield( const VolumeTextureManager::Data& d );
+	bool setVolume   ( const VolumeTextureManager::Data& d );
+	bool hasWarpfield() const { return !m_warp.values.empty(); }
+	bool hasVolume()    const { return !m_volume.values.empty(); }
+	const Grid& getWarpfield() const { return m_warp; }
+	///@}
+
+	/// Use flow map for lookup instead of integration (NULL to disable).
+	/// The flow map is not owned and must stay valid while set.
+	void setFlowMap( const FlowMap* fm ) { m_flowMap = fm; }
+	const FlowMap* getFlowMap() const { return m_flowMap; }
+
+	void setMode( int mode ) { m_mode = mode; }
+	int  getMode() const { return m_mode; }
+
+	void setIntegrator( int integrator ) { m_integrator = integrator; }
+	int  getIntegrator() const { return m_integrator; }
+
+	/// End-time of integration (negative for backwards), as in the shader
+	void  setTimescale( float ts ) { m_timescale = ts; }
+	float getTimescale() const { return m_timescale; }
+
+	/// Isovalue for projected streamlines
+	void  setIsovalue( float iso ) { m_isovalue = iso; }
+	float getIsovalue() const { return m_isovalue; }
+
+	/// Number of integration steps of fixed step integrators (default 10).
+	/// For the adaptive integrator this is the minimal number of steps, i.e.
+	/// the step size never exceeds timescale / numSteps.
+	void setNumSteps( int n ) { m_numSteps = n>0 ? n : 1; }
+	int  getNumSteps() const { return m_numSteps; }
+
+	/// Local error tolerance of adaptive integrator in world units
+	void   setTolerance( double tol ) { m_tolerance = tol; }
+	double getTolerance() const { return m_tolerance; }
+
+	/// Upper bound on vertices per line, including the seed (default 10000)
+	void setMaxVertices( int n ) { m_maxVertices = n>1 ? n : 2; }
+	int  getMaxVertices() const { return m_maxVertices; }
+
+	/// Number of Newton iterations in isosurface projection (default 10)
+	void setNewtonIterations( int n ) { m_newtonIterations = n; }
+
+	/// Trace all seeds given as array of 3*numSeeds floats. Returns polylines
+	/// (resp. vertices in \a Meshwarp mode) with point data array "Time" of
+	/// normalized integration time in [0,1] and cell data array "SeedId".
+	/// Returns NULL if required volumes are missing.
+	vtkSmartPointer<vtkPolyData> trace( const float* seeds, int numSeeds );
+
+	/// Move points (3*numPoints floats) in place along the flow for the given
+	/// (signed) time by numSteps RK4 steps, used to build a \a FlowMap.
+	/// A point stops when its next step would leave the warpfield domain.
+	void advect( float* points, int numPoints, double time, int numSteps ) const;
+
+	///@{ Statistics of last trace
+	long getNumFieldEvaluations() const { return m_numEvaluations; }
+	long getNumRejectedSteps()    const { return m_numRejected; }
+	long getNumVertices()         const { return m_numVertices; }
+	///@}
+
+protected:
+	/// Evaluate warp at x times sign, counts evaluations
+	void velocity( const double x[3], double sign, double v[3], long& evals ) const;
+
+	/// Single integration step of size h with given integrator. Returns
+	/// estimated local error for the adaptive integrator, zero otherwise.
+	double step( int integrator, const double x[3], double h, double sign,
+	             double xnew[3], long& evals ) const;
+
+	/// Normal as normalized negative gradient of volume (zero if undefined)
+	void normal( const double x[3], double n[3] ) const;
+
+	/// Project x onto isosurface along dir via damped Newton iteration
+	void projectToIsosurface( double x[3], const double dir[3] ) const;
+
+	/// Trace a single line, appends xyz and normalized time to buffers
+	void traceLine( const float* seed, std::vector<float>& pts,
+	                std::vector<float>& times, long& evals, long& rejected ) const;
+
+private:
+	Grid m_warp;
+	Grid m_volume;
+	const FlowMap* m_flowMap;
+
+	int    m_mode;
+	int    m_integrator;
+	float  m_timescale;
+	float  m_isovalue;
+	int    m_numSteps;
+	double m_tolerance;
+	int    m_maxVertices;
+	int    m_newtonIterations;
+
+	long m_numEvaluations;
+	long m_numRejected;
+	long m_numVertices;
+};
+
+#endif // STREAMLINETRACER_H
@@ -10,12 +10,27 @@
 #include <QDoubleSpinBox>
 #include <QFormLayout>
 #include <QWidget>
+#include <QtConcurrentRun>
 
 #include <GL/GLSLProgram.h>
 #include <GL/GLError.h>
 
 #include "VolumeUtils.h"
 
+#include <vtkPolyData.h>
+#include <vtkPolyDataWriter.h>
+
+#include <iostream>
+
+namespace {
+	/// Worker thread function of Viewer::updateFlowMap()
+	bool buildFlowMap( FlowMap* flowMap, const StreamlineTracer* tracer,
+	                   std::string mhdFilename, FlowMap::Parameters p )
+	{
+		return flowMap->loadOrBuild( mhdFilename.c_str(), *tracer, p );
+	}
+}
+
 
 #ifdef USE_MESHTOOLS
 #include <meshtools.h>
@@ -92,7 +107,6 @@ void SimpleMesh::renderVAO( unsigned shaderProgram )
 #endif // USE_MESHTOOLS
 
 
-/// Copy information from VolumeDataHeader to VolumeTextureManager::Data
 VolumeTextureManager::Data adapt( VolumeDataHeader* mhd )
 {
 	if( !mhd ) return VolumeTextureManager::Data();
@@ -159,6 +173,7 @@ Viewer::Viewer( QWidget* parent )
 		*actLoadDeformation = new QAction(tr("Load deformation..."),this),
 		*actLoadSeedPoints  = new QAction(tr("Load seed points..."),this),
 		*actLoadMesh        = new QAction(tr("Load mesh..."),this),
+		*actExportLines     = new QAction(tr("Export streamlines..."),this),
 		*actSetIsovalue     = new QAction(tr("Set isovalue"),this),
 		*actShowWarpedMesh  = new QAction(tr("Show warped mesh"),this),
 		*actShowStreamlines = new QAction(tr("Show streamlines"),this),
@@ -167,6 +182,7 @@ Viewer::Viewer( QWidget* parent )
 	connect( actLoadDeformation, SIGNAL(triggered()), this, SLOT(loadDeformation()) );
 	connect( actLoadSeedPoints , SIGNAL(triggered()), this, SLOT(loadSeedPoints()) );
 	connect( actLoadMesh       , SIGNAL(triggered()), this, SLOT(loadMesh()) );
+	connect( actExportLines    , SIGNAL(triggered()), this, SLOT(exportStreamlines()) );
 	connect( actSetIsovalue    , SIGNAL(triggered()), this, SLOT(setIsovalue()) );
 
 	QStringList itemNames;
@@ -189,6 +205,8 @@ Viewer::Viewer( QWidget* parent )
 	m_actions.push_back( actLoadSeedPoints );
 	m_actions.push_back( actLoadMesh );
 	m_actions.push_back( createSeparator(this) );
+	m_actions.push_back( actExportLines );
+	m_actions.push_back( createSeparator(this) );
 	m_actions.push_back( actSetIsovalue );
 	m_actions.push_back( createSeparator(this) );
 	m_actions.push_back( actReloadShader );
@@ -210,6 +228,16 @@ Viewer::Viewer( QWidget* parent )
 	formLayout->addRow(tr("timescale"),m_spinTimescale);
 	m_controlWidget = new QWidget;
 	m_controlWidget->setLayout( formLayout );
+
+	// -- Flow map worker
+
+	m_flowMapWatcher = new QFutureWatcher<bool>( this );
+	connect( m_flowMapWatcher, SIGNAL(finished()), this, SLOT(flowMapFinished()) );
+}
+
+Viewer::~Viewer()
+{
+	m_flowMapWatcher->waitForFinished();
 }
 
 void Viewer::init()
@@ -443,12 +471,31 @@ void Viewer::loadMesh()
 	}
 }
 
+void Viewer::exportStreamlines()
+{
+	QString filename = QFileDialog::getSaveFileName( this, 
+		tr("Export streamlines"), m_baseDir, tr("VTK PolyData (*.vtk)") );
+
+	if( filename.isEmpty() )
+		return;
+
+	if( !exportStreamlines( filename ) )
+	{
+		QMessageBox::warning( this, tr("Error exporting streamlines"),
+			tr("Error exporting streamlines to %1").arg(filename) );
+		return;
+	}
+}
+
 bool Viewer::loadTemplate( QString filename )
 {
-	GL::GLTexture* tex = loadVolume( filename );
+	VolumeTextureManager::Data data;
+	GL::GLTexture* tex = loadVolume( filename, &data );
 	if( !tex )
 		return false;
 
+	m_tracer.setVolume( data );
+
 	// Remove old texture from manager (if any)
 	m_vtm.erase( m_slr[0].getVolume() );
 
@@ -461,10 +508,21 @@ bool Viewer::loadTemplate( QString filename )
 
 bool Viewer::loadDeformation( QString filename )
 {
-	GL::GLTexture* tex = loadVolume( filename );
+	VolumeTextureManager::Data data;
+	GL::GLTexture* tex = loadVolume( filename, &data );
 	if( !tex )
 		return false;
 
+	// Precompute flow map (or reuse cached one) for CPU tracing in the
+	// background, a running build still reads the old warpfield
+	m_flowMapWatcher->waitForFinished();
+	m_flowMapPending.clear();
+	m_flowMap.clear();
+	m_tracer.setFlowMap( NULL );
+	m_flowMapFilename = filename.toStdString();
+	if( m_tracer.setWarpfield( data ) )
+		updateFlowMap();
+
 	// Remove old texture from manager (if any)
 	m_vtm.erase( m_slr[0].getWarpfield() );
 
@@ -490,7 +548,35 @@ bool Viewer::loadMesh( QString filename )
 	return m_mesh.load( filename.toStdString().c_str() );
 }
 
-GL::GLTexture* Viewer::loadVolume( QString filename )
+bool Viewer::exportStreamlines( QString filename )
+{
+	if( !m_seed.getDataPtr() || !m_tracer.hasWarpfield() )
+		return false;
+
+	// Trace projected streamlines if shown and template is available
+	bool projected = m_itemVisibilityActions[ProjectedStreamlines]->isChecked()
+	                 && m_tracer.hasVolume();
+
+	m_tracer.setMode( projected ? StreamlineTracer::ProjectedStreamlines
+	                            : StreamlineTracer::Streamlines );
+	m_tracer.setTimescale( m_slr[0].getTimescale() );
+	m_tracer.setIsovalue( m_slr[0].getIsovalue() );
+
+	vtkSmartPointer<vtkPolyData> lines =
+		m_tracer.trace( m_seed.getDataPtr(), m_seed.getNumPoints() );
+	if( !lines )
+		return false;
+
+	vtkSmartPointer<vtkPolyDataWriter> writer = 
+		vtkSmartPointer<vtkPolyDataWriter>::New();
+	writer->SetFileName( filename.toStdString().c_str() );
+	writer->SetInput( lines );
+	writer->SetFileTypeToBinary();
+	return writer->Write() == 1;
+}
+
+GL::GLTexture* Viewer::loadVolume( QString filename,
+                                   VolumeTextureManager::Data* cpuData )
 {
 	// Load
 	VolumeDataHeader* mhd;
@@ -530,6 +616,9 @@ GL::GLTexture* Viewer::loadVolume( QString filename )
 		return NULL;
 	}
 
+	if( cpuData )
+		*cpuData = data;
+
 	return tex;
 }
 
@@ -553,10 +642,51 @@ void Viewer::setTimescale( double val )
 	m_slr[1].setTimescale( (float)val );
 	m_slr[2].setTimescale( (float)val );
 
+	updateFlowMap();
+
 	// Render
 	updateGL();
 }
 
+void Viewer::updateFlowMap()
+{
+	// A running build is followed up in flowMapFinished()
+	float timescale = m_slr[0].getTimescale();
+	if( m_flowMapWatcher->isRunning() || !m_tracer.hasWarpfield() ||
+		m_flowMap.covers( timescale ) )
+		return;
+
+	// Same timescale and number of steps as used for tracing
+	m_tracer.setTimescale( timescale );
+	m_flowMapWatcher->setFuture( QtConcurrent::run( buildFlowMap,
+		&m_flowMapPending, (const StreamlineTracer*)&m_tracer,
+		m_flowMapFilename, FlowMap::parametersFor( m_tracer ) ) );
+}
+
+void Viewer::flowMapFinished()
+{
+	if( m_flowMapWatcher->isRunning() )
+		return;
+
+	if( !m_flowMapWatcher->result() )
+	{
+		std::cerr << "Warning: Building flow map failed, streamlines will be "
+			"integrated instead!" << std::endl;
+		return;
+	}
+
+	// Result is empty if superseded by loadDeformation()
+	if( m_flowMapPending.empty() )
+		return;
+
+	m_flowMap = m_flowMapPending;
+	m_flowMapPending.clear();
+	m_tracer.setFlowMap( &m_flowMap );
+
+	// Timescale may have changed meanwhile
+	updateFlowMap();
+}
+
 void Viewer::updateBoundingBox()
 {
 	// Use points to update bounding box for QGLViewer camera
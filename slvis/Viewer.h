@@ -5,12 +5,17 @@
 
 #include <QGLViewer/qglviewer.h>
 #include <QList>
+#include <QFutureWatcher>
+#include <string>
 
 #include "PointSamples.h"
 #include "StreamlineRenderer.h"
 #include "VolumeTextureManager.h"
+#include "StreamlineTracer.h"
+#include "FlowMap.h"
 
 class GLSLProgram;
+class VolumeDataHeader;
 class QAction;
 class QDoubleSpinBox;
 
@@ -47,6 +52,9 @@ public:
 };
 #endif
 
+/// Copy information from VolumeDataHeader to VolumeTextureManager::Data
+VolumeTextureManager::Data adapt( VolumeDataHeader* mhd );
+
 /**
 	Stand alone viewer widget for prototyping streamline rendering.	
 */
@@ -56,6 +64,7 @@ class Viewer : public QGLViewer
 	
 public:
 	Viewer( QWidget* parent=0 );
+	~Viewer();
 
 	QList<QAction*> getActions() { return m_actions; }
 
@@ -75,14 +84,21 @@ public slots:
 	bool loadSeedPoints( QString filename );
 	bool loadMesh( QString filename );
 
+	void exportStreamlines();
+	bool exportStreamlines( QString filename );
+
 	void setIsovalue();
 	void setTimescale( double );
 
+protected slots:
+	void flowMapFinished();
+
 protected:
 	/// Load MHD volume from disk, returns NULL on error otherwise returns 
 	/// texture pointer of texture already added to texture manager and uploaded
-	/// to GPU.
-	GL::GLTexture* loadVolume( QString filename );
+	/// to GPU. Optionally returns the CPU side data.
+	GL::GLTexture* loadVolume( QString filename,
+	                           VolumeTextureManager::Data* cpuData=NULL );
 
 	///@{ QGLViewer implementation
 	void draw();
@@ -95,6 +111,9 @@ protected:
 
 	void updateBoundingBox();
 
+	/// Build flow map in worker thread if it does not cover the timescale
+	void updateFlowMap();
+
 	/// Returns GLSL program handle, mode is index into m_slr array
 	unsigned bindShader( int mode );
 
@@ -120,6 +139,15 @@ private:
 	VolumeTextureManager m_vtm;
 	PointSamples         m_seed;
 	SimpleMesh           m_mesh;
+
+	// CPU tracing (for export)
+	StreamlineTracer     m_tracer;
+	FlowMap              m_flowMap;
+
+	// Flow map worker, only reads the warpfield of m_tracer
+	QFutureWatcher<bool>* m_flowMapWatcher;
+	FlowMap               m_flowMapPending; ///< Result of worker
+	std::string           m_flowMapFilename;
 };
 
 #endif // VIEWER_H
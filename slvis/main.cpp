@@ -3,11 +3,19 @@
 #include <QFile>
 #include <QString>
 #include <QDebug>
+#include <QTime>
 
 #include <exception>
+#include <iostream>
+#include <cstring> // strcmp
+#include <cstdlib> // atof
 
 #include "MainWindow.h"
 #include "Viewer.h"
+#include "PointSamples.h"
+#include "StreamlineTracer.h"
+#include "FlowMap.h"
+#include "VolumeUtils.h"
 
 /// Derived QApplication to catch exceptions via notify()
 /// See http://stackoverflow.com/questions/4661883/qt-c-error-handling
@@ -39,8 +47,111 @@ protected:
 	}
 };
 
+/// Load MHD volume into tracer (no GPU upload)
+bool loadTracerVolume( StreamlineTracer& tracer, const char* filename, bool warpfield )
+{
+	void* dataPtr;
+	VolumeDataHeader* mhd = load_volume( filename, 0, &dataPtr );
+	if( !mhd )
+		return false;
+
+	VolumeTextureManager::Data data = adapt( mhd );
+	data.setDataPtr( dataPtr );
+	bool ok = (data.type >= 0) && 
+		(warpfield ? tracer.setWarpfield( data ) : tracer.setVolume( data ));
+
+	mhd->clear(); // free data, tracer keeps its own copy
+	delete mhd;
+	return ok;
+}
+
+/// Benchmark CPU streamline tracer on one or more seed point sets, usage:
+///   slvis --benchmark <warpfield.mhd> <template.mhd|-> <isovalue> <seeds.vtk>...
+int benchmark( int argc, char* argv[] )
+{
+	using std::cout;
+	using std::cerr;
+	using std::endl;
+
+	if( argc < 6 )
+	{
+		cerr << "Usage: " << argv[0] << " --benchmark <warpfield.mhd> "
+			"<template.mhd|-> <isovalue> <seeds.vtk> [<seeds.vtk> ...]" << endl;
+		return -1;
+	}
+
+	StreamlineTracer tracer;
+	if( !loadTracerVolume( tracer, argv[2], true ) )
+	{
+		cerr << "Error loading warpfield " << argv[2] << endl;
+		return -2;
+	}
+	if( strcmp( argv[3], "-" ) != 0 && !loadTracerVolume( tracer, argv[3], false ) )
+	{
+		cerr << "Error loading template " << argv[3] << endl;
+		return -3;
+	}
+	tracer.setIsovalue( (float)atof( argv[4] ) );
+
+	QTime timer;
+	timer.start();
+	FlowMap flowMap;
+	bool hasFlowMap = flowMap.loadOrBuild( argv[2], tracer,
+	                                       FlowMap::parametersFor( tracer ) );
+	if( hasFlowMap )
+		cout << "Flow map (load or build) : " << timer.elapsed() << " ms" << endl;
+	else
+		cerr << "Error: Building flow map failed, skipping flow map runs!" << endl;
+
+	const char* modeNames[] = { "streamlines", "meshwarp", "projected" };
+	const char* integratorNames[] = { "Euler", "RK4", "RK45", "flow map" };
+
+	for( int f=5; f < argc; f++ )
+	{
+		PointSamples seeds;
+		if( !seeds.loadPointSamples( argv[f] ) )
+		{
+			cerr << "Error loading seed points " << argv[f] << endl;
+			continue;
+		}
+		cout << argv[f] << " : " << seeds.getNumPoints() << " seeds" << endl;
+
+		for( int mode=0; mode < 3; mode++ )
+		{
+			if( mode==StreamlineTracer::ProjectedStreamlines && !tracer.hasVolume() )
+				continue;
+
+			for( int integrator=0; integrator < 4; integrator++ )
+			{
+				if( integrator==3 && !hasFlowMap )
+					continue;
+
+				// Last run uses flow map lookup instead of integration
+				tracer.setMode( mode );
+				tracer.setIntegrator( integrator < 3 ? integrator : 0 );
+				tracer.setFlowMap( integrator < 3 ? NULL : &flowMap );
+
+				timer.start();
+				tracer.trace( seeds.getDataPtr(), seeds.getNumPoints() );
+				int ms = timer.elapsed();
+
+				cout << "  " << modeNames[mode] << ", " << integratorNames[integrator]
+				     << " : " << ms << " ms, "
+				     << tracer.getNumVertices() << " vertices, "
+				     << tracer.getNumFieldEvaluations() << " field evaluations, "
+				     << tracer.getNumRejectedSteps() << " rejected steps" << endl;
+			}
+		}
+	}
+	return 0;
+}
+
 int main( int argc, char* argv[] )
 {
+	// Headless benchmark of CPU streamline tracing
+	if( argc > 1 && strcmp( argv[1], "--benchmark" )==0 )
+		return benchmark( argc, argv );
+
 	Q_INIT_RESOURCE( slvis );
 
 	QMyApplication app( argc, argv );
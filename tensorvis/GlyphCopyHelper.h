@@ -0,0 +1,240 @@
+#ifndef GLYPHCOPYHELPER_H
+#define GLYPHCOPYHELPER_H
+
+#include "vtkCellArray.h"
+#include "vtkDataArray.h"
+#include "vtkFieldData.h"
+#include "vtkIdTypeArray.h"
+#include "vtkPolyData.h"
+#include "vtkSmartPointer.h"
+#include <cmath>
+#include <cstring> // for memcpy()
+
+/// Building blocks for glyph filters which write into preallocated output.
+///
+/// Used by vtkTensorGlyph3 and vtkGlyph3D_3 to replace the per-glyph
+/// vtkTransform / InsertNextCell() / InsertTuple() calls. All functions write
+/// disjoint ranges of arrays sized up front and are safe to call from an
+/// OpenMP parallel loop unless stated otherwise.
+namespace GlyphCopyHelper
+{
+  /// Affine transformation p' = A p + t
+  struct Affine
+  {
+    double A[3][3];
+    double t[3];
+
+    void Identity()
+    {
+      for (int i=0; i < 3; i++)
+        {
+        for (int j=0; j < 3; j++)
+          {
+          A[i][j] = (i==j) ? 1.0 : 0.0;
+          }
+        t[i] = 0.0;
+        }
+    }
+
+    /// Right-multiply linear part by M, i.e. same as vtkTransform::PreMultiply()
+    void Concatenate(const double M[3][3])
+    {
+      double B[3][3];
+      for (int i=0; i < 3; i++)
+        {
+        for (int j=0; j < 3; j++)
+          {
+          B[i][j] = A[i][0]*M[0][j] + A[i][1]*M[1][j] + A[i][2]*M[2][j];
+          }
+        }
+      memcpy(A, B, sizeof(B));
+    }
+
+    /// Right-multiply linear part by diag(sx,sy,sz)
+    void Scale(double sx, double sy, double sz)
+    {
+      for (int i=0; i < 3; i++)
+        {
+        A[i][0] *= sx;
+        A[i][1] *= sy;
+        A[i][2] *= sz;
+        }
+    }
+
+    /// Right-multiply by translation (x,y,z)
+    void Translate(double x, double y, double z)
+    {
+      for (int i=0; i < 3; i++)
+        {
+        t[i] += A[i][0]*x + A[i][1]*y + A[i][2]*z;
+        }
+    }
+
+    /// Cofactor matrix det(A)*inv(A)^T, maps normals up to a positive factor
+    /// if det(A) > 0 and flips them if det(A) < 0 (inside out glyph).
+    void Cofactor(double C[3][3]) const
+    {
+      for (int i=0; i < 3; i++)
+        {
+        int i1 = (i+1)%3, i2 = (i+2)%3;
+        for (int j=0; j < 3; j++)
+          {
+          int j1 = (j+1)%3, j2 = (j+2)%3;
+          C[i][j] = A[i1][j1]*A[i2][j2] - A[i1][j2]*A[i2][j1];
+          }
+        }
+    }
+  };
+
+  /// Transform n points, src and dst may be the same array
+  template <class T>
+  inline void TransformPoints(const Affine& trans, const T* src, vtkIdType n,
+                              float* dst)
+  {
+    for (vtkIdType i=0; i < n; i++)
+      {
+      double p[3] = { (double)src[3*i], (double)src[3*i+1], (double)src[3*i+2] };
+      for (int d=0; d < 3; d++)
+        {
+        dst[3*i+d] = (float)(trans.A[d][0]*p[0] + trans.A[d][1]*p[1] +
+                             trans.A[d][2]*p[2] + trans.t[d]);
+        }
+      }
+  }
+
+  /// Transform and normalize n normals by matrix N (e.g. a cofactor matrix),
+  /// src and dst may be the same array
+  template <class T>
+  inline void TransformNormals(const double N[3][3], const T* src, vtkIdType n,
+                               float* dst)
+  {
+    for (vtkIdType i=0; i < n; i++)
+      {
+      double p[3] = { (double)src[3*i], (double)src[3*i+1], (double)src[3*i+2] };
+      double q[3];
+      for (int d=0; d < 3; d++)
+        {
+        q[d] = N[d][0]*p[0] + N[d][1]*p[1] + N[d][2]*p[2];
+        }
+      double len = sqrt(q[0]*q[0] + q[1]*q[1] + q[2]*q[2]);
+      if (len > 0.0)
+        {
+        len = 1.0 / len;
+        }
+      for (int d=0; d < 3; d++)
+        {
+        dst[3*i+d] = (float)(q[d]*len);
+        }
+      }
+  }
+
+  /// Copy tuple srcId of in to tuples [dstId,dstId+count) of out. Both arrays
+  /// must have the same type and number of components.
+  inline void ReplicateTuple(vtkDataArray* in, vtkIdType srcId,
+                             vtkDataArray* out, vtkIdType dstId, vtkIdType count)
+  {
+    int size = in->GetNumberOfComponents() * in->GetDataTypeSize();
+    const char* src = static_cast<const char*>(in->GetVoidPointer(0)) + srcId*size;
+    char* dst = static_cast<char*>(out->GetVoidPointer(0)) + dstId*size;
+    for (vtkIdType i=0; i < count; i++, dst += size)
+      {
+      memcpy(dst, src, size);
+      }
+  }
+
+  /// Copy all count tuples of in to out starting at tuple dstId
+  inline void CopyTuples(vtkDataArray* in, vtkDataArray* out, vtkIdType dstId,
+                         vtkIdType count)
+  {
+    int size = in->GetNumberOfComponents() * in->GetDataTypeSize();
+    memcpy(static_cast<char*>(out->GetVoidPointer(0)) + dstId*size,
+           in->GetVoidPointer(0), count*size);
+  }
+
+  /// New empty array of the same type, name and number of components as in
+  /// with numTuples tuples. Caller has to Delete() it.
+  inline vtkDataArray* NewArrayLike(vtkDataArray* in, vtkIdType numTuples)
+  {
+    vtkDataArray* out = in->NewInstance();
+    out->SetNumberOfComponents(in->GetNumberOfComponents());
+    out->SetName(in->GetName());
+    out->SetNumberOfTuples(numTuples);
+    return out;
+  }
+
+  /// True if all arrays of fd can be replicated via ReplicateTuple()
+  inline bool CanReplicate(vtkFieldData* fd)
+  {
+    for (int i=0; fd && i < fd->GetNumberOfArrays(); i++)
+      {
+      vtkDataArray* a = vtkDataArray::SafeDownCast(fd->GetAbstractArray(i));
+      if (!a || a->GetDataType() == VTK_BIT)
+        {
+        return false;
+        }
+      }
+    return true;
+  }
+
+  /// Replicate the cells of source for numGroups*numCopies glyphs of
+  /// numSourcePts points each, glyph (g,c) using point ids offset by
+  /// (g*numCopies+c)*numSourcePts. Within each cell array the order is group,
+  /// source cell, copy; this matches calling InsertNextCell() in that order.
+  /// Not thread-safe itself, the copy is parallelized over groups internally.
+  inline void CopyTopology(vtkPolyData* source, vtkPolyData* output,
+                           vtkIdType numGroups, int numCopies,
+                           vtkIdType numSourcePts)
+  {
+    for (int type=0; type < 4; type++)
+      {
+      vtkCellArray* cells =
+        type==0 ? source->GetVerts() :
+        type==1 ? source->GetLines() :
+        type==2 ? source->GetPolys() : source->GetStrips();
+      vtkIdType numCells = cells ? cells->GetNumberOfCells() : 0;
+      if (numCells == 0)
+        {
+        continue;
+        }
+      const vtkIdType* src = cells->GetPointer();
+      vtkIdType size = cells->GetNumberOfConnectivityEntries();
+      vtkIdType groupSize = numCopies*size;
+
+      vtkSmartPointer<vtkIdTypeArray> ids = vtkSmartPointer<vtkIdTypeArray>::New();
+      ids->SetNumberOfValues(numGroups*groupSize);
+      vtkIdType* dst0 = ids->GetPointer(0);
+
+      #pragma omp parallel for schedule(static)
+      for (int g=0; g < (int)numGroups; g++)
+        {
+        vtkIdType* dst = dst0 + g*groupSize;
+        vtkIdType ofs = (vtkIdType)g*numCopies*numSourcePts;
+        for (vtkIdType k=0; k < size; k += src[k]+1)
+          {
+          vtkIdType npts = src[k];
+          for (int c=0; c < numCopies; c++)
+            {
+            vtkIdType cofs = ofs + c*numSourcePts;
+            *dst++ = npts;
+            for (vtkIdType j=1; j <= npts; j++)
+              {
+              *dst++ = src[k+j] + cofs;
+              }
+            }
+          }
+        }
+
+      vtkSmartPointer<vtkCellArray> newCells = vtkSmartPointer<vtkCellArray>::New();
+      newCells->SetCells(numGroups*numCopies*numCells, ids);
+      switch (type)
+        {
+        case 0: output->SetVerts(newCells); break;
+        case 1: output->SetLines(newCells); break;
+        case 2: output->SetPolys(newCells); break;
+        default: output->SetStrips(newCells); break;
+        }
+      }
+  }
+}
+
+#endif // GLYPHCOPYHELPER_H
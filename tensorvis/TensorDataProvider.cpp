@@ -271,6 +271,11 @@ void TensorDataProvider::
 void TensorDataProvider::
   setImageMask( vtkImageData* img )
 {
+	m_thresholdBricks.clear();
+	m_thresholdImage = img;
+	if( !img )
+		return;
+
 	int dims[3];
 	double spacing[3];
 	double origin [3];
@@ -278,7 +283,16 @@ void TensorDataProvider::
 	img->GetSpacing   ( spacing );
 	img->GetOrigin    ( origin );
 	m_thresholdSpace = ImageDataSpace( dims, spacing, origin );
-	m_thresholdImage = img;
+
+	// Brick min/max of first channel for early rejection of sample points
+	void* ptr = img->GetScalarPointer();
+	if( ptr && img->GetNumberOfScalarComponents()==1 )
+	{
+		switch( img->GetScalarType() )
+		{
+			vtkTemplateMacro( m_thresholdBricks.build( (VTK_TT*)ptr, dims, 1, 8 ) );
+		}
+	}
 }
 
 //-----------------------------------------------------------------------------
@@ -303,6 +317,8 @@ bool TensorDataProvider::
 	{
 		int ijk[3];
 		m_thresholdSpace.getIJK( x,y,z, ijk );
+		if( m_thresholdBricks.isBelow( ijk[0],ijk[1],ijk[2], (float)m_thresholdLow ) )
+			return false;
 		double intensity 
 			= m_thresholdImage->GetScalarComponentAsDouble(ijk[0],ijk[1],ijk[2],0);
 		if( (intensity < m_thresholdLow) ) //|| (intensity > m_thresholdHigh) )
@@ -2,6 +2,7 @@
 #define TENSORDATAPROVIDER_H
 
 #include "ImageDataSpace.h"
+#include <VolumeRendering/VolumeBricks.h>
 
 #include <vtkPoints.h>
 #include <vtkDoubleArray.h>
@@ -108,6 +109,9 @@ public:
 	/// below \a threshHigh. Note that since \a isValidSamplePoint() may be 
 	/// re-implemented in a subclass, this functionality can be overridden.
 	/// Set \a img to NULL to deactivate thresholding.
+	/// For single channel images brick min/max are computed such that points
+	/// in bricks entirely below the low threshold are rejected without
+	/// accessing the image.
 	void setImageMask( vtkImageData* img );
 	void setImageThreshold( double threshLow, double threshHigh=30000.0 );
 
@@ -184,6 +188,7 @@ private:
 	// based on a given image.
 	vtkImageData*  m_thresholdImage;
 	ImageDataSpace m_thresholdSpace;
+	VolumeBricks   m_thresholdBricks;
 	double m_thresholdLow;
 	double m_thresholdHigh;
 
@@ -2,11 +2,8 @@
 #include <iostream>
 #include <cstdio>
 
-#include "rednum.h"
-namespace {
-	typedef boost::numeric::ublas::matrix< float > Matrix;
-	typedef boost::numeric::ublas::vector< float > Vector;
-};
+#include "fixnum.h"
+#include <cmath>
 
 #ifdef TENSORVIS_TEEM_SUPPORT
 
@@ -218,8 +215,8 @@ void TensorNormalDistribution::computeModes()
 	m_spect = new float[     NumModes * N ];
 
 	// Covariance weight (note the factor 2.0 in the lower right block)
-	Matrix W(6,6);
-	float sqrt2 = (float)sqrt(2.), one=1.f, two=2.f;
+	fixnum::Mat6 W;
+	double sqrt2 = sqrt(2.), one=1., two=2.;
 	W(0,0)=one; W(0,1)=one; W(0,2)=one; W(0,3)=sqrt2; W(0,4)=sqrt2; W(0,5)=sqrt2;
 	W(1,0)=one; W(1,1)=one; W(1,2)=one; W(1,3)=sqrt2; W(1,4)=sqrt2; W(1,5)=sqrt2;
 	W(2,0)=one; W(2,1)=one; W(2,2)=one; W(2,3)=sqrt2; W(2,4)=sqrt2; W(2,5)=sqrt2;
@@ -227,10 +224,21 @@ void TensorNormalDistribution::computeModes()
 	W(4,0)=sqrt2; W(4,1)=sqrt2; W(4,2)=sqrt2; W(4,3)=two; W(4,4)=two; W(4,5)=two;
 	W(5,0)=sqrt2; W(5,1)=sqrt2; W(5,2)=sqrt2; W(5,3)=two; W(5,4)=two; W(5,5)=two;
 	
+	// Eigen-tensor weight
+	double one_over_sqrt2 = 1. / sqrt(2.);
+	fixnum::Vec6 wv;
+	wv(0) = 1.;
+	wv(1) = 1.;
+	wv(2) = 1.;
+	wv(3) = one_over_sqrt2;
+	wv(4) = one_over_sqrt2;
+	wv(5) = one_over_sqrt2;
+
 	// A very expensive loop ;-)
-	static Matrix Sigma(6,6);
-	static Matrix U, V; // eigenvectors
-	static Vector eigenvals;
+	// (Fixed-size 6x6 types, i.e. no heap allocation per tensor.)
+	fixnum::Mat6 Sigma;
+	fixnum::Mat6 U; // eigenvectors
+	fixnum::Vec6 eigenvals;
 #if 0
 	for( int n=0; n < 1000; n++ ) // for debugging purposes operate on 100 entries only
 #else
@@ -254,30 +262,20 @@ void TensorNormalDistribution::computeModes()
 				Sigma(j,i) = W(j,i) * Sigma(j,i);
 			}
 		
-		// FIXME: Exploit symmetry and avoid SVD computation
-		rednum::compute_svd<Matrix,Vector,float>( Sigma, U, eigenvals, V );
-
-		// Eigen-tensor weight
-		double one_over_sqrt2 = 1. / sqrt(2.);
-		Vector wv(6);
-		wv(0) = (Vector::value_type)1.;
-		wv(1) = (Vector::value_type)1.;
-		wv(2) = (Vector::value_type)1.;
-		wv(3) = (Vector::value_type)one_over_sqrt2;
-		wv(4) = (Vector::value_type)one_over_sqrt2;
-		wv(5) = (Vector::value_type)one_over_sqrt2;
+		// Exploit symmetry, eigen decomposition instead of SVD
+		fixnum::sym_eigen( Sigma, eigenvals, U );
 		
 		// Copy result
 		ofs = 0;
 		int mode_addr = n * 6 * NumModes;
 		for( int j=0; j < NumModes; j++ )
 			for( int i=0; i < 6; i++, ofs++ )
-			 m_modes[mode_addr + ofs] = U(i,j) * wv(i);
+			 m_modes[mode_addr + ofs] = (float)(U(i,j) * wv(i));
 				// was: ... * ((i>=3) ? one_over_sqrt2 : 1.);
 			
 		int spect_addr = n * NumModes;
 		for( int i=0; i < NumModes; i++ )
-			m_spect[spect_addr + i] = eigenvals[i];
+			m_spect[spect_addr + i] = (float)eigenvals[i];
 	}
 	std::cout << std::endl;	
 }
@@ -1,29 +1,25 @@
 #include "TensorSpectrum.h"
-#include <vtkMath.h>  // vtkMath::Jacobi(),::Normalize()
+#include "fixnum.h"   // fixnum::sym_eigen()
+#include <vtkMath.h>  // vtkMath::Normalize()
 #include <algorithm>  // min(),max()
 #include <cmath>      // sqrt()
 
 void TensorSpectrum::compute( double* tensor9 )
 {
-	// The following code is partly taken from vtkTensorGlyph
+	// Fixed-size Jacobi with the same ordering and sign convention as the
+	// former vtkMath::Jacobi() (code partly taken from vtkTensorGlyph)
+	fixnum::Mat3 m, v;
+	fixnum::Vec3 l;
+	fixnum::from_rawbuffer( m, tensor9, false );
 
-	// set up temporary working matrices
-	double *m[3], *v[3];
-	double m0[3], m1[3], m2[3];
-	double v0[3], v1[3], v2[3];
-	m[0] = m0; m[1] = m1; m[2] = m2;
-	v[0] = v0; v[1] = v1; v[2] = v2;
-	for( int j=0; j<3; j++ )
-		for( int i=0; i<3; i++ )
-			m[i][j] = tensor9[i+3*j];
-
-	// compute eigenvectors (v) and ~values (lambda) from psd matrix (m)
-	vtkMath::Jacobi(m, lambda, v);
+	// compute eigenvectors (v) and ~values (l) from psd matrix (m)
+	fixnum::sym_eigen( m, l, v );
+	lambda[0] = l(0);  lambda[1] = l(1);  lambda[2] = l(2);
 
 	// copy eigenvectors
-	ev1[0] = v[0][0];  ev1[1] = v[1][0];  ev1[2] = v[2][0];
-	ev2[0] = v[0][1];  ev2[1] = v[1][1];  ev2[2] = v[2][1];
-	ev3[0] = v[0][2];  ev3[1] = v[1][2];  ev3[2] = v[2][2];
+	ev1[0] = v(0,0);  ev1[1] = v(1,0);  ev1[2] = v(2,0);
+	ev2[0] = v(0,1);  ev2[1] = v(1,1);  ev2[2] = v(2,1);
+	ev3[0] = v(0,2);  ev3[1] = v(1,2);  ev3[2] = v(2,2);
 }
 
 void TensorSpectrum::set( double* basis9 )
@@ -40,29 +36,14 @@ void TensorSpectrum::set( double* basis9 )
 	lambda[2] = vtkMath::Normalize(ev3);
 }
 
-// WORKAROUND: Simply copied above double* functions to take float* input!
+// float* variants simply convert to double
 
 void TensorSpectrum::compute( float* tensor9 )
 {
-	// The following code is partly taken from vtkTensorGlyph
-
-	// set up temporary working matrices
-	double *m[3], *v[3];
-	double m0[3], m1[3], m2[3];
-	double v0[3], v1[3], v2[3];
-	m[0] = m0; m[1] = m1; m[2] = m2;
-	v[0] = v0; v[1] = v1; v[2] = v2;
-	for( int j=0; j<3; j++ )
-		for( int i=0; i<3; i++ )
-			m[i][j] = tensor9[i+3*j];
-
-	// compute eigenvectors (v) and ~values (lambda) from psd matrix (m)
-	vtkMath::Jacobi(m, lambda, v);
-
-	// copy eigenvectors
-	ev1[0] = v[0][0];  ev1[1] = v[1][0];  ev1[2] = v[2][0];
-	ev2[0] = v[0][1];  ev2[1] = v[1][1];  ev2[2] = v[2][1];
-	ev3[0] = v[0][2];  ev3[1] = v[1][2];  ev3[2] = v[2][2];
+	double t[9];
+	for( int i=0; i < 9; i++ )
+		t[i] = tensor9[i];
+	compute( t );
 }
 
 void TensorSpectrum::set( float* basis9 )
@@ -30,6 +30,21 @@
 #include "vtkStreamingDemandDrivenPipeline.h"
 #include "vtkTransform.h"
 #include "vtkUnsignedCharArray.h"
+#include "GlyphCopyHelper.h"
+
+#include <vector>
+
+namespace
+{
+  // Per glyph result of the first pass in vtkGlyph3D_3::RequestDataParallel()
+  struct GlyphFrame
+  {
+    GlyphCopyHelper::Affine trans;   // source to glyph
+    GlyphCopyHelper::Affine normals; // linear part maps source normals
+    double v[3], vMag;               // input vector
+    double scale;                    // scale value for VTK_COLOR_BY_SCALE
+  };
+}
 
 vtkStandardNewMacro(vtkGlyph3D_3);
 vtkCxxSetObjectMacro(vtkGlyph3D_3, SourceTransform, vtkTransform);
@@ -248,6 +263,20 @@ int vtkGlyph3D_3::RequestData(
     defaultPoints->Delete();
     defaultPoints = NULL;
     }
+
+  // A single source is glyphed in parallel into preallocated output
+  if ( this->IndexMode == VTK_INDEXING_OFF &&
+       this->GetSource(0, inputVector[1]) &&
+       GlyphCopyHelper::CanReplicate(input->GetPointData()) )
+    {
+    pts->Delete();
+    trans->Delete();
+    return this->RequestDataParallel(
+      input, this->GetSource(0, inputVector[1]), output, inSScalars, inCScalars,
+      haveVectors ? (this->VectorMode == VTK_USE_NORMAL ? inNormals : inVectors)
+                  : NULL,
+      inGhostLevels, requestedGhostLevel);
+    }
   
   if ( this->IndexMode != VTK_INDEXING_OFF )
     {
@@ -717,6 +746,470 @@ int vtkGlyph3D_3::RequestData(
   return 1;
 }
 
+//----------------------------------------------------------------------------
+// Variant of RequestData() for a single source glyph (IndexMode off) which
+// writes into preallocated output arrays. A first pass determines the glyphed
+// input points and computes their transforms, a second pass then fills
+// points, normals and attributes of all glyphs in parallel.
+int vtkGlyph3D_3::RequestDataParallel(vtkDataSet *input, vtkPolyData *source,
+                                      vtkPolyData *output,
+                                      vtkDataArray *inSScalars,
+                                      vtkDataArray *inCScalars,
+                                      vtkDataArray *array3D,
+                                      unsigned char *inGhostLevels,
+                                      int requestedGhostLevel)
+{
+  vtkPointData *pd = input->GetPointData();
+  vtkPointData *outputPD = output->GetPointData();
+  vtkCellData *outputCD = output->GetCellData();
+  vtkIdType numPts = input->GetNumberOfPoints();
+  vtkPoints *sourcePts = source->GetPoints();
+  vtkIdType numSourcePts = sourcePts->GetNumberOfPoints();
+  vtkIdType numSourceCells = source->GetNumberOfCells();
+  vtkDataArray *sourceNormals = source->GetPointData()->GetNormals();
+  vtkDataArray *sourceTCoords = source->GetPointData()->GetTCoords();
+  vtkIdType inPtId, i;
+  double den;
+  int k;
+
+  if ( array3D && array3D->GetNumberOfComponents() > 3 )
+    {
+    vtkErrorMacro(<<"vtkDataArray "<<array3D->GetName()<<" has more than 3 components.\n");
+    return 0;
+    }
+  if ( (den = this->Range[1] - this->Range[0]) == 0.0 )
+    {
+    den = 1.0;
+    }
+
+  // Determine glyphed points. IsPointVisible() may be overridden and is
+  // therefore evaluated serially.
+  std::vector<vtkIdType> glyphPts;
+  glyphPts.reserve(numPts);
+  for (inPtId=0; inPtId < numPts; inPtId++)
+    {
+    // Check ghost points, see RequestData()
+    if (inGhostLevels && inGhostLevels[inPtId] > requestedGhostLevel)
+      {
+      continue;
+      }
+    if (this->IsPointVisible(input, inPtId))
+      {
+      glyphPts.push_back(inPtId);
+      }
+    }
+  vtkIdType numGlyphs = static_cast<vtkIdType>(glyphPts.size());
+  vtkIdType numOutPts = numGlyphs*numSourcePts;
+
+  // Source geometry, SourceTransform is applied once for all glyphs
+  std::vector<double> srcPts(3*numSourcePts), srcNormals;
+  if (this->SourceTransform)
+    {
+    vtkSmartPointer<vtkPoints> transformedSourcePts = vtkSmartPointer<vtkPoints>::New();
+    transformedSourcePts->SetDataTypeToDouble();
+    transformedSourcePts->Allocate(numSourcePts);
+    this->SourceTransform->TransformPoints(sourcePts, transformedSourcePts);
+    sourcePts = transformedSourcePts;
+    for (i=0; i < numSourcePts; i++)
+      {
+      sourcePts->GetPoint(i, &srcPts[3*i]);
+      }
+    }
+  else
+    {
+    for (i=0; i < numSourcePts; i++)
+      {
+      sourcePts->GetPoint(i, &srcPts[3*i]);
+      }
+    }
+  if (sourceNormals)
+    {
+    srcNormals.resize(3*numSourcePts);
+    for (i=0; i < numSourcePts; i++)
+      {
+      sourceNormals->GetTuple(i, &srcNormals[3*i]);
+      }
+    }
+  const double *srcP = srcPts.empty() ? NULL : &srcPts[0];
+  const double *srcN = srcNormals.empty() ? NULL : &srcNormals[0];
+
+  // Pass 1: Transformation and attributes of each glyph
+  std::vector<GlyphFrame> frames(numGlyphs);
+  double x0[3];
+  if (numPts > 0)
+    {
+    input->GetPoint(0, x0); // GetPoint() is thread safe once called serially
+    }
+
+  #pragma omp parallel for schedule(static)
+  for (int g=0; g < (int)numGlyphs; g++)
+    {
+    GlyphFrame &f = frames[g];
+    vtkIdType ptId = glyphPts[g];
+    double x[3], s, scalex, scaley, scalez;
+    double R[3][3] = { {1.,0.,0.}, {0.,1.,0.}, {0.,0.,1.} };
+
+    scalex = scaley = scalez = 1.0;
+    f.v[0] = f.v[1] = f.v[2] = f.vMag = 0.0;
+
+    // Get the scalar and vector data
+    if ( inSScalars )
+      {
+      s = inSScalars->GetComponent(ptId, 0);
+      if ( this->ScaleMode == VTK_SCALE_BY_SCALAR ||
+           this->ScaleMode == VTK_DATA_SCALING_OFF )
+        {
+        scalex = scaley = scalez = s;
+        }
+      }
+
+    if ( array3D )
+      {
+      array3D->GetTuple(ptId, f.v);
+      f.vMag = vtkMath::Norm(f.v);
+      if ( this->ScaleMode == VTK_SCALE_BY_VECTORCOMPONENTS )
+        {
+        scalex = f.v[0];
+        scaley = f.v[1];
+        scalez = f.v[2];
+        }
+      else if ( this->ScaleMode == VTK_SCALE_BY_VECTOR )
+        {
+        scalex = scaley = scalez = f.vMag;
+        }
+//[MH-11-2012]---ADDON-BEGIN----
+	  else if ( this->ScaleMode == VTK_SCALE_X_BY_VECTOR )
+	    {
+			scalex = f.vMag; scaley = scalez = 1;
+	    }
+	  else if ( this->ScaleMode == VTK_SCALE_Y_BY_VECTOR )
+	    {
+			scaley = f.vMag; scalex = scalez = 1;
+	    }
+	  else if ( this->ScaleMode == VTK_SCALE_Z_BY_VECTOR )
+	    {
+			scalez = f.vMag; scalex = scaley = 1;
+	    }
+//[MH-11-2012]---ADDON-END----
+
+      // Rotation by 180 degrees about (v+|v|e_x)/2, i.e. x axis onto v
+      if (this->Orient && (f.vMag > 0.0))
+        {
+        // if there is no y or z component
+        if ( f.v[1] == 0.0 && f.v[2] == 0.0 )
+          {
+          if (f.v[0] < 0) //just flip x if we need to
+            {
+            R[0][0] = R[2][2] = -1.0;
+            }
+          }
+        else
+          {
+          double u[3] = { (f.v[0]+f.vMag) / 2.0, f.v[1] / 2.0, f.v[2] / 2.0 };
+          vtkMath::Normalize(u);
+          for (int r=0; r < 3; r++)
+            {
+            for (int c=0; c < 3; c++)
+              {
+              R[r][c] = 2.0*u[r]*u[c] - (r==c ? 1.0 : 0.0);
+              }
+            }
+          }
+        }
+      }
+
+    // Clamp data scale if enabled
+    if ( this->Clamping )
+      {
+      scalex = (scalex < this->Range[0] ? this->Range[0] :
+                (scalex > this->Range[1] ? this->Range[1] : scalex));
+      scalex = (scalex - this->Range[0]) / den;
+      scaley = (scaley < this->Range[0] ? this->Range[0] :
+                (scaley > this->Range[1] ? this->Range[1] : scaley));
+      scaley = (scaley - this->Range[0]) / den;
+      scalez = (scalez < this->Range[0] ? this->Range[0] :
+                (scalez > this->Range[1] ? this->Range[1] : scalez));
+      scalez = (scalez - this->Range[0]) / den;
+      }
+    f.scale = scalex; // = scaley = scalez
+
+    // scale data if appropriate
+    if ( this->Scaling )
+      {
+      if ( this->ScaleMode == VTK_DATA_SCALING_OFF )
+        {
+        scalex = scaley = scalez = this->ScaleFactor;
+        }
+      else
+        {
+        scalex *= this->ScaleFactor;
+        scaley *= this->ScaleFactor;
+        scalez *= this->ScaleFactor;
+        }
+
+      if ( scalex == 0.0 )
+        {
+        scalex = 1.0e-10;
+        }
+      if ( scaley == 0.0 )
+        {
+        scaley = 1.0e-10;
+        }
+      if ( scalez == 0.0 )
+        {
+        scalez = 1.0e-10;
+        }
+      }
+    else
+      {
+      scalex = scaley = scalez = 1.0;
+      }
+
+    // translate Source to Input point, rotate and scale
+    input->GetPoint(ptId, x);
+    f.trans.Identity();
+    f.trans.Translate(x[0], x[1], x[2]);
+    f.trans.Concatenate(R);
+    f.trans.Scale(scalex, scaley, scalez);
+
+    // normals transform by the inverse transpose, R is orthogonal
+    f.normals.Identity();
+    f.normals.Concatenate(R);
+    f.normals.Scale(1.0/scalex, 1.0/scaley, 1.0/scalez);
+    }
+
+  this->UpdateProgress(0.5);
+
+  // Allocate storage for output PolyData
+  GlyphCopyHelper::CopyTopology(source, output, numGlyphs, 1, numSourcePts);
+
+  vtkPoints *newPts = vtkPoints::New();
+  newPts->SetDataTypeToFloat();
+  newPts->SetNumberOfPoints(numOutPts);
+  float *outPts = static_cast<float*>(newPts->GetData()->GetVoidPointer(0));
+
+  vtkDataArray *newScalars = NULL;
+  vtkFloatArray *newVectors = NULL, *newNormals = NULL, *newTCoords = NULL;
+  vtkIdTypeArray *pointIds = NULL;
+  int colorMode = -1;
+  if ( this->ColorMode == VTK_COLOR_BY_SCALAR && inCScalars )
+    {
+    colorMode = VTK_COLOR_BY_SCALAR;
+    newScalars = GlyphCopyHelper::NewArrayLike(inCScalars, numOutPts);
+    }
+  else if ( (this->ColorMode == VTK_COLOR_BY_SCALE) && inSScalars )
+    {
+    colorMode = VTK_COLOR_BY_SCALE;
+    newScalars = vtkFloatArray::New();
+    newScalars->SetNumberOfTuples(numOutPts);
+    newScalars->SetName("GlyphScale");
+    if (this->ScaleMode == VTK_SCALE_BY_SCALAR)
+      {
+      newScalars->SetName(inSScalars->GetName());
+      }
+    }
+  else if ( (this->ColorMode == VTK_COLOR_BY_VECTOR) && array3D )
+    {
+    colorMode = VTK_COLOR_BY_VECTOR;
+    newScalars = vtkFloatArray::New();
+    newScalars->SetNumberOfTuples(numOutPts);
+    newScalars->SetName("VectorMagnitude");
+    }
+  if ( array3D )
+    {
+    newVectors = vtkFloatArray::New();
+    newVectors->SetNumberOfComponents(3);
+    newVectors->SetNumberOfTuples(numOutPts);
+    newVectors->SetName("GlyphVector");
+    }
+  if ( sourceNormals )
+    {
+    newNormals = vtkFloatArray::New();
+    newNormals->SetNumberOfComponents(3);
+    newNormals->SetNumberOfTuples(numOutPts);
+    newNormals->SetName("Normals");
+    }
+  std::vector<float> srcTCoords;
+  int numTCoordComps = 0;
+  if ( sourceTCoords )
+    {
+    numTCoordComps = sourceTCoords->GetNumberOfComponents();
+    newTCoords = vtkFloatArray::New();
+    newTCoords->SetNumberOfComponents(numTCoordComps);
+    newTCoords->SetNumberOfTuples(numOutPts);
+    newTCoords->SetName("TCoords");
+
+    srcTCoords.resize(numTCoordComps*numSourcePts);
+    for (i=0; i < numSourcePts; i++)
+      {
+      for (k=0; k < numTCoordComps; k++)
+        {
+        srcTCoords[i*numTCoordComps+k] =
+          static_cast<float>(sourceTCoords->GetComponent(i, k));
+        }
+      }
+    }
+  if ( this->GeneratePointIds )
+    {
+    pointIds = vtkIdTypeArray::New();
+    pointIds->SetName(this->PointIdsName);
+    pointIds->SetNumberOfValues(numOutPts);
+    outputPD->AddArray(pointIds);
+    pointIds->Delete();
+    }
+
+  // Input point data copied to glyph points (and cells), vectors, normals
+  // and texture coordinates are replaced by the glyph's own as in the
+  // CopyAllocate() setup of RequestData()
+  std::vector<vtkDataArray*> inArrays, outArrays, inCellArrays, outCellArrays;
+  for (k=0; k < pd->GetNumberOfArrays(); k++)
+    {
+    vtkDataArray *in = pd->GetArray(k);
+    int attribute = pd->IsArrayAnAttribute(k);
+    if ( attribute == vtkDataSetAttributes::GLOBALIDS )
+      {
+      continue;
+      }
+    if ( attribute != vtkDataSetAttributes::VECTORS &&
+         attribute != vtkDataSetAttributes::NORMALS &&
+         attribute != vtkDataSetAttributes::TCOORDS )
+      {
+      vtkDataArray *out = GlyphCopyHelper::NewArrayLike(in, numOutPts);
+      if ( attribute >= 0 )
+        {
+        outputPD->SetAttribute(out, attribute);
+        }
+      else
+        {
+        outputPD->AddArray(out);
+        }
+      inArrays.push_back(in);
+      outArrays.push_back(out);
+      out->Delete();
+      }
+    if ( this->FillCellData )
+      {
+      vtkDataArray *out = GlyphCopyHelper::NewArrayLike(in, numGlyphs*numSourceCells);
+      if ( attribute >= 0 )
+        {
+        outputCD->SetAttribute(out, attribute);
+        }
+      else
+        {
+        outputCD->AddArray(out);
+        }
+      inCellArrays.push_back(in);
+      outCellArrays.push_back(out);
+      out->Delete();
+      }
+    }
+
+  // Pass 2: Copy and transform glyphs into preallocated arrays
+  float *outNormals = newNormals ? newNormals->GetPointer(0) : NULL;
+  float *outVectors = newVectors ? newVectors->GetPointer(0) : NULL;
+  float *outTCoords = newTCoords ? newTCoords->GetPointer(0) : NULL;
+  vtkIdType *outIds = pointIds ? pointIds->GetPointer(0) : NULL;
+  int numArrays = static_cast<int>(inArrays.size());
+  int numCellArrays = static_cast<int>(outCellArrays.size());
+
+  #pragma omp parallel for schedule(static)
+  for (int g=0; g < (int)numGlyphs; g++)
+    {
+    const GlyphFrame &f = frames[g];
+    vtkIdType ptId = glyphPts[g];
+    vtkIdType ptIncr = g*numSourcePts;
+    vtkIdType j;
+
+    GlyphCopyHelper::TransformPoints(f.trans, srcP, numSourcePts,
+                                     outPts + 3*ptIncr);
+    if ( outNormals )
+      {
+      GlyphCopyHelper::TransformNormals(f.normals.A, srcN, numSourcePts,
+                                        outNormals + 3*ptIncr);
+      }
+
+    for (j=0; j < numSourcePts; j++)
+      {
+      if ( outVectors )
+        {
+        outVectors[3*(ptIncr+j)  ] = static_cast<float>(f.v[0]);
+        outVectors[3*(ptIncr+j)+1] = static_cast<float>(f.v[1]);
+        outVectors[3*(ptIncr+j)+2] = static_cast<float>(f.v[2]);
+        }
+      if ( outIds )
+        {
+        outIds[ptIncr+j] = ptId;
+        }
+      }
+    if ( outTCoords && numSourcePts > 0 )
+      {
+      memcpy(outTCoords + numTCoordComps*ptIncr, &srcTCoords[0],
+             numTCoordComps*numSourcePts*sizeof(float));
+      }
+
+    // Copy scalar value
+    if ( colorMode == VTK_COLOR_BY_SCALAR )
+      {
+      GlyphCopyHelper::ReplicateTuple(inCScalars, ptId, newScalars, ptIncr,
+                                      numSourcePts);
+      }
+    else if ( colorMode >= 0 )
+      {
+      float s = static_cast<float>(colorMode == VTK_COLOR_BY_SCALE ?
+                                   f.scale : f.vMag);
+      float *outScalars = static_cast<float*>(newScalars->GetVoidPointer(0));
+      for (j=0; j < numSourcePts; j++)
+        {
+        outScalars[ptIncr+j] = s;
+        }
+      }
+
+    // Copy point data from input
+    for (int a=0; a < numArrays; a++)
+      {
+      GlyphCopyHelper::ReplicateTuple(inArrays[a], ptId, outArrays[a], ptIncr,
+                                      numSourcePts);
+      }
+    for (int a=0; a < numCellArrays; a++)
+      {
+      GlyphCopyHelper::ReplicateTuple(inCellArrays[a], ptId, outCellArrays[a],
+                                      g*numSourceCells, numSourceCells);
+      }
+    }
+
+  // Update ourselves and release memory
+  //
+  output->SetPoints(newPts);
+  newPts->Delete();
+
+  if (newScalars)
+    {
+    int idx = outputPD->AddArray(newScalars);
+    outputPD->SetActiveAttribute(idx, vtkDataSetAttributes::SCALARS);
+    newScalars->Delete();
+    }
+
+  if (newVectors)
+    {
+    outputPD->SetVectors(newVectors);
+    newVectors->Delete();
+    }
+
+  if (newNormals)
+    {
+    outputPD->SetNormals(newNormals);
+    newNormals->Delete();
+    }
+
+  if (newTCoords)
+    {
+    outputPD->SetTCoords(newTCoords);
+    newTCoords->Delete();
+    }
+
+  return 1;
+}
+
 //----------------------------------------------------------------------------
 // Specify a source object at a specified table location.
 void vtkGlyph3D_3::SetSourceConnection(int id, vtkAlgorithmOutput* algOutput)
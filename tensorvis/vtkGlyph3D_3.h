@@ -97,6 +97,7 @@
 #define VTK_INDEXING_BY_SCALAR 1
 #define VTK_INDEXING_BY_VECTOR 2
 
+class vtkDataArray;
 class vtkTransform;
 
 class /*VTK_GRAPHICS_EXPORT*/ vtkGlyph3D_3 : public vtkPolyDataAlgorithm
@@ -260,6 +261,14 @@ protected:
   virtual int RequestUpdateExtent(vtkInformation *, vtkInformationVector **, vtkInformationVector *);
   virtual int FillInputPortInformation(int, vtkInformation *);
 
+  // Description:
+  // Multi-threaded RequestData() for a single source (IndexMode off), used
+  // by RequestData() if all input point data can be copied tuple-wise.
+  int RequestDataParallel(vtkDataSet *input, vtkPolyData *source,
+                          vtkPolyData *output, vtkDataArray *inSScalars,
+                          vtkDataArray *inCScalars, vtkDataArray *array3D,
+                          unsigned char *inGhostLevels, int requestedGhostLevel);
+
   vtkPolyData* GetSource(int idx, vtkInformationVector *sourceInfo);
 
   vtkPolyData **Source; // Geometry to copy to each point
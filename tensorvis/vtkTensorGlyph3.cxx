@@ -14,7 +14,6 @@
 =========================================================================*/
 #include "vtkTensorGlyph3.h"
 
-#include "vtkCell.h"
 #include "vtkCellArray.h"
 #include "vtkFloatArray.h"
 #include "vtkMath.h"
@@ -24,7 +23,10 @@
 #include "vtkPointData.h"
 #include "vtkPolyData.h"
 #include "vtkStreamingDemandDrivenPipeline.h"
-#include "vtkTransform.h"
+#include "GlyphCopyHelper.h"
+
+#include <vector>
+#include <iostream>
 
 vtkStandardNewMacro(vtkTensorGlyph3);
 
@@ -47,12 +49,40 @@ vtkTensorGlyph3::~vtkTensorGlyph3()
 {
 }
 
+namespace
+{
+  // Per input point result of the first pass in vtkTensorGlyph3::RequestData()
+  struct TensorFrame
+  {
+    double x[3];          // glyph center
+    double R[3][3];       // normalized eigenvectors as columns
+    double w[3];          // geometric scale factors
+    double w_original[3]; // eigenvalues without ScaleFactor for color coding
+    double s;             // scalar or fractional anisotropy for color coding
+    double alpha, beta;   // superquadric roundness
+  };
+
+  // Rotations of the glyph for eigen directions 1 and 2, i.e. RotateZ(90)
+  // and RotateY(-90)
+  const double c_rotEigenDir[2][3][3] = {
+    { { 0.,-1., 0. }, { 1., 0., 0. }, { 0., 0., 1. } },
+    { { 0., 0.,-1. }, { 0., 1., 0. }, { 1., 0., 0. } }
+  };
+}
+
 //----------------------------------------------------------------------------
 // Don't rely on the implementation of this->Superclass::RequestData as that
 // has, at point of writing, some known issues. See issues 1 and 2 at
 // http://public.kitware.com/Bug/view.php?id=12179
+//
+// The glyphs are generated in passes over the input points which write into
+// preallocated output arrays instead of growing them per glyph:
+// 1. (parallel) eigen decomposition, scale factors and color value per point,
+// 2. (serial) superquadric geometry per point if enabled,
+// 3. (parallel) transformation of points and normals and fill of scalars.
+// Topology is copied up front, since it does not depend on the tensors.
 int vtkTensorGlyph3::RequestData(
-  vtkInformation *request,
+  vtkInformation *vtkNotUsed(request),
   vtkInformationVector **inputVector,
   vtkInformationVector *outputVector)
 {
@@ -69,51 +99,23 @@ int vtkTensorGlyph3::RequestData(
   vtkPolyData *output = vtkPolyData::SafeDownCast(
     outInfo->Get(vtkDataObject::DATA_OBJECT()));
 
-  vtkDataArray *inTensors;
-  double tensor[9];
-  vtkDataArray *inScalars;
-  vtkIdType numPts, numSourcePts, numSourceCells, inPtId, i;
-  int j;
-  vtkPoints *sourcePts;
-  vtkDataArray *sourceNormals;
-  vtkCellArray *sourceCells, *cells;
-  vtkPoints *newPts;
+  vtkDataArray *inTensors, *inScalars, *inVectors;
+  vtkIdType numPts, numSourcePts, numOutPts, j;
+  vtkPoints *sourcePts, *newPts;
+  vtkDataArray *sourceNormals, *sourceScalars=NULL;
   vtkFloatArray *newScalars=NULL;
   vtkFloatArray *newNormals=NULL;
-  double x[3], s;
-  vtkTransform *trans;
-  vtkCell *cell;
-  vtkIdList *cellPts;
-  int npts;
-  vtkIdType *pts;
-  vtkIdType ptIncr, cellId;
-  vtkIdType subIncr;
-  int numDirs, dir, eigen_dir, symmetric_dir;
-  vtkMatrix4x4 *matrix;
-  double *m[3], w[3], *v[3];
-  double m0[3], m1[3], m2[3];
-  double v0[3], v1[3], v2[3];
-  double xv[3], yv[3], zv[3];
-  double maxScale;
-  vtkPointData *pd, *outPD;
+  vtkDataArray *newSourceScalars=NULL;
+  vtkPointData *outPD;
+  int numDirs, colorMode;
 
   numDirs = (this->ThreeGlyphs?3:1)*(this->Symmetric+1);
 
-  pts = new vtkIdType[source->GetMaxCellSize()];
-  trans = vtkTransform::New();
-  matrix = vtkMatrix4x4::New();
-
-  // set up working matrices
-  m[0] = m0; m[1] = m1; m[2] = m2;
-  v[0] = v0; v[1] = v1; v[2] = v2;
-
   vtkDebugMacro(<<"Generating tensor glyphs");
 
-  pd = input->GetPointData();
   outPD = output->GetPointData();
   inTensors = this->GetInputArrayToProcess(0, inputVector);
   inScalars = this->GetInputArrayToProcess(1, inputVector);
-  vtkDataArray *inVectors;
   inVectors = this->GetInputArrayToProcess(2, inputVector);
   numPts = input->GetNumberOfPoints();
 
@@ -129,7 +131,7 @@ int vtkTensorGlyph3::RequestData(
   // Special case of superquadric tensor glyphs
   //
   // We assume that the topology does not change. The particular superquadric
-  // is adjusted later according to the eigenvalues computed in the main loop.
+  // is adjusted later according to the eigenvalues computed in the first pass.
   bool doSuperquadrics = false;
   vtkSuperquadricSource* sqSource = NULL;
   if( m_superquadricSource.GetPointer() )
@@ -144,54 +146,30 @@ int vtkTensorGlyph3::RequestData(
 
   //
   // Allocate storage for output PolyData
-  //  
+  //
   sourcePts = source->GetPoints();
   numSourcePts = sourcePts->GetNumberOfPoints();
-  numSourceCells = source->GetNumberOfCells();
+  numOutPts = numDirs*numPts*numSourcePts;
 
   newPts = vtkPoints::New();
-  newPts->Allocate(numDirs*numPts*numSourcePts);
-
-  // Setting up for calls to PolyData::InsertNextCell()
-  if ( (sourceCells=source->GetVerts())->GetNumberOfCells() > 0 )
-    {
-    cells = vtkCellArray::New();
-    cells->Allocate(numDirs*numPts*sourceCells->GetSize());
-    output->SetVerts(cells);
-    cells->Delete();
-    }
-  if ( (sourceCells=this->GetSource()->GetLines())->GetNumberOfCells() > 0 )
-    {
-    cells = vtkCellArray::New();
-    cells->Allocate(numDirs*numPts*sourceCells->GetSize());
-    output->SetLines(cells);
-    cells->Delete();
-    }
-  if ( (sourceCells=this->GetSource()->GetPolys())->GetNumberOfCells() > 0 )
-    {
-    cells = vtkCellArray::New();
-    cells->Allocate(numDirs*numPts*sourceCells->GetSize());
-    output->SetPolys(cells);
-    cells->Delete();
-    }
-  if ( (sourceCells=this->GetSource()->GetStrips())->GetNumberOfCells() > 0 )
-    {
-    cells = vtkCellArray::New();
-    cells->Allocate(numDirs*numPts*sourceCells->GetSize());
-    output->SetStrips(cells);
-    cells->Delete();
-    }
-
-  // only copy scalar data through
-  pd = this->GetSource()->GetPointData();
-  // generate scalars if eigenvalues are chosen or if scalars exist.
+  newPts->SetDataTypeToFloat();
+  newPts->SetNumberOfPoints(numOutPts);
+  float *outPts = static_cast<float*>(newPts->GetData()->GetVoidPointer(0));
+  float *outNormals = NULL;
+  float *outScalars = NULL;
+
+  // generate scalars if eigenvalues are chosen or if scalars exist,
+  // otherwise only copy scalar data of the source through
+  colorMode = -1;
   if (this->ColorGlyphs &&
       ((this->ColorMode == COLOR_BY_EIGENVALUES) ||
 	   (this->ColorMode == COLOR_BY_FRACTIONAL_ANISOTROPY) ||
        (inScalars && (this->ColorMode == COLOR_BY_SCALARS)) ) )
     {
+    colorMode = this->ColorMode;
     newScalars = vtkFloatArray::New();
-    newScalars->Allocate(numDirs*numPts*numSourcePts);
+    newScalars->SetNumberOfTuples(numOutPts);
+    outScalars = newScalars->GetPointer(0);
     if (this->ColorMode == COLOR_BY_EIGENVALUES)
       {
       newScalars->SetName("MaxEigenvalue");
@@ -205,64 +183,74 @@ int vtkTensorGlyph3::RequestData(
       newScalars->SetName(inScalars->GetName());
       }
     }
-  else
+  else if ( (sourceScalars = source->GetPointData()->GetScalars()) )
     {
-    outPD->CopyAllOff();
-    outPD->CopyScalarsOn();
-    outPD->CopyAllocate(pd,numDirs*numPts*numSourcePts);
+    newSourceScalars = GlyphCopyHelper::NewArrayLike(sourceScalars, numOutPts);
     }
-  if ( (sourceNormals = pd->GetNormals()) )
+  if ( (sourceNormals = source->GetPointData()->GetNormals()) )
     {
     newNormals = vtkFloatArray::New();
     newNormals->SetNumberOfComponents(3);
     newNormals->SetName("Normals");
-    newNormals->Allocate(numDirs*3*numPts*numSourcePts);
+    newNormals->SetNumberOfTuples(numOutPts);
+    outNormals = newNormals->GetPointer(0);
     }
-  //
-  // First copy all topology (transformation independent)
-  //
-  for (inPtId=0; inPtId < numPts; inPtId++)
+
+  // Source geometry in double precision, shared by all glyphs
+  std::vector<double> srcPts(3*numSourcePts), srcNormals;
+  for (j=0; j < numSourcePts; j++)
     {
-    ptIncr = numDirs * inPtId * numSourcePts;
-    for (cellId=0; cellId < numSourceCells; cellId++)
+    sourcePts->GetPoint(j, &srcPts[3*j]);
+    }
+  if ( newNormals )
+    {
+    srcNormals.resize(3*numSourcePts);
+    for (j=0; j < numSourcePts; j++)
       {
-      cell = this->GetSource()->GetCell(cellId);
-      cellPts = cell->GetPointIds();
-      npts = cellPts->GetNumberOfIds();
-      for (dir=0; dir < numDirs; dir++)
-        {
-        // This variable may be removed, but that
-        // will not improve readability
-        subIncr = ptIncr + dir*numSourcePts;
-        for (i=0; i < npts; i++)
-          {
-          pts[i] = cellPts->GetId(i) + subIncr;
-          }
-        output->InsertNextCell(cell->GetCellType(),npts,pts);
-        }
+      sourceNormals->GetTuple(j, &srcNormals[3*j]);
       }
     }
+  const double *srcP = srcPts.empty() ? NULL : &srcPts[0];
+  const double *srcN = srcNormals.empty() ? NULL : &srcNormals[0];
+
   //
-  // Traverse all Input points, transforming glyph at Source points
+  // First copy all topology (transformation independent)
   //
-  trans->PreMultiply();
+  GlyphCopyHelper::CopyTopology(source, output, numPts, numDirs, numSourcePts);
 
-  for (inPtId=0; inPtId < numPts; inPtId++)
+  //
+  // Pass 1: Compute orientation, scale factors and color per input point
+  //
+  std::vector<TensorFrame> frames(numPts);
+  double x0[3];
+  input->GetPoint(0, x0); // GetPoint() is thread safe once called serially
+
+
+  #pragma omp parallel for schedule(static)
+  for (int ptId=0; ptId < (int)numPts; ptId++)
     {
-    ptIncr = numDirs * inPtId * numSourcePts;
+    TensorFrame &f = frames[ptId];
+    double tensor[9], *m[3], w[3], *v[3];
+    double m0[3], m1[3], m2[3];
+    double v0[3], v1[3], v2[3];
+    double xv[3], yv[3], zv[3];
+    double maxScale;
+    int i;
 
-    // Translation is postponed
+    // set up working matrices
+    m[0] = m0; m[1] = m1; m[2] = m2;
+    v[0] = v0; v[1] = v1; v[2] = v2;
 
-    inTensors->GetTuple(inPtId, tensor);
+    inTensors->GetTuple(ptId, tensor);
 
     // compute orientation vectors and scale factors from tensor
     if ( this->ExtractEigenvalues ) // extract appropriate eigenfunctions
       {
-      for (j=0; j<3; j++)
+      for (int k=0; k<3; k++)
         {
         for (i=0; i<3; i++)
           {
-          m[i][j] = tensor[i+3*j];
+          m[i][k] = tensor[i+3*k];
           }
         }
       vtkMath::Jacobi(m, w, v);
@@ -285,8 +273,16 @@ int vtkTensorGlyph3::RequestData(
       w[2] = vtkMath::Normalize(zv);
       }
 
+    // normalized eigenvectors rotate object for eigen direction 0
+    for (i=0; i<3; i++)
+      {
+      f.R[i][0] = xv[i];
+      f.R[i][1] = yv[i];
+      f.R[i][2] = zv[i];
+      }
+
 //[MH-08-2013]---ADDON-BEGIN----
-	// Do the superquadric glyps!
+	// Superquadric parameters, the geometry itself is generated in pass 2
 	if( doSuperquadrics )
 	{
 	  // Compute barycentric coordinates from eigenvalues c_(linear/planar/sperical)
@@ -294,45 +290,20 @@ int vtkTensorGlyph3::RequestData(
 		     cp = 2.*(w[1]-w[2]) / (w[0]+w[1]+w[2]);
 
 	  // Modulate superquadric parameters according to cl and cp
-	  double alpha, beta;
 	  if( cl >= cp )
 	  {
 		  // Linear case
-		  alpha = pow(1. - cp, SuperquadricGamma);
-		  beta  = pow(1. - cl, SuperquadricGamma);
+		  f.alpha = pow(1. - cp, SuperquadricGamma);
+		  f.beta  = pow(1. - cl, SuperquadricGamma);
 		  // TODO: Use parameterization along x
 	  }
 	  else
 	  {
 		  // Planar or spherical case
-		  alpha = pow(1. - cl, SuperquadricGamma);
-		  beta  = pow(1. - cp, SuperquadricGamma);
+		  f.alpha = pow(1. - cl, SuperquadricGamma);
+		  f.beta  = pow(1. - cp, SuperquadricGamma);
 		  // TODO: Use parameterization along x
 	  }
-
-	  // Re-compute superquadric PolyData
-      sqSource->SetPhiRoundness  ( alpha );
-      sqSource->SetThetaRoundness( beta );
-	  sqSource->Update();
-
-	  // Exchange source points
-	  if( sourcePts->GetNumberOfPoints() == sqSource->GetOutput()->GetPoints()->GetNumberOfPoints() )
-	  {
-		sourcePts->DeepCopy( sqSource->GetOutput()->GetPoints() );		
-
-		if( sqSource->GetOutput()->GetPointData()->GetNormals() )
-		{
-		  sourceNormals->DeepCopy( sqSource->GetOutput()->GetPointData()->GetNormals() );
-		}
-		else
-		  std::cout << "Warning: Normals mismatch in superquadric glyph!\n";
-	  }
-	  else
-	  {
-		std::cout << "Warning: Mismatch in superquadric glyph point count!\n";
-	  }
-	  //sourcePts = m_superquadricSource->GetOutput()->GetPoints();
-		// sourcePts = source->GetPoints();
 	}
 //[MH-08-2013]---ADDON-END----
 
@@ -341,7 +312,7 @@ int vtkTensorGlyph3::RequestData(
 	// them out to scalar data, e.g. for color-coding this leads to a correctly
 	// scaled lookup table without the arbitrary scaling factor (which should
 	// only increase visibility of the glyphs in a particular visualization)
-	double w_original[3];
+	double *w_original = f.w_original;
 	w_original[0] = w[0];
 	w_original[1] = w[1];
 	w_original[2] = w[2];
@@ -393,8 +364,6 @@ int vtkTensorGlyph3::RequestData(
         }
       }
 
-    // normalization is postponed
-
     // make sure scale is okay (non-zero) and scale data
     for (maxScale=0.0, i=0; i<3; i++)
       {
@@ -413,173 +382,210 @@ int vtkTensorGlyph3::RequestData(
         {
         w[i] = maxScale * 1.0e-06;
         }
+      f.w[i] = w[i];
       }
 
-    // Now do the real work for each "direction"
+    // translate Source to Input point
+    input->GetPoint(ptId, f.x);
+
+//[MH-11-2012]---ADDON-BEGIN----
+	// translate by additional vector data given
+	if( VectorDisplacement && inVectors  )
+	{
+	  double tv[3] = { 0., 0., 0. };
+	  inVectors->GetTuple(ptId, tv);
+	  double tvscale = VectorDisplacementFactor; //1e7;
+	  f.x[0] += tvscale*tv[0];
+	  f.x[1] += tvscale*tv[1];
+	  f.x[2] += tvscale*tv[2];
+	}
+//[MH-11-2012]---ADDON-END----
 
-    for (dir=0; dir < numDirs; dir++)
+    // color value shared by all directions
+    if ( colorMode == COLOR_BY_SCALARS )
+      {
+//[MH-03-2013]---CHANGE-BEGIN----
+		// Remove user scale factor
+        f.s = inScalars->GetComponent(ptId, 0) / this->ScaleFactor;
+		// was:
+		// s = inScalars->GetComponent(inPtId, 0);
+//[MH-03-2013]---CHANGE-END------
+      }
+//[MH-07-2013]---CHANGE-BEGIN----
+    else if ( colorMode == COLOR_BY_FRACTIONAL_ANISOTROPY )
       {
-      eigen_dir = dir%(this->ThreeGlyphs?3:1);
-      symmetric_dir = dir/(this->ThreeGlyphs?3:1);
+			double mu = (w_original[0]+w_original[1]+w_original[2]) / 3.;
+			f.s = sqrt(3./2.) * 
+				sqrt( (w_original[0]-mu)*(w_original[0]-mu) +
+					  (w_original[1]-mu)*(w_original[1]-mu) +
+					  (w_original[2]-mu)*(w_original[2]-mu)	) 
+				/
+				sqrt( w_original[0]*w_original[0] +
+				      w_original[1]*w_original[1] +
+				      w_original[2]*w_original[2] );
+      }
+//[MH-07-2013]---CHANGE-END------
+    }
 
-      // Remove previous scales ...
-      trans->Identity();
+//[MH-08-2013]---ADDON-BEGIN----
+  //
+  // Pass 2: Superquadric geometry per input point
+  //
+  // vtkSuperquadricSource is a pipeline object and therefore updated
+  // serially. The untransformed glyph is written to the output slot of the
+  // first direction and transformed in place in pass 3.
+  if( doSuperquadrics )
+  {
+	bool warned = false;
+	for( vtkIdType ptId=0; ptId < numPts; ptId++ )
+	{
+	  vtkIdType ofs = ptId*numDirs*numSourcePts;
 
-	  ///*==*
-	  //double mu[3];
-	  //pd->GetVectors()->GetTuple( inPtId, mu );
+	  // Re-compute superquadric PolyData
+	  sqSource->SetPhiRoundness  ( frames[ptId].alpha );
+	  sqSource->SetThetaRoundness( frames[ptId].beta );
+	  sqSource->Update();
 
-      // translate Source to Input point
-      input->GetPoint(inPtId, x);
-      trans->Translate(x[0], x[1], x[2]);
+	  vtkPoints*    sqPts     = sqSource->GetOutput()->GetPoints();
+	  vtkDataArray* sqNormals = sqSource->GetOutput()->GetPointData()->GetNormals();
+	  bool match = sqPts && sqPts->GetNumberOfPoints() == numSourcePts;
+	  if( !match && !warned )
+	  {
+		std::cout << "Warning: Mismatch in superquadric glyph point count!\n";
+		warned = true;
+	  }
+	  if( match && newNormals && !sqNormals && !warned )
+	  {
+		std::cout << "Warning: Normals mismatch in superquadric glyph!\n";
+		warned = true;
+	  }
 
-//[MH-11-2012]---ADDON-BEGIN----
-	  // translate by additional vector data given
-	  if( VectorDisplacement && inVectors  )
+	  // Exchange source points (fall back to source glyph on mismatch)
+	  for( j=0; j < numSourcePts; j++ )
 	  {
-		double* tv = inVectors->GetTuple3(inPtId);
-		double tvscale = VectorDisplacementFactor; //1e7;
-		trans->Translate( tvscale*tv[0], tvscale*tv[1], tvscale*tv[2] );
+		double p[3], n[3];
+		if( match ) sqPts->GetPoint( j, p );
+		else { p[0]=srcPts[3*j]; p[1]=srcPts[3*j+1]; p[2]=srcPts[3*j+2]; }
+		for( int d=0; d < 3; d++ )
+		  outPts[3*(ofs+j)+d] = (float)p[d];
+
+		if( !newNormals )
+		  continue;
+		if( match && sqNormals ) sqNormals->GetTuple( j, n );
+		else { n[0]=srcNormals[3*j]; n[1]=srcNormals[3*j+1]; n[2]=srcNormals[3*j+2]; }
+		for( int d=0; d < 3; d++ )
+		  outNormals[3*(ofs+j)+d] = (float)n[d];
 	  }
-//[MH-11-2012]---ADDON-END----
+	}
+	sqSource->Delete();
+  }
+//[MH-08-2013]---ADDON-END----
 
-      // normalized eigenvectors rotate object for eigen direction 0
-      matrix->Element[0][0] = xv[0];
-      matrix->Element[0][1] = yv[0];
-      matrix->Element[0][2] = zv[0];
-      matrix->Element[1][0] = xv[1];
-      matrix->Element[1][1] = yv[1];
-      matrix->Element[1][2] = zv[1];
-      matrix->Element[2][0] = xv[2];
-      matrix->Element[2][1] = yv[2];
-      matrix->Element[2][2] = zv[2];
-      trans->Concatenate(matrix);
-
-      if (eigen_dir == 1)
-        {
-        trans->RotateZ(90.0);
-        }
+  //
+  // Pass 3: Transform glyph for each input point and "direction"
+  //
+
+  #pragma omp parallel for schedule(static)
+  for (int ptId=0; ptId < (int)numPts; ptId++)
+    {
+    const TensorFrame &f = frames[ptId];
+    vtkIdType ptIncr = (vtkIdType)ptId * numDirs * numSourcePts;
+
+    // Superquadric glyph of this point is stored in the slot of direction 0,
+    // which is therefore transformed last.
+    for (int dir=numDirs-1; dir >= 0; dir--)
+      {
+      int eigen_dir = dir%(this->ThreeGlyphs?3:1);
+      int symmetric_dir = dir/(this->ThreeGlyphs?3:1);
+      vtkIdType ofs = ptIncr + dir*numSourcePts;
 
-      if (eigen_dir == 2)
+      GlyphCopyHelper::Affine trans;
+      trans.Identity();
+      trans.Translate(f.x[0], f.x[1], f.x[2]);
+      trans.Concatenate(f.R);
+
+      if (eigen_dir > 0)
         {
-        trans->RotateY(-90.0);
+        trans.Concatenate(c_rotEigenDir[eigen_dir-1]);
         }
 
       if (this->ThreeGlyphs)
         {
-        trans->Scale(w[eigen_dir], this->ScaleFactor, this->ScaleFactor);
+        trans.Scale(f.w[eigen_dir], this->ScaleFactor, this->ScaleFactor);
         }
       else
         {
-        trans->Scale(w[0], w[1], w[2]);
+        trans.Scale(f.w[0], f.w[1], f.w[2]);
         }
 
       // Mirror second set to the symmetric position
       if (symmetric_dir == 1)
         {
-        trans->Scale(-1.,1.,1.);
+        trans.Scale(-1.,1.,1.);
         }
 
       // if the eigenvalue is negative, shift to reverse direction.
       // The && is there to ensure that we do not change the
       // old behaviour of vtkTensorGlyphs (which only used one dir),
       // in case there is an oriented glyph, e.g. an arrow.
-      if (w[eigen_dir] < 0 && numDirs > 1)
+      if (f.w[eigen_dir] < 0 && numDirs > 1)
         {
-        trans->Translate(-this->Length, 0., 0.);
+        trans.Translate(-this->Length, 0., 0.);
         }
 
-      // multiply points (and normals if available) by resulting
-      // matrix
-      trans->TransformPoints(sourcePts,newPts);
-
-      // Apply the transformation to a series of points,
-      // and append the results to outPts.
-      if ( newNormals )
+      // multiply points (and normals if available) by resulting matrix
+      if (doSuperquadrics)
         {
-        // a negative determinant means the transform turns the
-        // glyph surface inside out, and its surface normals all
-        // point inward. The following scale corrects the surface
-        // normals to point outward.
-        if (trans->GetMatrix()->Determinant() < 0)
-          {
-          trans->Scale(-1.0,-1.0,-1.0);
-          }
-        trans->TransformNormals(sourceNormals,newNormals);
+        GlyphCopyHelper::TransformPoints(trans, outPts + 3*ptIncr,
+                                         numSourcePts, outPts + 3*ofs);
+        }
+      else
+        {
+        GlyphCopyHelper::TransformPoints(trans, srcP, numSourcePts,
+                                         outPts + 3*ofs);
         }
 
-        // Copy point data from source
-      if ( this->ColorGlyphs && inScalars &&
-           (this->ColorMode == COLOR_BY_SCALARS) )
+      if ( outNormals )
         {
-//[MH-03-2013]---CHANGE-BEGIN----
-		// Remove user scale factor
-        s = inScalars->GetComponent(inPtId, 0) / this->ScaleFactor;
-		// was:
-		// s = inScalars->GetComponent(inPtId, 0);
-//[MH-03-2013]---CHANGE-END------
-        for (i=0; i < numSourcePts; i++)
+        // The cofactor matrix also corrects the surface normals to point
+        // outward if a negative determinant turns the glyph inside out.
+        double N[3][3];
+        trans.Cofactor(N);
+        if (doSuperquadrics)
           {
-          newScalars->InsertTuple(ptIncr+i, &s);
+          GlyphCopyHelper::TransformNormals(N, outNormals + 3*ptIncr,
+                                            numSourcePts, outNormals + 3*ofs);
           }
-        }
-      else if (this->ColorGlyphs &&
-               (this->ColorMode == COLOR_BY_EIGENVALUES) )
-        {
-        // If ThreeGlyphs is false we use the first (largest)
-        // eigenvalue as scalar.
-//[MH-03-2013]---CHANGE-BEGIN----
-		// Remove user scale factor
-		 s = w_original[eigen_dir];
-		// was:
-		// s = w[eigen_dir];
-//[MH-03-2013]---CHANGE-END------
-        for (i=0; i < numSourcePts; i++)
+        else
           {
-          newScalars->InsertTuple(ptIncr+i, &s);
+          GlyphCopyHelper::TransformNormals(N, srcN, numSourcePts,
+                                            outNormals + 3*ofs);
           }
         }
-//[MH-07-2013]---CHANGE-BEGIN----
-      else if (this->ColorGlyphs &&
-               (this->ColorMode == COLOR_BY_FRACTIONAL_ANISOTROPY) )
-        {
-
-			double mu = (w_original[0]+w_original[1]+w_original[2]) / 3.;
-			double FA = sqrt(3./2.) * 
-				sqrt( (w_original[0]-mu)*(w_original[0]-mu) +
-					  (w_original[1]-mu)*(w_original[1]-mu) +
-					  (w_original[2]-mu)*(w_original[2]-mu)	) 
-				/
-				sqrt( w_original[0]*w_original[0] +
-				      w_original[1]*w_original[1] +
-				      w_original[2]*w_original[2] );
-
-			s = FA;
 
-        for (i=0; i < numSourcePts; i++)
+      // Copy point data from source
+      if ( outScalars )
+        {
+        // If ThreeGlyphs is false we use the first (largest)
+        // eigenvalue as scalar.
+        float s = (float)((colorMode == COLOR_BY_EIGENVALUES) ?
+                          f.w_original[eigen_dir] : f.s);
+        for (vtkIdType k=0; k < numSourcePts; k++)
           {
-          newScalars->InsertTuple(ptIncr+i, &s);
+          outScalars[ofs+k] = s;
           }
         }
-//[MH-07-2013]---CHANGE-END------
-      else
+      else if ( newSourceScalars )
         {
-        for (i=0; i < numSourcePts; i++)
-          {
-          outPD->CopyData(pd,i,ptIncr+i);
-          }
+        GlyphCopyHelper::CopyTuples(sourceScalars, newSourceScalars, ofs,
+                                    numSourcePts);
         }
-      ptIncr += numSourcePts;
       }
     }
   vtkDebugMacro(<<"Generated " << numPts <<" tensor glyphs");
   //
   // Update output and release memory
   //
-  delete [] pts;
-
-  if( sqSource ) sqSource->Delete();
-
   output->SetPoints(newPts);
   newPts->Delete();
 
@@ -590,16 +596,18 @@ int vtkTensorGlyph3::RequestData(
     newScalars->Delete();
     }
 
+  if ( newSourceScalars )
+    {
+    outPD->SetScalars(newSourceScalars);
+    newSourceScalars->Delete();
+    }
+
   if ( newNormals )
     {
     outPD->SetNormals(newNormals);
     newNormals->Delete();
     }
 
-  output->Squeeze();
-  trans->Delete();
-  matrix->Delete();
-
   return 1;
 }
 
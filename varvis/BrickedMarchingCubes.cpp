@@ -0,0 +1,493 @@
+#include "BrickedMarchingCubes.h"
+
+#include "vtkObjectFactory.h"
+#include "vtkStreamingDemandDrivenPipeline.h"
+#include "vtkInformationVector.h"
+#include "vtkInformation.h"
+#include "vtkImageData.h"
+#include "vtkPolyData.h"
+#include "vtkPointData.h"
+#include "vtkDataArray.h"
+#include "vtkFloatArray.h"
+#include "vtkIdTypeArray.h"
+#include "vtkCellArray.h"
+#include "vtkPoints.h"
+#include "vtkMarchingCubesCases.h"
+#include "vtkMath.h"
+#include <vector>
+#include <algorithm>
+#include <utility>
+
+vtkStandardNewMacro(BrickedMarchingCubes);
+
+//----------------------------------------------------------------------------
+//  Brick extraction
+//----------------------------------------------------------------------------
+namespace {
+
+// Cube corners and edges in the numbering of vtkMarchingCubesTriangleCases
+const int c_corner[8][3] = { {0,0,0}, {1,0,0}, {1,1,0}, {0,1,0},
+                             {0,0,1}, {1,0,1}, {1,1,1}, {0,1,1} };
+const int c_edge[12][2]  = { {0,1}, {1,2}, {3,2}, {0,3},
+                             {4,5}, {5,6}, {7,6}, {4,7},
+                             {0,4}, {1,5}, {3,7}, {2,6} };
+const int c_edgeAxis[12] = { 0, 1, 0, 1, 0, 1, 0, 1, 2, 2, 2, 2 };
+
+/// Image geometry shared by all bricks
+struct MCGrid
+{
+  int       dims[3];
+  vtkIdType sliceSize;
+  double    origin[3];  // world position of first point of extent
+  double    spacing[3];
+  int       brickSize;
+};
+
+/// Triangle soup of a brick. Each vertex carries a key identifying its
+/// position: 4*p+axis for a point on the edge starting at grid point p, or
+/// 4*p+3 if it coincides with grid point p.
+struct MCVertex
+{
+  vtkIdType key;
+  float     x[3];
+  float     n[3];
+};
+
+struct MCBrickOutput
+{
+  std::vector<vtkIdType> cells;  // cell id of each triangle
+  std::vector<MCVertex>  verts;  // 3 per triangle
+};
+
+/// Negative central difference gradient as in vtkMarchingCubes
+template <class T>
+void BrickedMarchingCubesGradient(const T *s, const MCGrid& g,
+                                  int i, int j, int k, double n[3])
+{
+  const int ijk[3] = { i, j, k };
+  const vtkIdType stride[3] = { 1, g.dims[0], g.sliceSize };
+  const T *c = s + i + j*stride[1] + k*stride[2];
+  for (int d=0; d < 3; d++)
+  {
+    if (ijk[d] == 0)
+      n[d] = ((double)c[0] - c[stride[d]]) / g.spacing[d];
+    else if (ijk[d] == g.dims[d]-1)
+      n[d] = ((double)c[-stride[d]] - c[0]) / g.spacing[d];
+    else
+      n[d] = 0.5*((double)c[-stride[d]] - c[stride[d]]) / g.spacing[d];
+  }
+}
+
+template <class T>
+void BrickedMarchingCubesRange(const T *s, const MCGrid& g, const int b[3],
+                               double range[2])
+{
+  int lo[3], hi[3];
+  for (int d=0; d < 3; d++)
+  {
+    lo[d] = b[d]*g.brickSize;
+    hi[d] = std::min(lo[d] + g.brickSize, g.dims[d]-1);
+  }
+  double vmin = s[lo[0] + lo[1]*g.dims[0] + lo[2]*g.sliceSize], vmax = vmin;
+  for (int k=lo[2]; k <= hi[2]; k++)
+    for (int j=lo[1]; j <= hi[1]; j++)
+    {
+      const T *row = s + j*g.dims[0] + k*g.sliceSize;
+      for (int i=lo[0]; i <= hi[0]; i++)
+      {
+        double v = row[i];
+        if (v < vmin) vmin = v;
+        if (v > vmax) vmax = v;
+      }
+    }
+  range[0] = vmin;
+  range[1] = vmax;
+}
+
+template <class T>
+void BrickedMarchingCubesBrick(const T *s, const MCGrid& g, const int b[3],
+                               double value, bool computeNormals,
+                               MCBrickOutput& out)
+{
+  vtkMarchingCubesTriangleCases *triCases =
+    vtkMarchingCubesTriangleCases::GetCases();
+
+  vtkIdType cornerOfs[8];
+  for (int c=0; c < 8; c++)
+    cornerOfs[c] = c_corner[c][0] + c_corner[c][1]*g.dims[0]
+                 + c_corner[c][2]*g.sliceSize;
+
+  int lo[3], hi[3];
+  for (int d=0; d < 3; d++)
+  {
+    lo[d] = b[d]*g.brickSize;
+    hi[d] = std::min(lo[d] + g.brickSize, g.dims[d]-1);
+  }
+
+  double sc[8], grad[8][3];
+  for (int k=lo[2]; k < hi[2]; k++)
+    for (int j=lo[1]; j < hi[1]; j++)
+      for (int i=lo[0]; i < hi[0]; i++)
+      {
+        vtkIdType p = i + j*g.dims[0] + k*g.sliceSize;
+        int index = 0;
+        for (int c=0; c < 8; c++)
+        {
+          sc[c] = s[p + cornerOfs[c]];
+          if (sc[c] >= value)
+            index |= (1 << c);
+        }
+        if (index == 0 || index == 255)
+          continue;
+
+        if (computeNormals)
+          for (int c=0; c < 8; c++)
+            BrickedMarchingCubesGradient(s, g, i+c_corner[c][0],
+              j+c_corner[c][1], k+c_corner[c][2], grad[c]);
+
+        for (int *edge=triCases[index].edges; edge[0] > -1; edge += 3)
+        {
+          out.cells.push_back(p);
+          for (int e=0; e < 3; e++)
+          {
+            const int *vert = c_edge[edge[e]];
+            double t = (value - sc[vert[0]]) / (sc[vert[1]] - sc[vert[0]]);
+
+            MCVertex v;
+            if (t == 0.0)
+              v.key = 4*(p + cornerOfs[vert[0]]) + 3;
+            else if (t == 1.0)
+              v.key = 4*(p + cornerOfs[vert[1]]) + 3;
+            else
+              v.key = 4*(p + cornerOfs[vert[0]]) + c_edgeAxis[edge[e]];
+
+            const int ijk[3] = { i, j, k };
+            for (int d=0; d < 3; d++)
+            {
+              double x0 = g.origin[d] + (ijk[d] + c_corner[vert[0]][d])*g.spacing[d],
+                     x1 = g.origin[d] + (ijk[d] + c_corner[vert[1]][d])*g.spacing[d];
+              v.x[d] = (float)(x0 + t*(x1 - x0));
+            }
+
+            if (computeNormals)
+            {
+              double n[3];
+              for (int d=0; d < 3; d++)
+                n[d] = grad[vert[0]][d] + t*(grad[vert[1]][d] - grad[vert[0]][d]);
+              vtkMath::Normalize(n);
+              for (int d=0; d < 3; d++)
+                v.n[d] = (float)n[d];
+            }
+            out.verts.push_back(v);
+          }
+        }
+      }
+}
+
+/// Triangle order: by cell id (scanline order of vtkMarchingCubes), a cell
+/// lies in a single brick so triangles of a cell keep their order
+struct MCTriangleRef
+{
+  vtkIdType cell;
+  int       brick;
+  int       tri;
+  bool operator < (const MCTriangleRef& other) const
+  {
+    return cell < other.cell || (cell == other.cell && tri < other.tri);
+  }
+};
+
+} // namespace
+
+//----------------------------------------------------------------------------
+BrickedMarchingCubes::BrickedMarchingCubes()
+{
+  this->Value = 0.0;
+  this->ComputeNormals = 1;
+  this->ComputeScalars = 1;
+  this->BrickSize = 16;
+  this->NumberOfActiveBricks = 0;
+  for (int d=0; d < 3; d++)
+    this->BrickDims[d] = 0;
+  for (int d=0; d < 6; d++)
+    this->BrickIndexExtent[d] = 0;
+}
+
+//----------------------------------------------------------------------------
+void BrickedMarchingCubes::SetValue(int i, double value)
+{
+  if (i != 0)
+  {
+    vtkErrorMacro(<<"Only a single contour value is supported!");
+    return;
+  }
+  if (this->Value != value)
+  {
+    this->Value = value;
+    this->Modified();
+  }
+}
+
+void BrickedMarchingCubes::SetBrickSize(int size)
+{
+  size = (size < 2) ? 2 : size;
+  if (this->BrickSize != size)
+  {
+    this->BrickSize = size;
+    this->BrickRange.clear();
+    this->Modified();
+  }
+}
+
+//----------------------------------------------------------------------------
+int BrickedMarchingCubes::FillInputPortInformation(int, vtkInformation *info)
+{
+  info->Set(vtkAlgorithm::INPUT_REQUIRED_DATA_TYPE(), "vtkImageData");
+  return 1;
+}
+
+int BrickedMarchingCubes::RequestUpdateExtent(vtkInformation *vtkNotUsed(request),
+                                              vtkInformationVector **inputVector,
+                                              vtkInformationVector *vtkNotUsed(outputVector))
+{
+  // Brick index covers the whole image, so always request all of it
+  vtkInformation *inInfo = inputVector[0]->GetInformationObject(0);
+  if (inInfo && inInfo->Has(vtkStreamingDemandDrivenPipeline::WHOLE_EXTENT()))
+    inInfo->Set(vtkStreamingDemandDrivenPipeline::UPDATE_EXTENT(),
+      inInfo->Get(vtkStreamingDemandDrivenPipeline::WHOLE_EXTENT()), 6);
+  return 1;
+}
+
+//----------------------------------------------------------------------------
+void BrickedMarchingCubes::UpdateBrickIndex(vtkImageData *input,
+                                            vtkDataArray *scalars)
+{
+  int *extent = input->GetExtent();
+  bool valid = !this->BrickRange.empty()
+            && input->GetMTime()   <= this->BrickIndexTime.GetMTime()
+            && scalars->GetMTime() <= this->BrickIndexTime.GetMTime();
+  for (int d=0; d < 6; d++)
+    valid = valid && extent[d] == this->BrickIndexExtent[d];
+  if (valid)
+    return;
+
+  MCGrid g;
+  input->GetDimensions(g.dims);
+  g.sliceSize = (vtkIdType)g.dims[0]*g.dims[1];
+  g.brickSize = this->BrickSize;
+  for (int d=0; d < 3; d++)
+    this->BrickDims[d] = (g.dims[d] - 2) / g.brickSize + 1;
+  for (int d=0; d < 6; d++)
+    this->BrickIndexExtent[d] = extent[d];
+
+  int numBricks = this->BrickDims[0]*this->BrickDims[1]*this->BrickDims[2];
+  this->BrickRange.resize(2*numBricks);
+
+  void *ptr = scalars->GetVoidPointer(0);
+  #pragma omp parallel for schedule(dynamic)
+  for (int bi=0; bi < numBricks; bi++)
+  {
+    int b[3] = { bi % this->BrickDims[0],
+                 (bi / this->BrickDims[0]) % this->BrickDims[1],
+                 bi / (this->BrickDims[0]*this->BrickDims[1]) };
+    switch (scalars->GetDataType())
+    {
+      vtkTemplateMacro(
+        BrickedMarchingCubesRange(static_cast<const VTK_TT*>(ptr), g, b,
+                                  &this->BrickRange[2*bi]));
+    }
+  }
+  this->BrickIndexTime.Modified();
+}
+
+//----------------------------------------------------------------------------
+int BrickedMarchingCubes::RequestData(vtkInformation *vtkNotUsed(request),
+                                      vtkInformationVector **inputVector,
+                                      vtkInformationVector *outputVector)
+{
+  vtkInformation *inInfo  = inputVector[0]->GetInformationObject(0);
+  vtkInformation *outInfo = outputVector->GetInformationObject(0);
+
+  vtkImageData *input = vtkImageData::SafeDownCast(
+    inInfo->Get(vtkDataObject::DATA_OBJECT()));
+  vtkPolyData *output = vtkPolyData::SafeDownCast(
+    outInfo->Get(vtkDataObject::DATA_OBJECT()));
+
+  this->NumberOfActiveBricks = 0;
+  if (!input || !output)
+    return 0;
+
+  vtkDataArray *scalars = input->GetPointData()->GetScalars();
+  if (!scalars)
+  {
+    vtkErrorMacro(<<"No scalars to contour!");
+    return 1;
+  }
+
+  MCGrid g;
+  input->GetDimensions(g.dims);
+  if (g.dims[0] < 2 || g.dims[1] < 2 || g.dims[2] < 2)
+  {
+    vtkErrorMacro(<<"Cannot contour data of dimension != 3");
+    return 1;
+  }
+  g.sliceSize = (vtkIdType)g.dims[0]*g.dims[1];
+  g.brickSize = this->BrickSize;
+  int *extent = input->GetExtent();
+  double *origin = input->GetOrigin(), *spacing = input->GetSpacing();
+  for (int d=0; d < 3; d++)
+  {
+    g.origin[d]  = origin[d] + extent[2*d]*spacing[d];
+    g.spacing[d] = spacing[d];
+  }
+
+  // Active bricks from index, i.e. bricks whose range straddles the value
+  this->UpdateBrickIndex(input, scalars);
+
+  std::vector<int> active;
+  int numBricks = (int)this->BrickRange.size()/2;
+  for (int bi=0; bi < numBricks; bi++)
+    if (this->BrickRange[2*bi] < this->Value && this->BrickRange[2*bi+1] >= this->Value)
+      active.push_back(bi);
+  this->NumberOfActiveBricks = (int)active.size();
+
+  // Triangulate active bricks
+  std::vector<MCBrickOutput> bricks(active.size());
+  void *ptr = scalars->GetVoidPointer(0);
+  bool computeNormals = this->ComputeNormals != 0;
+  #pragma omp parallel for schedule(dynamic)
+  for (int a=0; a < (int)active.size(); a++)
+  {
+    int bi = active[a];
+    int b[3] = { bi % this->BrickDims[0],
+                 (bi / this->BrickDims[0]) % this->BrickDims[1],
+                 bi / (this->BrickDims[0]*this->BrickDims[1]) };
+    switch (scalars->GetDataType())
+    {
+      vtkTemplateMacro(
+        BrickedMarchingCubesBrick(static_cast<const VTK_TT*>(ptr), g, b,
+                                  this->Value, computeNormals, bricks[a]));
+    }
+  }
+
+  // Bring triangles into scanline order
+  std::vector<MCTriangleRef> tris;
+  for (size_t a=0; a < bricks.size(); a++)
+    for (size_t t=0; t < bricks[a].cells.size(); t++)
+    {
+      MCTriangleRef ref = { bricks[a].cells[t], (int)a, (int)t };
+      tris.push_back(ref);
+    }
+  std::sort(tris.begin(), tris.end());
+
+  // Merge coincident vertices, point ids in order of first occurrence as
+  // with the point locator of vtkMarchingCubes
+  vtkIdType numVerts = 3*(vtkIdType)tris.size();
+  std::vector< std::pair<vtkIdType,vtkIdType> > keys(numVerts);
+  for (vtkIdType r=0; r < numVerts; r++)
+  {
+    const MCTriangleRef& ref = tris[r/3];
+    keys[r].first  = bricks[ref.brick].verts[3*ref.tri + r%3].key;
+    keys[r].second = r;
+  }
+  std::sort(keys.begin(), keys.end());
+
+  std::vector<vtkIdType> first(numVerts);
+  for (vtkIdType r=0; r < numVerts; r++)
+    first[keys[r].second] = (r > 0 && keys[r].first == keys[r-1].first)
+                          ? first[keys[r-1].second] : keys[r].second;
+  keys.clear();
+
+  std::vector<vtkIdType> pointId(numVerts);
+  vtkIdType numPts = 0;
+  for (vtkIdType r=0; r < numVerts; r++)
+    pointId[r] = (first[r] == r) ? numPts++ : pointId[first[r]];
+
+  // Output
+  vtkPoints *newPts = vtkPoints::New();
+  newPts->SetNumberOfPoints(numPts);
+  float *x = static_cast<float*>(newPts->GetData()->GetVoidPointer(0));
+
+  vtkFloatArray *newNormals = NULL;
+  float *n = NULL;
+  if (computeNormals)
+  {
+    newNormals = vtkFloatArray::New();
+    newNormals->SetName("Normals");
+    newNormals->SetNumberOfComponents(3);
+    newNormals->SetNumberOfTuples(numPts);
+    n = newNormals->GetPointer(0);
+  }
+
+  vtkIdTypeArray *cellIds = vtkIdTypeArray::New();
+  cellIds->Allocate(4*(vtkIdType)tris.size());
+  vtkIdType numCells = 0;
+  for (vtkIdType t=0; t < (vtkIdType)tris.size(); t++)
+  {
+    const MCTriangleRef& ref = tris[t];
+    const MCVertex *v = &bricks[ref.brick].verts[3*ref.tri];
+    vtkIdType ids[3];
+    for (int e=0; e < 3; e++)
+    {
+      vtkIdType r = 3*t + e;
+      ids[e] = pointId[r];
+      if (first[r] != r)
+        continue;
+      for (int d=0; d < 3; d++)
+      {
+        x[3*ids[e]+d] = v[e].x[d];
+        if (n)
+          n[3*ids[e]+d] = v[e].n[d];
+      }
+    }
+    if (ids[0] != ids[1] && ids[0] != ids[2] && ids[1] != ids[2])
+    {
+      cellIds->InsertNextValue(3);
+      cellIds->InsertNextValue(ids[0]);
+      cellIds->InsertNextValue(ids[1]);
+      cellIds->InsertNextValue(ids[2]);
+      numCells++;
+    }
+  }
+
+  vtkCellArray *newPolys = vtkCellArray::New();
+  newPolys->SetCells(numCells, cellIds);
+  cellIds->Delete();
+
+  output->SetPoints(newPts);
+  output->SetPolys(newPolys);
+  newPts->Delete();
+  newPolys->Delete();
+
+  if (newNormals)
+  {
+    output->GetPointData()->SetNormals(newNormals);
+    newNormals->Delete();
+  }
+
+  if (this->ComputeScalars)
+  {
+    vtkDataArray *newScalars = scalars->NewInstance();
+    newScalars->SetNumberOfComponents(1);
+    newScalars->SetNumberOfTuples(numPts);
+    for (vtkIdType i=0; i < numPts; i++)
+      newScalars->SetTuple1(i, this->Value);
+    int idx = output->GetPointData()->AddArray(newScalars);
+    output->GetPointData()->SetActiveAttribute(idx, vtkDataSetAttributes::SCALARS);
+    newScalars->Delete();
+  }
+
+  output->Squeeze();
+  return 1;
+}
+
+//----------------------------------------------------------------------------
+void BrickedMarchingCubes::PrintSelf(ostream& os, vtkIndent indent)
+{
+  this->Superclass::PrintSelf(os,indent);
+  os << indent << "Value: " << this->Value << "\n";
+  os << indent << "Compute Normals: " << (this->ComputeNormals ? "On\n" : "Off\n");
+  os << indent << "Compute Scalars: " << (this->ComputeScalars ? "On\n" : "Off\n");
+  os << indent << "Brick Size: " << this->BrickSize << "\n";
+  os << indent << "Number Of Active Bricks: " << this->NumberOfActiveBricks << "\n";
+}
@@ -0,0 +1,82 @@
+#ifndef __BrickedMarchingCubes_h
+#define __BrickedMarchingCubes_h
+
+#include "vtkPolyDataAlgorithm.h"
+#include <vector>
+
+class vtkImageData;
+class vtkDataArray;
+
+/// Marching cubes isosurface of vtkImageData scalars on a brick index.
+///
+/// Drop-in replacement for vtkMarchingCubes for a single contour value. The
+/// volume is partitioned into bricks of BrickSize^3 cells and the scalar range
+/// of each brick is stored in an index, which is only rebuilt when the input
+/// changes. An update then visits just the bricks whose range straddles the
+/// isovalue, such that moving the isovalue (see VarVisRender::setIsovalue())
+/// costs a pass over the active bricks instead of the whole volume. Active
+/// bricks are triangulated in parallel via OpenMP if available.
+///
+/// Output is the same as vtkMarchingCubes: same case table, vertex
+/// interpolation and gradient normals, and coincident points are merged in
+/// the same (scanline) order, so point and triangle ids are identical. As in
+/// vtkMarchingCubes a scalar array holding the contour value is attached if
+/// ComputeScalars is on (default).
+class BrickedMarchingCubes : public vtkPolyDataAlgorithm
+{
+public:
+  vtkTypeMacro(BrickedMarchingCubes,vtkPolyDataAlgorithm);
+  void PrintSelf(ostream& os, vtkIndent indent);
+  static BrickedMarchingCubes *New();
+
+  /// Contour value, only a single contour (i=0) is supported
+  void SetValue(int i, double value);
+  double GetValue(int i=0) const {return (i==0) ? Value : 0.0;}
+  int GetNumberOfContours() const {return 1;}
+
+  vtkSetMacro(ComputeNormals,int);
+  vtkGetMacro(ComputeNormals,int);
+  vtkBooleanMacro(ComputeNormals,int);
+
+  vtkSetMacro(ComputeScalars,int);
+  vtkGetMacro(ComputeScalars,int);
+  vtkBooleanMacro(ComputeScalars,int);
+
+  /// Edge length of a brick in cells (default 16)
+  void SetBrickSize(int size);
+  int GetBrickSize() const {return BrickSize;}
+
+  /// Statistics of last update
+  int GetNumberOfBricks() const {return (int)BrickRange.size()/2;}
+  int GetNumberOfActiveBricks() const {return NumberOfActiveBricks;}
+
+protected:
+  BrickedMarchingCubes();
+  ~BrickedMarchingCubes() {}
+
+  int RequestData(vtkInformation *, vtkInformationVector **, vtkInformationVector *);
+  int RequestUpdateExtent(vtkInformation *, vtkInformationVector **, vtkInformationVector *);
+  int FillInputPortInformation(int port, vtkInformation *info);
+
+  /// Rebuild brick index if input or brick size changed
+  void UpdateBrickIndex(vtkImageData *input, vtkDataArray *scalars);
+
+  double Value;
+  int    ComputeNormals;
+  int    ComputeScalars;
+  int    BrickSize;
+  int    NumberOfActiveBricks;
+
+  // Brick index: number of bricks per axis and min/max scalar per brick,
+  // valid for the extent it was built for
+  int                 BrickDims[3];
+  int                 BrickIndexExtent[6];
+  std::vector<double> BrickRange;
+  vtkTimeStamp        BrickIndexTime;
+
+private:
+  BrickedMarchingCubes(const BrickedMarchingCubes&);  // Not implemented.
+  void operator=(const BrickedMarchingCubes&);  // Not implemented.
+};
+
+#endif
@@ -375,10 +375,7 @@ void GlyphControls::do_GlyphUpdate()
 
 	m_varVis->setGlyphAutoScaling( getGlyphAutoScaling() );
 
-	if( m_chbx_glyphScaleByVector->isChecked() )
-		m_varVis->getWarpVis()->getGlyph3D()->SetScaleModeToScaleByVector();
-	else
-		m_varVis->getWarpVis()->getGlyph3D()->SetScaleModeToDataScalingOff();	
+	m_varVis->getWarpVis()->setGlyphScaleByVector( m_chbx_glyphScaleByVector->isChecked() );
 
 	sceneUpdate();
 }
@@ -549,6 +546,6 @@ void GlyphControls::setColormap( const ColorMapRGB& colormap )
 {
 	m_colormap = colormap;	
 	m_colormap.applyTo( m_varVis->getWarpVis()->getGlyphMapper()->GetLookupTable() ); //m_varVis->getWarpVis()->getLutTangentialComponent() );
-	m_varVis->getWarpVis()->getGlyph3D()->Update();
+	m_varVis->getWarpVis()->getGlyphMapper()->Modified();
 	//m_varVis->getWarpVis()->updateColorBars();	
 }
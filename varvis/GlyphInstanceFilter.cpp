@@ -0,0 +1,132 @@
+#include "GlyphInstanceFilter.h"
+
+#include "vtkObjectFactory.h"
+#include "vtkInformationVector.h"
+#include "vtkInformation.h"
+#include "vtkDataObject.h"
+#include "vtkPolyData.h"
+#include "vtkPointData.h"
+#include "vtkPoints.h"
+#include "vtkDataArray.h"
+#include "vtkFloatArray.h"
+#include <cmath>
+
+vtkStandardNewMacro(GlyphInstanceFilter);
+
+//----------------------------------------------------------------------------
+GlyphInstanceFilter::GlyphInstanceFilter()
+{
+  this->SetNumberOfInputPorts(1);
+  this->SetNumberOfOutputPorts(1);
+  this->Offset = 0.0;
+  this->Invert = 0;
+  this->MaxMagnitude = 0.0;
+}
+
+GlyphInstanceFilter::~GlyphInstanceFilter()
+{
+}
+
+//----------------------------------------------------------------------------
+int GlyphInstanceFilter::RequestData(vtkInformation *vtkNotUsed(request),
+                                     vtkInformationVector **inputVector,
+                                     vtkInformationVector *outputVector)
+{
+  vtkInformation *inInfo  = inputVector[0]->GetInformationObject(0);
+  vtkInformation *outInfo = outputVector->GetInformationObject(0);
+
+  vtkPolyData *input = vtkPolyData::SafeDownCast(
+    inInfo->Get(vtkDataObject::DATA_OBJECT()));
+  vtkPolyData *output = vtkPolyData::SafeDownCast(
+    outInfo->Get(vtkDataObject::DATA_OBJECT()));
+
+  this->MaxMagnitude = 0.0;
+  if (!input || !output)
+    return 0;
+
+  output->ShallowCopy(input);
+
+  vtkPoints    *inPts   = input->GetPoints();
+  vtkDataArray *vectors = input->GetPointData()->GetVectors();
+  vtkDataArray *normals = input->GetPointData()->GetNormals();
+  if (!inPts || !vectors)
+  {
+    vtkErrorMacro(<<"Input requires points and vectors!");
+    return 1;
+  }
+  if (!normals && this->Offset != 0.0)
+  {
+    vtkErrorMacro(<<"Input requires normals for glyph offset!");
+    return 1;
+  }
+
+  vtkIdType numPts = input->GetNumberOfPoints();
+
+  vtkPoints *newPts = vtkPoints::New();
+  newPts->SetDataTypeToFloat();
+  newPts->SetNumberOfPoints(numPts);
+  float *x = static_cast<float*>(newPts->GetData()->GetVoidPointer(0));
+
+  vtkFloatArray *direction = vtkFloatArray::New();
+  direction->SetName("GlyphDirection");
+  direction->SetNumberOfComponents(3);
+  direction->SetNumberOfTuples(numPts);
+  float *dir = direction->GetPointer(0);
+
+  vtkFloatArray *magnitude = vtkFloatArray::New();
+  magnitude->SetName("GlyphMagnitude");
+  magnitude->SetNumberOfTuples(numPts);
+  float *mag = magnitude->GetPointer(0);
+
+  // Only attribute arrays are written per point, glyph geometry is shared
+  double offset = (normals ? this->Offset : 0.0);
+  bool   invert = this->Invert != 0;
+  double maxMag = 0.0;
+  #pragma omp parallel
+  {
+    double localMax = 0.0;
+    #pragma omp for schedule(static)
+    for (int i=0; i < (int)numPts; i++)
+    {
+      double p[3], v[3], n[3] = { 0.0, 0.0, 0.0 };
+      inPts->GetPoint(i, p);
+      vectors->GetTuple(i, v);
+      if (offset != 0.0)
+        normals->GetTuple(i, n);
+
+      double len = sqrt(v[0]*v[0] + v[1]*v[1] + v[2]*v[2]);
+      double shift = (invert && len > 0.0) ? 1.0/len : 0.0;
+      double sign  = invert ? -1.0 : 1.0;
+      for (int d=0; d < 3; d++)
+      {
+        x  [3*i+d] = (float)(p[d] + shift*v[d] + offset*n[d]);
+        dir[3*i+d] = (float)(sign*v[d]);
+      }
+      mag[i] = (float)len;
+      if (len > localMax)
+        localMax = len;
+    }
+    #pragma omp critical
+    {
+      if (localMax > maxMag)
+        maxMag = localMax;
+    }
+  }
+  this->MaxMagnitude = maxMag;
+
+  output->SetPoints(newPts);
+  output->GetPointData()->SetVectors(direction);
+  output->GetPointData()->SetScalars(magnitude);
+  newPts->Delete();
+  direction->Delete();
+  magnitude->Delete();
+  return 1;
+}
+
+//----------------------------------------------------------------------------
+void GlyphInstanceFilter::PrintSelf(ostream& os, vtkIndent indent)
+{
+  this->Superclass::PrintSelf(os,indent);
+  os << indent << "Offset: " << this->Offset << "\n";
+  os << indent << "Invert: " << (this->Invert ? "On\n" : "Off\n");
+}
@@ -0,0 +1,53 @@
+#ifndef __GlyphInstanceFilter_h
+#define __GlyphInstanceFilter_h
+
+#include "vtkPolyDataAlgorithm.h"
+
+/// Per-point glyph attributes for instanced rendering via vtkGlyph3DMapper.
+///
+/// Combines GlyphInvertFilter and GlyphOffsetFilter into a single parallel
+/// pass over the points but does not generate any glyph geometry. The output
+/// is the input with moved points and the following point data arrays:
+/// - "GlyphDirection" (3 floats): glyph vector, set as active vectors and
+///   used for orientation and scaling of the shared arrow source,
+/// - "GlyphMagnitude" (1 float): vector length, set as active scalars for
+///   coloring as vtkGlyph3D::SetColorModeToColorByVector() would.
+///
+/// Glyph position is the input point moved by Offset along the point normal.
+/// With Invert on, the glyph is additionally moved one unit along its vector
+/// and then points back, i.e. the arrow tip ends at the sample point.
+class GlyphInstanceFilter : public vtkPolyDataAlgorithm
+{
+public:
+  vtkTypeMacro(GlyphInstanceFilter,vtkPolyDataAlgorithm);
+  void PrintSelf(ostream& os, vtkIndent indent);
+  static GlyphInstanceFilter *New();
+
+  /// Offset along point normals (default 0, requires normals if non-zero)
+  vtkSetMacro(Offset,double);
+  vtkGetMacro(Offset,double);
+
+  /// Invert glyph direction (default off)
+  vtkSetMacro(Invert,int);
+  vtkGetMacro(Invert,int);
+  vtkBooleanMacro(Invert,int);
+
+  /// Largest vector magnitude in last update, e.g. for lookup table range
+  double GetMaxMagnitude() const {return MaxMagnitude;}
+
+protected:
+  GlyphInstanceFilter();
+  ~GlyphInstanceFilter();
+
+  int RequestData(vtkInformation *, vtkInformationVector **, vtkInformationVector *);
+
+  double Offset;
+  int    Invert;
+  double MaxMagnitude;
+
+private:
+  GlyphInstanceFilter(const GlyphInstanceFilter&);  // Not implemented.
+  void operator=(const GlyphInstanceFilter&);  // Not implemented.
+};
+
+#endif
@@ -1,11 +1,10 @@
 #include "GlyphVisualization.h"
 #include "VectorToMeshColorFilter.h"
 #include "VectorToVertexNormalFilter.h"
-#include "GlyphInvertFilter.h"
-#include "GlyphOffsetFilter.h"
+#include "GlyphInstanceFilter.h"
+#include "ImageProbeFilter.h"
 #include "ColorMapRGB.h"
 
-#include <vtkProbeFilter.h>
 #include <vtkArrowSource.h>
 #include <vtkColorTransferFunction.h>
 #include <vtkLookupTable.h>
@@ -49,7 +48,7 @@ GlyphVisualization
 	
 	// Setup probe filter
 	mesh->Update();  // Make sure the mesh is already loaded in memory
-	VTKPTR<vtkProbeFilter> probe = VTKPTR<vtkProbeFilter>::New();
+	VTKPTR<ImageProbeFilter> probe = VTKPTR<ImageProbeFilter>::New();
 	probe->SetInput( mesh );
 	probe->SetSource( source );
 	probe->Update();
@@ -69,19 +68,21 @@ VTKPTR<vtkActor> GlyphVisualization
   ::createGlyphVisActor2( vtkPolyData * polyData )
 {
 	VTKPTR<vtkArrowSource>    arrow  = VTKPTR<vtkArrowSource>   ::New();
-	VTKPTR<vtkGlyph3D>        glyph  = VTKPTR<vtkGlyph3D>       ::New();
-	VTKPTR<vtkPolyDataMapper> mapper = VTKPTR<vtkPolyDataMapper>::New();	
-	
-	glyph->SetInput(polyData);
-    glyph->SetSourceConnection( arrow->GetOutputPort() );
-    glyph->SetVectorModeToUseVector();
-	glyph->SetColorModeToColorByVector();
-    glyph->OrientOn();
-    glyph->Update();
+	VTKPTR<vtkGlyph3DMapper>  mapper = VTKPTR<vtkGlyph3DMapper> ::New();
 
 	arrow->SetTipLength( 1.0 );
 	//arrow->SetTipRadius( 0.23 );
 	arrow->SetTipResolution( 50 );
+
+	// Instanced glyphs, orientation and scale from the per-point vectors and
+	// color from their magnitude as provided by GlyphInstanceFilter
+	mapper->SetInputConnection( polyData->GetProducerPort() );
+	mapper->SetSourceConnection( arrow->GetOutputPort() );
+	mapper->SetOrientationArray( "GlyphDirection" );
+	mapper->SetOrientationModeToDirection();
+	mapper->OrientOn();
+	mapper->SetScaleArray( "GlyphDirection" );
+	mapper->SetScaleModeToScaleByMagnitude();
 	
 	// create lookUpTable for arrow Colors
 #if 1
@@ -156,18 +157,17 @@ VTKPTR<vtkActor> GlyphVisualization
 	hlut->Build();
 #endif
 
-    mapper->SetInputConnection( glyph->GetOutputPort() );
 	mapper->SetScalarVisibility( 1 ); // color by scalars?
     //mapper->SetScalarRange( 0,1 ); // source->GetOutput()->GetScalarRange()
 	mapper->SetScalarRange( 0.0, m_maxOrthVector );
 
 	if( m_autoScaleEnabled && (m_maxOrthVector>0.0001) )
 	{
-		glyph->SetScaleFactor( m_autoScaleFactor / m_maxOrthVector );
+		mapper->SetScaleFactor( m_autoScaleFactor / m_maxOrthVector );
 	}
 	else
 	{
-		glyph->SetScaleFactor( m_glyphSize );
+		mapper->SetScaleFactor( m_glyphSize );
 	}
 
 #if 1
@@ -215,7 +215,6 @@ VTKPTR<vtkActor> GlyphVisualization
 #endif
 	
 	// store as members to allow later adjustments e.g. SetScaleFactor()
-	m_glyph = glyph;
 	m_glyphMapper = mapper;
 	m_lutTangentialComponent = mapper->GetLookupTable(); // was: hlut;
 
@@ -242,22 +241,23 @@ VTKPTR<vtkActor> GlyphVisualization
 VTKPTR<vtkActor> GlyphVisualization
   ::createGlyphVisActor2( vtkAlgorithm* algo )
 {
-	VTKPTR<vtkArrowSource>    arrow  = VTKPTR<vtkArrowSource>   ::New();
-	VTKPTR<vtkGlyph3D>        glyph  = VTKPTR<vtkGlyph3D>       ::New();
-	VTKPTR<vtkPolyDataMapper> mapper = VTKPTR<vtkPolyDataMapper>::New();
-
-	glyph->SetInputConnection( algo->GetOutputPort() );
-    glyph->SetSourceConnection( arrow->GetOutputPort() );
-    glyph->SetVectorModeToUseVector();
-    glyph->OrientOn();
-	//glyph->SetScaleFactor(m_glyphSize);
-    glyph->Update();
-	
-    mapper->SetInputConnection( glyph->GetOutputPort() );
+	VTKPTR<vtkArrowSource>      arrow     = VTKPTR<vtkArrowSource>     ::New();
+	VTKPTR<GlyphInstanceFilter> instances = VTKPTR<GlyphInstanceFilter>::New();
+	VTKPTR<vtkGlyph3DMapper>    mapper    = VTKPTR<vtkGlyph3DMapper>   ::New();
+
+	instances->SetInputConnection( algo->GetOutputPort() );
+
+	mapper->SetInputConnection( instances->GetOutputPort() );
+	mapper->SetSourceConnection( arrow->GetOutputPort() );
+	mapper->SetOrientationArray( "GlyphDirection" );
+	mapper->SetOrientationModeToDirection();
+	mapper->OrientOn();
+	mapper->SetScaleArray( "GlyphDirection" );
+	mapper->SetScaleModeToScaleByMagnitude();
+	//mapper->SetScaleFactor(m_glyphSize);
 	mapper->SetScalarVisibility( 0 ); // color by scalars?
     
 	// store as members to allow later adjustments e.g. SetScaleFactor()
-	m_glyph = glyph;
 	m_glyphMapper = mapper;
 
 	VTKPTR<vtkActor> actor = VTKPTR<vtkActor>::New();
@@ -375,7 +375,7 @@ void GlyphVisualization
 		// FIXME: Avoid a second call to v2mc->Update(), this is expensive!
 
 	// generate new samples for the the sampling points 
-	VTKPTR<vtkProbeFilter> probe = VTKPTR<vtkProbeFilter>::New();
+	VTKPTR<ImageProbeFilter> probe = VTKPTR<ImageProbeFilter>::New();
 	probe->SetInput(pointSamples );
 	probe->SetSource( source );
 	probe->Update();
@@ -404,29 +404,21 @@ void GlyphVisualization
 	// set Vectors to pointsSample Data 
 	pointSamples->GetPointData()->SetVectors( v2vn->GetOutput()->GetPointData()->GetVectors() );
 	
-	// Invert direction of vectors in vectorfield
-	vtkPolyData* myData = pointSamples;	
-	if( m_invertVectors )
-	{
-		VTKPTR<GlyphInvertFilter> invertFilter = VTKPTR<GlyphInvertFilter>::New();
-		invertFilter->SetInput(pointSamples);
-		invertFilter->Update();
-		myData = invertFilter->GetOutput();
-	}
-
-	// Offset glyph position +2 from the surface in direction of the normal
-	VTKPTR<GlyphOffsetFilter> offsetFilter = VTKPTR<GlyphOffsetFilter>::New();
-	offsetFilter->SetOffset( 2 );
-	offsetFilter->SetInput( myData );
-	offsetFilter->Update();	
+	// Per-point glyph attributes: optionally inverted vectors and glyph
+	// position offset +2 from the surface in direction of the normal
+	VTKPTR<GlyphInstanceFilter> instances = VTKPTR<GlyphInstanceFilter>::New();
+	instances->SetOffset( 2 );
+	instances->SetInvert( m_invertVectors ? 1 : 0 );
+	instances->SetInput( pointSamples );
+	instances->Update();
 
 	// create the actor for Visualization
-	m_visActor = createGlyphVisActor2( offsetFilter->GetOutput() );
+	m_visActor = createGlyphVisActor2( instances->GetOutput() );
 
 	if( m_clusterData )
 		m_clusterData->Delete();
 	m_clusterData  = vtkPolyData::New();
-	m_clusterData->ShallowCopy(	offsetFilter->GetOutput() );
+	m_clusterData->ShallowCopy(	instances->GetOutput() );
 
 	// adjust mapper
 	//m_glyphMapper->SetScalarRange( v2mc->getMin(),v2mc->getMax() );
@@ -499,11 +491,23 @@ void GlyphVisualization
 	m_glyphSize=value;
 	if( !m_autoScaleEnabled )
 	{
-		m_glyph->SetScaleFactor(m_glyphSize);
-		m_glyph->Update();
+		// Only the mapper scale factor changes, glyphs are instanced
+		m_glyphMapper->SetScaleFactor(m_glyphSize);
 	}
 }
 
+//-----------------------------------------------------------------------------
+//  setGlyphScaleByVector
+//-----------------------------------------------------------------------------
+void GlyphVisualization
+  ::setGlyphScaleByVector( bool b )
+{
+	if( b )
+		m_glyphMapper->SetScaleModeToScaleByMagnitude();
+	else
+		m_glyphMapper->SetScaleModeToNoDataScaling();
+}
+
 //-----------------------------------------------------------------------------
 //  updateWarpVis
 //-----------------------------------------------------------------------------
@@ -515,7 +519,7 @@ void GlyphVisualization
 {
 	mesh->Update();  // just to be sure the model is already loaded in memory
 
-	VTKPTR<vtkProbeFilter> probe = VTKPTR<vtkProbeFilter>::New();
+	VTKPTR<ImageProbeFilter> probe = VTKPTR<ImageProbeFilter>::New();
 	probe->SetInput(mesh );
 	probe->SetSource( source );
 	probe->Update();
@@ -4,7 +4,7 @@
 #include <vector>
 
 #include <vtkActor.h>
-#include <vtkGlyph3D.h>
+#include <vtkGlyph3DMapper.h>
 #include <vtkPolyData.h>
 #include <vtkPolyDataMapper.h>
 #include <vtkScalarBarActor.h>
@@ -27,6 +27,11 @@
 	De-factor standard visualization for surface deformation fields as used
 	extensively for instance by Zollikofer et al.
 
+	Glyphs are rendered instanced via vtkGlyph3DMapper, i.e. a single arrow
+	mesh is shared and only per-point attributes are computed (see
+	GlyphInstanceFilter). Changing the glyph size or scale mode therefore
+	does not regenerate any geometry.
+
 	\author Max Hermann
 	\author Vitalis Wiens
 */
@@ -39,8 +44,7 @@ public:
 	~GlyphVisualization();
 	vtkActor*			getVisActor()        { return m_visActor; }
 	vtkPolyData*		getVectorField()     { return m_vectorField;}
-	vtkGlyph3D*			getGlyph3D()         { return m_glyph; }
-	vtkPolyDataMapper*	getGlyphMapper()     { return m_glyphMapper; }
+	vtkGlyph3DMapper*	getGlyphMapper()     { return m_glyphMapper; }
 	vtkScalarBarActor*	getScalarBar()       { return m_scalarBar; }
 	vtkScalarBarActor*	getScalarBarVector() { return m_scalarBarVector; }
 	vtkScalarsToColors* getLutTangentialComponent() { return m_lutTangentialComponent;}
@@ -58,6 +62,9 @@ public:
 	void setGlyphSize( double value );
 	void setScaleValue( double value );	
 
+	/// Scale glyphs by vector magnitude (default) or uniformly
+	void setGlyphScaleByVector( bool b );
+
 	void setGlyphAutoScaling( bool b) { m_autoScaleEnabled = b; }
 	void setGlyphAutoScaleFactor( double f ) { m_autoScaleFactor = f; };
 	bool getGlyphAutoScaling() const { return m_autoScaleEnabled; }
@@ -88,8 +95,7 @@ private:
 	bool   m_invertVectors;
 
 	VTKPTR<vtkActor>		  m_visActor;
-	VTKPTR<vtkGlyph3D>        m_glyph;
-	VTKPTR<vtkPolyDataMapper> m_glyphMapper;
+	VTKPTR<vtkGlyph3DMapper>  m_glyphMapper;
 	VTKPTR<vtkScalarBarActor> m_scalarBar;
 	VTKPTR<vtkScalarBarActor> m_scalarBarVector;
 	VTKPTR<vtkPolyData>		  m_vectorField;
@@ -0,0 +1,342 @@
+#include "ImageProbeFilter.h"
+
+#include "vtkObjectFactory.h"
+#include "vtkStreamingDemandDrivenPipeline.h"
+#include "vtkInformationVector.h"
+#include "vtkInformation.h"
+#include "vtkDataObject.h"
+#include "vtkDataSet.h"
+#include "vtkPointSet.h"
+#include "vtkPoints.h"
+#include "vtkImageData.h"
+#include "vtkPointData.h"
+#include "vtkDataArray.h"
+#include "vtkCharArray.h"
+#include "vtkSmartPointer.h"
+#include <vector>
+#include <cmath>
+#include <cstring> // memcpy(), memset()
+
+vtkStandardNewMacro(ImageProbeFilter);
+
+//----------------------------------------------------------------------------
+//  Batched trilinear interpolation
+//----------------------------------------------------------------------------
+namespace {
+
+const int c_batchSize = 256;
+
+/// Lower corner index and trilinear weights for a batch of points
+struct ProbeBatch
+{
+  vtkIdType offset[c_batchSize];
+  double    fx[c_batchSize], fy[c_batchSize], fz[c_batchSize];
+  char      valid[c_batchSize];
+};
+
+/// Regular grid geometry in index space
+struct ProbeGrid
+{
+  double    origin[3];   // world position of first grid point
+  double    invSpacing[3];
+  double    maxIndex[3]; // dims-1
+  int       maxCell[3];  // dims-2 (or 0 for degenerate axis)
+  vtkIdType stride[3];   // 0 for degenerate axis
+  int       dims[3];
+  double    tol;
+};
+
+template<class T> inline T ImageProbeFilterRound(double v) { return (T)floor(v+0.5); }
+template<> inline float  ImageProbeFilterRound<float >(double v) { return (float)v; }
+template<> inline double ImageProbeFilterRound<double>(double v) { return v; }
+
+void ImageProbeFilterWeights(const ProbeGrid& g, const double* coords,
+                             int n, ProbeBatch& b)
+{
+  for (int i=0; i < n; i++)
+  {
+    const double* x = coords + 3*i;
+    char valid = 1;
+    int idx[3];
+    double f[3];
+    for (int d=0; d < 3; d++)
+    {
+      double t = (x[d] - g.origin[d]) * g.invSpacing[d];
+      if (t < -g.tol || t > g.maxIndex[d] + g.tol)
+        valid = 0;
+      t = (t < 0.0) ? 0.0 : ((t > g.maxIndex[d]) ? g.maxIndex[d] : t);
+      idx[d] = (int)t;
+      if (idx[d] > g.maxCell[d])
+        idx[d] = g.maxCell[d];
+      f[d] = t - idx[d];
+    }
+    b.offset[i] = idx[0] + (idx[1] + (vtkIdType)idx[2]*g.dims[1])*g.dims[0];
+    b.fx[i] = f[0];
+    b.fy[i] = f[1];
+    b.fz[i] = f[2];
+    b.valid[i] = valid;
+  }
+}
+
+template<class T>
+void ImageProbeFilterInterpolate(const T* in, T* out, int nc, const ProbeGrid& g,
+                                 const ProbeBatch& b, int n)
+{
+  vtkIdType sx = g.stride[0]*nc, sy = g.stride[1]*nc, sz = g.stride[2]*nc;
+  for (int i=0; i < n; i++)
+  {
+    T* o = out + (vtkIdType)i*nc;
+    if (!b.valid[i])
+    {
+      for (int c=0; c < nc; c++)
+        o[c] = 0;
+      continue;
+    }
+
+    const T* p = in + b.offset[i]*nc;
+    double fx = b.fx[i], fy = b.fy[i], fz = b.fz[i];
+    for (int c=0; c < nc; c++)
+    {
+      double c00 = p[c      ] + fx*((double)p[c+sx      ] - p[c      ]),
+             c10 = p[c+sy   ] + fx*((double)p[c+sx+sy   ] - p[c+sy   ]),
+             c01 = p[c+sz   ] + fx*((double)p[c+sx+sz   ] - p[c+sz   ]),
+             c11 = p[c+sy+sz] + fx*((double)p[c+sx+sy+sz] - p[c+sy+sz]);
+      double c0 = c00 + fy*(c10 - c00),
+             c1 = c01 + fy*(c11 - c01);
+      o[c] = ImageProbeFilterRound<T>( c0 + fz*(c1 - c0) );
+    }
+  }
+}
+
+} // namespace
+
+//----------------------------------------------------------------------------
+ImageProbeFilter::ImageProbeFilter()
+{
+  this->SetNumberOfInputPorts(2);
+  this->SetNumberOfOutputPorts(1);
+  this->Tolerance = 1e-6;
+  this->NumberOfValidPoints = 0;
+}
+
+ImageProbeFilter::~ImageProbeFilter()
+{
+}
+
+//----------------------------------------------------------------------------
+void ImageProbeFilter::SetSource(vtkDataObject *source)
+{
+  this->SetInput(1, source);
+}
+
+vtkDataObject *ImageProbeFilter::GetSource()
+{
+  if (this->GetNumberOfInputConnections(1) < 1)
+    return NULL;
+  return this->GetExecutive()->GetInputData(1, 0);
+}
+
+void ImageProbeFilter::SetSourceConnection(vtkAlgorithmOutput* algOutput)
+{
+  this->SetInputConnection(1, algOutput);
+}
+
+//----------------------------------------------------------------------------
+int ImageProbeFilter::FillInputPortInformation(int port, vtkInformation *info)
+{
+  if (port == 1)
+  {
+    info->Set(vtkAlgorithm::INPUT_REQUIRED_DATA_TYPE(), "vtkImageData");
+    return 1;
+  }
+  return this->Superclass::FillInputPortInformation(port, info);
+}
+
+int ImageProbeFilter::RequestUpdateExtent(vtkInformation *vtkNotUsed(request),
+                                          vtkInformationVector **inputVector,
+                                          vtkInformationVector *outputVector)
+{
+  vtkInformation *inInfo     = inputVector[0]->GetInformationObject(0);
+  vtkInformation *sourceInfo = inputVector[1]->GetInformationObject(0);
+  vtkInformation *outInfo    = outputVector->GetInformationObject(0);
+
+  // Pass requested piece to input, source is always needed as a whole
+  if (inInfo)
+  {
+    inInfo->Set(vtkStreamingDemandDrivenPipeline::UPDATE_PIECE_NUMBER(),
+      outInfo->Get(vtkStreamingDemandDrivenPipeline::UPDATE_PIECE_NUMBER()));
+    inInfo->Set(vtkStreamingDemandDrivenPipeline::UPDATE_NUMBER_OF_PIECES(),
+      outInfo->Get(vtkStreamingDemandDrivenPipeline::UPDATE_NUMBER_OF_PIECES()));
+    inInfo->Set(vtkStreamingDemandDrivenPipeline::UPDATE_NUMBER_OF_GHOST_LEVELS(),
+      outInfo->Get(vtkStreamingDemandDrivenPipeline::UPDATE_NUMBER_OF_GHOST_LEVELS()));
+    if (inInfo->Has(vtkStreamingDemandDrivenPipeline::WHOLE_EXTENT()))
+      inInfo->Set(vtkStreamingDemandDrivenPipeline::UPDATE_EXTENT(),
+        inInfo->Get(vtkStreamingDemandDrivenPipeline::WHOLE_EXTENT()), 6);
+  }
+  if (sourceInfo)
+  {
+    sourceInfo->Set(vtkStreamingDemandDrivenPipeline::UPDATE_PIECE_NUMBER(), 0);
+    sourceInfo->Set(vtkStreamingDemandDrivenPipeline::UPDATE_NUMBER_OF_PIECES(), 1);
+    sourceInfo->Set(vtkStreamingDemandDrivenPipeline::UPDATE_NUMBER_OF_GHOST_LEVELS(), 0);
+    if (sourceInfo->Has(vtkStreamingDemandDrivenPipeline::WHOLE_EXTENT()))
+      sourceInfo->Set(vtkStreamingDemandDrivenPipeline::UPDATE_EXTENT(),
+        sourceInfo->Get(vtkStreamingDemandDrivenPipeline::WHOLE_EXTENT()), 6);
+  }
+  return 1;
+}
+
+//----------------------------------------------------------------------------
+void ImageProbeFilter::GetPointCoordinates(vtkDataSet *input, double *coords)
+{
+  vtkIdType numPts = input->GetNumberOfPoints();
+
+  // Direct access to coordinate arrays of point sets
+  vtkPointSet *ps = vtkPointSet::SafeDownCast(input);
+  vtkDataArray *data = (ps && ps->GetPoints()) ? ps->GetPoints()->GetData() : NULL;
+  if (data && data->GetDataType()==VTK_DOUBLE)
+  {
+    memcpy(coords, data->GetVoidPointer(0), 3*numPts*sizeof(double));
+    return;
+  }
+  if (data && data->GetDataType()==VTK_FLOAT)
+  {
+    const float *p = static_cast<const float*>(data->GetVoidPointer(0));
+    for (vtkIdType i=0; i < 3*numPts; i++)
+      coords[i] = p[i];
+    return;
+  }
+
+  // Generic (not thread-safe) access
+  for (vtkIdType i=0; i < numPts; i++)
+    input->GetPoint(i, coords + 3*i);
+}
+
+//----------------------------------------------------------------------------
+int ImageProbeFilter::RequestData(vtkInformation *vtkNotUsed(request),
+                                  vtkInformationVector **inputVector,
+                                  vtkInformationVector *outputVector)
+{
+  vtkInformation *inInfo     = inputVector[0]->GetInformationObject(0);
+  vtkInformation *sourceInfo = inputVector[1]->GetInformationObject(0);
+  vtkInformation *outInfo    = outputVector->GetInformationObject(0);
+
+  vtkDataSet *input = vtkDataSet::SafeDownCast(
+    inInfo->Get(vtkDataObject::DATA_OBJECT()));
+  vtkImageData *source = sourceInfo ? vtkImageData::SafeDownCast(
+    sourceInfo->Get(vtkDataObject::DATA_OBJECT())) : NULL;
+  vtkDataSet *output = vtkDataSet::SafeDownCast(
+    outInfo->Get(vtkDataObject::DATA_OBJECT()));
+
+  this->NumberOfValidPoints = 0;
+  if (!input || !output)
+    return 0;
+  if (!source)
+  {
+    vtkErrorMacro(<<"No image data source specified!");
+    return 0;
+  }
+
+  output->CopyStructure(input);
+  vtkPointData *outPD = output->GetPointData();
+  vtkPointData *srcPD = source->GetPointData();
+  vtkIdType numPts = input->GetNumberOfPoints();
+
+  // Grid geometry in index space
+  ProbeGrid g;
+  double spacing[3];
+  int extent[6];
+  source->GetOrigin(g.origin);
+  source->GetSpacing(spacing);
+  source->GetExtent(extent);
+  for (int d=0; d < 3; d++)
+  {
+    g.dims[d]       = extent[2*d+1] - extent[2*d] + 1;
+    g.origin[d]    += extent[2*d]*spacing[d];
+    g.invSpacing[d] = (spacing[d] != 0.0) ? 1.0/spacing[d] : 0.0;
+    g.maxIndex[d]   = g.dims[d] - 1;
+    g.maxCell[d]    = (g.dims[d] > 1) ? g.dims[d]-2 : 0;
+  }
+  g.stride[0] = (g.dims[0] > 1) ? 1 : 0;
+  g.stride[1] = (g.dims[1] > 1) ? g.dims[0] : 0;
+  g.stride[2] = (g.dims[2] > 1) ? (vtkIdType)g.dims[0]*g.dims[1] : 0;
+  g.tol = this->Tolerance;
+
+  // Output arrays of same type, name and attribute role as source arrays
+  std::vector<vtkDataArray*> inArrays, outArrays;
+  for (int a=0; a < srcPD->GetNumberOfArrays(); a++)
+  {
+    vtkDataArray *in = srcPD->GetArray(a);
+    if (!in || in->GetNumberOfTuples() < (vtkIdType)g.dims[0]*g.dims[1]*g.dims[2])
+      continue;
+
+    vtkDataArray *out = vtkDataArray::CreateDataArray(in->GetDataType());
+    out->SetName(in->GetName());
+    out->SetNumberOfComponents(in->GetNumberOfComponents());
+    out->SetNumberOfTuples(numPts);
+    outPD->AddArray(out);
+    out->Delete();
+
+    for (int attr=0; attr < vtkDataSetAttributes::NUM_ATTRIBUTES; attr++)
+      if (srcPD->GetAttribute(attr) == in && in->GetName())
+        outPD->SetActiveAttribute(in->GetName(), attr);
+
+    inArrays .push_back(in);
+    outArrays.push_back(out);
+  }
+
+  vtkSmartPointer<vtkCharArray> mask = vtkSmartPointer<vtkCharArray>::New();
+  mask->SetName("vtkValidPointMask");
+  mask->SetNumberOfComponents(1);
+  mask->SetNumberOfTuples(numPts);
+  outPD->AddArray(mask);
+
+  if (numPts == 0)
+    return 1;
+
+  std::vector<double> coords(3*numPts);
+  GetPointCoordinates(input, &coords[0]);
+
+  char *maskPtr = mask->GetPointer(0);
+  int numBatches = (int)((numPts + c_batchSize - 1) / c_batchSize);
+  int numArrays  = (int)inArrays.size();
+  vtkIdType numValid = 0;
+
+  #pragma omp parallel for schedule(dynamic,16) reduction(+:numValid)
+  for (int batch=0; batch < numBatches; batch++)
+  {
+    ProbeBatch b;
+    vtkIdType first = (vtkIdType)batch*c_batchSize;
+    int n = (int)((numPts - first < c_batchSize) ? numPts - first : c_batchSize);
+
+    ImageProbeFilterWeights(g, &coords[3*first], n, b);
+
+    for (int a=0; a < numArrays; a++)
+    {
+      int nc = inArrays[a]->GetNumberOfComponents();
+      void *inPtr  = inArrays [a]->GetVoidPointer(0);
+      void *outPtr = outArrays[a]->GetVoidPointer(first*nc);
+      switch (inArrays[a]->GetDataType())
+      {
+        vtkTemplateMacro(
+          ImageProbeFilterInterpolate(static_cast<const VTK_TT*>(inPtr),
+                                      static_cast<VTK_TT*>(outPtr), nc, g, b, n));
+      }
+    }
+
+    for (int i=0; i < n; i++)
+    {
+      maskPtr[first+i] = b.valid[i];
+      numValid += b.valid[i];
+    }
+  }
+
+  this->NumberOfValidPoints = numValid;
+  return 1;
+}
+
+//----------------------------------------------------------------------------
+void ImageProbeFilter::PrintSelf(ostream& os, vtkIndent indent)
+{
+  this->Superclass::PrintSelf(os,indent);
+  os << indent << "Tolerance: " << this->Tolerance << "\n";
+}
@@ -0,0 +1,58 @@
+#ifndef __ImageProbeFilter_h
+#define __ImageProbeFilter_h
+
+#include "vtkDataSetAlgorithm.h"
+
+class vtkImageData;
+
+/// Trilinear resampling of vtkImageData point data at the points of a dataset.
+///
+/// Drop-in replacement for vtkProbeFilter restricted to a regular grid source.
+/// Cells are not located generically, instead grid indices and trilinear
+/// weights are computed directly from origin and spacing. Points are processed
+/// in batches: weights of a batch are computed first, then each source array
+/// is gathered. Batches are distributed over threads via OpenMP if available.
+///
+/// As vtkProbeFilter the output has the structure of the input (port 0) and
+/// carries all point data arrays of the source (port 1) with their names and
+/// attribute roles and an additional "vtkValidPointMask" char array. Points
+/// outside the grid get zero values and a mask of 0.
+class ImageProbeFilter : public vtkDataSetAlgorithm
+{
+public:
+  vtkTypeMacro(ImageProbeFilter,vtkDataSetAlgorithm);
+  void PrintSelf(ostream& os, vtkIndent indent);
+  static ImageProbeFilter *New();
+
+  /// Set image data to be probed (same as SetInput(1,source))
+  void SetSource(vtkDataObject *source);
+  vtkDataObject *GetSource();
+  void SetSourceConnection(vtkAlgorithmOutput* algOutput);
+
+  /// Tolerance in voxels for points just outside the grid (default 1e-6)
+  void SetTolerance(double tol){Tolerance=tol;}
+  double GetTolerance() const {return Tolerance;}
+
+  /// Number of points inside the grid in last update
+  vtkIdType GetNumberOfValidPoints() const {return NumberOfValidPoints;}
+
+protected:
+  ImageProbeFilter();
+  ~ImageProbeFilter();
+
+  int RequestData(vtkInformation *, vtkInformationVector **, vtkInformationVector *);
+  int RequestUpdateExtent(vtkInformation *, vtkInformationVector **, vtkInformationVector *);
+  int FillInputPortInformation(int port, vtkInformation *info);
+
+  /// Copy input point coordinates into contiguous array of 3*n doubles
+  static void GetPointCoordinates(vtkDataSet *input, double *coords);
+
+  double    Tolerance;
+  vtkIdType NumberOfValidPoints;
+
+private:
+  ImageProbeFilter(const ImageProbeFilter&);  // Not implemented.
+  void operator=(const ImageProbeFilter&);  // Not implemented.
+};
+
+#endif
@@ -19,18 +19,91 @@
 #include "vtkCellArray.h"
 #include "vtkVertex.h"
 #include "vtkCellData.h"
+#include "vtkIdTypeArray.h"
+#include "vtkFloatArray.h"
+#include <boost/random/mersenne_twister.hpp>
+#include <boost/random/uniform_real.hpp>
+#include <boost/random/variate_generator.hpp>
+#include <cmath>
+#include <algorithm>
 vtkStandardNewMacro(PointSamplerFilter);
  
 PointSamplerFilter::PointSamplerFilter()
 {
 	this->SetNumberOfInputPorts(1);
 	this->SetNumberOfOutputPorts(1);
+	useMeshNormals = false;
+	numberOfSamplingPoints = 0;
+	seed = 5489u; // default seed of boost::mt19937
 }
  
 PointSamplerFilter::~PointSamplerFilter()
 {
 }
 
+double PointSamplerFilter::triangleArea(const double a[3], const double b[3], const double c[3])
+{
+	double vectorA[3];
+	double vectorB[3];
+	for (int iB=0;iB<3;iB++)
+	{
+		vectorA[iB]=b[iB]-a[iB];
+		vectorB[iB]=c[iB]-a[iB];
+	}
+
+	double AxB[3];
+	AxB[0]= vectorA[1]*vectorB[2]-vectorA[2]*vectorB[1];
+	AxB[1]= vectorA[2]*vectorB[0]-vectorA[0]*vectorB[2];
+	AxB[2]= vectorA[0]*vectorB[1]-vectorA[1]*vectorB[0];
+
+	return 0.5*sqrt(AxB[0]*AxB[0]+AxB[1]*AxB[1]+AxB[2]*AxB[2]);
+}
+
+void PointSamplerFilter::buildAliasTable(const std::vector<double>& weights,
+                                         std::vector<double>& prob, std::vector<int>& alias)
+{
+	// Vose's variant of Walker's alias method
+	int n=(int)weights.size();
+	prob .assign(n,1.0);
+	alias.resize(n);
+	for (int iA=0;iA<n;iA++)
+		alias[iA]=iA;
+
+	double sum=0;
+	for (int iA=0;iA<n;iA++)
+		sum+=weights[iA];
+	if (n==0 || sum<=0)
+		return;
+
+	std::vector<double> scaled(n);
+	std::vector<int> small, large;
+	for (int iA=0;iA<n;iA++)
+	{
+		scaled[iA]=weights[iA]*n/sum;
+		if (scaled[iA]<1.0)
+			small.push_back(iA);
+		else
+			large.push_back(iA);
+	}
+
+	while (!small.empty() && !large.empty())
+	{
+		int s=small.back(); small.pop_back();
+		int l=large.back();
+		prob [s]=scaled[s];
+		alias[s]=l;
+		scaled[l]=(scaled[l]+scaled[s])-1.0;
+		if (scaled[l]<1.0)
+		{
+			large.pop_back();
+			small.push_back(l);
+		}
+	}
+	// Remaining entries are 1 up to rounding
+	for (size_t iA=0;iA<large.size();iA++) prob[large[iA]]=1.0;
+	for (size_t iA=0;iA<small.size();iA++) prob[small[iA]]=1.0;
+}
+
 int PointSamplerFilter::RequestData(vtkInformation *vtkNotUsed(request),
                                              vtkInformationVector **inputVector,
                                              vtkInformationVector *outputVector)
@@ -47,144 +120,137 @@ int PointSamplerFilter::RequestData(vtkInformation *vtkNotUsed(request),
 	vtkPolyData *pointsOutput= vtkPolyData::SafeDownCast(
 	  infoPoints->Get(vtkDataObject::DATA_OBJECT()));
 
-  
-	std::vector<double> areaVector;
-  	vtkSmartPointer<vtkPoints>	    thePoints  = vtkSmartPointer<vtkPoints     >::New();   
-	vtkSmartPointer<vtkCellArray>   someVertex = vtkSmartPointer<vtkCellArray  >::New();
-	vtkSmartPointer<vtkVertex>      vertex     = vtkSmartPointer<vtkVertex     >::New();
-	vtkSmartPointer<vtkDoubleArray> theNormals = vtkSmartPointer<vtkDoubleArray>::New();   
-	theNormals->SetNumberOfComponents(3);
+	// triangle list (fan triangulation of polygons) read directly
+	// from connectivity array
+	std::vector<vtkIdType> triangles;
+	std::vector<double>    areaVector;
+	vtkPoints* meshPoints=meshInput->GetPoints();
+	vtkCellArray* polys=meshInput->GetPolys();
+	if (meshPoints && polys)
+	{
+		triangles .reserve(3*polys->GetNumberOfCells());
+		areaVector.reserve(  polys->GetNumberOfCells());
 
-	// generate lookup table for cell numbers
-	for (int iA=0;iA<meshInput->GetNumberOfCells();iA++)
-    {
-		double pointX[3];
-		double pointY[3]; 
-		double pointZ[3]; 
-		meshInput->GetCell(iA)->GetPoints()->GetPoint(0,pointX);
-		meshInput->GetCell(iA)->GetPoints()->GetPoint(1,pointY);
-		meshInput->GetCell(iA)->GetPoints()->GetPoint(2,pointZ);
-
-		double vectorA[3];
-		double vectorB[3];
-
-		vectorA[0]=pointY[0]-pointX[0];
-		vectorA[1]=pointY[1]-pointX[1];
-		vectorA[2]=pointY[2]-pointX[2];
-
-		vectorB[0]=pointZ[0]-pointX[0];
-		vectorB[1]=pointZ[1]-pointX[1];
-		vectorB[2]=pointZ[2]-pointX[2];
-
-		// calculate the determinate of this two 
-		//first crossproduct
-		double AxB[3];
-		AxB[0]= vectorA[1]*vectorB[2]-vectorA[2]-vectorB[1];
-		AxB[1]= vectorA[2]*vectorB[0]-vectorA[0]-vectorB[2];
-		AxB[2]= vectorA[0]*vectorB[1]-vectorA[1]-vectorB[0];
-
-		// make a norm of this one 
-		double norm=AxB[0]*AxB[0]+AxB[1]*AxB[1]+AxB[2]*AxB[2];
-		norm = sqrt(norm);
-		
-		// we have a area , wahoo 
-		//put this in a vector for look up 
-		double area= 0.5*norm;
-		if (areaVector.empty())
-			areaVector.push_back(area);
-		else
-		{	// sum the area for index 
-			areaVector.push_back(area+areaVector.at(iA-1));
-		}
-
-	}
-	// generate Sampling Points 
-	for (int iA=0;iA<numberOfSamplingPoints;iA++)
-    {
-		// find the triangle we wanna work with
-		double totalArea= areaVector.at(areaVector.size()-1);   // last element of this one is total area
-		double aRandNum= (double)rand()/RAND_MAX ;				// a value between 0 and 1
-		double randomArea= totalArea*aRandNum;
-		
-		// now we have a areaValue and we need to find the index in the area Vector 
-		bool done=false;
-		int left=0;
-		int right=(int)areaVector.size();
-		int mid=0.5*(left+right);
-		while(!done)
-		{
-			if(left==mid)
-				done=true;
-			if (areaVector.at(mid)<randomArea)
+		vtkIdType npts, *pts;
+		for (polys->InitTraversal(); polys->GetNextCell(npts,pts); )
+			for (vtkIdType iB=2;iB<npts;iB++)
 			{
-				left=mid;
-				mid=0.5*(left+right);
-			}
-			else
-			{
-				right=mid;
-				mid=0.5*(left+right);
+				double pointX[3], pointY[3], pointZ[3];
+				meshPoints->GetPoint(pts[0],   pointX);
+				meshPoints->GetPoint(pts[iB-1],pointY);
+				meshPoints->GetPoint(pts[iB],  pointZ);
+
+				triangles.push_back(pts[0]);
+				triangles.push_back(pts[iB-1]);
+				triangles.push_back(pts[iB]);
+				areaVector.push_back(triangleArea(pointX,pointY,pointZ));
 			}
-		}
+	}
 
-		int index=left;
-
-		// get the points for Barycentric coordinate system
-		double pointX[3];
-		double pointY[3]; 
-		double pointZ[3]; 
-		meshInput->GetCell(index)->GetPoints()->GetPoint(0,pointX);
-		meshInput->GetCell(index)->GetPoints()->GetPoint(1,pointY);
-		meshInput->GetCell(index)->GetPoints()->GetPoint(2,pointZ);
-		
-		if (useMeshNormals)
-		{
-			// get the normal vector for this point Ids
-			// FIND OUT; is the normal for all points in the 
-			// Trinangel the same ? >> looks like it 
-			// thats why we just read one point and 
-			// save its normal data 
-			int pIDx=meshInput->GetCell(index)->GetPointId(0);
-			double *normalX = meshInput->GetPointData()->GetNormals()->GetTuple3(pIDx);
-			double normX[3];
+	int numTriangles=(int)areaVector.size();
+	int numSamples  =(numTriangles>0) ? numberOfSamplingPoints : 0;
+	if (numTriangles==0)
+		vtkWarningMacro(<<"No polygons to sample!");
 
-			for (int iB=0;iB<3;iB++)
-				normX[iB]=normalX[iB];
-			
-			theNormals->InsertTuple3(iA,normX[0],normX[1],normX[2]);
-		}
-		// generate a random point on the triangele surface
-		double x,y,z;
-	
-		double rand1=(double)rand()/RAND_MAX;
-		double rand2=(double)rand()/RAND_MAX;
-		double rand3=(double)rand()/RAND_MAX;
+	std::vector<double> prob;
+	std::vector<int> alias;
+	buildAliasTable(areaVector,prob,alias);
+
+	// output arrays (allocated up front, filled in parallel)
+	vtkSmartPointer<vtkPoints> thePoints = vtkSmartPointer<vtkPoints>::New();
+	thePoints->SetDataTypeToFloat();
+	thePoints->SetNumberOfPoints(numSamples);
+	float* outPts = static_cast<float*>(thePoints->GetData()->GetVoidPointer(0));
 
-		double lambda1= rand1/(rand1+rand2+rand3);
-		double lambda2= rand2/(rand1+rand2+rand3);
-		double lambda3= rand3/(rand1+rand2+rand3);
+	vtkSmartPointer<vtkIdTypeArray> vertIds = vtkSmartPointer<vtkIdTypeArray>::New();
+	vertIds->SetNumberOfValues(2*(vtkIdType)numSamples);
+	vtkIdType* outVerts = vertIds->GetPointer(0);
 
-		double sum = lambda1+lambda2+lambda3; // just a check value; sum should be 1 
+	vtkDataArray* meshNormals = meshInput->GetPointData()->GetNormals();
+	bool withNormals = useMeshNormals && meshNormals;
+	vtkSmartPointer<vtkFloatArray> theNormals = vtkSmartPointer<vtkFloatArray>::New();
+	theNormals->SetNumberOfComponents(3);
+	theNormals->SetNumberOfTuples(withNormals ? numSamples : 0);
+	float* outNormals = withNormals ? theNormals->GetPointer(0) : NULL;
+	if (useMeshNormals && !meshNormals)
+		vtkWarningMacro(<<"Mesh has no normals!");
 
-		x= lambda1*pointX[0]+lambda2*pointY[0]+lambda3*pointZ[0];
-		y= lambda1*pointX[1]+lambda2*pointY[1]+lambda3*pointZ[1];
-		z= lambda1*pointX[2]+lambda2*pointY[2]+lambda3*pointZ[2];
+	// mesh coordinates and normals as contiguous double arrays (vtkPoints
+	// and vtkDataArray accessors are not thread-safe)
+	vtkIdType numMeshPoints = meshPoints ? meshPoints->GetNumberOfPoints() : 0;
+	std::vector<double> coords (3*numMeshPoints);
+	std::vector<double> normals(withNormals ? 3*numMeshPoints : 0);
+	for (vtkIdType iA=0;iA<numMeshPoints;iA++)
+	{
+		meshPoints->GetPoint(iA,&coords[3*iA]);
+		if (withNormals)
+			meshNormals->GetTuple(iA,&normals[3*iA]);
+	}
 
-		double randomPoint[3] ;
-		randomPoint[0]=x;
-		randomPoint[1]=y;
-		randomPoint[2]=z;
+	// generate sampling points in fixed size blocks, each with its own
+	// random generator, such that result does not depend on thread count
+	const int blockSize=4096;
+	int numBlocks=(numSamples+blockSize-1)/blockSize;
 
-		// insert random point to polydata Points and create a vertex so we can see the point
-		vtkIdType pid[1]; 
-		pid[0] = thePoints->InsertNextPoint (randomPoint); 
-		someVertex->InsertNextCell ( 1,pid );
+	#pragma omp parallel for schedule(dynamic)
+	for (int block=0;block<numBlocks;block++)
+	{
+		boost::mt19937 rng(seed + 2654435761u*(unsigned)block);
+		boost::variate_generator< boost::mt19937&, boost::uniform_real<> >
+			uniform(rng, boost::uniform_real<>(0.0,1.0));
 
+		int first=block*blockSize;
+		int last =std::min(first+blockSize,numSamples);
+		for (int iA=first;iA<last;iA++)
+		{
+			// O(1) triangle selection proportional to area
+			int index=std::min((int)(uniform()*numTriangles),numTriangles-1);
+			if (uniform()>=prob[index])
+				index=alias[index];
+
+			const vtkIdType* tri=&triangles[3*index];
+			const double* pointX=&coords[3*tri[0]];
+			const double* pointY=&coords[3*tri[1]];
+			const double* pointZ=&coords[3*tri[2]];
+
+			// uniform random point on the triangle surface
+			double r1=sqrt(uniform());
+			double r2=uniform();
+			double lambda1=1.0-r1;
+			double lambda2=r1*(1.0-r2);
+			double lambda3=r1*r2;
+
+			for (int iB=0;iB<3;iB++)
+				outPts[3*iA+iB]=(float)(lambda1*pointX[iB]+lambda2*pointY[iB]+lambda3*pointZ[iB]);
+
+			outVerts[2*iA  ]=1;
+			outVerts[2*iA+1]=iA;
+
+			if (withNormals)
+			{
+				// interpolate vertex normals
+				const double* nX=&normals[3*tri[0]];
+				const double* nY=&normals[3*tri[1]];
+				const double* nZ=&normals[3*tri[2]];
+				double n[3];
+				for (int iB=0;iB<3;iB++)
+					n[iB]=lambda1*nX[iB]+lambda2*nY[iB]+lambda3*nZ[iB];
+				double len=sqrt(n[0]*n[0]+n[1]*n[1]+n[2]*n[2]);
+				if (len>0)
+					for (int iB=0;iB<3;iB++) n[iB]/=len;
+				for (int iB=0;iB<3;iB++)
+					outNormals[3*iA+iB]=(float)n[iB];
+			}
+		}
 	}
+
+	vtkSmartPointer<vtkCellArray> someVertex = vtkSmartPointer<vtkCellArray>::New();
+	someVertex->SetCells(numSamples,vertIds);
+
 	// generate OutPut PolyData 
 	pointsOutput->SetPoints(thePoints);  // set the points
 	pointsOutput->SetVerts(someVertex);  // set the vertex
-	if (useMeshNormals)
+	if (withNormals)
 		pointsOutput->GetPointData()->SetNormals(theNormals);
     return 1;
 }
@@ -3,6 +3,15 @@
  
 #include "vtkPolyDataAlgorithm.h"
 #include "vtkScalarsToColors.h"
+#include <vector>
+
+/// Uniform random point samples on the polygons of a mesh.
+///
+/// Triangles (polygons are fan triangulated) are selected proportional to
+/// their area in O(1) via an alias table, points are drawn uniformly on the
+/// selected triangle. Samples are generated in parallel (OpenMP) in fixed
+/// blocks, each with its own random generator derived from the seed, such
+/// that the output only depends on the seed and not on the number of threads.
 class PointSamplerFilter : public vtkPolyDataAlgorithm 
 {
 public:
@@ -13,6 +22,17 @@ public:
  
   void setNumberOfSamplingPoints(int num){numberOfSamplingPoints=num;}
   void saveMeshNormas(bool yes){useMeshNormals=yes;}
+  void setSeed(unsigned s){seed=s;this->Modified();}
+
+  /// Area of triangle (a,b,c), i.e. half the norm of (b-a)x(c-a)
+  static double triangleArea(const double a[3], const double b[3], const double c[3]);
+
+  /// Walker's alias table for sampling index i with probability
+  /// weights[i]/sum(weights). Draw with uniform r1,r2 in [0,1) as
+  /// i=floor(r1*n); return (r2 < prob[i]) ? i : alias[i];
+  static void buildAliasTable(const std::vector<double>& weights,
+                              std::vector<double>& prob, std::vector<int>& alias);
+
 protected:
   PointSamplerFilter();
   ~PointSamplerFilter();
@@ -25,6 +45,7 @@ private:
 
   bool useMeshNormals;
   int numberOfSamplingPoints;
+  unsigned seed;
 };
  
 #endif
@@ -0,0 +1,113 @@
+// PointSamplerFilterTest - checks triangle area and alias table sampling
+// of PointSamplerFilter.
+#undef NDEBUG // keep assertions in release builds
+#include "PointSamplerFilter.h"
+#include <boost/random/mersenne_twister.hpp>
+#include <boost/random/uniform_real.hpp>
+#include <boost/random/variate_generator.hpp>
+#include <cassert>
+#include <cmath>
+#include <iostream>
+#include <vector>
+
+namespace {
+
+bool nearlyEqual( double a, double b, double eps=1e-12 )
+{
+	return std::fabs(a-b) <= eps;
+}
+
+void testTriangleArea()
+{
+	const double o[3] = { 0, 0, 0 };
+	const double x[3] = { 1, 0, 0 };
+	const double y[3] = { 0, 1, 0 };
+	const double z[3] = { 0, 0, 1 };
+
+	// unit right triangles in the three coordinate planes, such that each
+	// component of the cross product is exercised on its own
+	assert( nearlyEqual( PointSamplerFilter::triangleArea(o,x,y), 0.5 ) );
+	assert( nearlyEqual( PointSamplerFilter::triangleArea(o,y,z), 0.5 ) );
+	assert( nearlyEqual( PointSamplerFilter::triangleArea(o,z,x), 0.5 ) );
+
+	// area does not depend on orientation
+	assert( nearlyEqual( PointSamplerFilter::triangleArea(o,y,x), 0.5 ) );
+
+	// equilateral triangle with edge length sqrt(2)
+	assert( nearlyEqual( PointSamplerFilter::triangleArea(x,y,z),
+	                     std::sqrt(3.0)/2.0 ) );
+
+	// general position: edges (3,4,0) and (0,0,5) meet at a right angle in a
+	const double a[3] = { 1, 1, 1 };
+	const double b[3] = { 4, 5, 1 };
+	const double c[3] = { 1, 1, 6 };
+	assert( nearlyEqual( PointSamplerFilter::triangleArea(a,b,c), 12.5 ) );
+
+	// degenerate (collinear) triangle
+	const double d[3] = { 2, 2, 2 };
+	assert( nearlyEqual( PointSamplerFilter::triangleArea(o,a,d), 0.0 ) );
+}
+
+void testAliasTable()
+{
+	std::vector<double> weights;
+	weights.push_back( 1.0 );
+	weights.push_back( 2.0 );
+	weights.push_back( 0.0 );
+	weights.push_back( 3.0 );
+	weights.push_back( 4.0 );
+	const int n = (int)weights.size();
+	const double sum = 10.0;
+
+	std::vector<double> prob;
+	std::vector<int> alias;
+	PointSamplerFilter::buildAliasTable( weights, prob, alias );
+	assert( (int)prob .size() == n );
+	assert( (int)alias.size() == n );
+
+	// exact probability of drawing each index from the table
+	std::vector<double> p( n, 0.0 );
+	for( int i=0; i < n; i++ )
+	{
+		assert( prob[i] >= 0.0 && prob[i] <= 1.0 );
+		assert( alias[i] >= 0 && alias[i] < n );
+		p[i]        += prob[i] / n;
+		p[alias[i]] += (1.0 - prob[i]) / n;
+	}
+	for( int i=0; i < n; i++ )
+		assert( nearlyEqual( p[i], weights[i]/sum ) );
+
+	// empirical frequencies, drawn the same way as in RequestData()
+	boost::mt19937 rng( 5489u );
+	boost::uniform_real<double> unit( 0.0, 1.0 );
+	boost::variate_generator<boost::mt19937&, boost::uniform_real<double> >
+		uniform( rng, unit );
+
+	const int numDraws = 200000;
+	std::vector<int> count( n, 0 );
+	for( int k=0; k < numDraws; k++ )
+	{
+		int i = (int)(uniform()*n);
+		if( i >= n ) i = n-1;
+		count[ (uniform() < prob[i]) ? i : alias[i] ]++;
+	}
+	assert( count[2] == 0 ); // zero weight is never drawn
+	for( int i=0; i < n; i++ )
+		assert( nearlyEqual( count[i]/(double)numDraws, weights[i]/sum, 0.01 ) );
+
+	// degenerate input yields identity table
+	std::vector<double> zeros( 3, 0.0 );
+	PointSamplerFilter::buildAliasTable( zeros, prob, alias );
+	for( int i=0; i < 3; i++ )
+		assert( prob[i] == 1.0 && alias[i] == i );
+}
+
+} // namespace
+
+int main( int, char** )
+{
+	testTriangleArea();
+	testAliasTable();
+	std::cout << "PointSamplerFilterTest passed." << std::endl;
+	return 0;
+}
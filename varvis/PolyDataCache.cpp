@@ -0,0 +1,371 @@
+#include "PolyDataCache.h"
+
+#include <vtkPolyData.h>
+#include <vtkPolyDataReader.h>
+#include <vtkPoints.h>
+#include <vtkCellArray.h>
+#include <vtkIdTypeArray.h>
+#include <vtkDataArray.h>
+#include <vtkPointData.h>
+#include <vtkSmartPointer.h>
+
+#include <QFile>
+#include <QFileInfo>
+#include <QDir>
+#include <QDateTime>
+#include <QTextStream>
+#include <QByteArray>
+
+#include <vector>
+#include <cstring>  // for memcpy(), memcmp(), strncpy()
+#include <iostream>
+
+using namespace std;
+
+namespace {
+	const char c_magic[4] = { 'P','D','C','1' };
+
+	struct Header
+	{
+		char    magic[4];
+		qint32  numArrays;
+		quint64 key;
+		qint64  numPoints;
+		qint32  pointType;
+		qint32  reserved;
+		qint64  cells[3][2]; // number of cells and ids of verts, lines, polys
+	};
+
+	struct ArrayHeader
+	{
+		char    name[64];
+		qint32  type;
+		qint32  components;
+		qint32  attribute; // -1 if not an attribute
+		qint32  reserved;
+		qint64  numTuples;
+	};
+
+	qint64 padded( qint64 size )
+	{
+		return (size + 7) & ~(qint64)7;
+	}
+
+	bool writePadded( QFile& f, const void* data, qint64 size )
+	{
+		static const char zeros[8] = { 0,0,0,0,0,0,0,0 };
+		if( size > 0 && f.write( (const char*)data, size ) != size )
+			return false;
+		qint64 pad = padded(size) - size;
+		return pad == 0 || f.write( zeros, pad ) == pad;
+	}
+
+	vtkCellArray* getCells( vtkPolyData* pd, int i )
+	{
+		switch( i )
+		{
+		case 0: return pd->GetVerts();
+		case 1: return pd->GetLines();
+		default: return pd->GetPolys();
+		}
+	}
+}
+
+//-----------------------------------------------------------------------------
+//	Keys
+//-----------------------------------------------------------------------------
+
+quint64 PolyDataCache::hash( quint64 key, const void* data, size_t size )
+{
+	quint64 h = key ? key : Q_UINT64_C(14695981039346656037);
+	const unsigned char* p = (const unsigned char*)data;
+	for( size_t i=0; i < size; i++ )
+	{
+		h ^= p[i];
+		h *= Q_UINT64_C(1099511628211);
+	}
+	return h;
+}
+
+quint64 PolyDataCache::hashFile( const QString& filename )
+{
+	QFile f( filename );
+	if( !f.open( QIODevice::ReadOnly ) )
+		return 0;
+
+	quint64 key = 0;
+	QByteArray buf;
+	do {
+		buf = f.read( 1<<20 );
+		key = hash( key, buf.constData(), (size_t)buf.size() );
+	} while( buf.size() > 0 );
+	return key;
+}
+
+quint64 PolyDataCache::hashVolumeFile( const QString& mhdFilename )
+{
+	quint64 key = hashFile( mhdFilename );
+	if( !key )
+		return 0;
+
+	// Raw data filename from header
+	QFile f( mhdFilename );
+	if( !f.open( QIODevice::ReadOnly | QIODevice::Text ) )
+		return 0;
+	QString dataFile;
+	QTextStream ts( &f );
+	while( !ts.atEnd() && dataFile.isEmpty() )
+	{
+		QString line = ts.readLine();
+		int eq = line.indexOf( '=' );
+		if( eq > 0 && line.left( eq ).trimmed() == "ElementDataFile" )
+			dataFile = line.mid( eq+1 ).trimmed();
+	}
+
+	// Data stored in header itself is already covered by its hash
+	if( dataFile == "LOCAL" )
+		return key;
+
+	// Raw data is relative to header (file lists are not supported)
+	QFileInfo info( QFileInfo( mhdFilename ).dir(), dataFile );
+	if( dataFile.isEmpty() || !info.isFile() )
+		return 0;
+
+	qint64  size  = info.size();
+	quint32 mtime = info.lastModified().toTime_t();
+	key = hash( key, &size,  sizeof(size) );
+	key = hash( key, &mtime, sizeof(mtime) );
+	return key;
+}
+
+QString PolyDataCache::cacheFilename( const QString& source, const QString& tag )
+{
+	QFileInfo info( source );
+	return info.path() + "/" + info.completeBaseName() + "." + tag + ".pdc";
+}
+
+//-----------------------------------------------------------------------------
+//	Serialization
+//-----------------------------------------------------------------------------
+
+bool PolyDataCache::save( const QString& filename, vtkPolyData* pd, quint64 key )
+{
+	if( !pd )
+		return false;
+
+	Header h;
+	memset( &h, 0, sizeof(Header) );
+	memcpy( h.magic, c_magic, 4 );
+	h.key = key;
+
+	vtkPoints* points = pd->GetPoints();
+	h.numPoints = points ? points->GetNumberOfPoints() : 0;
+	h.pointType = points ? points->GetDataType() : VTK_FLOAT;
+
+	// Connectivity as 32 bit ids
+	std::vector<qint32> ids[3];
+	for( int i=0; i < 3; i++ )
+	{
+		vtkCellArray* ca = getCells( pd, i );
+		if( !ca || ca->GetNumberOfCells() == 0 )
+			continue;
+		vtkIdTypeArray* data = ca->GetData();
+		h.cells[i][0] = ca->GetNumberOfCells();
+		h.cells[i][1] = data->GetNumberOfTuples();
+		ids[i].resize( (size_t)h.cells[i][1] );
+		for( size_t j=0; j < ids[i].size(); j++ )
+		{
+			vtkIdType id = data->GetValue( (vtkIdType)j );
+			if( id > 0x7fffffff )
+			{
+				cerr << "PolyDataCache::save() : Too many points for cache!" << endl;
+				return false;
+			}
+			ids[i][j] = (qint32)id;
+		}
+	}
+
+	// Point data arrays (bit arrays and non-numeric arrays are skipped)
+	std::vector<vtkDataArray*> arrays;
+	std::vector<ArrayHeader> arrayHeaders;
+	vtkPointData* pointData = pd->GetPointData();
+	for( int i=0; i < pointData->GetNumberOfArrays(); i++ )
+	{
+		vtkDataArray* a = pointData->GetArray( i );
+		if( !a || a->GetDataType() == VTK_BIT )
+			continue;
+
+		ArrayHeader ah;
+		memset( &ah, 0, sizeof(ArrayHeader) );
+		if( a->GetName() )
+			strncpy( ah.name, a->GetName(), sizeof(ah.name)-1 );
+		ah.type       = a->GetDataType();
+		ah.components = a->GetNumberOfComponents();
+		ah.attribute  = pointData->IsArrayAnAttribute( i );
+		ah.numTuples  = a->GetNumberOfTuples();
+
+		arrays.push_back( a );
+		arrayHeaders.push_back( ah );
+	}
+	h.numArrays = (qint32)arrays.size();
+
+	// Write header and sections, each padded to 8 bytes
+	QFile f( filename );
+	if( !f.open( QIODevice::WriteOnly ) )
+	{
+		cerr << "Error: Could not open \"" << filename.toStdString() << "\" for writing!" << endl;
+		return false;
+	}
+
+	bool ok = writePadded( f, &h, sizeof(Header) );
+	for( size_t i=0; ok && i < arrayHeaders.size(); i++ )
+		ok = writePadded( f, &arrayHeaders[i], sizeof(ArrayHeader) );
+	if( ok && h.numPoints > 0 )
+		ok = writePadded( f, points->GetData()->GetVoidPointer(0),
+		        3*h.numPoints*points->GetData()->GetDataTypeSize() );
+	for( int i=0; ok && i < 3; i++ )
+		if( !ids[i].empty() )
+			ok = writePadded( f, &ids[i][0], ids[i].size()*sizeof(qint32) );
+	for( size_t i=0; ok && i < arrays.size(); i++ )
+		ok = writePadded( f, arrays[i]->GetVoidPointer(0),
+		        arrayHeaders[i].numTuples * arrayHeaders[i].components
+		        * arrays[i]->GetDataTypeSize() );
+
+	if( !ok )
+	{
+		cerr << "Error: Could not write \"" << filename.toStdString() << "\"!" << endl;
+		f.remove();
+	}
+	return ok;
+}
+
+bool PolyDataCache::load( const QString& filename, vtkPolyData* pd, quint64 key )
+{
+	QFile f( filename );
+	if( !pd || !f.open( QIODevice::ReadOnly ) )
+		return false;
+
+	qint64 size = f.size();
+	const uchar* base = (size >= (qint64)sizeof(Header)) ? f.map( 0, size ) : NULL;
+	if( !base )
+		return false;
+
+	Header h;
+	memcpy( &h, base, sizeof(Header) );
+	if( memcmp( h.magic, c_magic, 4 ) != 0 || h.key != key || h.numArrays < 0 ||
+		h.numPoints < 0 )
+	{
+		f.unmap( (uchar*)base );
+		return false;
+	}
+
+	// Validate section sizes against file size before touching any data
+	qint64 ofs = padded( sizeof(Header) ) + h.numArrays*padded( sizeof(ArrayHeader) );
+	std::vector<ArrayHeader> arrayHeaders( h.numArrays );
+	vtkSmartPointer<vtkPoints> points = vtkSmartPointer<vtkPoints>::New();
+	points->SetDataType( h.pointType );
+	qint64 required = ofs + padded( 3*h.numPoints*points->GetData()->GetDataTypeSize() );
+	for( int i=0; i < 3; i++ )
+		required += padded( h.cells[i][1]*(qint64)sizeof(qint32) );
+	for( int i=0; i < h.numArrays && ofs <= size; i++ )
+	{
+		memcpy( &arrayHeaders[i], base + padded( sizeof(Header) )
+		                                + i*padded( sizeof(ArrayHeader) ),
+		        sizeof(ArrayHeader) );
+		arrayHeaders[i].name[sizeof(arrayHeaders[i].name)-1] = 0;
+		int typeSize = vtkDataArray::GetDataTypeSize( arrayHeaders[i].type );
+		required += padded( arrayHeaders[i].numTuples * arrayHeaders[i].components
+		                    * typeSize );
+	}
+	if( ofs > size || required != size )
+	{
+		cerr << "Error: \"" << filename.toStdString() << "\" is not a valid cache file!" << endl;
+		f.unmap( (uchar*)base );
+		return false;
+	}
+
+	pd->Initialize();
+
+	// Points
+	points->SetNumberOfPoints( h.numPoints );
+	qint64 bytes = 3*h.numPoints*points->GetData()->GetDataTypeSize();
+	if( bytes > 0 )
+		memcpy( points->GetData()->GetVoidPointer(0), base + ofs, bytes );
+	ofs += padded( bytes );
+	pd->SetPoints( points );
+
+	// Connectivity
+	for( int i=0; i < 3; i++ )
+	{
+		qint64 numIds = h.cells[i][1];
+		const qint32* src = (const qint32*)(base + ofs);
+		ofs += padded( numIds*sizeof(qint32) );
+		if( numIds == 0 )
+			continue;
+
+		vtkSmartPointer<vtkIdTypeArray> ids = vtkSmartPointer<vtkIdTypeArray>::New();
+		ids->SetNumberOfValues( numIds );
+		vtkIdType* dst = ids->GetPointer(0);
+		for( qint64 j=0; j < numIds; j++ )
+			dst[j] = src[j];
+
+		vtkSmartPointer<vtkCellArray> ca = vtkSmartPointer<vtkCellArray>::New();
+		ca->SetCells( h.cells[i][0], ids );
+		switch( i )
+		{
+		case 0: pd->SetVerts( ca ); break;
+		case 1: pd->SetLines( ca ); break;
+		case 2: pd->SetPolys( ca ); break;
+		}
+	}
+
+	// Point data
+	for( int i=0; i < h.numArrays; i++ )
+	{
+		const ArrayHeader& ah = arrayHeaders[i];
+		vtkDataArray* a = vtkDataArray::CreateDataArray( ah.type );
+		if( !a )
+			continue;
+		if( ah.name[0] )
+			a->SetName( ah.name );
+		a->SetNumberOfComponents( ah.components );
+		a->SetNumberOfTuples( ah.numTuples );
+		bytes = ah.numTuples * ah.components * a->GetDataTypeSize();
+		if( bytes > 0 )
+			memcpy( a->GetVoidPointer(0), base + ofs, bytes );
+		ofs += padded( bytes );
+
+		if( ah.attribute >= 0 )
+			pd->GetPointData()->SetAttribute( a, ah.attribute );
+		else
+			pd->GetPointData()->AddArray( a );
+		a->Delete();
+	}
+
+	f.unmap( (uchar*)base );
+	return true;
+}
+
+bool PolyDataCache::readPolyData( const QString& filename, vtkPolyData* pd,
+                                  bool writeCache, quint64* keyOut )
+{
+	if( !pd )
+		return false;
+
+	quint64 key = hashFile( filename );
+	if( keyOut )
+		*keyOut = key;
+
+	QString cache = cacheFilename( filename, "vtk" );
+	if( key && load( cache, pd, key ) )
+		return true;
+
+	vtkSmartPointer<vtkPolyDataReader> reader = vtkSmartPointer<vtkPolyDataReader>::New();
+	reader->SetFileName( filename.toAscii() );
+	reader->Update();
+	pd->DeepCopy( reader->GetOutput() );
+
+	if( writeCache && key && pd->GetNumberOfPoints() > 0 )
+		save( cache, pd, key ); // failure is not critical
+	return pd->GetNumberOfPoints() > 0;
+}
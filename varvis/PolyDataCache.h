@@ -0,0 +1,53 @@
+#ifndef POLYDATACACHE_H
+#define POLYDATACACHE_H
+
+#include <QString>
+#include <QtGlobal> // quint64
+
+class vtkPolyData;
+
+/// Binary cache files for polydata, e.g. meshes and point sample sets.
+///
+/// A cache file is a flat little header followed by 8 byte aligned raw
+/// sections: points, vertex/line/polygon connectivity (legacy VTK cell array
+/// layout as 32 bit ids) and all point data arrays with their name, type and
+/// attribute role. Files are memory mapped on load such that a warm start
+/// only copies the sections into VTK arrays instead of parsing.
+///
+/// Each file carries a 64 bit key. For caches of VTK files this is the hash
+/// of the source file content, for derived data (e.g. sample sets) the hash
+/// of the source combined with all generation parameters via \a hash().
+/// A cache file whose key does not match is ignored and overwritten.
+class PolyDataCache
+{
+public:
+	/// 64 bit FNV-1a hash of file content, returns 0 on error
+	static quint64 hashFile( const QString& filename );
+
+	/// Key of a MetaImage volume, i.e. hash of the MHD header combined with
+	/// size and modification time of its raw ElementDataFile (not hashed
+	/// since it may be huge), returns 0 on error
+	static quint64 hashVolumeFile( const QString& mhdFilename );
+
+	/// Continue FNV-1a hash with given bytes (start with key=0)
+	static quint64 hash( quint64 key, const void* data, size_t size );
+
+	/// Cache file for given source, i.e. same path and name with suffix
+	/// ".<tag>.pdc"
+	static QString cacheFilename( const QString& source, const QString& tag );
+
+	/// Write polydata to cache file
+	static bool save( const QString& filename, vtkPolyData* pd, quint64 key );
+
+	/// Load cache file into pd, fails if file is missing, invalid or was
+	/// written for a different key
+	static bool load( const QString& filename, vtkPolyData* pd, quint64 key );
+
+	/// Read legacy VTK polydata file via cache, i.e. load cache file next to
+	/// it if it matches, else parse the VTK file and (optionally) write the
+	/// cache file for next time. Optionally returns the key of the file.
+	static bool readPolyData( const QString& filename, vtkPolyData* pd,
+	                          bool writeCache=true, quint64* key=NULL );
+};
+
+#endif // POLYDATACACHE_H
@@ -2,6 +2,8 @@
 #include "GlyphVisualization.h"
 #include "PointSamplerFilter.h"
 #include "GlyphInvertFilter.h"
+#include "ImageProbeFilter.h"
+#include "PolyDataCache.h"
 
 // VarVis render includes
 #include <vtkPolyDataConnectivityFilter.h>
@@ -340,6 +342,8 @@ VarVisRender::VarVisRender()
 #endif
 	m_sampleRange=2500;
 	m_samlePointSize=2.5;
+	m_volumeKey=0;
+	m_meshKey=0;
 	m_useResolutionScaling=false;
 		
 	m_centroidNum=0.05;
@@ -377,7 +381,7 @@ void VarVisRender::init()
 	m_volume       = vtkVolume::New();
 	
 	// marching cube mesh
-	m_contour      = vtkMarchingCubes ::New();
+	m_contour      = BrickedMarchingCubes::New();
 	m_contMapper   = vtkPolyDataMapper::New();
 	m_contActor    = vtkActor         ::New();
 	
@@ -621,7 +625,7 @@ void VarVisRender::clusterVolumeGlyphs()
 	// proceed with glyphVisualisation  on this data
 	// (generate the Vectors for this data from loaded warp file)
 	vtkImageData * source= getWarpVis()->getImageData();
-	VTKPTR<vtkProbeFilter> probe = VTKPTR<vtkProbeFilter>::New();
+	VTKPTR<ImageProbeFilter> probe = VTKPTR<ImageProbeFilter>::New();
 	probe->SetInput(m_ClusterVolumeData);
 	probe->SetSource(source);
 	probe->Update();
@@ -766,18 +770,16 @@ void VarVisRender::clusterGlyphs()
 #endif
 	
 	m_Cluster->generateCentroids();
-	m_Cluster->setIterationDone(false);
 	m_Cluster->setEpsilon(0.001);
 	m_Cluster->calculateW(m_resolution[0],m_resolution[1],m_resolution[2]);
-	cout<<"clustering ";
-	for (int iA=0;iA<100;iA++)
-	{	cout<<"|";
-	if (!m_Cluster->isIterationDone())
-			m_Cluster->clusterIt();
-		else 
-			break;
-	}	
-	cout<<"done!"<<endl;
+
+	// Mini-batch k-means++ keeps large sample sets interactive. Runtime is
+	// bounded by the iteration count only, a time budget would make the
+	// result depend on machine load.
+	m_Cluster->setKMeansPlusPlus( true );
+	m_Cluster->setMiniBatchSize( 10000 );
+	m_Cluster->setMaxIterations( 100 );
+	m_Cluster->runClustering( false );
 	
 	// generate Visualisation 
 	m_Cluster->setVisualisationData(m_pointPolyData);
@@ -933,7 +935,7 @@ void VarVisRender::setWarp(QString mhdFilename, bool backwardsField)
 	getWarpVis()->setImageData(img_data.GetPointer());
 	getWarpVis()->setGlyphSize(m_glyphSize);
 	getWarpVis()->setGlyphAutoScaleFactor(m_glyphAutoScaling);
-	getWarpVis()->getGlyph3D()->SetScaleModeToScaleByVector();
+	getWarpVis()->setGlyphScaleByVector( true );
 
 	// add to visualization
 	addWarpVisActors();
@@ -1249,6 +1251,27 @@ void VarVisRender::resetRefMeshes()
 // -- generateSampleData -- 
 void VarVisRender::generateSampleData()
 {
+	// Reuse cached sample set of the same mesh and number of samples
+	QString cacheName;
+	quint64 key=0;
+	if (m_meshKey)
+	{
+		int params[2]={m_sampleRange,1}; // number of samples, with normals
+		key=PolyDataCache::hash(m_meshKey,params,sizeof(params));
+
+		// One file per sample set, e.g. "<source>.iso500.samples10000.pdc"
+		// for the isosurface of a volume
+		QString tag=QString("samples%1").arg(m_sampleRange);
+		if (m_meshSource==m_loadedReferenceName)
+			tag=QString("iso%1.").arg(m_isovalue)+tag;
+		cacheName=PolyDataCache::cacheFilename(m_meshSource,tag);
+		if (PolyDataCache::load(cacheName,m_pointPolyData,key))
+		{
+			m_samplesPresent=true;
+			return;
+		}
+	}
+
 	// Generate Samples
 	VTKPTR<PointSamplerFilter> sampler=VTKPTR<PointSamplerFilter>::New();
 	sampler->SetInput(m_mesh);
@@ -1256,9 +1279,23 @@ void VarVisRender::generateSampleData()
 	sampler->saveMeshNormas(true);
 	sampler->Update();
 	m_pointPolyData->DeepCopy(sampler->GetOutput());
+
+	if (key)
+		PolyDataCache::save(cacheName,m_pointPolyData,key); // failure is not critical
 	
 	m_samplesPresent=true;
 }
+
+void VarVisRender::updateContourKey()
+{
+	m_meshSource=m_loadedReferenceName;
+	m_meshKey=m_volumeKey;
+	if (m_meshKey)
+	{
+		double params[2]={m_isovalue,m_useGaussianSmoothing ? m_gaussionRadiusValue : 0.0};
+		m_meshKey=PolyDataCache::hash(m_meshKey,params,sizeof(params));
+	}
+}
 // -- setIsovalue -- 
 void VarVisRender::setIsovalue( double value )
 {
@@ -1284,6 +1321,7 @@ void VarVisRender::setIsovalue( double value )
 
 		m_mesh->GetPointData()->AddArray(colors);
 		m_isovalue=value;
+		updateContourKey();
 		m_samplesPresent=false;
 		if (getWarpVis())
 		{
@@ -1674,6 +1712,7 @@ void VarVisRender::createContour()
 	
 	// copy marching cube mesh to m_mesh polyData 
 	m_mesh->ShallowCopy( contour );
+	updateContourKey();
 
 	// Set standard gray color for mesh, else it will be colorised with colorToMeshFilter!
 	VTKPTR<vtkUnsignedCharArray> colors =VTKPTR<vtkUnsignedCharArray>::New();
@@ -1926,7 +1965,7 @@ void VarVisRender::loadVolumen(QString original,QString registed)
 	
 	// Generate the Meshes for original
 	emit statusMessage("create Original Mesh");	
-	VTKPTR<vtkMarchingCubes>originalContour=VTKPTR<vtkMarchingCubes>::New();
+	VTKPTR<BrickedMarchingCubes>originalContour=VTKPTR<BrickedMarchingCubes>::New();
 	originalContour->SetInputConnection(originalReader->GetOutputPort());
 	originalContour->SetValue( 0, m_isoValueForMeshes ); // Hounsfield units, bones approx.500-1500HU
 	originalContour->SetComputeNormals( 1 );
@@ -1959,7 +1998,7 @@ void VarVisRender::loadVolumen(QString original,QString registed)
 
 	// Generate the Meshes for registed
 	emit statusMessage("create Registered Mesh");	
-	VTKPTR<vtkMarchingCubes>registedContour=VTKPTR<vtkMarchingCubes>::New();
+	VTKPTR<BrickedMarchingCubes>registedContour=VTKPTR<BrickedMarchingCubes>::New();
 	registedContour->SetInputConnection(registedReader->GetOutputPort());
 	registedContour->SetValue( 0, m_isoValueForMeshes ); // Hounsfield units, bones approx.500-1500HU
 	registedContour->SetComputeNormals( 1 );
@@ -2150,7 +2189,7 @@ void VarVisRender::loadVolumen(QString original,QString registed,QString differe
 	emit statusMessage("create Original Mesh");	
 
 	// Generate the Meshes for original
-	VTKPTR<vtkMarchingCubes>originalContour=VTKPTR<vtkMarchingCubes>::New();
+	VTKPTR<BrickedMarchingCubes>originalContour=VTKPTR<BrickedMarchingCubes>::New();
 	originalContour->SetInputConnection(originalReader->GetOutputPort());
 	originalContour->SetValue( 0, m_isoValueForMeshes ); // Hounsfield units, bones approx.500-1500HU
 	originalContour->SetComputeNormals( 1 );
@@ -2183,7 +2222,7 @@ void VarVisRender::loadVolumen(QString original,QString registed,QString differe
 	
 	// Generate the Meshes for registed
 	emit statusMessage("create Registered Mesh");	
-	VTKPTR<vtkMarchingCubes>registedContour=VTKPTR<vtkMarchingCubes>::New();
+	VTKPTR<BrickedMarchingCubes>registedContour=VTKPTR<BrickedMarchingCubes>::New();
 	registedContour->SetInputConnection(registedReader->GetOutputPort());
 	registedContour->SetValue( 0, m_isoValueForMeshes ); // Hounsfield units, bones approx.500-1500HU
 	registedContour->SetComputeNormals( 1 );
@@ -2216,7 +2255,7 @@ void VarVisRender::loadVolumen(QString original,QString registed,QString differe
 
 	// Generate the Meshes for difference
 	emit statusMessage("create Difference Mesh");	
-	VTKPTR<vtkMarchingCubes>differenceContour=VTKPTR<vtkMarchingCubes>::New();
+	VTKPTR<BrickedMarchingCubes>differenceContour=VTKPTR<BrickedMarchingCubes>::New();
 	differenceContour->SetInputConnection(diffReader->GetOutputPort());
 	differenceContour->SetValue( 0, m_isoValueForError ); // Hounsfield units, bones approx.500-1500HU
 	differenceContour->SetComputeNormals( 1 );
@@ -2299,23 +2338,28 @@ bool VarVisRender::generateAdvancedDiffContour()
 		m_analyseDiffMeshActor.clear();
 		int sizeOfCountours=10;
 		emit statusMessage("create Advanced Difference Meshes");	
+
+		// Single contour filter for all levels, such that its brick index
+		// is computed only once for the difference image
+		VTKPTR<BrickedMarchingCubes>differenceContour=VTKPTR<BrickedMarchingCubes>::New();
+		differenceContour->SetInput(m_diffImage);
+		differenceContour->SetComputeNormals( 1 );
+
 		for (int iA=0;iA<sizeOfCountours;iA++)
 		{
-		
-			VTKPTR<vtkMarchingCubes>differenceContour=VTKPTR<vtkMarchingCubes>::New();
-			differenceContour->SetInput(m_diffImage);
-
 			if (iA==9)
 				differenceContour->SetValue( 0, 255); // Hounsfield units, bones approx.500-1500HU
 			else	
 				differenceContour->SetValue( 0, (iA+1)*25 ); // Hounsfield units, bones approx.500-1500HU
 	
 			emit statusMessage("create Advanced Difference Meshes "+QString::number(iA+1)+"/10");	
-			differenceContour->SetComputeNormals( 1 );
 			differenceContour->Update();
 
+			VTKPTR<vtkPolyData> differenceMesh=VTKPTR<vtkPolyData>::New();
+			differenceMesh->DeepCopy(differenceContour->GetOutput());
+
 			VTKPTR<vtkPolyDataMapper> differenceContourMapper=VTKPTR<vtkPolyDataMapper>::New();
-			differenceContourMapper->SetInputConnection(differenceContour->GetOutputPort());
+			differenceContourMapper->SetInput(differenceMesh);
 			differenceContourMapper->SetLookupTable(m_colorFunc);
 			
 			VTKPTR<vtkActor> differenceContourActor=VTKPTR<vtkActor>	::New();
@@ -2349,6 +2393,7 @@ void VarVisRender::setVolume( VTKPTR<vtkImageData> volume, QString name )
 	m_VolumeImageData     = volume;
 	m_loadedReferenceName = name;
 	m_volumePresent       = true;
+	m_volumeKey           = 0; // unknown source, see readVolume()
 	
 	// Clear previous data (if applicable)
 	if( m_referenceLoaded )
@@ -2410,6 +2455,7 @@ bool VarVisRender::readVolume( QString volumeName )
 
 	// Set volume
 	setVolume( reader->GetOutput(), volumeName );
+	m_volumeKey = PolyDataCache::hashVolumeFile( volumeName );
 
 	return m_volumePresent;
 }
@@ -2418,10 +2464,12 @@ bool VarVisRender::readMesh(QString meshName)
 {
 	cout<<"VarVis::Reading Mesh ...";
 	emit statusMessage("VarVis::Read Mesh...");
-	VTKPTR<vtkPolyDataReader> meshReader=VTKPTR<vtkPolyDataReader>::New();
-	meshReader->SetFileName(meshName.toAscii());
-	meshReader->Update();
-	setMesh(meshReader->GetOutput());
+	VTKPTR<vtkPolyData> mesh=VTKPTR<vtkPolyData>::New();
+	quint64 key=0;
+	PolyDataCache::readPolyData(meshName,mesh,true,&key);
+	setMesh(mesh);
+	m_meshKey=key;
+	m_meshSource=meshName;
 	cout<<"...done"<<endl;
 	emit statusMessage("Ready");
 	return m_meshPresent;
@@ -2432,10 +2480,9 @@ bool VarVisRender::readPoints(QString pointsName)
 {
 	cout<<"VarVis::Reading Points ...";
 	emit statusMessage("VarVis::Reading Points ...");
-	VTKPTR<vtkPolyDataReader> pointsReader=VTKPTR<vtkPolyDataReader>::New();
-	pointsReader->SetFileName(pointsName.toAscii());
-	pointsReader->Update();
-	setSample(pointsReader->GetOutput());
+	VTKPTR<vtkPolyData> points=VTKPTR<vtkPolyData>::New();
+	PolyDataCache::readPolyData(pointsName,points);
+	setSample(points);
 	m_samplesPresent=true;
 	cout<<"...done"<<endl;
 	emit statusMessage("Ready");
@@ -2571,6 +2618,7 @@ bool VarVisRender::initVarVis( const char* volumeName,const char* meshName,const
 void VarVisRender::setMesh(vtkPolyData *mesh)
 {
 	m_mesh->DeepCopy(mesh);
+	m_meshKey=0; // unknown source, see readMesh()
 	m_meshMapper->SetInput(m_mesh);
 	m_meshMapper->ScalarVisibilityOn();
 	m_meshMapper->SetScalarModeToUsePointFieldData();
@@ -17,6 +17,7 @@
 
 #include "VectorfieldClustering.h"
 #include "GlyphVisualization.h"
+#include "BrickedMarchingCubes.h"
 
 // vtk volume stuff
 #ifdef VREN_GPU_RAYCASTER
@@ -65,7 +66,6 @@
 #include <vtkPolyDataNormals.h>
 #include <vtkProperty.h>
 #include <vtkProbeFilter.h>
-#include <vtkMarchingCubes.h>
 #include <vtkRenderWindow.h>
 #include <vtkRenderer.h>
 #include <vtkTransformToGrid.h>
@@ -450,6 +450,8 @@ private:
 	// Functions
 	void generateRefMeshesData();
 	void generateSampleData();
+	/// Set cache key of mesh derived from reference volume (see PolyDataCache)
+	void updateContourKey();
 	
 	void destroy();
 	void init();
@@ -494,6 +496,12 @@ private:
 	double m_isovalue;	///< current isovalue
 	QString m_loadedReferenceName;
 	int m_sampleRange;
+
+	// Cache keys of loaded reference volume and current mesh (0 if unknown)
+	// and file next to which derived sample sets are cached
+	quint64 m_volumeKey;
+	quint64 m_meshKey;
+	QString m_meshSource;
 	double m_centroidNum;
 
 	// Helper Vars
@@ -531,7 +539,7 @@ private:
 	vtkActor                *m_ClusterVolumeActor;
 
 	// mesh with marchingCubes
-	vtkMarchingCubes		*m_contour;
+	BrickedMarchingCubes	*m_contour;
 	vtkPolyData				*m_mesh;
 	vtkPolyDataMapper		*m_meshMapper;
 	vtkActor				*m_meshActor;
@@ -22,6 +22,8 @@
 #include <vtkColorTransferFunction.h>
 #include <vtkCoordinate.h>
 
+#include <QTime>
+
 #ifndef VTKPTR
  #include <vtkSmartPointer.h>
  #define VTKPTR vtkSmartPointer
@@ -42,7 +44,7 @@
 class MyRand
 {
 public:
-	MyRand( int N ): m_dist(0,N-1) {}
+	MyRand( int N, unsigned seed=5489u ): m_rng(seed), m_dist(0,N-1) {}
 	int operator() () { return m_dist(m_rng); }
 private:
 	boost::mt19937       m_rng;
@@ -55,7 +57,7 @@ T randomDrawUnique( RNG& rng, std::vector<T>& alreadyDrawn )
 {
 	T randomNumber;
 
-	std::vector<T>::iterator it;
+	typename std::vector<T>::iterator it;
 	do 	{
 		// Draw a new random number ...
 		randomNumber = rng();
@@ -63,7 +65,7 @@ T randomDrawUnique( RNG& rng, std::vector<T>& alreadyDrawn )
 		it = std::find( alreadyDrawn.begin(), alreadyDrawn.end(), randomNumber );
 
 		// ... until it is not contained in alreadyDrawn array
-	} while( it == alreadyDrawn.end() && !alreadyDrawn.empty() );
+	} while( it != alreadyDrawn.end() );
 
 	// Add number to alreadyDrawn array
 	alreadyDrawn.push_back( randomNumber );
@@ -77,7 +79,13 @@ T randomDrawUnique( RNG& rng, std::vector<T>& alreadyDrawn )
 //-----------------------------------------------------------------------------
 
 VectorfieldClustering::VectorfieldClustering()
-  : m_ClusterVolumeData( 0 )
+  : m_kmeansSpace( NoSpace ),
+	m_seed( 5489u ), // default seed of boost::mt19937
+	m_kmeansPlusPlus( false ),
+	m_miniBatchSize( 0 ),
+	m_maxIterations( 200 ),
+	m_timeBudget( 0 ),
+	m_ClusterVolumeData( 0 )
 {
 }
 
@@ -154,12 +162,14 @@ void VectorfieldClustering
   ::setPointList( std::vector<Point2> pointList )
 {
 	m_pointList=pointList;
+	m_kmeansSpace=NoSpace;
 }
 
 void VectorfieldClustering
   ::clearPointsList()
 {
 	m_pointList.clear();
+	m_kmeansSpace=NoSpace;
 }
 
 //-----------------------------------------------------------------------------
@@ -168,282 +178,237 @@ void VectorfieldClustering
 
 void VectorfieldClustering::generateCentroids()
 {	
-	clusterVector.resize( m_numberOfCentroids );
-	
-	Point2 zeroPoint;
-	zeroPoint.setX( 0.0 );
-	zeroPoint.setY( 0.0 );
-
 	m_centroidsList.clear();
-	m_oldCentroidsList.push_back( zeroPoint );
+	m_randomVector.clear(); // Keep track of randomly drawn indices
+	m_kmeansSpace = NoSpace;  // (Re-)initialize k-means on next iteration
 
-	MyRand myrand( m_numberOfPoints );
+	if( m_numberOfPoints <= 0 )
+		return;
+	if( m_numberOfCentroids > m_numberOfPoints )
+		m_numberOfCentroids = m_numberOfPoints;
+
+	MyRand myrand( m_numberOfPoints, m_seed );
 
 	// Randomly pick centroids from point set (while avoiding duplicates!)
-	m_randomVector.clear(); // Keep track of randomly drawn indices
 	for( unsigned i=0; i< m_numberOfCentroids; i++ )
 	{
 		vtkIdType id = randomDrawUnique<vtkIdType,MyRand>( myrand, m_randomVector );
 
-		m_oldCentroidsList.push_back( zeroPoint );
-		m_centroidsList   .push_back( m_pointList[ id ] );
+		m_centroidsList.push_back( m_pointList[ id ] );
 	}
 }
 
-void VectorfieldClustering::clusterIt()
+void VectorfieldClustering::setupKMeans( ClusterSpace space )
 {
-	MyRand myrand( m_numberOfPoints );
+	if( m_kmeansSpace == space )
+		return;
 
-	verifyDistance();
-	m_centroidsList.clear();
-	for (int iA=0;iA<m_numberOfCentroids;iA++)
+	// Copy samples into contiguous arrays of k-means engine
+	m_kmeans.setNumberOfSamples( (int)m_pointList.size() );
+	for (int iA=0;iA<m_pointList.size();iA++)
 	{
-		double PositionX=0;
-		double PositionY=0;
-		double normOfVector=0;
-
-		double VectorX=0;
-		double VectorY=0;
-		double VectorZ=0;
-		double vectorNorm=0;
-
-		double sumX=0;
-		double sumY=0;
-		double sumZ=0;
-		int sizeOfCluster=(int)clusterVector[iA].size();
-		if (sizeOfCluster==0)
+		Point2& p = m_pointList[iA];
+		double pos[3];
+		if( space == WorldSpace )
 		{
-			
-			Point2 tempCentroid;
-			int random = myrand();
-			double *vector=	m_pointList[random].getVector();
-
-			double x,y;
-			x=m_pointList[iA].getX();
-			y=m_pointList[iA].getY();
-			
-			tempCentroid.setVector(vector[0],vector[1],vector[2]);
-			tempCentroid.setX(x);
-			tempCentroid.setY(y);
-			m_centroidsList.push_back(tempCentroid);
+			pos[0] = p.getWorldX();
+			pos[1] = p.getWorldY();
+			pos[2] = p.getWorldZ();
 		}
 		else
 		{
-  			for (int iB=0;iB<clusterVector[iA].size();iB++)
-			{
-				double length=clusterVector[iA][iB].getVectorLength();
-				PositionX+=(length*length)*	clusterVector[iA][iB].getX();
-				PositionY+=(length*length)*	clusterVector[iA][iB].getY();
-
-				sumX+=clusterVector[iA][iB].getWorldX();
-				sumY+=clusterVector[iA][iB].getWorldY();
-				sumZ+=clusterVector[iA][iB].getWorldZ();
-
-				normOfVector+=(length*length);
-				double * vector=clusterVector[iA][iB].getVector();
-
-				VectorX+=length*vector[0];
-				VectorY+=length*vector[1];
-				VectorZ+=length*vector[2];
-			}
-
-			vectorNorm = sqrt(VectorX*VectorX + VectorY*VectorY + VectorZ*VectorZ);
-			PositionX/=normOfVector;
-			PositionY/=normOfVector;
-			VectorX/=vectorNorm;
-			VectorY/=vectorNorm;
-			VectorZ/=vectorNorm;
-				
-			Point2 centroid;
-			// need a new centroid calculation 
-			centroid.setX(PositionX);
-			centroid.setY(PositionY);
-			centroid.setClusterID(iA);
-			centroid.setWorldCoordinates(sumX/sizeOfCluster,sumY/sizeOfCluster,sumZ/sizeOfCluster);
-			centroid.setVector(VectorX,VectorY,VectorZ);
-			m_centroidsList.push_back(centroid);
+			pos[0] = p.getX();
+			pos[1] = p.getY();
+			pos[2] = 0.0;
 		}
+		m_kmeans.setSample( iA, pos, p.getVector() );
 	}
 
-	double sumEps=0;
-	for (int iA=0;iA<m_centroidsList.size();iA++)
+	// Screen space centroids are weighted by squared vector length
+	m_kmeans.setPositionWeighting( (space == WorldSpace)
+		? VectorfieldKMeans::UniformPositionWeights
+		: VectorfieldKMeans::SquaredLengthPositionWeights );
+	m_kmeans.setPositionWeight( w );
+	m_kmeans.setSeed( m_seed );
+
+	if( m_kmeansPlusPlus )
 	{
-		Point2 oldTempPoint=m_oldCentroidsList[iA];
-		Point2 newTempPoint=(m_centroidsList.at(iA));
-		Point2 tempPoint=oldTempPoint.sub(newTempPoint);
-		sumEps+=tempPoint.length();
+		// Seed on a subset which is a small multiple of the batch size
+		int maxSamples = useMiniBatch() 
+			? std::max( 2*m_miniBatchSize, 3*m_numberOfCentroids ) : 0;
+		m_kmeans.seedPlusPlus( m_numberOfCentroids, maxSamples );
+	}
+	else
+	{
+		std::vector<int> ids( m_randomVector.begin(), m_randomVector.end() );
+		m_kmeans.setInitialCentroids( ids );
 	}
-	cout<<sumEps<<"|";
-	if (sumEps<m_epsilon)
-		m_iterationDone=true;
 
-	m_oldCentroidsList.clear();
-	for (int iA=0;iA<m_centroidsList.size();iA++)
-		m_oldCentroidsList.push_back(m_centroidsList.at(iA));
+	m_kmeansSpace = space;
+	updateCentroidsList();
 }
 
-void VectorfieldClustering::verifyDistance()
+bool VectorfieldClustering::useMiniBatch() const
 {
-	for (int iA=0;iA<m_numberOfCentroids;iA++)
-		clusterVector[iA].clear();
-
-	for (int iA=0;iA<m_pointList.size();iA++)
-	{
-		m_pointList[iA].setClusterID(distance(m_pointList[iA],m_centroidsList));
-	}
+	return m_miniBatchSize > 0 && 4*m_miniBatchSize < (int)m_pointList.size();
 }
 
-int VectorfieldClustering::distance(Point2 p,std::vector<Point2> centroids)
+int VectorfieldClustering::runClustering( bool worldSpace )
 {
-	double dist= 5000;
-	double tempDistance=0;
-	int index=0;
-	
-	// vergleiche die diestance zu jedem punkt 
-	for (int iA=0;iA<centroids.size();iA++)
-	{
-		Point2 tempCentroid=centroids.at(iA);
-		Point2 temp= p.sub(centroids.at(iA));
+	setupKMeans( worldSpace ? WorldSpace : ScreenSpace );
+	m_kmeans.setPositionWeight( w );
 
-		double positionDistance= temp.length()*temp.length();
-		
-		// get Centroid Vector 
-		double *centroidVector=centroids[iA].getVector();
-		double *pointVector=p.getVector();
+	bool miniBatch = useMiniBatch();
+	cout << "clustering " << m_pointList.size() << " samples into " 
+	     << m_kmeans.getNumberOfCentroids() << " clusters"
+	     << (miniBatch ? " (mini-batch)" : "") << endl;
 
-		// calculate their length
-		double centroidVectorLength=centroidVector[0]*centroidVector[0]+
-									centroidVector[1]*centroidVector[1]+
-									centroidVector[2]*centroidVector[2];
+	QTime time;
+	time.start();
 
-		double pointVectorLength =  pointVector[0]*pointVector[0]+
-									pointVector[1]*pointVector[1]+
-									pointVector[2]*pointVector[2];
+	m_iterationDone = false;
+	m_convergence.clear();
+	int iter;
+	for( iter=0; iter < m_maxIterations && !m_iterationDone; iter++ )
+	{
+		double sumEps = miniBatch ? m_kmeans.iterateMiniBatch( m_miniBatchSize )
+		                          : m_kmeans.iterate();
+		m_convergence.push_back( sumEps );
 
-		centroidVectorLength=sqrt(centroidVectorLength);
-		pointVectorLength=sqrt(pointVectorLength);
+		cout << "  iteration " << iter << ": displacement " << sumEps
+		     << ", " << m_kmeans.getNumDistanceEvaluations() << " distances";
+		if( m_kmeans.getNumEmptyClusters() > 0 )
+			cout << ", " << m_kmeans.getNumEmptyClusters() << " empty clusters";
+		cout << endl;
 
-		// calculate skalar product
-		double dotProd= centroidVector[0]*pointVector[0]+
-					    centroidVector[1]*pointVector[1]+
-						centroidVector[2]*pointVector[2];
+		if( sumEps < m_epsilon )
+			m_iterationDone = true;
 
-		// calculate angle between the Vectors
-		double cosVectors= dotProd/(pointVectorLength*centroidVectorLength);
+		if( m_timeBudget > 0 && time.elapsed() > m_timeBudget )
+		{
+			cout << "  time budget of " << m_timeBudget << "ms exhausted" << endl;
+			iter++;
+			break;
+		}
+	}
 
-		// distance = pointVectorLength * centroidVectorLength * sqrt( 1- cos(theta) + w* positionDistance)
-		tempDistance= 1- cosVectors + w*positionDistance;
-		if (tempDistance>0)
-			tempDistance=sqrt(fabs(tempDistance));
-		else 
-			tempDistance=0;
+	// Mini-batches do not label all samples
+	if( miniBatch )
+		m_kmeans.assign();
 
-		tempDistance*=pointVectorLength*centroidVectorLength;
+	updateCentroidsList();
+	for (int iA=0;iA<m_pointList.size();iA++)
+		m_pointList[iA].setClusterID( m_kmeans.getLabel(iA) );
+
+	cout << "done after " << iter << " iterations (" << time.elapsed() << "ms)" << endl;
+	return iter;
+}
 
-		if (tempDistance<dist )
+void VectorfieldClustering::updateCentroidsList()
+{
+	m_centroidsList.resize( m_kmeans.getNumberOfCentroids() );
+	for (int iA=0;iA<m_centroidsList.size();iA++)
+	{
+		double pos[3], dir[3];
+		m_kmeans.getCentroidPosition ( iA, pos );
+		m_kmeans.getCentroidDirection( iA, dir );
+
+		Point2& centroid = m_centroidsList[iA];
+		centroid.setClusterID( iA );
+		centroid.setVector( dir[0], dir[1], dir[2] );
+		if( m_kmeansSpace == WorldSpace )
 		{
-			index=iA;
-			dist=tempDistance;
+			centroid.setX( 0 );
+			centroid.setY( 0 );
+			centroid.setWorldCoordinates( pos[0], pos[1], pos[2] );
+		}
+		else
+		{
+			centroid.setX( pos[0] );
+			centroid.setY( pos[1] );
+			centroid.setWorldCoordinates( 0, 0, 0 );
 		}
 	}
-
-	// push this point to Cluster[index]
-	clusterVector[index].push_back(p);
-	return index;
 }
 
-void VectorfieldClustering::clusterIt3D()
+void VectorfieldClustering::computeClusterStatistics( 
+	std::vector<double>& meanPos, std::vector<double>& meanLength )
 {
-	// calculate the cluster zugehoerigkeit
-	verifyDistance3D();
-	std::vector<Point2> tempList;
-	MyRand myrand(m_numberOfPoints);
-	m_centroidsList.clear();
+	int k = m_kmeans.getNumberOfCentroids();
+	std::vector<int> count( k, 0 );
+	meanPos   .assign( 3*k, 0.0 );
+	meanLength.assign(   k, 0.0 );
 
-	// m_randomVector is not cleared ??
-
-	int numberOfFaildClusters=0;
-	for (int iA=0;iA<m_numberOfCentroids;iA++)
+	std::vector<Point2>& points = m_pointList;
+	for (int iA=0;iA<points.size();iA++)
 	{
-		
-		double PositionX=0;
-		double PositionY=0;
-		double PositionZ=0;
-		double normOfVector=0;
-
-		double VectorX=0;
-		double VectorY=0;
-		double VectorZ=0;
-		double vectorNorm=0;
-
-		double sumX=0;
-		double sumY=0;
-		double sumZ=0;
-
-		int sizeOfCluster=(int)clusterVector[iA].size();
+		int c = m_kmeans.getLabel( iA );
+		if( c < 0 ) continue;
+		count[c]++;
+		meanPos[3*c  ] += points[iA].getWorldX();
+		meanPos[3*c+1] += points[iA].getWorldY();
+		meanPos[3*c+2] += points[iA].getWorldZ();
+		meanLength[c]  += points[iA].getVectorLength();
+	}
 
-		if (sizeOfCluster==0)
+	for (int iA=0;iA<k;iA++)
+		if( count[iA] > 0 )
 		{
-			cout << "Warning: Cluster ["<<iA<<"] is empty." << endl;
-
-			vtkIdType id = randomDrawUnique<vtkIdType,MyRand>( myrand, m_randomVector );
-			m_centroidsList.push_back( m_pointList.at(id) );
-
-			Point2 tempPoint = m_pointList.at( id );
-			numberOfFaildClusters++;
+			meanPos[3*iA  ] /= count[iA];
+			meanPos[3*iA+1] /= count[iA];
+			meanPos[3*iA+2] /= count[iA];
+			meanLength[iA]  /= count[iA];
 		}
 		else
 		{
-			for (int iB=0;iB<clusterVector[iA].size();iB++)
-			{
-				double length=clusterVector[iA][iB].getVectorLength();
-				PositionX+=(length*length)*	clusterVector[iA][iB].getWorldX();
-				PositionY+=(length*length)*	clusterVector[iA][iB].getWorldY();
-				PositionZ+=(length*length)*	clusterVector[iA][iB].getWorldZ();
-
-				sumX+=clusterVector[iA][iB].getWorldX();
-				sumY+=clusterVector[iA][iB].getWorldY();
-				sumZ+=clusterVector[iA][iB].getWorldZ();
-
-				normOfVector+=(length*length);
-				double * vector=clusterVector[iA][iB].getVector();
-
-				VectorX+=length*vector[0];
-				VectorY+=length*vector[1];
-				VectorZ+=length*vector[2];
-				 
-			}
-			vectorNorm = sqrt(VectorX*VectorX + VectorY*VectorY + VectorZ*VectorZ);
-			VectorX/=vectorNorm;
-			VectorY/=vectorNorm;
-			VectorZ/=vectorNorm;
-				
-			Point2 centroid;
-			// need a new centroid calculation 
-			centroid.setClusterID(iA);
-			centroid.setWorldCoordinates(sumX/sizeOfCluster,sumY/sizeOfCluster,sumZ/sizeOfCluster);
-			centroid.setVector(VectorX,VectorY,VectorZ);
-			m_centroidsList.push_back(centroid);
+			// Empty cluster, keep its centroid
+			meanPos[3*iA  ] = m_centroidsList[iA].getWorldX();
+			meanPos[3*iA+1] = m_centroidsList[iA].getWorldY();
+			meanPos[3*iA+2] = m_centroidsList[iA].getWorldZ();
 		}
-	}
+}
 
-	cout<<"num of Faild Clusters "<< numberOfFaildClusters<<endl;
-	double sumEps=0;
-	for (int iA=0;iA<m_centroidsList.size();iA++)
-	{
-		Point2 oldTempPoint=m_oldCentroidsList[iA];
-		Point2 newTempPoint=(m_centroidsList.at(iA));
+void VectorfieldClustering::clusterIt()
+{
+	setupKMeans( ScreenSpace );
+	m_kmeans.setPositionWeight( w );
 
-		Point2 tempPoint=oldTempPoint.sub3d(newTempPoint);
-		sumEps+=tempPoint.length3d();
-	}
-	cout<<sumEps<<" ";
+	double sumEps = m_kmeans.iterate();
+	updateCentroidsList();
+
+	cout<<sumEps<<"|";
 	if (sumEps<m_epsilon)
 		m_iterationDone=true;
+}
 
-	m_oldCentroidsList.clear();
-	for (int iA=0;iA<m_centroidsList.size();iA++)
-		m_oldCentroidsList.push_back(m_centroidsList.at(iA));	
+void VectorfieldClustering::verifyDistance()
+{
+	setupKMeans( ScreenSpace );
+	m_kmeans.setPositionWeight( w );
+	m_kmeans.assign();
+
+	for (int iA=0;iA<m_pointList.size();iA++)
+		m_pointList[iA].setClusterID( m_kmeans.getLabel(iA) );
+}
+
+double VectorfieldClustering::distance( int pointIndex, int centroid ) const
+{
+	return m_kmeans.distance( pointIndex, centroid );
+}
+
+void VectorfieldClustering::clusterIt3D()
+{
+	setupKMeans( WorldSpace );
+	m_kmeans.setPositionWeight( w );
+
+	double sumEps = m_kmeans.iterate();
+	updateCentroidsList();
+
+	if( m_kmeans.getNumEmptyClusters() > 0 )
+		cout<<"num of Faild Clusters "<< m_kmeans.getNumEmptyClusters()<<endl;
+	cout<<sumEps<<" ("<<m_kmeans.getNumDistanceEvaluations()<<" dist.) ";
+	if (sumEps<m_epsilon)
+		m_iterationDone=true;
 }
 
 void VectorfieldClustering::generate3DClustering()
@@ -475,6 +440,8 @@ void VectorfieldClustering::generate3DClustering()
 
 		// get all points [their coordinates and Vectors]
 		// and push them to m_pointList
+		clearPointsList();
+		m_pointList.reserve( m_ClusterVolumeData->GetNumberOfPoints() );
 		for (int iA=0;iA<m_ClusterVolumeData->GetNumberOfPoints();iA++)
 		{
 			double *pointX=m_ClusterVolumeData->GetPoint(iA);
@@ -532,16 +499,7 @@ void VectorfieldClustering::generate3DClustering()
 	#endif
 
 		// do the clustering
-		m_iterationDone=false;
-		cout<<"clustering ";
-		for (int iA=0;iA<200;iA++)
-		{	cout<<"|"<<iA<<"->";
-		if (!m_iterationDone)
-			clusterIt3D();
-		else 
-			break;
-		}	
-		cout<<"done!"<<endl;
+		runClustering( true );
 
 		// create Visualisation 
 		vtkPoints		  * points2	= vtkPoints::New();
@@ -559,24 +517,11 @@ void VectorfieldClustering::generate3DClustering()
 		// generate the centroids Position and their Vectors
 		// calculate the mean of the points in the cluster -> new position
 		// calculate the mean of the Vectors in the cluster -> new Vector
-		for (int iA=0;iA<m_numberOfCentroids;iA++)
+		std::vector<double> meanPos, meanLength;
+		computeClusterStatistics( meanPos, meanLength );
+		for (int iA=0;iA<m_centroidsList.size();iA++)
 		{
-			double worldSumX=0;
-			double worldSumY=0;
-			double worldSumZ=0;
-
-			for (int iB=0;iB<clusterVector[iA].size();iB++)
-			{
-				worldSumX+=clusterVector[iA][iB].getWorldX();
-				worldSumY+=clusterVector[iA][iB].getWorldY();
-				worldSumZ+=clusterVector[iA][iB].getWorldZ();
-			}
-		
-			worldSumX/=clusterVector[iA].size();
-			worldSumY/=clusterVector[iA].size();
-			worldSumZ/=clusterVector[iA].size();
-	 
-			m_centroidsList[iA].setWorldCoordinates(worldSumX,worldSumY,worldSumZ);
+			m_centroidsList[iA].setWorldCoordinates(meanPos[3*iA],meanPos[3*iA+1],meanPos[3*iA+2]);
 
 			double * vector=m_centroidsList[iA].getVector();
 			double x=m_centroidsList[iA].getWorldX();
@@ -682,74 +627,12 @@ void VectorfieldClustering::generate3DClustering()
 
 void VectorfieldClustering::verifyDistance3D()
 {
-	for (int iA=0;iA<m_numberOfCentroids;iA++)
-		clusterVector[iA].clear();
+	setupKMeans( WorldSpace );
+	m_kmeans.setPositionWeight( w );
+	m_kmeans.assign();
 
 	for (int iA=0;iA<m_pointList.size();iA++)
-	{
-		m_pointList[iA].setClusterID(distance3D(m_pointList[iA],m_centroidsList));
-		if (iA%1000==0)
-			cout<<".";
-	}
-}
-
-int  VectorfieldClustering::distance3D(Point2 p,std::vector<Point2> centroids)
-{
-	double dist= 500000;
-	double tempDistance=0;
-	int index=0;
-	
-	// vergleiche die diestance zu jedem punkt 
-	for (int iA=0;iA<centroids.size();iA++)
-	{
-		Point2 tempCentroid=centroids[iA];
-		Point2 temp= p.sub3d(centroids[iA]);
-
-		double positionDistance= temp.length3d()*temp.length3d();
-
-		// get the Vectors
-		double *centroidVector=centroids[iA].getVector();
-		double *pointVector=p.getVector();
-		// calculate their length
-		double centroidVectorLength=centroidVector[0]*centroidVector[0]+
-									centroidVector[1]*centroidVector[1]+
-									centroidVector[2]*centroidVector[2];
-
-		double pointVectorLength =  pointVector[0]*pointVector[0]+
-									pointVector[1]*pointVector[1]+
-									pointVector[2]*pointVector[2];
-
-		centroidVectorLength=sqrt(centroidVectorLength);
-		pointVectorLength=sqrt(pointVectorLength);
-
-		// calculate skalarProduct
-		double dotProd= centroidVector[0]*pointVector[0]+
-					    centroidVector[1]*pointVector[1]+
-						centroidVector[2]*pointVector[2];
-
-		// calculate Angle
-		double cosVectors= dotProd/(pointVectorLength*centroidVectorLength);
-		
-		// distance = pointVectorLength * centroidVectorLength * sqrt( 1- cos(theta) + w* positionDistance)
-		tempDistance= 1- cosVectors + w*positionDistance;
-
-		if (tempDistance>0)
-			tempDistance=sqrt(fabs(tempDistance));
-
-		else 
-			tempDistance=0;
-
-		tempDistance*=pointVectorLength*centroidVectorLength;
-
-		if (tempDistance<dist )
-		{
-			index=iA;
-			dist=tempDistance;
-		}
-	}
-	// push this point to Cluster[index]
-	clusterVector[index].push_back(p);
-	return index;
+		m_pointList[iA].setClusterID( m_kmeans.getLabel(iA) );
 }
 
 void VectorfieldClustering::Visualisate()
@@ -767,14 +650,17 @@ void VectorfieldClustering::Visualisate()
 	double m_maxOrthVector=0;
 	double m_minOrthVector=20;
 
+	// cluster assignment of last iteration
+	for (int iA=0;iA<m_pointList.size();iA++)
+		m_pointList[iA].setClusterID( m_kmeans.getLabel(iA) );
+
+	std::vector<double> meanPos, meanLength;
+	computeClusterStatistics( meanPos, meanLength );
+
 	{	// generate the color map for the centroids arrows
-		for (int iA=0;iA<m_numberOfCentroids;iA++)
+		for (int iA=0;iA<m_centroidsList.size();iA++)
 		{
-			double tempLength=0;
-			for (int iB=0;iB<clusterVector[iA].size();iB++)
-				tempLength+=clusterVector[iA][iB].getVectorLength();
-
-			tempLength/=clusterVector[iA].size();
+			double tempLength=meanLength[iA];
 
 			double *tempV= m_centroidsList[iA].getVector();
 			double tempVLength= m_centroidsList[iA].getVectorLength();
@@ -835,24 +721,9 @@ void VectorfieldClustering::Visualisate()
 		m_samplerMapper->Update();
 	}
 
-	for (int iA=0;iA<m_numberOfCentroids;iA++)
+	for (int iA=0;iA<m_centroidsList.size();iA++)
 	{
-		double worldSumX=0;
-		double worldSumY=0;
-		double worldSumZ=0;
-
-		for (int iB=0;iB<clusterVector[iA].size();iB++)
-		{
-			worldSumX+=clusterVector[iA][iB].getWorldX();
-			worldSumY+=clusterVector[iA][iB].getWorldY();
-			worldSumZ+=clusterVector[iA][iB].getWorldZ();
-		}
-	
-		worldSumX/=clusterVector[iA].size();
-		worldSumY/=clusterVector[iA].size();
-		worldSumZ/=clusterVector[iA].size();
- 
-		m_centroidsList[iA].setWorldCoordinates(worldSumX,worldSumY,worldSumZ);
+		m_centroidsList[iA].setWorldCoordinates(meanPos[3*iA],meanPos[3*iA+1],meanPos[3*iA+2]);
 
 	
 	double * vector=m_centroidsList[iA].getVector();
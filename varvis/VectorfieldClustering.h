@@ -1,6 +1,7 @@
 #ifndef VECTORFIELDCLUSTERING_H
 #define VECTORFIELDCLUSTERING_H
 
+#include "VectorfieldKMeans.h"
 #include <vector>
 #include <vtkType.h>
 
@@ -135,6 +136,14 @@ private:
 	based algorithms for vector fields visualization and segmentation." 
 	Proceedings of the conference on Visualization'04., 2004.
 
+	The k-means iterations are performed by \a VectorfieldKMeans on a
+	contiguous copy of the sample positions and vectors, the \a Point2 lists
+	only keep the per sample ids and coordinates required for visualization.
+
+	For very large sample sets \a runClustering() supports a mini-batch
+	k-means++ mode with an iteration and time budget. Random choices are
+	drawn with a fixed seed (\a setSeed()) such that results are reproducible.
+
 	\author Vitalis Wiens
 */
 class VectorfieldClustering
@@ -162,12 +171,26 @@ protected:
 	void clearPointsList();
 
 public:
+	/// Single k-means iteration on screen space positions
 	void clusterIt();
+	/// Assign samples to nearest centroid w.r.t. screen space positions
 	void verifyDistance();
-	int distance(Point2 p,std::vector<Point2> centroids);
+	/// Single k-means iteration on world space positions
 	void clusterIt3D();
+	/// Assign samples to nearest centroid w.r.t. world space positions
 	void verifyDistance3D();
-	int distance3D(Point2 p,std::vector<Point2> centroids);
+
+	/// Distance between sample and centroid of last assignment, see [Du2004]
+	double distance( int pointIndex, int centroid ) const;
+
+	/// Iterate until converged (see \a setEpsilon()) or until the iteration
+	/// or time budget is exhausted, then assign all samples. Uses mini-batch
+	/// iterations if enabled and the number of samples is large enough.
+	/// Returns number of iterations performed.
+	int runClustering( bool worldSpace );
+
+	/// Sum of centroid displacements of each iteration of \a runClustering()
+	const std::vector<double>& getConvergenceHistory() const { return m_convergence; }
 
 	std::vector<vtkActor*>		   GetActors()		   {return m_clusterActor;}
 	std::vector<vtkPoints*>		   GetClusterPoints()  {return m_clusterPoints;}
@@ -182,19 +205,50 @@ public:
 	
 	void setNumberOfCentroidsRelative( double fraction );
 
+	///@{ Clustering parameters for \a runClustering()
+	void setSeed         ( unsigned seed ) { m_seed = seed; }
+	void setKMeansPlusPlus( bool b )       { m_kmeansPlusPlus = b; }
+	/// Samples per mini-batch iteration, 0 disables mini-batch mode. Mini-
+	/// batches are only used if there are more than 4 times as many samples.
+	void setMiniBatchSize( int size )      { m_miniBatchSize = size; }
+	void setMaxIterations( int n )         { m_maxIterations = n; }
+	/// Time budget in milliseconds, 0 = unlimited (default). Note that with
+	/// a time budget the result is no longer deterministic for a given seed.
+	void setTimeBudget   ( int ms )        { m_timeBudget = ms; }
+	///@}
+
 	bool isIterationDone() const          { return m_iterationDone; }
 	void setIterationDone( bool done )    { m_iterationDone=done; }
 	void setRenderer( vtkRenderer* ren )  { m_renderer = ren; }
 
 	void setPointData( vtkPolyData* pointData ) { m_ClusterVolumeData=pointData; }
 
+protected:
+	enum ClusterSpace { NoSpace, ScreenSpace, WorldSpace };
+
+	/// Copy samples to k-means engine if not already done for given space
+	void setupKMeans( ClusterSpace space );
+	bool useMiniBatch() const;
+	/// Copy current centroids from k-means engine to m_centroidsList
+	void updateCentroidsList();
+	/// Mean world position (3 components) and mean vector length per cluster
+	void computeClusterStatistics( std::vector<double>& meanPos,
+	                               std::vector<double>& meanLength );
+
 private:
-	std::vector<std::vector<Point2>> clusterVector;
 	std::vector<Point2> m_pointList;
-	std::vector<Point2> m_pointListVolume;
 	std::vector<Point2> m_centroidsList;
-	std::vector<Point2> m_oldCentroidsList;
 	std::vector<vtkIdType> m_randomVector;
+
+	VectorfieldKMeans m_kmeans;
+	ClusterSpace      m_kmeansSpace;
+	std::vector<double> m_convergence;
+
+	unsigned m_seed;
+	bool     m_kmeansPlusPlus;
+	int      m_miniBatchSize;
+	int      m_maxIterations;
+	int      m_timeBudget;
 	
 	// Visualization
 	std::vector<vtkPoints*>	        m_clusterPoints ;
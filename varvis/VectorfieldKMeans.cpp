@@ -0,0 +1,545 @@
+#include "VectorfieldKMeans.h"
+#include <cmath>
+#include <cfloat>    // DBL_MAX
+#include <algorithm> // partial_sort(), max()
+#include <utility>   // pair
+#include <boost/random/uniform_int.hpp>
+#include <boost/random/uniform_real.hpp>
+#include <boost/random/variate_generator.hpp>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+//-----------------------------------------------------------------------------
+//  c'tor / setup
+//-----------------------------------------------------------------------------
+
+VectorfieldKMeans::VectorfieldKMeans()
+  : m_w( 1.0 ),
+	m_weighting( UniformPositionWeights ),
+	m_boundsValid( false ),
+	m_numEvaluations( 0 ),
+	m_numReassigned( 0 ),
+	m_numEmpty( 0 )
+{
+}
+
+void VectorfieldKMeans::setNumberOfSamples( int n )
+{
+	n = std::max( n, 0 );
+	m_x.assign( n, 0.0 ); m_y.assign( n, 0.0 ); m_z.assign( n, 0.0 );
+	m_u.assign( n, 0.0 ); m_v.assign( n, 0.0 ); m_t.assign( n, 0.0 );
+	m_len.assign( n, 0.0 );
+
+	m_label.assign( n, -1 );
+	m_upper.assign( n, DBL_MAX );
+	m_lower.assign( n, 0.0 );
+
+	m_cx.clear(); m_cy.clear(); m_cz.clear();
+	m_cu.clear(); m_cv.clear(); m_ct.clear();
+	m_count.clear();
+	m_halfSep.clear();
+}
+
+void VectorfieldKMeans::setSample( int i, const double pos[3], const double vec[3] )
+{
+	m_x[i] = pos[0];
+	m_y[i] = pos[1];
+	m_z[i] = pos[2];
+
+	double len = sqrt( vec[0]*vec[0] + vec[1]*vec[1] + vec[2]*vec[2] );
+	m_len[i] = len;
+	if( len > 0.0 )
+	{
+		m_u[i] = vec[0] / len;
+		m_v[i] = vec[1] / len;
+		m_t[i] = vec[2] / len;
+	}
+	else
+		m_u[i] = m_v[i] = m_t[i] = 0.0;
+}
+
+void VectorfieldKMeans::setPositionWeight( double w )
+{
+	// Bounds are only valid for a fixed metric
+	if( w != m_w )
+		resetBounds();
+	m_w = w;
+}
+
+void VectorfieldKMeans::setInitialCentroids( const std::vector<int>& sampleIds )
+{
+	int k = (int)sampleIds.size();
+	m_cx.resize( k ); m_cy.resize( k ); m_cz.resize( k );
+	m_cu.resize( k ); m_cv.resize( k ); m_ct.resize( k );
+	m_count.assign( k, 0 );
+	m_halfSep.assign( k, 0.0 );
+
+	for( int c=0; c < k; c++ )
+	{
+		int i = sampleIds[c];
+		m_cx[c] = m_x[i];  m_cy[c] = m_y[i];  m_cz[c] = m_z[i];
+		m_cu[c] = m_u[i];  m_cv[c] = m_v[i];  m_ct[c] = m_t[i];
+	}
+
+	m_label.assign( m_x.size(), -1 );
+	resetBounds();
+	resetMiniBatch();
+}
+
+void VectorfieldKMeans::resetBounds()
+{
+	std::fill( m_upper.begin(), m_upper.end(), DBL_MAX );
+	std::fill( m_lower.begin(), m_lower.end(), 0.0 );
+	m_boundsValid = true;
+}
+
+void VectorfieldKMeans::resetMiniBatch()
+{
+	m_mbWeight.assign(   getNumberOfCentroids(), 0.0 );
+	m_mbDir   .assign( 3*getNumberOfCentroids(), 0.0 );
+}
+
+void VectorfieldKMeans::seedPlusPlus( int k, int maxSamples )
+{
+	int n = getNumberOfSamples();
+	int m = (maxSamples > 0) ? std::min( maxSamples, n ) : n;
+	k = std::min( k, m );
+	if( k <= 0 )
+	{
+		setInitialCentroids( std::vector<int>() );
+		return;
+	}
+
+	boost::variate_generator< boost::mt19937&, boost::uniform_real<> >
+		uniform( m_rng, boost::uniform_real<>( 0.0, 1.0 ) );
+
+	// Random subset of m samples (partial Fisher-Yates shuffle)
+	std::vector<int> subset( n );
+	for( int i=0; i < n; i++ )
+		subset[i] = i;
+	if( m < n )
+		for( int i=0; i < m; i++ )
+		{
+			int j = i + std::min( (int)(uniform()*(n-i)), n-i-1 );
+			std::swap( subset[i], subset[j] );
+		}
+	subset.resize( m );
+
+	// Each next centroid is drawn with probability proportional to the
+	// squared feature distance to the nearest centroid chosen so far
+	std::vector<int> ids;
+	ids.reserve( k );
+	ids.push_back( subset[ std::min( (int)(uniform()*m), m-1 ) ] );
+
+	std::vector<double> d2( m, DBL_MAX );
+	while( (int)ids.size() < k )
+	{
+		int c = ids.back();
+		double sum = 0.0;
+
+		#pragma omp parallel for reduction(+:sum) schedule(static)
+		for( int j=0; j < m; j++ )
+		{
+			int i = subset[j];
+			double dx = m_x[i]-m_x[c], dy = m_y[i]-m_y[c], dz = m_z[i]-m_z[c],
+			       du = m_u[i]-m_u[c], dv = m_v[i]-m_v[c], dt = m_t[i]-m_t[c];
+			double d = m_w*(dx*dx + dy*dy + dz*dz) + 0.5*(du*du + dv*dv + dt*dt);
+			d2[j] = std::min( d2[j], d );
+			sum += d2[j];
+		}
+
+		int pick = m-1;
+		if( sum > 0.0 )
+		{
+			double r = uniform() * sum;
+			for( int j=0; j < m; j++ )
+			{
+				r -= d2[j];
+				if( r < 0.0 ) { pick = j; break; }
+			}
+		}
+		else
+			// Degenerate case of only duplicate samples left
+			pick = std::min( (int)(uniform()*m), m-1 );
+
+		ids.push_back( subset[pick] );
+	}
+
+	setInitialCentroids( ids );
+}
+
+//-----------------------------------------------------------------------------
+//  Queries
+//-----------------------------------------------------------------------------
+
+void VectorfieldKMeans::getCentroidPosition( int c, double pos[3] ) const
+{
+	pos[0] = m_cx[c];
+	pos[1] = m_cy[c];
+	pos[2] = m_cz[c];
+}
+
+void VectorfieldKMeans::getCentroidDirection( int c, double dir[3] ) const
+{
+	dir[0] = m_cu[c];
+	dir[1] = m_cv[c];
+	dir[2] = m_ct[c];
+}
+
+double VectorfieldKMeans::distance( int i, int c ) const
+{
+	// |d| = 1 for centroids
+	return m_len[i] * sqrt( featureDistance2( i, c ) );
+}
+
+//-----------------------------------------------------------------------------
+//  Assignment
+//-----------------------------------------------------------------------------
+
+void VectorfieldKMeans::computeSeparation()
+{
+	int k = getNumberOfCentroids();
+
+	#pragma omp parallel for schedule(static)
+	for( int c=0; c < k; c++ )
+	{
+		double best = DBL_MAX;
+		for( int c2=0; c2 < k; c2++ )
+		{
+			if( c2 == c ) continue;
+			double dx = m_cx[c] - m_cx[c2],
+			       dy = m_cy[c] - m_cy[c2],
+			       dz = m_cz[c] - m_cz[c2],
+			       du = m_cu[c] - m_cu[c2],
+			       dv = m_cv[c] - m_cv[c2],
+			       dt = m_ct[c] - m_ct[c2];
+			double d2 = m_w*(dx*dx + dy*dy + dz*dz) + 0.5*(du*du + dv*dv + dt*dt);
+			best = std::min( best, d2 );
+		}
+		m_halfSep[c] = (best < DBL_MAX) ? 0.5*sqrt( best ) : DBL_MAX;
+	}
+}
+
+int VectorfieldKMeans::findNearest( int i, double* dist,
+                                    double& best2, double& second2 ) const
+{
+	int k = getNumberOfCentroids();
+	const double* cx = &m_cx[0];
+	const double* cy = &m_cy[0];
+	const double* cz = &m_cz[0];
+	const double* cu = &m_cu[0];
+	const double* cv = &m_cv[0];
+	const double* ct = &m_ct[0];
+	const double w = m_w;
+
+	// Distances to all centroids, this loop vectorizes
+	double x = m_x[i], y = m_y[i], z = m_z[i],
+	       u = m_u[i], v = m_v[i], t = m_t[i];
+	for( int c=0; c < k; c++ )
+	{
+		double dx = x - cx[c], dy = y - cy[c], dz = z - cz[c],
+		       du = u - cu[c], dv = v - cv[c], dt = t - ct[c];
+		dist[c] = w*(dx*dx + dy*dy + dz*dz) + 0.5*(du*du + dv*dv + dt*dt);
+	}
+
+	int best = 0;
+	best2 = second2 = DBL_MAX;
+	for( int c=0; c < k; c++ )
+		if( dist[c] < best2 )
+		{
+			second2 = best2;
+			best2   = dist[c];
+			best    = c;
+		}
+		else
+		if( dist[c] < second2 )
+			second2 = dist[c];
+
+	return best;
+}
+
+void VectorfieldKMeans::assign()
+{
+	int n = getNumberOfSamples();
+	int k = getNumberOfCentroids();
+	m_numEvaluations = 0;
+	m_numReassigned  = 0;
+	if( n==0 || k==0 )
+		return;
+
+	if( !m_boundsValid )
+		resetBounds();
+	computeSeparation();
+
+	int numEvaluations = 0,
+	    numReassigned  = 0;
+
+	#pragma omp parallel reduction(+:numEvaluations,numReassigned)
+	{
+		std::vector<double> dist( k );
+
+		#pragma omp for schedule(dynamic,1024)
+		for( int i=0; i < n; i++ )
+		{
+			int a = m_label[i];
+			if( a >= 0 )
+			{
+				// Hamerly's test: nearest centroid can not have changed if
+				// upper bound is below lower bound or half separation
+				double m = std::max( m_halfSep[a], m_lower[i] );
+				if( m_upper[i] <= m )
+					continue;
+
+				// Tighten upper bound and test again
+				m_upper[i] = sqrt( featureDistance2( i, a ) );
+				numEvaluations++;
+				if( m_upper[i] <= m )
+					continue;
+			}
+
+			double best2, second2;
+			int best = findNearest( i, &dist[0], best2, second2 );
+			numEvaluations += k;
+
+			if( best != a )
+				numReassigned++;
+			m_label[i] = best;
+			m_upper[i] = sqrt( best2 );
+			m_lower[i] = (second2 < DBL_MAX) ? sqrt( second2 ) : DBL_MAX;
+		}
+	}
+
+	m_numEvaluations = numEvaluations;
+	m_numReassigned  = numReassigned;
+}
+
+//-----------------------------------------------------------------------------
+//  Update
+//-----------------------------------------------------------------------------
+
+double VectorfieldKMeans::update()
+{
+	int n = getNumberOfSamples();
+	int k = getNumberOfCentroids();
+	m_numEmpty = 0;
+	if( n==0 || k==0 )
+		return 0.0;
+
+	// Per cluster accumulators: count, position weight, weighted position,
+	// direction weighted by squared length (i.e. sum of |v| v)
+	enum { Count, Weight, PX, PY, PZ, VX, VY, VZ, NumSums };
+	bool uniform = (m_weighting == UniformPositionWeights);
+
+	// Thread local sums are reduced in fixed order for reproducible results
+	int numThreads = 1;
+#ifdef _OPENMP
+	numThreads = omp_get_max_threads();
+#endif
+	std::vector<double> threadSums( (size_t)numThreads*NumSums*k, 0.0 );
+
+	#pragma omp parallel num_threads(numThreads)
+	{
+		int thread = 0;
+	#ifdef _OPENMP
+		thread = omp_get_thread_num();
+	#endif
+		double* local = &threadSums[ (size_t)thread*NumSums*k ];
+
+		#pragma omp for schedule(static)
+		for( int i=0; i < n; i++ )
+		{
+			int c = m_label[i];
+			if( c < 0 ) continue;
+
+			double len2 = m_len[i]*m_len[i];
+			double pw = uniform ? 1.0 : len2;
+			double* s = &local[NumSums*c];
+			s[Count ] += 1.0;
+			s[Weight] += pw;
+			s[PX] += pw*m_x[i];
+			s[PY] += pw*m_y[i];
+			s[PZ] += pw*m_z[i];
+			s[VX] += len2*m_u[i];
+			s[VY] += len2*m_v[i];
+			s[VZ] += len2*m_t[i];
+		}
+	}
+
+	std::vector<double> sums( threadSums.begin(), threadSums.begin()+NumSums*k );
+	for( int thread=1; thread < numThreads; thread++ )
+		for( int j=0; j < NumSums*k; j++ )
+			sums[j] += threadSums[ (size_t)thread*NumSums*k + j ];
+
+	// Move centroids
+	std::vector<double> shift( k, 0.0 );
+	std::vector<int> empty;
+	double sumDisplacement = 0.0;
+	for( int c=0; c < k; c++ )
+	{
+		const double* s = &sums[NumSums*c];
+		m_count[c] = (int)s[Count];
+		if( m_count[c] == 0 )
+		{
+			empty.push_back( c );
+			continue;
+		}
+
+		double px = m_cx[c], py = m_cy[c], pz = m_cz[c],
+		       pu = m_cu[c], pv = m_cv[c], pt = m_ct[c];
+
+		// Keep previous position resp. direction if weights vanish
+		if( s[Weight] > 0.0 )
+		{
+			m_cx[c] = s[PX] / s[Weight];
+			m_cy[c] = s[PY] / s[Weight];
+			m_cz[c] = s[PZ] / s[Weight];
+		}
+		double norm = sqrt( s[VX]*s[VX] + s[VY]*s[VY] + s[VZ]*s[VZ] );
+		if( norm > 0.0 )
+		{
+			m_cu[c] = s[VX] / norm;
+			m_cv[c] = s[VY] / norm;
+			m_ct[c] = s[VZ] / norm;
+		}
+
+		double dx = m_cx[c]-px, dy = m_cy[c]-py, dz = m_cz[c]-pz,
+		       du = m_cu[c]-pu, dv = m_cv[c]-pv, dt = m_ct[c]-pt;
+		double d2 = dx*dx + dy*dy + dz*dz;
+		sumDisplacement += sqrt( d2 );
+		shift[c] = sqrt( m_w*d2 + 0.5*(du*du + dv*dv + dt*dt) );
+	}
+
+	// Re-seed empty clusters with the samples farthest from their centroid
+	m_numEmpty = (int)empty.size();
+	if( !empty.empty() )
+	{
+		std::vector< std::pair<double,int> > farthest( n );
+		for( int i=0; i < n; i++ )
+			farthest[i] = std::make_pair( -m_upper[i], i );
+
+		int numSeeds = std::min( (int)empty.size(), n );
+		std::partial_sort( farthest.begin(), farthest.begin()+numSeeds, farthest.end() );
+
+		for( int j=0; j < numSeeds; j++ )
+		{
+			int c = empty[j],
+			    i = farthest[j].second;
+			double dx = m_x[i]-m_cx[c], dy = m_y[i]-m_cy[c], dz = m_z[i]-m_cz[c];
+			sumDisplacement += sqrt( dx*dx + dy*dy + dz*dz );
+			shift[c] = sqrt( featureDistance2( i, c ) );
+
+			m_cx[c] = m_x[i];  m_cy[c] = m_y[i];  m_cz[c] = m_z[i];
+			m_cu[c] = m_u[i];  m_cv[c] = m_v[i];  m_ct[c] = m_t[i];
+		}
+	}
+
+	// Update bounds by centroid movement (triangle inequality)
+	int    maxIdx = 0;
+	double maxShift = 0.0, maxShift2 = 0.0;
+	for( int c=0; c < k; c++ )
+		if( shift[c] > maxShift )
+		{
+			maxShift2 = maxShift;
+			maxShift  = shift[c];
+			maxIdx    = c;
+		}
+		else
+		if( shift[c] > maxShift2 )
+			maxShift2 = shift[c];
+
+	#pragma omp parallel for schedule(static)
+	for( int i=0; i < n; i++ )
+	{
+		int a = m_label[i];
+		if( a < 0 ) continue;
+		m_upper[i] += shift[a];
+		if( m_lower[i] < DBL_MAX )
+			m_lower[i] -= (a == maxIdx) ? maxShift2 : maxShift;
+	}
+
+	return sumDisplacement;
+}
+
+//-----------------------------------------------------------------------------
+//  Mini-batch
+//-----------------------------------------------------------------------------
+
+double VectorfieldKMeans::iterateMiniBatch( int batchSize )
+{
+	int n = getNumberOfSamples();
+	int k = getNumberOfCentroids();
+	m_numEvaluations = 0;
+	m_numReassigned  = 0;
+	m_numEmpty       = 0;
+	if( n==0 || k==0 || batchSize <= 0 )
+		return 0.0;
+
+	// Draw batch (with replacement)
+	boost::variate_generator< boost::mt19937&, boost::uniform_int<> >
+		draw( m_rng, boost::uniform_int<>( 0, n-1 ) );
+	std::vector<int> batch( batchSize );
+	for( int j=0; j < batchSize; j++ )
+		batch[j] = draw();
+
+	// Assign batch w.r.t. fixed centroids
+	std::vector<int> nearest( batchSize );
+	#pragma omp parallel
+	{
+		std::vector<double> dist( k );
+		#pragma omp for schedule(static)
+		for( int j=0; j < batchSize; j++ )
+		{
+			double best2, second2;
+			nearest[j] = findNearest( batch[j], &dist[0], best2, second2 );
+		}
+	}
+	m_numEvaluations = batchSize * k;
+
+	// Incremental centroid update in batch order (deterministic)
+	std::vector<double> px( m_cx ), py( m_cy ), pz( m_cz );
+	bool uniform = (m_weighting == UniformPositionWeights);
+	for( int j=0; j < batchSize; j++ )
+	{
+		int i = batch[j],
+		    c = nearest[j];
+
+		double len2 = m_len[i]*m_len[i];
+		double pw = uniform ? 1.0 : len2;
+		if( pw > 0.0 )
+		{
+			m_mbWeight[c] += pw;
+			double eta = pw / m_mbWeight[c];
+			m_cx[c] += eta*(m_x[i] - m_cx[c]);
+			m_cy[c] += eta*(m_y[i] - m_cy[c]);
+			m_cz[c] += eta*(m_z[i] - m_cz[c]);
+		}
+
+		// Direction is the normalized sum of |v| v
+		double* d = &m_mbDir[3*c];
+		d[0] += len2*m_u[i];
+		d[1] += len2*m_v[i];
+		d[2] += len2*m_t[i];
+		double norm = sqrt( d[0]*d[0] + d[1]*d[1] + d[2]*d[2] );
+		if( norm > 0.0 )
+		{
+			m_cu[c] = d[0] / norm;
+			m_cv[c] = d[1] / norm;
+			m_ct[c] = d[2] / norm;
+		}
+	}
+
+	double sumDisplacement = 0.0;
+	for( int c=0; c < k; c++ )
+	{
+		double dx = m_cx[c]-px[c], dy = m_cy[c]-py[c], dz = m_cz[c]-pz[c];
+		sumDisplacement += sqrt( dx*dx + dy*dy + dz*dz );
+	}
+
+	// Centroids moved without bound maintenance
+	m_boundsValid = false;
+
+	return sumDisplacement;
+}
+
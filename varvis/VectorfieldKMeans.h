@@ -0,0 +1,174 @@
+#ifndef VECTORFIELDKMEANS_H
+#define VECTORFIELDKMEANS_H
+
+#include <vector>
+#include <boost/random/mersenne_twister.hpp>
+
+//-----------------------------------------------------------------------------
+//  VectorfieldKMeans
+//-----------------------------------------------------------------------------
+/**
+	k-means engine for position+direction clustering of vector samples.
+
+	The distance between a sample (x,v) and a centroid (c,d) is the one of
+	[Du2004] as used by \a VectorfieldClustering:
+	\verbatim
+	  D = |v| |d| sqrt( 1 - cos(v,d) + w |x-c|^2 )
+	\endverbatim
+	Centroid directions are kept normalized, i.e. |d|=1, and the factor |v|
+	does not influence the assignment of a sample. For unit directions it
+	holds 1 - cos(v,d) = |v/|v| - d|^2 / 2, so the square root term is the
+	Euclidean distance of 6D feature points (sqrt(w) x, v/(sqrt(2)|v|)).
+	This allows to prune most sample-centroid distance evaluations after
+	the first iterations via the triangle inequality bounds of [Hamerly2010].
+
+	Samples and centroids are stored as contiguous arrays (structure of
+	arrays) such that the exhaustive nearest centroid search vectorizes.
+	Assignment and update steps are parallelized via OpenMP if available.
+
+	For very large sample sets centroids can be seeded by k-means++
+	[Arthur2007] and refined by mini-batch iterations [Sculley2010] whose
+	cost only depends on the batch size. All random choices are drawn from
+	a generator with fixed seed (see \a setSeed()), so results are
+	reproducible.
+
+	[Hamerly2010] Hamerly, Greg. "Making k-means even faster."
+	SIAM International Conference on Data Mining, 2010.
+
+	[Arthur2007] Arthur, David, and Sergei Vassilvitskii. "k-means++: The
+	advantages of careful seeding." ACM-SIAM Symposium on Discrete
+	Algorithms, 2007.
+
+	[Sculley2010] Sculley, David. "Web-scale k-means clustering."
+	Proceedings of the 19th International Conference on World Wide Web, 2010.
+*/
+class VectorfieldKMeans
+{
+public:
+	enum PositionWeighting
+	{
+		UniformPositionWeights,      ///< centroid position is plain mean
+		SquaredLengthPositionWeights ///< mean weighted by squared vector length
+	};
+
+	VectorfieldKMeans();
+
+	///@{ Sample setup, invalidates centroids
+	void setNumberOfSamples( int n );
+	void setSample( int i, const double pos[3], const double vec[3] );
+	int  getNumberOfSamples() const { return (int)m_x.size(); }
+	///@}
+
+	/// Weight w of squared position distance in the metric (see above)
+	void   setPositionWeight( double w );
+	double getPositionWeight() const { return m_w; }
+
+	/// Weighting of sample positions in centroid update (default uniform),
+	/// centroid directions are always weighted by squared vector length.
+	void setPositionWeighting( PositionWeighting pw ) { m_weighting = pw; }
+	PositionWeighting getPositionWeighting() const { return m_weighting; }
+
+	/// Initialize centroids to the given samples
+	void setInitialCentroids( const std::vector<int>& sampleIds );
+	int  getNumberOfCentroids() const { return (int)m_cx.size(); }
+
+	/// Re-seed random generator used by \a seedPlusPlus() and mini-batches
+	void setSeed( unsigned seed ) { m_rng.seed( seed ); }
+
+	/// Initialize k centroids by k-means++ seeding on a random subset of at
+	/// most \a maxSamples samples (0 = all samples).
+	void seedPlusPlus( int k, int maxSamples=0 );
+
+	/// Assign each sample to its nearest centroid
+	void assign();
+
+	/// Move centroids to the weighted mean of their clusters and re-seed
+	/// empty clusters. Returns sum of centroid position displacements.
+	double update();
+
+	/// Single Lloyd iteration, i.e. \a assign() followed by \a update()
+	double iterate() { assign(); return update(); }
+
+	/// Mini-batch iteration: assign \a batchSize random samples and move each
+	/// centroid towards its samples with a per-centroid learning rate of
+	/// 1/(accumulated weight). Sample labels are not updated, call \a assign()
+	/// after the last iteration. Returns sum of centroid position displacements.
+	double iterateMiniBatch( int batchSize );
+
+	///@{ Results
+	int  getLabel( int i ) const { return m_label[i]; }
+	const std::vector<int>& getLabels() const { return m_label; }
+	int  getClusterSize( int c ) const { return m_count[c]; }
+	void getCentroidPosition ( int c, double pos[3] ) const;
+	void getCentroidDirection( int c, double dir[3] ) const;
+	///@}
+
+	/// Distance between sample i and centroid c according to [Du2004]
+	double distance( int i, int c ) const;
+
+	///@{ Statistics of last assignment resp. update step
+	int getNumDistanceEvaluations() const { return m_numEvaluations; }
+	int getNumReassigned()          const { return m_numReassigned; }
+	int getNumEmptyClusters()       const { return m_numEmpty; }
+	///@}
+
+protected:
+	/// Squared 6D feature distance between sample i and centroid c
+	double featureDistance2( int i, int c ) const
+	{
+		double dx = m_x[i] - m_cx[c],
+		       dy = m_y[i] - m_cy[c],
+		       dz = m_z[i] - m_cz[c],
+		       du = m_u[i] - m_cu[c],
+		       dv = m_v[i] - m_cv[c],
+		       dt = m_t[i] - m_ct[c];
+		return m_w*(dx*dx + dy*dy + dz*dz) + 0.5*(du*du + dv*dv + dt*dt);
+	}
+
+	/// Compute half distance of each centroid to its nearest other centroid
+	void computeSeparation();
+
+	/// Force exhaustive search for all samples in next assignment
+	void resetBounds();
+
+	/// Exhaustive nearest centroid search, dist is scratch memory of size k.
+	/// Returns nearest centroid and squared feature distances to the nearest
+	/// and the second nearest centroid.
+	int findNearest( int i, double* dist, double& best2, double& second2 ) const;
+
+	/// Reset mini-batch accumulators
+	void resetMiniBatch();
+
+private:
+	// Samples (SoA)
+	std::vector<double> m_x, m_y, m_z;   // position
+	std::vector<double> m_u, m_v, m_t;   // normalized direction
+	std::vector<double> m_len;           // vector length
+
+	// Centroids (SoA)
+	std::vector<double> m_cx, m_cy, m_cz;
+	std::vector<double> m_cu, m_cv, m_ct;
+	std::vector<int>    m_count;
+	std::vector<double> m_halfSep;
+
+	// Assignment and Hamerly bounds on distance to assigned centroid (upper)
+	// and to second nearest centroid (lower) in 6D feature space
+	std::vector<int>    m_label;
+	std::vector<double> m_upper, m_lower;
+
+	// Mini-batch accumulated position weight and direction per centroid
+	std::vector<double> m_mbWeight;
+	std::vector<double> m_mbDir;
+
+	double m_w;
+	PositionWeighting m_weighting;
+	bool m_boundsValid;
+
+	boost::mt19937 m_rng;
+
+	int m_numEvaluations;
+	int m_numReassigned;
+	int m_numEmpty;
+};
+
+#endif // VECTORFIELDKMEANS_H